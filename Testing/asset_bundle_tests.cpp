@@ -0,0 +1,226 @@
+#include <bugspray/bugspray.hpp>
+#include "core/asset_bundle.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace forma;
+
+namespace {
+
+// Scratch project on disk; assets are mapped from real files
+struct TempProject {
+    std::filesystem::path root;
+
+    TempProject() {
+        root = std::filesystem::temp_directory_path() /
+               ("forma_asset_bundle_" + std::to_string(::getpid()));
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root / "assets");
+    }
+
+    ~TempProject() { std::filesystem::remove_all(root); }
+
+    void write(const std::string& relative, const std::string& contents) const {
+        std::ofstream(root / relative, std::ios::binary) << contents;
+    }
+};
+
+// Bytes of the hex array following `symbol` in generated C
+std::string decode_array(const std::string& source, const std::string& symbol) {
+    size_t start = source.find("char " + symbol + "[");
+    size_t open = source.find('{', start);
+    size_t close = source.find("};", open);
+    std::string bytes;
+    for (size_t i = source.find("0x", open); i < close; i = source.find("0x", i + 4)) {
+        bytes += static_cast<char>(std::stoi(source.substr(i + 2, 2), nullptr, 16));
+    }
+    return bytes;
+}
+
+// 2x1 24-bit BMP: red, blue
+std::string tiny_bmp() {
+    std::string file(54 + 8, '\0');
+    auto put32 = [&](size_t at, uint32_t v) {
+        for (int i = 0; i < 4; ++i) file[at + i] = static_cast<char>(v >> (i * 8));
+    };
+    file[0] = 'B';
+    file[1] = 'M';
+    put32(2, static_cast<uint32_t>(file.size()));
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, 2);
+    put32(22, 1);
+    file[26] = 1;
+    file[28] = 24;
+    file[56] = static_cast<char>(0xFF);  // B, G, R
+    file[57] = static_cast<char>(0xFF);
+    return file;
+}
+
+} // namespace
+
+TEST_CASE("Asset bundle") {
+    TempProject project;
+    fs::MemoryFileSystem out;
+
+    std::string logo;
+    for (int i = 0; i < 1000; ++i) {
+        logo += static_cast<char>(i * 37);
+    }
+    project.write("assets/logo.png", logo);
+    project.write("assets/logo_copy.png", logo);
+    project.write("assets/font.ttf", std::string(300, 'F'));
+
+    AssetBundleOptions options;
+    options.output_prefix = "/gen/forma_assets";
+
+    SECTION("Bytes are written as C arrays with their sizes") {
+        std::vector<std::string> uris = {"forma://assets/logo.png", "forma://assets/font.ttf"};
+        auto result = bundle_assets(uris, project.root.string(), options, out);
+
+        CHECK(result.errors.empty());
+        REQUIRE(result.outputs.size() == 1ul);
+        std::string source = out.read_file("/gen/forma_assets_0.c");
+        CHECK(decode_array(source, "asset_assets_logo_png") == logo);
+        CHECK(decode_array(source, "asset_assets_font_ttf") == std::string(300, 'F'));
+        CHECK(source.find("const unsigned int asset_assets_logo_png_size = 1000;") != std::string::npos);
+        CHECK(result.assets[0].size == 1000ul);
+    }
+
+    SECTION("Identical files are stored once") {
+        std::vector<std::string> uris = {"forma://assets/logo.png", "forma://assets/logo_copy.png"};
+        auto result = bundle_assets(uris, project.root.string(), options, out);
+
+        REQUIRE(result.assets.size() == 2ul);
+        CHECK(result.assets[1].canonical == 0ul);
+        CHECK(result.unique_bytes == 1000ul);
+        std::string source = out.read_file("/gen/forma_assets_0.c");
+        CHECK(source.find("asset_assets_logo_copy_png[1000] __attribute__((alias(\"asset_assets_logo_png\")))") !=
+              std::string::npos);
+        CHECK(source.find("asset_assets_logo_copy_png_size = 1000;") != std::string::npos);
+    }
+
+    SECTION("Assets are split across translation units by size") {
+        options.chunk_size = 1000;
+        std::vector<std::string> uris = {"forma://assets/font.ttf", "forma://assets/logo.png",
+                                         "forma://assets/logo_copy.png"};
+        auto result = bundle_assets(uris, project.root.string(), options, out);
+
+        REQUIRE(result.outputs.size() == 2ul);
+        CHECK(result.assets[0].unit == 0ul);
+        CHECK(result.assets[1].unit == 1ul);
+        CHECK(result.assets[2].unit == 1ul);  // Alias stays with its canonical copy
+        CHECK(out.read_file("/gen/forma_assets_1.c").find("asset_assets_logo_copy_png") != std::string::npos);
+
+        // A smaller bundle empties the unit it no longer needs
+        options.chunk_size = 1 << 20;
+        bundle_assets(uris, project.root.string(), options, out);
+        CHECK(out.read_file("/gen/forma_assets_1.c").find("asset_") == std::string::npos);
+    }
+
+    SECTION(".incbin and #embed reference the file instead of encoding it") {
+        std::vector<std::string> uris = {"forma://assets/logo.png", "forma://assets/logo_copy.png"};
+        std::string path = (project.root / "assets/logo.png").string();
+
+        options.mode = AssetEmbedMode::Incbin;
+        bundle_assets(uris, project.root.string(), options, out);
+        std::string source = out.read_file("/gen/forma_assets_0.c");
+        CHECK(source.find(".incbin \\\"" + path + "\\\"") != std::string::npos);
+        CHECK(source.find("\"asset_assets_logo_copy_png:\\n\"") != std::string::npos);
+        CHECK(source.find("0x") == std::string::npos);
+
+        options.mode = AssetEmbedMode::Embed;
+        bundle_assets(uris, project.root.string(), options, out);
+        source = out.read_file("/gen/forma_assets_0.c");
+        CHECK(source.find("#embed \"" + path + "\"") != std::string::npos);
+    }
+
+    SECTION("Unchanged bundles are not rewritten") {
+        options.stamp_path = "/gen/.forma/asset-bundle";
+        std::vector<std::string> uris = {"forma://assets/logo.png"};
+        CHECK(bundle_assets(uris, project.root.string(), options, out).written);
+        CHECK(!bundle_assets(uris, project.root.string(), options, out).written);
+
+        project.write("assets/logo.png", "changed");
+        auto result = bundle_assets(uris, project.root.string(), options, out);
+        CHECK(result.written);
+        CHECK(decode_array(out.read_file("/gen/forma_assets_0.c"), "asset_assets_logo_png") == "changed");
+    }
+
+    SECTION("Unchanged images are not decoded again") {
+        project.write("assets/tiny.bmp", tiny_bmp());
+        options.stamp_path = "/gen/.forma/asset-bundle";
+        options.image_format = image::ImageFormat::RGB565;
+        std::vector<std::string> uris = {"forma://assets/tiny.bmp"};
+        auto first = bundle_assets(uris, project.root.string(), options, out);
+        REQUIRE(first.written);
+        CHECK(first.converted == 1ul);
+        CHECK(!first.assets[0].descriptor.data.empty());
+
+        auto second = bundle_assets(uris, project.root.string(), options, out);
+        CHECK(!second.written);
+        CHECK(second.assets[0].descriptor.data.empty());
+        CHECK(second.converted == 1ul);
+        CHECK(second.unique_bytes == first.unique_bytes);
+        CHECK(second.outputs == first.outputs);
+
+        // A different color format is a different bundle
+        options.image_format = image::ImageFormat::ARGB8888;
+        CHECK(bundle_assets(uris, project.root.string(), options, out).written);
+    }
+
+    SECTION("Images too large for LVGL are embedded without decoding") {
+        // PNG signature and an IHDR claiming 70000 x 1
+        std::string huge("\x89PNG\r\n\x1a\n\0\0\0\x0dIHDR\0\x01\x11\x70\0\0\0\x01\x08\x06\0\0\0", 29);
+        project.write("assets/huge.png", huge);
+        options.image_format = image::ImageFormat::RGB565;
+        std::vector<std::string> uris = {"forma://assets/huge.png"};
+        auto result = bundle_assets(uris, project.root.string(), options, out);
+        CHECK(result.converted == 0ul);
+        REQUIRE(result.warnings.size() == 1ul);
+        CHECK(result.warnings[0].find("too large for an LVGL image header") != std::string::npos);
+    }
+
+    SECTION("Images get an LVGL image descriptor") {
+        std::vector<std::string> uris = {"forma://assets/logo.png", "forma://assets/logo_copy.png",
+                                         "forma://assets/font.ttf"};
+        bundle_assets(uris, project.root.string(), options, out);
+        std::string source = out.read_file("/gen/forma_assets_0.c");
+        CHECK(source.find("#include \"lvgl.h\"") != std::string::npos);
+        CHECK(source.find("const lv_image_dsc_t asset_assets_logo_png_dsc = {") != std::string::npos);
+        CHECK(source.find(".header.cf = LV_COLOR_FORMAT_RAW,") != std::string::npos);
+        CHECK(source.find(".data = asset_assets_logo_png,") != std::string::npos);
+        CHECK(source.find("asset_assets_logo_copy_png_dsc __attribute__((alias(\"asset_assets_logo_png_dsc\")))") !=
+              std::string::npos);
+        CHECK(source.find("asset_assets_font_ttf_dsc") == std::string::npos);
+    }
+
+    SECTION("Images are converted to the configured color format") {
+        project.write("assets/tiny.bmp", tiny_bmp());
+        options.mode = AssetEmbedMode::Incbin;
+        options.image_format = image::ImageFormat::RGB565;
+        std::vector<std::string> uris = {"forma://assets/tiny.bmp", "forma://assets/logo.png"};
+        auto result = bundle_assets(uris, project.root.string(), options, out);
+
+        CHECK(result.converted == 1ul);
+        CHECK(result.warnings.size() == 1ul);  // logo.png is not a real PNG
+        CHECK(result.assets[0].size == 4ul);
+        std::string source = out.read_file("/gen/forma_assets_0.c");
+        // Converted pixels are encoded even in incbin mode
+        CHECK(decode_array(source, "asset_assets_tiny_bmp") == std::string("\x00\xf8\x1f\x00", 4));
+        CHECK(source.find(".header.cf = LV_COLOR_FORMAT_RGB565,") != std::string::npos);
+        CHECK(source.find(".header.w = 2,") != std::string::npos);
+        CHECK(source.find(".header.stride = 4,") != std::string::npos);
+        CHECK(source.find(".incbin") != std::string::npos);
+        CHECK(source.find("extern const unsigned char asset_assets_logo_png[];") != std::string::npos);
+    }
+
+    SECTION("Missing files are reported") {
+        std::vector<std::string> uris = {"forma://assets/missing.png", "forma://assets/font.ttf"};
+        auto result = bundle_assets(uris, project.root.string(), options, out);
+        CHECK(result.errors.size() == 1ul);
+        CHECK(result.assets.size() == 1ul);
+    }
+}
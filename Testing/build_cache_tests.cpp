@@ -0,0 +1,87 @@
+#include <bugspray/bugspray.hpp>
+#include "core/build_cache.hpp"
+
+using namespace forma;
+
+TEST_CASE("Build cache tracks sources, imports and toolchain") {
+    fs::MemoryFileSystem mfs;
+    mfs.write_file("/proj/src/main.fml", "Button {}");
+    mfs.write_file("/proj/src/main.c", "// generated");
+    mfs.write_file("/proj/src/theme.fml", "enum Theme { Dark }");
+
+    uint64_t toolchain = BuildCache::toolchain_hash("lvgl", 0x1234);
+    uint64_t key = BuildCache::source_key("Button {}", toolchain);
+
+    {
+        BuildCache cache(mfs, "/proj/.forma/build-cache");
+        cache.load();
+        CHECK(!cache.is_fresh("/proj/src/main.fml", key));
+
+        BuildCacheEntry entry{key, "/proj/src/main.c", {}, {}, {}, {}};
+        entry.deps.emplace_back("/proj/src/theme.fml", fnv1a_hash("enum Theme { Dark }"));
+        cache.record("/proj/src/main.fml", std::move(entry));
+        cache.save();
+    }
+
+    SECTION("Unchanged inputs are fresh after reload") {
+        BuildCache cache(mfs, "/proj/.forma/build-cache");
+        cache.load();
+        CHECK(cache.size() == 1ul);
+        CHECK(cache.is_fresh("/proj/src/main.fml", key));
+    }
+
+    SECTION("Source or renderer changes invalidate") {
+        BuildCache cache(mfs, "/proj/.forma/build-cache");
+        cache.load();
+        CHECK(!cache.is_fresh("/proj/src/main.fml", BuildCache::source_key("Button { }", toolchain)));
+        uint64_t other_toolchain = BuildCache::toolchain_hash("lvgl", 0x5678);
+        CHECK(!cache.is_fresh("/proj/src/main.fml", BuildCache::source_key("Button {}", other_toolchain)));
+    }
+
+    SECTION("Import changes invalidate") {
+        mfs.write_file("/proj/src/theme.fml", "enum Theme { Light }");
+        BuildCache cache(mfs, "/proj/.forma/build-cache");
+        cache.load();
+        CHECK(!cache.is_fresh("/proj/src/main.fml", key));
+    }
+
+    SECTION("Asset references survive reload") {
+        BuildCache cache(mfs, "/proj/.forma/build-cache");
+        cache.load();
+        BuildCacheEntry entry = *cache.find("/proj/src/main.fml");
+        entry.assets = {"forma://assets/logo.png", "forma://assets/font.ttf"};
+        cache.record("/proj/src/main.fml", std::move(entry));
+        cache.save();
+
+        BuildCache reloaded(mfs, "/proj/.forma/build-cache");
+        reloaded.load();
+        REQUIRE(reloaded.find("/proj/src/main.fml") != nullptr);
+        CHECK(reloaded.find("/proj/src/main.fml")->assets.size() == 2ul);
+        CHECK(reloaded.find("/proj/src/main.fml")->assets[1] == "forma://assets/font.ttf");
+        CHECK(reloaded.find("/proj/src/other.fml") == nullptr);
+    }
+
+    SECTION("Glyphs and font selections survive reload") {
+        BuildCache cache(mfs, "/proj/.forma/build-cache");
+        cache.load();
+        BuildCacheEntry entry = *cache.find("/proj/src/main.fml");
+        entry.glyphs = "Ok \xc3\xa9";
+        entry.fonts = {{"forma://assets/font.ttf", 24}};
+        cache.record("/proj/src/main.fml", std::move(entry));
+        cache.save();
+
+        BuildCache reloaded(mfs, "/proj/.forma/build-cache");
+        reloaded.load();
+        REQUIRE(reloaded.find("/proj/src/main.fml") != nullptr);
+        CHECK(reloaded.find("/proj/src/main.fml")->glyphs == "Ok \xc3\xa9");
+        REQUIRE(reloaded.find("/proj/src/main.fml")->fonts.size() == 1ul);
+        CHECK(reloaded.find("/proj/src/main.fml")->fonts[0].second == 24);
+    }
+
+    SECTION("Unknown cache format is ignored") {
+        mfs.write_file("/proj/.forma/build-cache", "something else\nS\ta\tb\tc\n");
+        BuildCache cache(mfs, "/proj/.forma/build-cache");
+        cache.load();
+        CHECK(cache.size() == 0ul);
+    }
+}
@@ -0,0 +1,284 @@
+#include <bugspray/bugspray.hpp>
+#include "core/font_atlas.hpp"
+#include "parser/parser.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace forma;
+
+namespace {
+
+struct TempProject {
+    std::filesystem::path root;
+
+    TempProject() {
+        root = std::filesystem::temp_directory_path() / ("forma_font_atlas_" + std::to_string(::getpid()));
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root / "assets");
+    }
+
+    ~TempProject() { std::filesystem::remove_all(root); }
+
+    void write(const std::string& relative, const std::vector<uint8_t>& contents) const {
+        std::ofstream(root / relative, std::ios::binary)
+            .write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+    }
+};
+
+struct Bytes {
+    std::vector<uint8_t> data;
+    void u16(int v) {
+        data.push_back(static_cast<uint8_t>(v >> 8));
+        data.push_back(static_cast<uint8_t>(v));
+    }
+    void u32(uint32_t v) {
+        u16(static_cast<int>(v >> 16));
+        u16(static_cast<int>(v & 0xFFFF));
+    }
+};
+
+// Simple glyph of on-curve (or all off-curve) points with int16 deltas
+std::vector<uint8_t> simple_glyph(const std::vector<std::pair<int, int>>& points, bool on_curve) {
+    Bytes g;
+    g.u16(1);
+    g.u16(0), g.u16(0), g.u16(700), g.u16(700);
+    g.u16(static_cast<int>(points.size()) - 1);
+    g.u16(0);  // No instructions
+    for (size_t i = 0; i < points.size(); ++i) {
+        g.data.push_back(on_curve ? 1 : 0);
+    }
+    int last = 0;
+    for (auto [x, y] : points) {
+        g.u16(x - last);
+        last = x;
+    }
+    last = 0;
+    for (auto [x, y] : points) {
+        g.u16(y - last);
+        last = y;
+    }
+    return g.data;
+}
+
+// 1000 units per em. 'A' (1) is the square 100..600 x 0..700, 'B' (2) is
+// 'A' moved right by 50 through a composite, 'O' (3) is an all off-curve
+// (rounded) square 0..700.
+std::vector<uint8_t> test_font() {
+    std::vector<std::vector<uint8_t>> glyphs = {
+        {},
+        simple_glyph({{100, 0}, {100, 700}, {600, 700}, {600, 0}}, true),
+        {},
+        simple_glyph({{0, 0}, {0, 700}, {700, 700}, {700, 0}}, false),
+    };
+    Bytes composite;
+    composite.u16(-1 & 0xFFFF);
+    composite.u16(150), composite.u16(0), composite.u16(650), composite.u16(700);
+    composite.u16(0x0003);  // ARGS_ARE_WORDS | ARGS_ARE_XY
+    composite.u16(1);
+    composite.u16(50), composite.u16(0);
+    glyphs[2] = composite.data;
+
+    Bytes glyf, loca;
+    for (auto& g : glyphs) {
+        loca.u16(static_cast<int>(glyf.data.size() / 2));
+        glyf.data.insert(glyf.data.end(), g.begin(), g.end());
+        if (glyf.data.size() % 2) glyf.data.push_back(0);
+    }
+    loca.u16(static_cast<int>(glyf.data.size() / 2));
+
+    Bytes head;
+    head.u32(0x00010000), head.u32(0x00010000), head.u32(0), head.u32(0x5F0F3CF5);
+    head.u16(0), head.u16(1000);
+    for (int i = 0; i < 16; ++i) head.u16(0);  // Dates
+    head.u16(0), head.u16(0), head.u16(700), head.u16(700);
+    head.u16(0), head.u16(8), head.u16(2);
+    head.u16(0);  // Short loca
+    head.u16(0);
+
+    Bytes hhea;
+    hhea.u32(0x00010000), hhea.u16(800), hhea.u16(-200 & 0xFFFF), hhea.u16(0);
+    for (int i = 0; i < 12; ++i) hhea.u16(0);
+    hhea.u16(4);
+
+    Bytes maxp;
+    maxp.u32(0x00005000), maxp.u16(4);
+
+    Bytes hmtx;
+    for (int advance : {500, 700, 750, 800}) hmtx.u16(advance), hmtx.u16(0);
+
+    // Format 4: A-B -> 1-2, O -> 3
+    Bytes cmap;
+    cmap.u16(0), cmap.u16(1), cmap.u16(3), cmap.u16(1), cmap.u32(12);
+    cmap.u16(4), cmap.u16(16 + 3 * 8), cmap.u16(0), cmap.u16(6), cmap.u16(0), cmap.u16(0), cmap.u16(0);
+    cmap.u16('B'), cmap.u16('O'), cmap.u16(0xFFFF), cmap.u16(0);
+    cmap.u16('A'), cmap.u16('O'), cmap.u16(0xFFFF);
+    cmap.u16((1 - 'A') & 0xFFFF), cmap.u16((3 - 'O') & 0xFFFF), cmap.u16(1);
+    cmap.u16(0), cmap.u16(0), cmap.u16(0);
+
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> tables = {
+        {"cmap", cmap.data}, {"glyf", glyf.data}, {"head", head.data}, {"hhea", hhea.data},
+        {"hmtx", hmtx.data}, {"loca", loca.data}, {"maxp", maxp.data},
+    };
+    Bytes font;
+    font.u32(0x00010000), font.u16(static_cast<int>(tables.size())), font.u16(0), font.u16(0), font.u16(0);
+    size_t offset = 12 + tables.size() * 16;
+    for (auto& [tag, data] : tables) {
+        font.data.insert(font.data.end(), tag.begin(), tag.end());
+        font.u32(0), font.u32(static_cast<uint32_t>(offset)), font.u32(static_cast<uint32_t>(data.size()));
+        offset += (data.size() + 3) & ~size_t{3};
+    }
+    for (auto& [tag, data] : tables) {
+        font.data.insert(font.data.end(), data.begin(), data.end());
+        font.data.resize((font.data.size() + 3) & ~size_t{3});
+    }
+    return font.data;
+}
+
+} // namespace
+
+TEST_CASE("TrueType fonts") {
+    auto bytes = test_font();
+    std::string error;
+    auto font = font::TrueTypeFont::parse(bytes, error);
+    REQUIRE(font.has_value());
+
+    SECTION("Header metrics and cmap lookups are read") {
+        CHECK(font->units_per_em == 1000);
+        CHECK(font->ascender == 800);
+        CHECK(font->descender == -200);
+        CHECK(font->glyph_index('A') == 1);
+        CHECK(font->glyph_index('B') == 2);
+        CHECK(font->glyph_index('O') == 3);
+        CHECK(font->glyph_index('C') == 0);
+        CHECK(font->glyph_index(0x1F600) == 0);
+        CHECK(font->advance_width(2) == 750);
+    }
+
+    SECTION("Glyphs rasterize with full coverage inside the outline") {
+        auto a = font->rasterize(1, 10);
+        CHECK(a.width == 5);
+        CHECK(a.height == 7);
+        CHECK(a.x_offset == 1);
+        CHECK(a.y_offset == 0);
+        bool solid = true;
+        for (auto coverage : a.coverage) solid = solid && coverage == 255;
+        CHECK(solid);
+    }
+
+    SECTION("Composite glyphs apply their component offsets") {
+        auto b = font->rasterize(2, 10);
+        CHECK(b.x_offset == 1);
+        CHECK(b.width == 6);
+        CHECK(b.coverage[0] > 100);
+        CHECK(b.coverage[0] < 155);
+        CHECK(b.coverage[2] == 255);
+    }
+
+    SECTION("Off-curve points make curves") {
+        auto o = font->rasterize(3, 20);
+        REQUIRE(o.width > 0);
+        size_t center = static_cast<size_t>(o.height / 2) * o.width + o.width / 2;
+        CHECK(o.coverage[center] == 255);
+        CHECK(o.coverage[0] < 64);
+    }
+
+    SECTION("CFF outlines and truncated fonts are rejected") {
+        auto cff = bytes;
+        cff[0] = 'O', cff[1] = 'T', cff[2] = 'T', cff[3] = 'O';
+        for (size_t i = 12; i < 12 + 7 * 16; i += 16) {
+            if (std::string(cff.begin() + i, cff.begin() + i + 4) == "glyf") cff[i] = 'x';
+        }
+        CHECK_FALSE(font::TrueTypeFont::parse(cff, error).has_value());
+        CHECK(error.find("CFF") != std::string::npos);
+
+        std::vector<uint8_t> truncated(bytes.begin(), bytes.begin() + 40);
+        CHECK_FALSE(font::TrueTypeFont::parse(truncated, error).has_value());
+    }
+}
+
+TEST_CASE("Font atlas") {
+    TempProject project;
+    project.write("assets/test.ttf", test_font());
+    fs::MemoryFileSystem out;
+
+    FontAtlasOptions options;
+    options.output_prefix = "/gen/forma_font";
+    options.cache_dir = "/cache";
+    options.manifest_path = "/state/fonts";
+
+    auto doc = parse_document_runtime(R"(
+Label {
+    text: "AB é"
+    font: "forma://assets/test.ttf"
+    font_size: 24
+}
+Label {
+    text: "O"
+    font: "forma://assets/test.ttf"
+}
+)");
+    FontUsage usage;
+    scan_font_usage(doc, usage);
+
+    SECTION("String literals and font selections are collected") {
+        CHECK(usage.code_points.count('A') == 1ul);
+        CHECK(usage.code_points.count(' ') == 1ul);
+        CHECK(usage.code_points.count(U'é') == 1ul);
+        CHECK(usage.code_points.count('f') == 0ul);  // forma:// URIs are not text
+        CHECK(usage.fonts.size() == 2ul);
+        CHECK(usage.fonts.count({"forma://assets/test.ttf", 24}) == 1ul);
+        CHECK(usage.fonts.count({"forma://assets/test.ttf", DEFAULT_FONT_SIZE}) == 1ul);
+    }
+
+    SECTION("Fonts are rasterized to LVGL bitmap fonts per size") {
+        auto result = build_font_atlases({}, usage, project.root.string(), options, out);
+        REQUIRE(result.warnings.empty());
+        REQUIRE(result.fonts.size() == 2ul);
+        CHECK(result.rasterized.size() == 1ul);
+
+        const auto& font = result.fonts[1];
+        CHECK(font.symbol == "asset_assets_test_ttf_24");
+        CHECK(font.output == "/gen/forma_font_assets_test_ttf_24.c");
+        CHECK(font.glyphs == 3ul);   // A, B, O
+        CHECK(font.missing == 2ul);  // Space and é
+        std::string source = out.read_file(font.output);
+        CHECK(source.find("const lv_font_t asset_assets_test_ttf_24 = {") != std::string::npos);
+        CHECK(source.find(".range_start = 65, .range_length = 15") != std::string::npos);
+        CHECK(source.find(".bpp = 4") != std::string::npos);
+        CHECK(source.find("/* U+0041 */") != std::string::npos);
+        CHECK(source.find(".adv_w = 269") != std::string::npos);  // 700 units at 24 px, 1/16 px
+    }
+
+    SECTION("Unchanged fonts come from the cache") {
+        build_font_atlases({}, usage, project.root.string(), options, out);
+        auto again = build_font_atlases({}, usage, project.root.string(), options, out);
+        REQUIRE(again.fonts.size() == 2ul);
+        CHECK(again.fonts[0].cached);
+        CHECK(again.fonts[1].cached);
+        CHECK(again.fonts[1].glyphs == 3ul);
+
+        usage.code_points.insert('Z');
+        auto changed = build_font_atlases({}, usage, project.root.string(), options, out);
+        CHECK_FALSE(changed.fonts[0].cached);
+    }
+
+    SECTION("Sizes that are no longer used are emptied") {
+        build_font_atlases({}, usage, project.root.string(), options, out);
+        usage.fonts.erase({"forma://assets/test.ttf", 24});
+        build_font_atlases({}, usage, project.root.string(), options, out);
+        CHECK(out.read_file("/gen/forma_font_assets_test_ttf_24.c").find("lv_font_t") == std::string::npos);
+        CHECK(out.read_file("/gen/forma_font_assets_test_ttf_16.c").find("lv_font_t") != std::string::npos);
+    }
+
+    SECTION("Fonts that cannot be rasterized are reported") {
+        project.write("assets/bad.ttf", {0, 1, 2, 3});
+        std::vector<std::string> uris = {"forma://assets/bad.ttf"};
+        options.sizes = {12};
+        auto result = build_font_atlases(uris, usage, project.root.string(), options, out);
+        CHECK(result.warnings.size() == 1ul);
+        CHECK(result.rasterized.size() == 1ul);  // test.ttf only
+    }
+}
@@ -0,0 +1,366 @@
+#include <bugspray/bugspray.hpp>
+#include "core/image_convert.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace forma::image;
+
+namespace {
+
+// zlib.compress(b"stored block", 0)
+const std::vector<uint8_t> ZLIB_STORED = {
+    0x78, 0x01, 0x01, 0x0c, 0x00, 0xf3, 0xff, 0x73, 0x74, 0x6f, 0x72, 0x65, 0x64, 0x20, 0x62, 0x6c,
+    0x6f, 0x63, 0x6b, 0x1f, 0x80, 0x04, 0xbd,
+};
+
+// zlib.compress(b"hello hello hello hello", 9): fixed Huffman codes
+const std::vector<uint8_t> ZLIB_FIXED = {
+    0x78, 0xda, 0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0xc8, 0x40, 0x27, 0x01, 0x68, 0x03, 0x08, 0xb1,
+};
+
+// zlib.compress(dynamic_text(), 9): dynamic Huffman codes
+const std::vector<uint8_t> ZLIB_DYNAMIC = {
+    0x78, 0xda, 0xed, 0x8d, 0xbb, 0x09, 0x44, 0x41, 0x0c, 0x03, 0x6b, 0xb5, 0x90, 0xd7, 0x1f, 0x79,
+    0xfb, 0x4f, 0xcf, 0x5c, 0x13, 0x2f, 0xd9, 0x64, 0x18, 0x81, 0x60, 0xcc, 0x7d, 0x4c, 0x40, 0x75,
+    0xa8, 0xe9, 0x38, 0xd4, 0xe4, 0xac, 0x5d, 0x22, 0x8b, 0x79, 0x34, 0xd1, 0x79, 0xad, 0x54, 0xf6,
+    0xc7, 0xcd, 0x8e, 0xd1, 0x49, 0x56, 0x82, 0xd7, 0xd9, 0x7b, 0x17, 0x0f, 0xd6, 0x14, 0x5d, 0x80,
+    0x6c, 0xdc, 0x8d, 0x16, 0x01, 0x47, 0xe6, 0x22, 0x62, 0xe7, 0xeb, 0xbc, 0xce, 0xeb, 0x7c, 0xd6,
+    0xf9, 0x01, 0x2a, 0x3a, 0x91, 0x90,
+};
+
+// 4x5 RGBA; pixel (x, y) = (60x, 50y, 10x + 20y, 255 - 10xy); row y uses filter y
+const std::vector<uint8_t> RGBA_PNG = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+    0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x05, 0x08, 0x06, 0x00, 0x00, 0x00, 0x62, 0xad, 0x4d,
+    0xdb, 0x00, 0x00, 0x00, 0x46, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x60, 0x60, 0xf8,
+    0x6f, 0xc3, 0xc0, 0xf5, 0xbf, 0x82, 0x41, 0xe4, 0xff, 0x16, 0x06, 0xb9, 0xff, 0x8c, 0x0c, 0x46,
+    0x22, 0x20, 0x81, 0x6f, 0x30, 0xcc, 0x04, 0x14, 0x60, 0x00, 0xe2, 0x6f, 0x40, 0xfc, 0x06, 0x88,
+    0x1f, 0x31, 0x33, 0xa4, 0x68, 0x34, 0xc8, 0x49, 0xf2, 0xbf, 0x01, 0xe2, 0xe7, 0x40, 0xfc, 0x88,
+    0x05, 0xac, 0x02, 0xa8, 0x14, 0x88, 0xdf, 0x00, 0xf1, 0x23, 0x00, 0xe7, 0xb1, 0x16, 0x3b, 0xa6,
+    0xd3, 0x18, 0xf3, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+// 5x3, 2-bit palette {red, green, blue}, tRNS {255, 128}; index (x + y) % 3
+const std::vector<uint8_t> PALETTE_PNG = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+    0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x03, 0x02, 0x03, 0x00, 0x00, 0x00, 0x26, 0x58, 0x2d,
+    0x6b, 0x00, 0x00, 0x00, 0x09, 0x50, 0x4c, 0x54, 0x45, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00,
+    0x00, 0xff, 0x2d, 0x4a, 0xcd, 0x8a, 0x00, 0x00, 0x00, 0x02, 0x74, 0x52, 0x4e, 0x53, 0xff, 0x80,
+    0x08, 0x0f, 0xb3, 0x6a, 0x00, 0x00, 0x00, 0x11, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x90,
+    0x70, 0x60, 0x48, 0x6c, 0x60, 0x68, 0x63, 0x00, 0x00, 0x07, 0x7a, 0x01, 0xc0, 0xb3, 0x8e, 0x7a,
+    0x52, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+// 3x1 8-bit gray {0, 128, 255}, tRNS key 0
+const std::vector<uint8_t> GRAY_PNG = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+    0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x08, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x8b, 0x4b,
+    0x68, 0x00, 0x00, 0x00, 0x02, 0x74, 0x52, 0x4e, 0x53, 0x00, 0x00, 0x76, 0x93, 0xcd, 0x38, 0x00,
+    0x00, 0x00, 0x0c, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x68, 0xf8, 0x0f, 0x00, 0x02,
+    0x03, 0x01, 0x80, 0x1a, 0x9c, 0x26, 0x3b, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae,
+    0x42, 0x60, 0x82,
+};
+
+std::vector<uint8_t> dynamic_text() {
+    std::vector<uint8_t> text;
+    for (int i = 0; i < 1000; ++i) {
+        text.push_back(static_cast<uint8_t>(((i * i * 31 + i * 7) >> 3) % 13 + 97));
+    }
+    return text;
+}
+
+std::vector<uint8_t> bytes_of(std::string_view text) {
+    return {text.begin(), text.end()};
+}
+
+// Bottom-up BMP from RGB rows listed top to bottom
+std::vector<uint8_t> make_bmp(uint32_t width, const std::vector<std::vector<uint8_t>>& rows, uint16_t bits) {
+    size_t stride = ((width * bits + 31) / 32) * 4;
+    std::vector<uint8_t> file(54 + stride * rows.size(), 0);
+    auto put32 = [&](size_t at, uint32_t v) {
+        for (int i = 0; i < 4; ++i) file[at + i] = static_cast<uint8_t>(v >> (i * 8));
+    };
+    file[0] = 'B';
+    file[1] = 'M';
+    put32(2, static_cast<uint32_t>(file.size()));
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, width);
+    put32(22, static_cast<uint32_t>(rows.size()));
+    file[26] = 1;
+    file[28] = static_cast<uint8_t>(bits);
+    for (size_t y = 0; y < rows.size(); ++y) {
+        uint8_t* out = file.data() + 54 + stride * (rows.size() - 1 - y);
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint8_t* px = rows[y].data() + x * (bits / 8);
+            out[x * (bits / 8)] = px[2];
+            out[x * (bits / 8) + 1] = px[1];
+            out[x * (bits / 8) + 2] = px[0];
+            if (bits == 32) out[x * 4 + 3] = px[3];
+        }
+    }
+    return file;
+}
+
+RgbaImage solid(uint32_t width, uint32_t height, std::vector<uint32_t> colors) {
+    RgbaImage image;
+    image.width = width;
+    image.height = height;
+    for (uint32_t i = 0; i < width * height; ++i) {
+        uint32_t c = colors[i % colors.size()];
+        image.pixels.insert(image.pixels.end(), {static_cast<uint8_t>(c >> 24), static_cast<uint8_t>(c >> 16),
+                                                 static_cast<uint8_t>(c >> 8), static_cast<uint8_t>(c)});
+        image.has_alpha = image.has_alpha || (c & 0xFF) != 0xFF;
+    }
+    return image;
+}
+
+// lv_rle_decompress
+std::vector<uint8_t> rle_decode(const std::vector<uint8_t>& in, size_t block) {
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i < in.size();) {
+        uint8_t control = in[i++];
+        if (control & 0x80) {
+            size_t n = (control & 0x7F) * block;
+            out.insert(out.end(), in.begin() + i, in.begin() + i + n);
+            i += n;
+        } else {
+            for (int r = 0; r < control; ++r) {
+                out.insert(out.end(), in.begin() + i, in.begin() + i + block);
+            }
+            i += block;
+        }
+    }
+    return out;
+}
+
+uint32_t le32(const std::vector<uint8_t>& data, size_t at) {
+    return data[at] | (data[at + 1] << 8) | (data[at + 2] << 16) | (uint32_t{data[at + 3]} << 24);
+}
+
+} // namespace
+
+TEST_CASE("Inflate") {
+    std::vector<uint8_t> out;
+
+    SECTION("Stored, fixed and dynamic blocks") {
+        REQUIRE(zlib_decompress(ZLIB_STORED, out));
+        CHECK(out == bytes_of("stored block"));
+        REQUIRE(zlib_decompress(ZLIB_FIXED, out));
+        CHECK(out == bytes_of("hello hello hello hello"));
+        REQUIRE(zlib_decompress(ZLIB_DYNAMIC, out));
+        CHECK(out == dynamic_text());
+    }
+
+    SECTION("Corrupt streams are rejected") {
+        auto truncated = ZLIB_DYNAMIC;
+        truncated.resize(truncated.size() / 2);
+        CHECK(!zlib_decompress(truncated, out));
+
+        auto bad_checksum = ZLIB_FIXED;
+        bad_checksum.back() ^= 1;
+        CHECK(!zlib_decompress(bad_checksum, out));
+
+        auto bad_header = ZLIB_FIXED;
+        bad_header[0] = 0x79;
+        CHECK(!zlib_decompress(bad_header, out));
+    }
+
+    SECTION("Output is capped at the expected size") {
+        CHECK(zlib_decompress(ZLIB_DYNAMIC, out, 1000));
+        CHECK(!zlib_decompress(ZLIB_DYNAMIC, out, 999));
+        CHECK(!zlib_decompress(ZLIB_FIXED, out, 5));
+        CHECK(!zlib_decompress(ZLIB_STORED, out, 4));
+    }
+
+    SECTION("The size limit is not reserved up front") {
+        REQUIRE(zlib_decompress(ZLIB_FIXED, out, size_t{1} << 31));
+        CHECK(out.capacity() < size_t{4096});
+    }
+}
+
+TEST_CASE("Image decoding") {
+    std::string error;
+
+    SECTION("PNG with every scanline filter") {
+        auto image = decode_image(RGBA_PNG, error);
+        REQUIRE(image.has_value());
+        CHECK(image->width == 4u);
+        CHECK(image->height == 5u);
+        CHECK(image->has_alpha);
+        bool all_match = true;
+        for (uint32_t y = 0; y < 5; ++y) {
+            for (uint32_t x = 0; x < 4; ++x) {
+                const uint8_t* px = &image->pixels[(y * 4 + x) * 4];
+                all_match = all_match && px[0] == x * 60 && px[1] == y * 50 && px[2] == x * 10 + y * 20 &&
+                            px[3] == 255 - x * y * 10;
+            }
+        }
+        CHECK(all_match);
+    }
+
+    SECTION("Palette and gray PNGs with transparency") {
+        auto palette = decode_png(PALETTE_PNG, error);
+        REQUIRE(palette.has_value());
+        // (1, 0): index 1, green at half alpha; (2, 1): index 0, opaque red
+        CHECK(std::vector<uint8_t>(&palette->pixels[4], &palette->pixels[8]) == std::vector<uint8_t>{0, 255, 0, 128});
+        CHECK(std::vector<uint8_t>(&palette->pixels[28], &palette->pixels[32]) == std::vector<uint8_t>{255, 0, 0, 255});
+
+        auto gray = decode_png(GRAY_PNG, error);
+        REQUIRE(gray.has_value());
+        CHECK(gray->pixels == std::vector<uint8_t>{0, 0, 0, 0, 128, 128, 128, 255, 255, 255, 255, 255});
+    }
+
+    SECTION("24-bit and 32-bit BMP") {
+        std::vector<std::vector<uint8_t>> rows = {{10, 20, 30, 40, 50, 60, 70, 80, 90}, {1, 2, 3, 4, 5, 6, 7, 8, 9}};
+        auto image = decode_image(make_bmp(3, rows, 24), error);
+        REQUIRE(image.has_value());
+        CHECK(image->height == 2u);
+        CHECK(!image->has_alpha);
+        CHECK(std::vector<uint8_t>(image->pixels.begin(), image->pixels.begin() + 4) ==
+              std::vector<uint8_t>{10, 20, 30, 255});
+        CHECK(std::vector<uint8_t>(image->pixels.begin() + 12, image->pixels.begin() + 16) ==
+              std::vector<uint8_t>{1, 2, 3, 255});
+
+        auto with_alpha = decode_bmp(make_bmp(1, {{9, 8, 7, 100}}, 32), error);
+        REQUIRE(with_alpha.has_value());
+        CHECK(with_alpha->pixels == std::vector<uint8_t>{9, 8, 7, 100});
+        CHECK(with_alpha->has_alpha);
+    }
+
+    SECTION("BI_BITFIELDS masks after a 40-byte header") {
+        auto file = make_bmp(1, {{9, 8, 7, 100}}, 32);
+        const uint8_t masks[12] = {0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0};
+        file.insert(file.begin() + 54, masks, masks + 12);
+        file[10] = 66;  // Pixel data follows the masks
+        file[30] = 3;   // BI_BITFIELDS
+        auto image = decode_bmp(file, error);
+        REQUIRE(image.has_value());
+        CHECK(image->pixels == std::vector<uint8_t>{9, 8, 7, 100});
+
+        file.resize(60);
+        CHECK(!decode_bmp(file, error).has_value());
+        CHECK(error == "truncated BMP");
+    }
+
+    SECTION("Unsupported files report why") {
+        CHECK(!decode_image(bytes_of("GIF89a"), error).has_value());
+        CHECK(!error.empty());
+
+        auto truncated = RGBA_PNG;
+        truncated.resize(60);
+        CHECK(!decode_image(truncated, error).has_value());
+    }
+
+    SECTION("Oversized headers are refused before decoding") {
+        auto huge = RGBA_PNG;
+        huge[17] = 0xEA;  // 60000 x 60000
+        huge[18] = 0x60;
+        huge[21] = 0xEA;
+        huge[22] = 0x60;
+        CHECK(!decode_png(huge, error).has_value());
+        CHECK(error == "PNG dimensions too large");
+    }
+}
+
+TEST_CASE("Pixel kernels") {
+    // Odd count so the SIMD loops leave a scalar tail
+    std::vector<uint8_t> rgba(4 * 1027);
+    for (size_t i = 0; i < rgba.size(); ++i) {
+        rgba[i] = static_cast<uint8_t>(i * 2654435761u >> 13);
+    }
+    size_t count = rgba.size() / 4;
+
+    std::vector<uint8_t> fast(count * 4), reference(count * 4);
+    kernels::rgba_to_rgb565(rgba.data(), fast.data(), count);
+    kernels::rgba_to_rgb565_scalar(rgba.data(), reference.data(), count);
+    CHECK(fast == reference);
+
+    kernels::rgba_to_bgra(rgba.data(), fast.data(), count);
+    kernels::rgba_to_bgra_scalar(rgba.data(), reference.data(), count);
+    CHECK(fast == reference);
+
+    kernels::rgba_alpha(rgba.data(), fast.data(), count);
+    kernels::rgba_alpha_scalar(rgba.data(), reference.data(), count);
+    CHECK(fast == reference);
+
+    uint8_t pixel[4] = {0xFF, 0x80, 0x08, 0xFF};
+    uint8_t rgb565[2];
+    kernels::rgba_to_rgb565_scalar(pixel, rgb565, 1);
+    CHECK(rgb565[0] == 0x01);  // 0xFC01: R 31, G 32, B 1
+    CHECK(rgb565[1] == 0xFC);
+}
+
+TEST_CASE("Image conversion") {
+    std::string note;
+
+    SECTION("RGB565 adds an alpha plane only when needed") {
+        auto opaque = convert_image(solid(3, 2, {0xFF0000FF}), ImageFormat::RGB565, false, note);
+        CHECK(opaque.cf == ColorFormat::RGB565);
+        CHECK(opaque.stride == 6u);
+        CHECK(opaque.data.size() == 12ul);
+        CHECK(opaque.data[1] == 0xF8);
+
+        auto translucent = convert_image(solid(3, 2, {0xFF000080}), ImageFormat::RGB565, false, note);
+        CHECK(translucent.cf == ColorFormat::RGB565A8);
+        CHECK(translucent.data.size() == 18ul);
+        CHECK(translucent.data[12] == 0x80);
+    }
+
+    SECTION("ARGB8888 is stored as B, G, R, A") {
+        auto image = convert_image(solid(1, 1, {0x11223344}), ImageFormat::ARGB8888, false, note);
+        CHECK(image.cf == ColorFormat::ARGB8888);
+        CHECK(image.data == std::vector<uint8_t>{0x33, 0x22, 0x11, 0x44});
+    }
+
+    SECTION("Indexed picks the smallest palette") {
+        auto two = convert_image(solid(10, 1, {0x000000FF, 0xFFFFFFFF}), ImageFormat::Indexed, false, note);
+        CHECK(two.cf == ColorFormat::I1);
+        CHECK(two.stride == 2u);
+        REQUIRE(two.data.size() == 8ul + 2ul);
+        CHECK(std::vector<uint8_t>(two.data.begin() + 4, two.data.begin() + 8) ==
+              std::vector<uint8_t>{0xFF, 0xFF, 0xFF, 0xFF});
+        CHECK(two.data[8] == 0x55);  // 0101 0101
+        CHECK(two.data[9] == 0x40);  // Last two pixels, padded
+
+        auto five = convert_image(solid(5, 1, {1, 2, 3, 4, 5}), ImageFormat::Indexed, false, note);
+        CHECK(five.cf == ColorFormat::I4);
+        CHECK(five.data.size() == 16ul * 4 + 3);
+
+        std::vector<uint32_t> many;
+        for (uint32_t i = 0; i < 300; ++i) many.push_back(i << 8 | 0xFF);
+        auto fallback = convert_image(solid(300, 1, many), ImageFormat::Indexed, false, note);
+        CHECK(fallback.cf == ColorFormat::ARGB8888);
+        CHECK(!note.empty());
+    }
+
+    SECTION("RLE output decodes back to the pixels") {
+        auto plain = convert_image(solid(64, 4, {0x102030FF, 0x102030FF, 0x102030FF, 0x405060FF}),
+                                   ImageFormat::ARGB8888, false, note);
+        auto packed = convert_image(solid(64, 4, {0x102030FF, 0x102030FF, 0x102030FF, 0x405060FF}),
+                                    ImageFormat::ARGB8888, true, note);
+        REQUIRE(packed.flags & IMAGE_FLAG_COMPRESSED);
+        CHECK(packed.data.size() < plain.data.size());
+        CHECK(le32(packed.data, 0) == COMPRESS_RLE);
+        CHECK(le32(packed.data, 4) == packed.data.size() - 12);
+        CHECK(le32(packed.data, 8) == plain.data.size());
+        std::vector<uint8_t> payload(packed.data.begin() + 12, packed.data.end());
+        CHECK(rle_decode(payload, 4) == plain.data);
+
+        // Incompressible data stays uncompressed
+        std::vector<uint32_t> noise;
+        for (uint32_t i = 0; i < 64; ++i) noise.push_back((i * 2654435761u) | 0xFF);
+        auto random = convert_image(solid(64, 1, noise), ImageFormat::ARGB8888, true, note);
+        CHECK(!(random.flags & IMAGE_FLAG_COMPRESSED));
+    }
+
+    SECTION("RLE runs longer than one control byte") {
+        std::vector<uint8_t> data(1000, 7);
+        data[500] = 8;
+        CHECK(rle_decode(rle_compress(data, 1), 1) == data);
+        std::vector<uint8_t> mixed;
+        for (int i = 0; i < 400; ++i) mixed.push_back(static_cast<uint8_t>(i % 3 == 0 ? 1 : i));
+        CHECK(rle_decode(rle_compress(mixed, 2), 2) == mixed);
+    }
+}
@@ -0,0 +1,59 @@
+#include <bugspray/bugspray.hpp>
+#include "core/import_graph.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+using namespace forma;
+
+static void write_file(const std::filesystem::path& path, const std::string& content) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream of(path, std::ios::binary);
+    of << content;
+}
+
+TEST_CASE("Import graph loads each module once") {
+    auto dir = std::filesystem::temp_directory_path() /
+               ("forma_import_graph_" + std::to_string(std::chrono::high_resolution_clock::now().time_since_epoch().count()));
+
+    // main -> (shapes, colors); shapes -> (colors, widgets.Card); widgets.Card -> shapes
+    write_file(dir / "shapes.fml", "import colors\nimport widgets.Card\nclass Shape {\n    property size: int\n}\n");
+    write_file(dir / "colors.fml", "enum Color {\n    Red,\n    Green\n}\n");
+    write_file(dir / "widgets" / "Card.fml", "import shapes\nclass Card {\n    property title: string\n}\n");
+
+    std::string main_source = "import shapes\nimport colors\nShape {\n    size: 1\n}\n";
+    auto doc = parse_document(main_source);
+
+    SECTION("Shared and cyclic imports are deduplicated") {
+        ImportGraph graph;
+        REQUIRE(graph.load(doc, (dir / "main.fml").string()));
+
+        CHECK(graph.loaded().size() == 3ul);
+        CHECK(graph.file_count() == 4ul);
+        CHECK(graph.missing().empty());
+
+        // Sources are kept alive by the graph, so parsed names stay readable
+        bool found_card = false;
+        for (const auto& module : graph.loaded()) {
+            REQUIRE(module.doc != nullptr);
+            if (module.module_path == "widgets.Card") {
+                found_card = true;
+                REQUIRE(module.doc->type_count == 1ul);
+                CHECK(module.doc->types[0].name == "Card");
+            }
+        }
+        CHECK(found_card);
+    }
+
+    SECTION("Missing imports are reported") {
+        std::string source = "import shapes\nimport missing.Module\n";
+        auto broken = parse_document(source);
+
+        ImportGraph graph;
+        CHECK(!graph.load(broken, (dir / "main.fml").string(), 1));
+        REQUIRE(graph.missing().size() == 1ul);
+        CHECK(graph.missing()[0] == "missing.Module");
+    }
+
+    std::filesystem::remove_all(dir);
+}
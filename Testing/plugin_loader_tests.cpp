@@ -1,6 +1,8 @@
 #include <bugspray/bugspray.hpp>
 #include "plugin_loader.hpp"
 #include "core/fs/i_file_system.hpp"
+#include "core/render_targets.hpp"
+#include <thread>
 
 using namespace forma;
 
@@ -81,3 +83,285 @@ TEST_CASE("PluginLoader - BuiltinBuildSyncsToMemoryFS")
     auto content = fs.read_file("memproj/output.bin");
     CHECK(content == "BINARYDATA");
 }
+
+TEST_CASE("PluginLoader - Plugin widgets extend the registry")
+{
+    auto metadata = load_plugin_metadata_from_string(R"(
+[plugin]
+name = "gauges"
+kind = "renderer"
+api_version = "1.0.0"
+
+[widgets]
+Gauge = "lv_scale"
+
+[properties]
+needle = "lv_scale_set_line_needle_value"
+)");
+    REQUIRE(metadata != nullptr);
+    CHECK(metadata->widgets.size() == 1ul);
+    CHECK(metadata->properties.size() == 1ul);
+
+    CHECK(!widgets::is_widget("Gauge"));
+    PluginLoader loader;
+    loader.register_builtin_plugin(nullptr, test_builtin_build, nullptr, std::move(metadata));
+
+    CHECK(widgets::is_widget("Gauge"));
+    CHECK(std::string_view(widgets::lvgl_widget("Gauge")) == "lv_scale");
+    CHECK(std::string_view(widgets::lvgl_setter("needle")) == "lv_scale_set_line_needle_value");
+    CHECK(std::string_view(widgets::lvgl_widget("Button")) == "lv_btn");
+    widgets::overlay().clear();
+}
+
+TEST_CASE("PluginLoader - plugin.toml is parsed once per process")
+{
+    namespace stdfs = std::filesystem;
+    stdfs::path dir = stdfs::temp_directory_path() / "forma_toml_cache_test";
+    stdfs::remove_all(dir);
+    stdfs::create_directories(dir);
+    stdfs::path toml_path = dir / "plugin.toml";
+    std::ofstream(toml_path) << "[plugin]\nname = \"first\"\n[capabilities]\nprovides = [\"renderer:first\"]\n";
+
+    auto& cache = core::TomlCache::instance();
+    size_t parses = cache.parses();
+    auto metadata = load_plugin_metadata(toml_path);
+    REQUIRE(metadata != nullptr);
+    CHECK(metadata->name == "first");
+    CHECK(metadata->provides_renderer("first"));
+
+    fs::RealFileSystem realfs;
+    auto doc = core::parse_toml_from_fs(realfs, toml_path.string());
+    REQUIRE(doc != nullptr);
+    CHECK(doc == cache.load(toml_path));
+    CHECK(cache.parses() == parses + 1);
+
+    // A rewrite changes the size and modification time: parsed again
+    std::ofstream(toml_path) << "[plugin]\nname = \"second-version\"\n";
+    stdfs::last_write_time(toml_path, stdfs::last_write_time(toml_path) + std::chrono::seconds(1));
+    metadata = load_plugin_metadata(toml_path);
+    REQUIRE(metadata != nullptr);
+    CHECK(metadata->name == "second-version");
+    CHECK(cache.parses() == parses + 2);
+    CHECK(doc->get_table("plugin")->get_string("name") == "first");  // Earlier documents stay valid
+
+    stdfs::remove_all(dir);
+}
+
+TEST_CASE("PluginLoader - Registry cache survives runs and notices changes")
+{
+    namespace stdfs = std::filesystem;
+    stdfs::path root = stdfs::temp_directory_path() / "forma_plugin_registry_test";
+    stdfs::remove_all(root);
+    stdfs::create_directories(root / "user");
+    stdfs::create_directories(root / "system");
+    std::string library = (root / "system" / "forma-gauges.so").string();
+    std::string toml = (root / "system" / "plugin.toml").string();
+    std::ofstream(library) << "not really a library";
+    std::ofstream(toml) << "[plugin]\nname = \"gauges\"\n";
+    std::string cache_path = (root / "cache" / "plugin-registry").string();
+    std::vector<std::string> search = {(root / "user").string(), (root / "system").string()};
+
+    // Timestamps have coarse granularity; age the fixture so later changes
+    // are guaranteed to show
+    auto past = stdfs::file_time_type::clock::now() - std::chrono::hours(1);
+    for (const auto& path : {library, toml, search[0], search[1]}) {
+        stdfs::last_write_time(path, past);
+    }
+
+    {
+        PluginRegistryCache registry(cache_path);
+        registry.load();
+        PluginMetadata metadata;
+        metadata.name = "gauges";
+        metadata.kind = "renderer";
+        metadata.provides = {"renderer:gauges"};
+        metadata.widgets = {{"Gauge", "lv_scale"}};
+        registry.record({library, FileStamp::of(library), toml, FileStamp::of(toml), 0xabcdef, metadata});
+        registry.record_resolution("gauges", library, search);
+        REQUIRE(registry.save());
+    }
+
+    PluginRegistryCache registry(cache_path);
+    registry.load();
+    CHECK(registry.size() == 1);
+
+    SECTION("Unchanged files are answered from the registry")
+    {
+        const PluginRegistryEntry* entry = registry.find_fresh(library);
+        REQUIRE(entry != nullptr);
+        CHECK(entry->metadata_hash == 0xabcdef);
+        CHECK(entry->metadata.name == "gauges");
+        CHECK(entry->metadata.provides_renderer("gauges"));
+        CHECK(entry->metadata.widgets.at(0).second == "lv_scale");
+        CHECK(registry.resolve("gauges", search) == library);
+        CHECK(!registry.resolve("other", search));
+    }
+
+    SECTION("A changed plugin.toml invalidates its entry")
+    {
+        std::ofstream(toml) << "[plugin]\nname = \"gauges\"\nkind = \"renderer\"\n";
+        CHECK(registry.find_fresh(library) == nullptr);
+    }
+
+    SECTION("A file added to an earlier search directory invalidates the lookup")
+    {
+        std::ofstream(root / "user" / "forma-gauges.so") << "shadows the system one";
+        CHECK(!registry.resolve("gauges", search));
+        CHECK(!registry.resolve("gauges", {search[1]}));  // Different search path
+    }
+
+    stdfs::remove_all(root);
+}
+
+TEST_CASE("PluginLoader - Lazy loading opens a library only when it is used")
+{
+    namespace stdfs = std::filesystem;
+    stdfs::path dir = stdfs::temp_directory_path() / "forma_lazy_plugin_test";
+    stdfs::remove_all(dir);
+    stdfs::create_directories(dir);
+    std::string library = (dir / "forma-sketch.so").string();
+    std::ofstream(library) << "not really a library";
+    std::ofstream(dir / "plugin.toml") << "[plugin]\nname = \"sketch\"\nkind = \"renderer\"\napi_version = \"1.0.0\"\n"
+                                          "[capabilities]\nprovides = [\"renderer:svg\"]\n"
+                                          "[widgets]\nSketch = \"lv_canvas\"\n";
+
+    SECTION("Eager loading opens and rejects the library up front")
+    {
+        PluginLoader loader;
+        std::string error;
+        CHECK(!loader.load_plugin(library, error));
+        CHECK(error.find("Failed to load plugin") != std::string::npos);
+        CHECK(loader.get_loaded_plugins().empty());
+    }
+
+    SECTION("Lazy loading resolves by metadata and defers the failure")
+    {
+        PluginLoader loader;
+        loader.set_lazy_loading(true);
+        std::string error;
+        REQUIRE(loader.load_plugin(library, error));
+
+        LoadedPlugin* plugin = loader.find_provider("renderer:svg");
+        REQUIRE(plugin != nullptr);
+        CHECK(plugin == loader.find_plugin("sketch"));
+        CHECK(plugin->pending);
+        CHECK(plugin->handle == nullptr);
+        CHECK(plugin->metadata_hash != 0u);
+        CHECK(loader.find_provider("renderer:c") == nullptr);
+        CHECK(widgets::is_widget("Sketch"));
+
+        CHECK(!loader.get_renderer_adapter("sketch"));
+        CHECK(plugin->load_error.find("Failed to load plugin") != std::string::npos);
+        CHECK(!loader.ensure_loaded(*plugin, error));
+        CHECK(error == plugin->load_error);
+        widgets::overlay().clear();
+    }
+
+    stdfs::remove_all(dir);
+}
+
+TEST_CASE("PluginLoader - HostContext stream_io can be shared by concurrent renderers")
+{
+    HostContext host(std::make_unique<fs::MemoryFileSystem>(), nullptr);
+    host.initialize_stream_io();
+
+    std::vector<std::thread> renderers;
+    for (int i = 0; i < 8; ++i) {
+        renderers.emplace_back([&host, i] {
+            for (int j = 0; j < 50; ++j) {
+                std::string path = "out/target" + std::to_string(i) + "_" + std::to_string(j) + ".c";
+                host.stream_io.open_write(path, "// target " + std::to_string(i));
+            }
+        });
+    }
+    for (auto& renderer : renderers) {
+        renderer.join();
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        auto contents = host.stream_io.open_read("out/target" + std::to_string(i) + "_49.c");
+        REQUIRE(contents.has_value());
+        CHECK(*contents == "// target " + std::to_string(i));
+    }
+}
+
+// Builtin renderers for the multi-target tests; each writes its own name
+template<char const* Name>
+static bool test_named_render(const void* /*doc*/, const char* /*input_path*/, const char* output_path) {
+    std::ofstream of(output_path, std::ios::binary);
+    of << Name;
+    return static_cast<bool>(of);
+}
+
+static constexpr char c_codegen_name[] = "c-codegen";
+static constexpr char lvgl_name[] = "lvgl";
+static constexpr char json_name[] = "json";
+
+static std::unique_ptr<PluginMetadata> make_renderer_metadata(const std::string& name, const std::string& extension,
+                                                              std::vector<std::string> provides) {
+    auto m = std::make_unique<PluginMetadata>();
+    m->name = name;
+    m->kind = "renderer";
+    m->api_version = "1.0.0";
+    m->runtime = "native";
+    m->provides = std::move(provides);
+    m->output_extension = extension;
+    return m;
+}
+
+TEST_CASE("PluginLoader - Several renderers share one document")
+{
+    PluginLoader loader;
+    loader.register_builtin_plugin(test_named_render<c_codegen_name>, nullptr, nullptr,
+                                   make_renderer_metadata("c-codegen", ".c", {"renderer:c"}));
+    loader.register_builtin_plugin(test_named_render<lvgl_name>, nullptr, nullptr,
+                                   make_renderer_metadata("lvgl", ".c", {"renderer:lvgl"}));
+    loader.register_builtin_plugin(test_named_render<json_name>, nullptr, nullptr,
+                                   make_renderer_metadata("json", ".json", {"renderer:json"}));
+
+    auto resolve = [&loader](const std::string& renderer) {
+        std::vector<LoadedPlugin*> plugins;
+        for (const auto& name : split_renderers(renderer)) {
+            auto* plugin = find_renderer(loader, name);
+            REQUIRE(plugin != nullptr);
+            plugins.push_back(plugin);
+        }
+        return plan_render_targets(plugins, "app/main");
+    };
+
+    SECTION("Names are trimmed")
+    {
+        CHECK(split_renderers(" lvgl, json ,\tc ,, ") == std::vector<std::string>{"lvgl", "json", "c"});
+    }
+
+    SECTION("An alias and the plugin name are one target")
+    {
+        auto targets = resolve("c, c-codegen");
+        REQUIRE(targets.size() == 1);
+        CHECK(targets[0].name == "c-codegen");
+        CHECK(targets[0].output_file == "app/main.c");
+    }
+
+    SECTION("Every target renders to its own file")
+    {
+        auto targets = resolve("lvgl, c,json");
+        REQUIRE(targets.size() == 3);
+        CHECK(targets[0].output_file == "app/main.lvgl.c");
+        CHECK(targets[1].output_file == "app/main.c-codegen.c");
+        CHECK(targets[2].output_file == "app/main.json");
+
+        fs::MemoryFileSystem memfs;
+        memfs.write_file("app/main.fml", "Rectangle {}");
+        for (auto& target : targets) {
+            target.adapter = loader.get_renderer_adapter(target.name);
+            REQUIRE(static_cast<bool>(target.adapter));
+        }
+        int doc = 0;
+        render_targets(doc, "app/main.fml", targets, memfs);
+
+        for (const auto& target : targets) {
+            CHECK(target.ok);
+            CHECK(memfs.read_file(target.output_file) == target.name);
+        }
+    }
+}
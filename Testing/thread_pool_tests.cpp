@@ -0,0 +1,79 @@
+#include <bugspray/bugspray.hpp>
+#include "core/thread_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+using namespace forma;
+
+TEST_CASE("Thread pool runs every task") {
+    SECTION("Results land in submission slots") {
+        ThreadPool pool(4);
+        std::vector<int> results(1000, 0);
+        for (size_t i = 0; i < results.size(); ++i) {
+            pool.submit([&results, i] { results[i] = static_cast<int>(i) * 2; });
+        }
+        pool.wait();
+
+        bool all_set = true;
+        for (size_t i = 0; i < results.size(); ++i) {
+            all_set = all_set && results[i] == static_cast<int>(i) * 2;
+        }
+        CHECK(all_set);
+    }
+
+    SECTION("Idle workers steal from a busy one") {
+        ThreadPool pool(4);
+        std::atomic<int> done{0};
+        std::atomic<bool> blocked{false};
+        // Every fourth task lands on the same worker. The first of them to
+        // run holds its worker until all the others have finished, so the
+        // rest of that worker's queue has to be drained by the others
+        for (int i = 0; i < 64; ++i) {
+            pool.submit([&done, &blocked, i] {
+                if (i % 4 == 0 && !blocked.exchange(true)) {
+                    for (int spin = 0; spin < 5000 && done.load() < 63; ++spin) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                }
+                done.fetch_add(1);
+            });
+        }
+        pool.wait();
+        CHECK(done.load() == 64);
+        CHECK(pool.stolen_count() > 0ul);
+    }
+
+    SECTION("Pool can be reused after wait") {
+        ThreadPool pool(2);
+        std::atomic<int> count{0};
+        pool.submit([&count] { count.fetch_add(1); });
+        pool.wait();
+        pool.submit([&count] { count.fetch_add(1); });
+        pool.wait();
+        CHECK(count.load() == 2);
+    }
+
+    SECTION("Tasks may submit more tasks") {
+        ThreadPool pool(4);
+        std::atomic<int> leaves{0};
+        // Each parent fans out from inside a worker; wait() must cover the
+        // children even though they are submitted after the parents started
+        for (int i = 0; i < 32; ++i) {
+            pool.submit([&pool, &leaves] {
+                for (int j = 0; j < 8; ++j) {
+                    pool.submit([&pool, &leaves] {
+                        pool.submit([&leaves] { leaves.fetch_add(1); });
+                    });
+                }
+            });
+        }
+        pool.wait();
+        CHECK(leaves.load() == 32 * 8);
+
+        // Counters balanced: the pool stays usable and wait() returns
+        pool.submit([&leaves] { leaves.fetch_add(1); });
+        pool.wait();
+        CHECK(leaves.load() == 32 * 8 + 1);
+    }
+}
@@ -0,0 +1,65 @@
+// Semantic analysis throughput on large documents.
+//
+// Generates documents with N class declarations, each with a property that
+// references the previous class, plus one instance per class. Every property
+// type and instance type goes through SymbolTable lookup, so the run time
+// shows whether lookups scale with declaration count.
+//
+// Usage: forma_symbol_table_bench [declarations...]   (default: 1000 10000)
+
+#include "ir.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string make_source(size_t decl_count) {
+    std::string source;
+    source.reserve(decl_count * 96);
+    for (size_t i = 0; i < decl_count; ++i) {
+        std::string name = "Type" + std::to_string(i);
+        std::string prev = i == 0 ? "int" : "Type" + std::to_string(i - 1);
+        source += "class " + name + " {\n    property value: int\n    property link: " + prev + "\n}\n";
+    }
+    for (size_t i = 0; i < decl_count; ++i) {
+        source += "Type" + std::to_string(i) + " {\n    value: 1\n}\n";
+    }
+    return source;
+}
+
+double ms_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        sizes.push_back(static_cast<size_t>(std::strtoul(argv[i], nullptr, 10)));
+    }
+    if (sizes.empty()) {
+        sizes = {1000, 10000};
+    }
+    
+    for (size_t n : sizes) {
+        std::string source = make_source(n);
+        
+        auto start = std::chrono::steady_clock::now();
+        auto doc = forma::parse_document_runtime(source);
+        double parse_ms = ms_since(start);
+        
+        start = std::chrono::steady_clock::now();
+        auto diags = forma::analyze_document(doc);
+        double analyze_ms = ms_since(start);
+        
+        std::cout << n << " declarations: parse " << parse_ms << " ms, analyze "
+                  << analyze_ms << " ms (" << doc.symbols.count << " symbols, "
+                  << diags.count << " diagnostics)\n";
+    }
+    
+    return 0;
+}
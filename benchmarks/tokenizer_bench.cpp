@@ -0,0 +1,80 @@
+// Tokenizer throughput on large generated sources.
+//
+// Generates a .fml corpus of the requested size (classes, instances with
+// string properties, line and block comments, indentation) and tokenizes it
+// end to end once per scan kernel set the CPU supports, reporting MB/s.
+//
+// Usage: forma_tokenizer_bench [megabytes...]   (default: 1 16)
+
+#include "tokenizer.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string make_source(size_t bytes) {
+    std::string source;
+    source.reserve(bytes + 512);
+    for (size_t i = 0; source.size() < bytes; ++i) {
+        std::string name = "Widget" + std::to_string(i);
+        source += "// " + name + " keeps its settings panel in sync with the device state\n";
+        source += "class " + name + " {\n";
+        source += "    property title: string\n";
+        source += "    property refresh_interval_ms: int\n";
+        source += "    /* Enabled once the backing service reports ready; the\n";
+        source += "       renderer greys the widget out until then. */\n";
+        source += "    property enabled: bool\n";
+        source += "}\n\n";
+        source += name + " {\n";
+        source += "    title: \"Settings for the " + name + " configuration screen\"\n";
+        source += "    refresh_interval_ms: " + std::to_string(i % 1000) + "\n";
+        source += "    enabled: true\n";
+        source += "}\n\n";
+    }
+    return source;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        sizes.push_back(static_cast<size_t>(std::strtoul(argv[i], nullptr, 10)));
+    }
+    if (sizes.empty()) {
+        sizes = {1, 16};
+    }
+    
+    for (size_t mb : sizes) {
+        std::string source = make_source(mb * 1024 * 1024);
+        double megabytes = static_cast<double>(source.size()) / (1024.0 * 1024.0);
+        
+        for (const forma::scan::Kernels* set : forma::scan::available_kernels()) {
+            forma::scan::use_kernels(*set);
+            
+            // Best of three to keep page faults and frequency ramp-up out
+            double best = 0;
+            size_t tokens = 0;
+            for (int run = 0; run < 3; ++run) {
+                auto start = std::chrono::steady_clock::now();
+                forma::Lexer lexer{source, 0};
+                tokens = 0;
+                while (forma::next_token(lexer).kind != forma::TokenKind::EndOfFile) ++tokens;
+                double elapsed = seconds_since(start);
+                if (run == 0 || elapsed < best) best = elapsed;
+            }
+            
+            std::cout << megabytes << " MB, " << set->name << ": " << megabytes / best
+                      << " MB/s (" << tokens << " tokens)\n";
+        }
+    }
+    
+    return 0;
+}
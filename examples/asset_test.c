@@ -13,8 +13,10 @@
 /* Bundled Assets */
 extern const unsigned char asset_assets_logo_png[];
 extern const unsigned int asset_assets_logo_png_size;
+extern const lv_image_dsc_t asset_assets_logo_png_dsc;
 extern const unsigned char asset_assets_icons_settings_png[];
 extern const unsigned int asset_assets_icons_settings_png_size;
+extern const lv_image_dsc_t asset_assets_icons_settings_png_dsc;
 
 /* Event Callbacks (Internal) */
 /* UI Widgets (Internal) */
@@ -33,13 +35,13 @@ void forma_init(void) {
     lv_obj_set_y(image_0, 10);
     lv_obj_set_width(image_0, 200);
     lv_obj_set_height(image_0, 150);
-    lv_img_set_src(image_0, asset_assets_logo_png);    
+    lv_img_set_src(image_0, &asset_assets_logo_png_dsc);    
     image_1 = lv_img_create(lv_scr_act());
     lv_obj_set_x(image_1, 10);
     lv_obj_set_y(image_1, 170);
     lv_obj_set_width(image_1, 100);
     lv_obj_set_height(image_1, 100);
-    lv_img_set_src(image_1, asset_assets_icons_settings_png);    
+    lv_img_set_src(image_1, &asset_assets_icons_settings_png_dsc);    
     button_3 = lv_btn_create(lv_scr_act());
     lv_obj_set_x(button_3, 120);
     lv_obj_set_y(button_3, 170);
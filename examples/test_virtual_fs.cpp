@@ -10,7 +10,7 @@ void test_basic_operations() {
     std::cout << "Test: Basic VirtualFS Operations\n";
     std::cout << "==================================\n";
     
-    VirtualFS<32> fs;
+    VirtualFS fs;
     
     // Write a file
     assert(fs.write_file("file:///test.fml", "Point { property x: int }"));
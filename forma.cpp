@@ -12,6 +12,7 @@
 #include "plugins/tracer/src/tracer_plugin.hpp"
 #include "plugins/lvgl-renderer/src/lvgl_renderer_builtin.hpp"
 #include "src/core/toml_io.hpp"
+#include "src/core/render_targets.hpp"
 #include <CLI/CLI.hpp>
 #include <iostream>
 #include <fstream>
@@ -39,6 +40,7 @@ struct CompilerOptions {
     bool debug = false;
     bool list_plugins = false;
     bool is_plugin = false;  // true for forma init plugin
+    size_t jobs = 0;         // Parallel compile jobs for build
     bool flash = false;      // Flash to device after build
     bool monitor = false;    // Start monitor after flash
 };
@@ -111,13 +113,13 @@ int generate_code(const DocType& doc, const std::string& input_file,
     }
     
     // If only the built-in lvgl renderer is available and no renderer specified, use it as default
-    std::string target_renderer = renderer;
-    if (renderer.empty() && available_renderers.size() == 1 && available_renderers[0] == "lvgl") {
-        target_renderer = "lvgl";
+    std::vector<std::string> target_renderers = forma::split_renderers(renderer);
+    if (target_renderers.empty() && available_renderers.size() == 1 && available_renderers[0] == "lvgl") {
+        target_renderers = {"lvgl"};
         tracer.verbose("Auto-selected default renderer: lvgl");
     }
     // If plugins loaded but no --renderer specified, error (be explicit)
-    else if (!available_renderers.empty() && renderer.empty()) {
+    else if (!available_renderers.empty() && target_renderers.empty()) {
         tracer.error("Renderer plugins loaded but no --renderer specified");
         tracer.info("Available plugin renderers:");
         for (const auto& name : available_renderers) {
@@ -131,71 +133,71 @@ int generate_code(const DocType& doc, const std::string& input_file,
         tracer.error("No renderer plugins available");
         return 1;
     }
-    // Use specified renderer
-    else if (!renderer.empty()) {
-        target_renderer = renderer;
-    }
 
     tracer.begin_stage("Code generation");
     
-    std::string output_file = input_file;
-    size_t dot_pos = output_file.find_last_of('.');
+    std::string output_base = input_file;
+    size_t dot_pos = output_base.find_last_of('.');
     if (dot_pos != std::string::npos) {
-        output_file = output_file.substr(0, dot_pos);
+        output_base = output_base.substr(0, dot_pos);
     }
     
-    // Find matching renderer plugin (exact name match)
-    forma::LoadedPlugin* selected_plugin = nullptr;
-    for (const auto& plugin : plugin_loader.get_loaded_plugins()) {
-        if (plugin->metadata && 
-            plugin->metadata->is_renderer() &&
-            plugin->metadata->name == target_renderer) {
-            selected_plugin = plugin.get();
-            break;
+    // Resolve every target before rendering anything: plugins are opened
+    // here, on this thread, so the workers below only call adapters
+    std::vector<forma::LoadedPlugin*> selected_plugins;
+    for (const auto& target_renderer : target_renderers) {
+        auto* selected_plugin = forma::find_renderer(plugin_loader, target_renderer);
+        // No renderer found - error
+        if (!selected_plugin) {
+            tracer.error(std::string("Unknown renderer: ") + target_renderer);
+            tracer.info("Available renderers:");
+            for (const auto& name : available_renderers) {
+                tracer.info(std::string("  - ") + name);
+            }
+            return 1;
         }
+        selected_plugins.push_back(selected_plugin);
     }
-    
-    // Use plugin renderer if found
-    if (selected_plugin) {
-        tracer.verbose(std::string("Using plugin renderer: ") + selected_plugin->metadata->name);
-
-        // Get output extension from metadata
-        std::string extension = ".gen";  // default fallback
-        if (!selected_plugin->metadata->output_extension.empty()) {
-            extension = selected_plugin->metadata->output_extension;
-            tracer.verbose(std::string("Using output extension from metadata: ") + extension);
-        }
-        output_file += extension;
 
-        tracer.verbose(std::string("Output: ") + output_file);
+    std::vector<forma::RenderTarget> targets = forma::plan_render_targets(selected_plugins, output_base);
+    for (auto& target : targets) {
+        tracer.verbose(std::string("Using plugin renderer: ") + target.name);
+        tracer.verbose(std::string("Output: ") + target.output_file);
 
         // Use adapter if available
-        auto renderer_adapter = plugin_loader.get_renderer_adapter(selected_plugin->metadata->name);
-        if (!renderer_adapter) {
-            tracer.error("Plugin does not provide a render adapter");
+        target.adapter = plugin_loader.get_renderer_adapter(target.name);
+        if (!target.adapter) {
+            if (!target.plugin->load_error.empty()) {
+                tracer.error(std::string("Failed to load renderer plugin: ") + target.plugin->load_error);
+            } else {
+                tracer.error("Plugin does not provide a render adapter");
+            }
             return 1;
         }
+    }
 
-        // Use RealFileSystem for CLI compile
-        forma::fs::RealFileSystem realfs;
-        if (!renderer_adapter(&doc, input_file, output_file, realfs)) {
-            tracer.error("Plugin rendering failed");
-            return 1;
-        }
-        tracer.end_stage();
-    } 
-    // No renderer found - error
-    else {
-        tracer.error(std::string("Unknown renderer: ") + target_renderer);
-        tracer.info("Available renderers:");
-        for (const auto& name : available_renderers) {
-            tracer.info(std::string("  - ") + name);
+    // Parsed and analyzed once; every renderer reads the same document.
+    // Use RealFileSystem for CLI compile
+    forma::fs::RealFileSystem realfs;
+    forma::render_targets(doc, input_file, targets, realfs);
+
+    // Report in --renderer order so output does not depend on scheduling
+    bool failed = false;
+    for (const auto& target : targets) {
+        if (!target.ok) {
+            tracer.error(std::string("Plugin rendering failed: ") + target.name);
+            failed = true;
         }
+    }
+    if (failed) {
         return 1;
     }
+    tracer.end_stage();
 
     tracer.info("\n✓ Compilation successful");
-    tracer.info(std::string("  Output: ") + output_file);
+    for (const auto& target : targets) {
+        tracer.info(std::string("  Output: ") + target.output_file);
+    }
     
     return 0;
 }
@@ -235,7 +237,7 @@ int main(int argc, char* argv[]) {
     // Global options
     app.add_flag("-v,--verbose", opts.verbose, "Enable verbose output");
     app.add_flag("--debug", opts.debug, "Enable debug output");
-    app.add_option("--renderer", opts.renderer, "Renderer backend: js, sdl, lvgl, vulkan");
+    app.add_option("--renderer", opts.renderer, "Renderer backend: js, sdl, lvgl, vulkan; comma-separated to render several targets at once (e.g., lvgl,cpp,json)");
     app.add_option("--plugin", opts.plugins, "Load plugin by name (e.g., c-codegen, lvgl-renderer)")->expected(1, -1);
     app.add_option("--plugin-dir", opts.plugin_dirs, "Add directory to plugin search path")->expected(1, -1);
     app.add_flag("--list-plugins", opts.list_plugins, "List all loaded plugins");
@@ -269,6 +271,7 @@ int main(int argc, char* argv[]) {
     build_cmd->add_option("--project", opts.project_path, "Project directory");
     build_cmd->add_flag("--flash", opts.flash, "Flash to device after build (embedded targets)");
     build_cmd->add_flag("--monitor", opts.monitor, "Start serial monitor after flash (embedded targets)");
+    build_cmd->add_option("-j,--jobs", opts.jobs, "Parallel compile jobs (default: [build] jobs or all cores)");
     build_cmd->callback([&opts]() { opts.mode = "build"; });
 
     // Run command
@@ -337,6 +340,7 @@ int main(int argc, char* argv[]) {
         build_opts.verbose = opts.verbose;
         build_opts.flash = opts.flash;
         build_opts.monitor = opts.monitor;
+        build_opts.jobs = opts.jobs;
         
         return forma::commands::run_build_command(build_opts);
     }
@@ -376,6 +380,8 @@ int main(int argc, char* argv[]) {
 
     // Load plugins
     auto plugin_loader = std::make_unique<forma::PluginLoader>();
+    plugin_loader->use_registry_cache();
+    plugin_loader->set_lazy_loading(true);
     forma::tracer::TracerPlugin* active_tracer = &tracer;
     
     // Register built-in LVGL renderer plugin with inline metadata
@@ -441,7 +447,10 @@ int main(int argc, char* argv[]) {
     active_tracer->end_stage();
 
     // Resolve imports
-    forma::pipeline::resolve_imports(doc, opts.input_file, *active_tracer);
+    auto imports = forma::pipeline::resolve_imports(doc, opts.input_file, *active_tracer);
+    if (!imports.missing().empty()) {
+        return 1;
+    }
 
     // Type check
     if (forma::pipeline::run_semantic_analysis(doc, *active_tracer) != 0) {
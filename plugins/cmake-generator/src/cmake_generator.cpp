@@ -563,7 +563,7 @@ extern "C" {
                 // try stream_io
                 if (host->stream_io.open_read(config_path)) {
                     auto toml_str = *host->stream_io.open_read(config_path);
-                    auto doc = toml::parse<16>(toml_str);
+                    auto doc = toml::parse_runtime(std::string(toml_str));
                     if (auto* cmake_table = doc.get_table("cmake")) {
                         config.load_from_toml(*cmake_table);
                     }
@@ -22,7 +22,7 @@ struct CMakeGeneratorConfig {
     std::string target_triple; // Target architecture/platform (e.g., "aarch64-linux-gnu")
     
     // Load config from TOML table
-    void load_from_toml(const forma::toml::Table<32>& table) {
+    void load_from_toml(const forma::toml::RuntimeTable& table) {
         if (auto val = table.get_string("project_name")) project_name = std::string(*val);
         if (auto val = table.get_string("cmake_minimum_version")) cmake_minimum_version = std::string(*val);
         if (auto val = table.get_string("cxx_standard")) cxx_standard = std::string(*val);
@@ -32,8 +32,13 @@ struct CMakeGeneratorConfig {
         if (auto val = table.get_string("target_name")) target_name = std::string(*val);
         if (auto val = table.get_string("target_triple")) target_triple = std::string(*val);
         
-        // TODO: Support arrays when TOML parser adds array iteration
-        // source_files, include_dirs, link_libraries, compile_options
+        auto append = [&](std::vector<std::string>& list, std::string_view key) {
+            for (auto value : table.get_strings(key)) list.emplace_back(value);
+        };
+        append(source_files, "source_files");
+        append(include_dirs, "include_dirs");
+        append(link_libraries, "link_libraries");
+        append(compile_options, "compile_options");
     }
 };
 
@@ -0,0 +1,188 @@
+// Load generator for the HTTP LSP server.
+//
+// Starts the server in-process on an ephemeral port (or targets a running
+// one), opens C client connections and sends N requests per connection:
+// one didOpen each, then alternating didChange/diagnostic requests on a
+// per-client document. Reports requests per second and p50/p99 latency.
+// With --close every request uses a fresh connection, for comparison with
+// keep-alive.
+//
+// Usage: forma_http_load_bench [--clients C] [--requests N] [--port P] [--close]
+//        (default: 8 clients, 2000 requests each, in-process server)
+
+#include "lsp.hpp"
+#include "http_server.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    size_t clients = 8;
+    size_t requests = 2000;
+    int port = 0;  // 0: run an in-process server
+    bool keep_alive = true;
+};
+
+int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+std::string make_request(std::string_view body, bool keep_alive) {
+    std::string request = "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\n";
+    request += keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    request += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    request += body;
+    return request;
+}
+
+// Send one request and read its response; false on connection failure
+bool round_trip(int fd, const std::string& request, std::string& buffer) {
+    for (size_t sent = 0; sent < request.size();) {
+        ssize_t n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+
+    buffer.clear();
+    forma::http::HttpRequest response;
+    std::array<char, 16 * 1024> chunk;
+    for (;;) {
+        // The response has the same framing as a request
+        auto status = forma::http::parse_http_request(buffer, response, SIZE_MAX);
+        if (status == forma::http::HttpParseStatus::Complete) return true;
+        if (status != forma::http::HttpParseStatus::Incomplete) return false;
+        ssize_t n = read(fd, chunk.data(), chunk.size());
+        if (n <= 0) return false;
+        buffer.append(chunk.data(), static_cast<size_t>(n));
+    }
+}
+
+std::string document_text(size_t client, size_t revision) {
+    std::string text;
+    for (size_t i = 0; i < 20; ++i) {
+        text += "class Widget" + std::to_string(i) + " {\\n    property value: int\\n    property label: string\\n}\\n";
+    }
+    text += "Widget0 {\\n    value: " + std::to_string(client * 100000 + revision) + "\\n}\\n";
+    return text;
+}
+
+std::vector<double> run_client(const Options& options, size_t client) {
+    std::vector<double> latencies;
+    latencies.reserve(options.requests);
+
+    std::string uri = "file:///client" + std::to_string(client) + ".fml";
+    std::string buffer;
+    int fd = -1;
+
+    for (size_t i = 0; i < options.requests; ++i) {
+        std::string body;
+        if (i == 0) {
+            body = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"textDocument/didOpen\",\"params\":{\"textDocument\":{\"uri\":\"" +
+                   uri + "\",\"languageId\":\"forma\",\"version\":1,\"text\":\"" + document_text(client, 0) + "\"}}}";
+        } else if (i % 2 == 1) {
+            body = "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(i + 1) +
+                   ",\"method\":\"textDocument/didChange\",\"params\":{\"textDocument\":{\"uri\":\"" + uri +
+                   "\",\"version\":" + std::to_string(i + 1) + "},\"contentChanges\":[{\"text\":\"" +
+                   document_text(client, i) + "\"}]}}";
+        } else {
+            body = "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(i + 1) +
+                   ",\"method\":\"textDocument/diagnostic\",\"params\":{\"textDocument\":{\"uri\":\"" + uri + "\"}}}";
+        }
+        std::string request = make_request(body, options.keep_alive);
+
+        auto start = std::chrono::steady_clock::now();
+        if (fd < 0) {
+            fd = connect_to(options.port);
+        }
+        if (fd < 0 || !round_trip(fd, request, buffer)) {
+            std::cerr << "client " << client << ": request " << i << " failed\n";
+            break;
+        }
+        if (!options.keep_alive) {
+            close(fd);
+            fd = -1;
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    if (fd >= 0) close(fd);
+    return latencies;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--clients" && i + 1 < argc) options.clients = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--requests" && i + 1 < argc) options.requests = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--port" && i + 1 < argc) options.port = std::atoi(argv[++i]);
+        else if (arg == "--close") options.keep_alive = false;
+    }
+
+    forma::lsp::LSPDocumentManager<64> manager;
+    std::unique_ptr<forma::http::HttpServer<forma::lsp::LSPDocumentManager<64>>> server;
+    std::thread server_thread;
+    if (options.port == 0) {
+        server = std::make_unique<forma::http::HttpServer<forma::lsp::LSPDocumentManager<64>>>(0, manager);
+        if (!server->start()) {
+            std::cerr << "Failed to start server\n";
+            return 1;
+        }
+        options.port = server->bound_port();
+        server_thread = std::thread([&] { server->run(); });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<double>> results(options.clients);
+    {
+        std::vector<std::thread> clients;
+        for (size_t c = 0; c < options.clients; ++c) {
+            clients.emplace_back([&, c] { results[c] = run_client(options, c); });
+        }
+        for (auto& t : clients) t.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (server) {
+        server->stop();
+        server_thread.join();
+    }
+
+    std::vector<double> latencies;
+    for (auto& r : results) latencies.insert(latencies.end(), r.begin(), r.end());
+    if (latencies.empty()) {
+        std::cerr << "No requests completed\n";
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * static_cast<double>(latencies.size())))];
+    };
+
+    std::cout << options.clients << " clients, " << latencies.size() << " requests"
+              << (options.keep_alive ? " (keep-alive)" : " (connection per request)") << ": "
+              << static_cast<size_t>(static_cast<double>(latencies.size()) / seconds) << " req/s, p50 "
+              << percentile(0.50) << " us, p99 " << percentile(0.99) << " us\n";
+    return 0;
+}
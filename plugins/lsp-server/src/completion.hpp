@@ -0,0 +1,527 @@
+#pragma once
+
+#include "document_buffer.hpp"
+#include "semantic_tokens.hpp"
+#include <parser/widget_registry.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace forma::lsp {
+
+// ============================================================================
+// Completion - Prefix lookups over declarations, widgets and keywords
+// ============================================================================
+
+// LSP CompletionItemKind values
+enum class CompletionItemKind : int {
+    Method = 2,
+    Class = 7,
+    Property = 10,
+    Value = 12,
+    Enum = 13,
+    Keyword = 14,
+    EnumMember = 20,
+    Event = 23,
+    TypeParameter = 25,
+};
+
+struct CompletionItem {
+    std::string label;
+    std::string detail;
+    CompletionItemKind kind = CompletionItemKind::Keyword;
+};
+
+// Labels sorted case-insensitively, so the entries starting with a prefix
+// are one contiguous range found by two binary searches. Labels and
+// details are views; whoever fills the index keeps their text alive (the
+// analysed document, or static storage for the built-in entries). An
+// entry may name the origin it was taken from, so that update() can
+// replace the entries of some origins without sorting the rest again.
+class CompletionIndex {
+public:
+    struct Entry {
+        std::string_view label;
+        std::string_view detail;
+        CompletionItemKind kind;
+        const void* origin = nullptr;
+    };
+
+    void clear() { entries.clear(); }
+
+    void add(std::string_view label, std::string_view detail, CompletionItemKind kind,
+             const void* origin = nullptr) {
+        if (!label.empty()) {
+            entries.push_back({label, detail, kind, origin});
+        }
+    }
+
+    // Call after the last add()
+    void sort() {
+        std::ranges::stable_sort(entries, less);
+    }
+
+    // Make the index hold the entries of exactly `origins` (pointers or
+    // shared_ptrs): entries of origins no longer listed are dropped, and
+    // `add_entries(origin, added)` fills in those of listed origins the
+    // index has no entries from yet. Only the added entries are sorted;
+    // the rest of the index is merged with them in one linear pass.
+    template <typename Origins, typename AddEntries>
+    void update(const Origins& origins, AddEntries&& add_entries) {
+        std::unordered_set<const void*> listed;
+        for (const auto& origin : origins) {
+            listed.insert(std::to_address(origin));
+        }
+        std::unordered_set<const void*> indexed;
+        std::erase_if(entries, [&](const Entry& entry) {
+            if (!listed.contains(entry.origin)) {
+                return true;
+            }
+            indexed.insert(entry.origin);
+            return false;
+        });
+
+        CompletionIndex added;
+        for (const auto& origin : origins) {
+            if (!indexed.contains(std::to_address(origin))) {
+                add_entries(*origin, added);
+            }
+        }
+        added.sort();
+        auto middle = static_cast<std::ptrdiff_t>(entries.size());
+        entries.insert(entries.end(), added.entries.begin(), added.entries.end());
+        std::inplace_merge(entries.begin(), entries.begin() + middle, entries.end(), less);
+    }
+
+    size_t size() const { return entries.size(); }
+
+    // Entries whose label starts with `prefix`, ignoring case
+    std::span<const Entry> with_prefix(std::string_view prefix) const {
+        auto first = std::ranges::lower_bound(entries, prefix, less_key, &Entry::label);
+        auto last = std::find_if(first, entries.end(), [&](const Entry& entry) {
+            return !starts_with(entry.label, prefix);
+        });
+        return {first, last};
+    }
+
+    static bool starts_with(std::string_view label, std::string_view prefix) {
+        return label.size() >= prefix.size() &&
+               std::ranges::equal(label.substr(0, prefix.size()), prefix, {}, lower, lower);
+    }
+
+private:
+    std::vector<Entry> entries;
+
+    static constexpr char lower(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    static bool less_key(std::string_view a, std::string_view b) {
+        return std::ranges::lexicographical_compare(a, b, {}, lower, lower);
+    }
+
+    static bool less(const Entry& a, const Entry& b) {
+        return less_key(a.label, b.label);
+    }
+};
+
+// What the text before the cursor asks for
+struct CompletionContext {
+    enum class Kind {
+        TopLevel,  // Declarations and root instances
+        Type,      // After `property name:`, a class's `:` or in parameters
+        Member,    // Statement start inside an instance: properties, children
+        Value,     // After `name:` inside an instance
+        EnumValue, // After `Enum.`
+        ClassBody, // Inside a class: member keywords
+        None,      // Inside an enum body, a string, ...
+    } kind = Kind::TopLevel;
+    std::string_view prefix;     // Identifier characters before the cursor
+    std::string_view instance;   // Type of the enclosing instance
+    std::string_view property;   // For Value: the property being assigned
+    std::string_view qualifier;  // For EnumValue: the enum
+};
+
+namespace detail {
+
+constexpr bool is_completion_identifier_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Built-in widgets, properties, events, types and keywords, plus the
+// widgets and properties plugins registered through widgets::overlay().
+// Overlay labels are copied into `overlay_names`, as the overlay may be
+// cleared while the index is in use.
+struct BuiltinCompletions {
+    CompletionIndex index;
+    std::vector<std::string> overlay_names;
+    uint64_t generation = 0;
+};
+
+inline std::shared_ptr<const BuiltinCompletions> build_builtin_completions(uint64_t generation) {
+    auto out = std::make_shared<BuiltinCompletions>();
+    out->generation = generation;
+    CompletionIndex& index = out->index;
+    for (const auto& [name, info] : forma::widgets::BUILTIN_WIDGETS.all()) {
+        index.add(name, "widget", CompletionItemKind::Class);
+    }
+    for (const auto& [name, info] : forma::widgets::BUILTIN_PROPERTIES.all()) {
+        index.add(name, "widget property", CompletionItemKind::Property);
+    }
+    for (const auto& [name, info] : forma::widgets::BUILTIN_EVENTS.all()) {
+        index.add(name, "widget event", CompletionItemKind::Event);
+    }
+    for (std::string_view type : {"int", "float", "string", "bool", "void"}) {
+        index.add(type, "built-in type", CompletionItemKind::TypeParameter);
+    }
+    for (std::string_view keyword : {"class", "enum", "event", "import", "property", "method", "when", "on",
+                                     "animate", "preview", "true", "false"}) {
+        index.add(keyword, "keyword", CompletionItemKind::Keyword);
+    }
+
+    // Built-in names win, as they do in widgets::lvgl_widget()
+    std::vector<std::string> widgets = forma::widgets::overlay().widget_names();
+    std::vector<std::string> properties = forma::widgets::overlay().property_names();
+    out->overlay_names.reserve(widgets.size() + properties.size());  // Labels view these strings
+    for (auto& name : widgets) {
+        if (!forma::widgets::BUILTIN_WIDGETS.find(name)) {
+            index.add(out->overlay_names.emplace_back(std::move(name)), "plugin widget", CompletionItemKind::Class);
+        }
+    }
+    for (auto& name : properties) {
+        if (!forma::widgets::BUILTIN_PROPERTIES.find(name)) {
+            index.add(out->overlay_names.emplace_back(std::move(name)), "plugin widget property",
+                      CompletionItemKind::Property);
+        }
+    }
+    index.sort();
+    return out;
+}
+
+// Built once, and again whenever a plugin changed the overlay. Callers
+// hold the returned pointer for as long as they use its entries.
+inline std::shared_ptr<const BuiltinCompletions> builtin_completions() {
+    static std::mutex mutex;
+    static std::shared_ptr<const BuiltinCompletions> current;
+    uint64_t generation = forma::widgets::overlay().generation();
+    std::lock_guard lock(mutex);
+    if (!current || current->generation != generation) {
+        current = build_builtin_completions(generation);
+    }
+    return current;
+}
+
+} // namespace detail
+
+// Classify the cursor at `offset` of `buffer` from the tokens of the
+// declaration it is in. Only that segment (and, after error recovery, the
+// ones still open before it) is looked at, so the cost does not grow with
+// the document; the buffer is the current text, which may be newer than
+// the last analysis.
+inline CompletionContext completion_context(const DocumentBuffer& buffer, size_t offset) {
+    using forma::TokenKind;
+    CompletionContext context;
+
+    size_t base = 0;
+    size_t index = 0;
+    while (index + 1 < buffer.segment_count() && base + buffer.segment(index).length < offset) {
+        base += buffer.segment(index).length;
+        ++index;
+    }
+    if (buffer.segment_count() == 0) {
+        return context;
+    }
+    const auto& segment = buffer.segment(index);
+    std::string_view text = segment.source;
+    size_t cursor = std::min(offset - base, segment.length);
+
+    size_t start = cursor;
+    while (start > 0 && detail::is_completion_identifier_char(text[start - 1])) {
+        --start;
+    }
+    context.prefix = text.substr(start, cursor - start);
+
+    // Error recovery can start a segment inside a block (`mode: Mode.` cuts
+    // before the next word), so earlier segments that leave braces open
+    // are scanned too
+    struct Token { TokenKind kind; std::string_view text; };
+    std::vector<Token> scanned;
+    auto net_depth = [](const auto& seg) {
+        long depth = 0;
+        for (size_t i = 0; i < seg.tokens.size() && seg.tokens.offset(i) < seg.length; ++i) {
+            depth += (seg.tokens.kind(i) == TokenKind::LBrace) - (seg.tokens.kind(i) == TokenKind::RBrace);
+        }
+        return depth;
+    };
+    size_t first = index;
+    while (first > 0 && net_depth(buffer.segment(first - 1)) > 0) {
+        --first;
+    }
+    for (size_t s = first; s < index; ++s) {
+        const auto& earlier = buffer.segment(s);
+        for (size_t i = 0; i < earlier.tokens.size() && earlier.tokens.offset(i) < earlier.length; ++i) {
+            scanned.push_back({earlier.tokens.kind(i), earlier.tokens.text(i)});
+        }
+    }
+
+    const forma::TokenBuffer& tokens = segment.tokens;
+    size_t before = 0;  // Tokens of the segment before the prefix
+    while (before < tokens.size() && tokens.kind(before) != TokenKind::EndOfFile && tokens.end(before) <= start) {
+        ++before;
+    }
+    if (before < tokens.size() && tokens.offset(before) < cursor && tokens.kind(before) == TokenKind::StringLiteral) {
+        context.kind = CompletionContext::Kind::None;  // Inside a string
+        return context;
+    }
+    for (size_t i = 0; i < before; ++i) {
+        scanned.push_back({tokens.kind(i), tokens.text(i)});
+    }
+
+    // Frames of the braces open at the cursor
+    enum class Frame { Instance, Class, Enum, Block };
+    struct Open { Frame frame; std::string_view name; };
+    std::vector<Open> stack;
+    size_t paren_depth = 0;
+    size_t count = scanned.size();
+    auto kind = [&](size_t i, size_t back) { return i >= back ? scanned[i - back].kind : TokenKind::EndOfFile; };
+    auto text_at = [&](size_t i) { return scanned[i].text; };
+
+    for (size_t i = 0; i < count; ++i) {
+        switch (scanned[i].kind) {
+            case TokenKind::LParen: ++paren_depth; break;
+            case TokenKind::RParen: paren_depth -= paren_depth > 0; break;
+            case TokenKind::RBrace:
+                if (!stack.empty()) stack.pop_back();
+                break;
+            case TokenKind::LBrace: {
+                // class Name {, class Name : Base {, Name : Base {, enum Name {, Name {
+                if (kind(i, 2) == TokenKind::Enum) {
+                    stack.push_back({Frame::Enum, text_at(i - 1)});
+                } else if (kind(i, 2) == TokenKind::Class || kind(i, 4) == TokenKind::Class) {
+                    stack.push_back({Frame::Class, {}});
+                } else if (kind(i, 1) == TokenKind::Identifier) {
+                    // `name: Type {` is taken as an instance of Type
+                    stack.push_back({Frame::Instance, text_at(i - 1)});
+                } else {
+                    // when (...) {, animate ... {: statements of the enclosing instance
+                    Open enclosing = stack.empty() ? Open{Frame::Block, {}} : stack.back();
+                    stack.push_back({enclosing.frame == Frame::Instance ? Frame::Instance : Frame::Block, enclosing.name});
+                }
+                break;
+            }
+            default: break;
+        }
+    }
+
+    TokenKind prev = kind(count, 1);
+    Frame frame = stack.empty() ? Frame::Block : stack.back().frame;
+    if (!stack.empty() && frame == Frame::Instance) {
+        context.instance = stack.back().name;
+    }
+
+    using Kind = CompletionContext::Kind;
+    if (prev == TokenKind::Dot && kind(count, 2) == TokenKind::Identifier) {
+        context.kind = Kind::EnumValue;
+        context.qualifier = text_at(count - 2);
+    } else if (prev == TokenKind::Colon) {
+        TokenKind before = kind(count, 3);
+        bool declaration = before == TokenKind::Property || before == TokenKind::Class || paren_depth > 0 ||
+                           stack.empty() || frame == Frame::Class;
+        context.kind = declaration ? Kind::Type : Kind::Value;
+        if (!declaration && kind(count, 2) == TokenKind::Identifier) {
+            context.property = text_at(count - 2);
+        }
+    } else if (paren_depth > 0 || frame == Frame::Enum) {
+        context.kind = paren_depth > 0 && frame == Frame::Instance ? Kind::Value : Kind::None;
+    } else if (frame == Frame::Class) {
+        context.kind = prev == TokenKind::Property || prev == TokenKind::Method ? Kind::None : Kind::ClassBody;
+    } else if (frame == Frame::Instance) {
+        context.kind = Kind::Member;
+    } else if (!stack.empty()) {
+        context.kind = Kind::None;
+    } else {
+        context.kind = prev == TokenKind::Class || prev == TokenKind::Enum || prev == TokenKind::Event
+            ? Kind::None  // Naming a new declaration
+            : Kind::TopLevel;
+    }
+    return context;
+}
+
+// Completion items of one analysed document: its classes, enums with
+// their values, and events. Entries are read from the segment parses and
+// tagged with their segment, so installing a new analysis only drops the
+// entries of replaced segments and adds those of new ones instead of
+// rebuilding and sorting the whole index. The views point into the
+// segments' text, which the snapshot keeps alive. The previously indexed
+// segments lived until now, so none of the new ones can share an address
+// with a replaced one.
+inline void index_document_completions(CompletionIndex& index, const DocumentBuffer::Snapshot& snapshot) {
+    index.update(snapshot.segments, [](const DocumentBuffer::Segment& segment, CompletionIndex& added) {
+        const auto& doc = segment.doc;
+        for (size_t i = 0; i < doc.type_count; ++i) {
+            added.add(doc.types[i].name, doc.types[i].base_type, CompletionItemKind::Class, &segment);
+        }
+        for (size_t i = 0; i < doc.enum_count; ++i) {
+            added.add(doc.enums[i].name, "enum", CompletionItemKind::Enum, &segment);
+            for (size_t v = 0; v < doc.enums[i].value_count; ++v) {
+                added.add(doc.enums[i].values[v].name, doc.enums[i].name, CompletionItemKind::EnumMember, &segment);
+            }
+        }
+        for (size_t i = 0; i < doc.event_count; ++i) {
+            added.add(doc.events[i].name, "event", CompletionItemKind::Event, &segment);
+        }
+    });
+}
+
+// Items for `context`, from the document's index, its AST (the properties
+// of the instance's class and its bases) and the built-in entries
+template <typename DocType>
+std::vector<CompletionItem> complete(const CompletionContext& context, const CompletionIndex& document,
+                                     const DocType& doc, size_t limit = 200) {
+    using Kind = CompletionContext::Kind;
+    std::vector<CompletionItem> out;
+    auto add = [&](const CompletionIndex::Entry& entry) {
+        if (out.size() < limit) out.push_back({std::string(entry.label), std::string(entry.detail), entry.kind});
+    };
+    auto add_matching = [&](const CompletionIndex& index, auto&& accept) {
+        for (const auto& item : index.with_prefix(context.prefix)) {
+            if (accept(item)) add(item);
+        }
+    };
+    auto find_type = [&](std::string_view name) -> const TypeDecl* {
+        for (size_t i = 0; i < doc.type_count; ++i) {
+            if (doc.types[i].name == name) return &doc.types[i];
+        }
+        return nullptr;
+    };
+    auto find_enum = [&](std::string_view name) -> const EnumDecl* {
+        for (size_t i = 0; i < doc.enum_count; ++i) {
+            if (doc.enums[i].name == name) return &doc.enums[i];
+        }
+        return nullptr;
+    };
+    auto enum_members = [&](const EnumDecl& decl) {
+        for (size_t v = 0; v < decl.value_count; ++v) {
+            if (CompletionIndex::starts_with(decl.values[v].name, context.prefix)) {
+                add({decl.values[v].name, decl.name, CompletionItemKind::EnumMember});
+            }
+        }
+    };
+    auto is = [](CompletionItemKind kind) {
+        return [kind](const CompletionIndex::Entry& item) { return item.kind == kind; };
+    };
+    auto is_type = [](const CompletionIndex::Entry& item) {
+        return item.kind == CompletionItemKind::Class || item.kind == CompletionItemKind::Enum ||
+               item.kind == CompletionItemKind::TypeParameter;
+    };
+    auto builtin_set = detail::builtin_completions();
+    const CompletionIndex& builtin = builtin_set->index;
+
+    switch (context.kind) {
+        case Kind::None:
+            break;
+        case Kind::Type:
+            add_matching(document, is_type);
+            add_matching(builtin, is_type);
+            break;
+        case Kind::EnumValue:
+            if (const EnumDecl* decl = find_enum(context.qualifier)) {
+                enum_members(*decl);
+            }
+            break;
+        case Kind::Value: {
+            // An enum-typed property gets its enum's values; anything else
+            // every enum value and the booleans
+            const TypeDecl* type = find_type(context.instance);
+            for (size_t depth = 0; type && depth < 16; ++depth) {
+                for (size_t p = 0; p < type->prop_count; ++p) {
+                    if (type->properties[p].name == context.property) {
+                        if (const EnumDecl* decl = find_enum(type->properties[p].type.name)) {
+                            enum_members(*decl);
+                            return out;
+                        }
+                    }
+                }
+                type = find_type(type->base_type);
+            }
+            add_matching(document, is(CompletionItemKind::EnumMember));
+            add_matching(builtin, [](const CompletionIndex::Entry& item) {
+                return item.label == "true" || item.label == "false";
+            });
+            break;
+        }
+        case Kind::Member: {
+            // Properties of the instance's class and its bases, nearest first
+            const TypeDecl* type = find_type(context.instance);
+            for (size_t depth = 0; type && depth < 16; ++depth) {
+                for (size_t p = 0; p < type->prop_count; ++p) {
+                    if (CompletionIndex::starts_with(type->properties[p].name, context.prefix)) {
+                        add({type->properties[p].name, type->properties[p].type.name, CompletionItemKind::Property});
+                    }
+                }
+                type = find_type(type->base_type);
+            }
+            add_matching(builtin, is(CompletionItemKind::Property));
+            add_matching(document, is(CompletionItemKind::Class));
+            add_matching(builtin, is(CompletionItemKind::Class));
+            add_matching(builtin, [](const CompletionIndex::Entry& item) {
+                return item.label == "when" || item.label == "on" || item.label == "animate";
+            });
+            break;
+        }
+        case Kind::ClassBody:
+            add_matching(builtin, [](const CompletionIndex::Entry& item) {
+                return item.label == "property" || item.label == "method";
+            });
+            break;
+        case Kind::TopLevel:
+            add_matching(document, is(CompletionItemKind::Class));
+            add_matching(builtin, is(CompletionItemKind::Class));
+            add_matching(builtin, [](const CompletionIndex::Entry& item) {
+                return item.label == "class" || item.label == "enum" || item.label == "event" ||
+                       item.label == "import" || item.label == "preview";
+            });
+            break;
+    }
+    return out;
+}
+
+namespace detail {
+
+inline void append_json_string(std::string& out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    out += '"';
+}
+
+} // namespace detail
+
+// CompletionList result
+inline std::string encode_completions(const std::vector<CompletionItem>& items, bool incomplete) {
+    std::string out = incomplete ? "{\"isIncomplete\":true,\"items\":[" : "{\"isIncomplete\":false,\"items\":[";
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (i > 0) out += ',';
+        out += "{\"label\":";
+        detail::append_json_string(out, items[i].label);
+        out += ",\"kind\":";
+        detail::append_uint(out, static_cast<uint64_t>(items[i].kind));
+        if (!items[i].detail.empty()) {
+            out += ",\"detail\":";
+            detail::append_json_string(out, items[i].detail);
+        }
+        out += '}';
+    }
+    out += "]}";
+    return out;
+}
+
+} // namespace forma::lsp
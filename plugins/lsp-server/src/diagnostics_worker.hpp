@@ -0,0 +1,194 @@
+#pragma once
+
+#include "document_buffer.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace forma::lsp {
+
+// ============================================================================
+// Diagnostics Worker - Background analysis with debouncing
+// ============================================================================
+
+// Owns semantic analysis so the thread reading requests never waits for
+// it. schedule() (re)starts a per-URI debounce timer, so a burst of edits
+// results in one analysis of the last version. An analysis that is running
+// when a newer change is scheduled is abandoned at its next checkpoint,
+// and a result whose version no longer matches the document is dropped.
+//
+// `manager_mutex` guards the document manager. The worker holds it only to
+// snapshot a document and to install and publish the result, never while
+// analysing. `publish` is called with the lock held.
+template <typename Manager>
+class DiagnosticsWorker {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Publish = std::function<void(const std::string& uri)>;
+
+    DiagnosticsWorker(Manager& manager, std::mutex& manager_mutex, Publish publish,
+                      std::chrono::milliseconds debounce = std::chrono::milliseconds(100))
+        : manager(manager), manager_mutex(manager_mutex), publish(std::move(publish)), debounce(debounce) {
+        thread = std::thread([this] { run(); });
+    }
+
+    ~DiagnosticsWorker() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+
+    DiagnosticsWorker(const DiagnosticsWorker&) = delete;
+    DiagnosticsWorker& operator=(const DiagnosticsWorker&) = delete;
+
+    // Analyse `uri` once no further change arrives within the debounce window
+    void schedule(std::string_view uri) {
+        schedule_at(uri, Clock::now() + debounce);
+    }
+
+    // Analyse `uri` as soon as the worker is free (e.g. after didOpen)
+    void schedule_now(std::string_view uri) {
+        schedule_at(uri, Clock::now());
+    }
+
+    // Drop pending work for `uri`; a running analysis is abandoned
+    void cancel(std::string_view uri) {
+        std::lock_guard lock(mutex);
+        pending.erase(std::string(uri));
+        if (running == uri) {
+            running_cancelled = true;
+        }
+        if (pending.empty() && running.empty()) {
+            idle.notify_all();
+        }
+    }
+
+    // Block until nothing is pending or running
+    void wait_idle() {
+        std::unique_lock lock(mutex);
+        idle.wait(lock, [this] { return pending.empty() && running.empty(); });
+    }
+
+    size_t completed_count() const {
+        std::lock_guard lock(mutex);
+        return completed;
+    }
+
+    size_t cancelled_count() const {
+        std::lock_guard lock(mutex);
+        return cancelled;
+    }
+
+private:
+    Manager& manager;
+    std::mutex& manager_mutex;
+    Publish publish;
+    std::chrono::milliseconds debounce;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::unordered_map<std::string, Clock::time_point> pending;  // URI -> due time
+    std::string running;             // URI being analysed, empty when idle
+    bool running_cancelled = false;  // Set when `running` was rescheduled or cancelled
+    bool stopping = false;
+    size_t completed = 0;
+    size_t cancelled = 0;
+    std::thread thread;
+
+    void schedule_at(std::string_view uri, Clock::time_point due) {
+        {
+            std::lock_guard lock(mutex);
+            pending[std::string(uri)] = due;
+            if (running == uri) {
+                running_cancelled = true;
+            }
+        }
+        wake.notify_one();
+    }
+
+    void run() {
+        std::unique_lock lock(mutex);
+        for (;;) {
+            if (stopping) {
+                return;
+            }
+            if (pending.empty()) {
+                wake.wait(lock);
+                continue;
+            }
+
+            auto next = pending.begin();
+            for (auto it = pending.begin(); it != pending.end(); ++it) {
+                if (it->second < next->second) {
+                    next = it;
+                }
+            }
+            if (next->second > Clock::now()) {
+                wake.wait_until(lock, next->second);
+                continue;
+            }
+
+            std::string uri = next->first;
+            running = uri;
+            running_cancelled = false;
+            pending.erase(next);
+            lock.unlock();
+
+            bool done = analyze(uri);
+
+            lock.lock();
+            if (done) {
+                ++completed;
+            } else {
+                ++cancelled;
+            }
+            running.clear();
+            if (pending.empty()) {
+                idle.notify_all();
+            }
+        }
+    }
+
+    bool analyze(const std::string& uri) {
+        int version = 0;
+        DocumentBuffer::Snapshot snapshot;
+        {
+            std::lock_guard lock(manager_mutex);
+            auto* doc = manager.find_document(uri);
+            if (!doc) {
+                return false;
+            }
+            version = doc->version;
+            snapshot = doc->buffer.snapshot();
+        }
+
+        auto is_cancelled = [this] {
+            std::lock_guard lock(mutex);
+            return running_cancelled || stopping;
+        };
+        auto analysis = Manager::analyze_snapshot(version, std::move(snapshot), is_cancelled);
+        if (!analysis || is_cancelled()) {
+            return false;
+        }
+
+        std::lock_guard lock(manager_mutex);
+        if (!manager.install_analysis(uri, std::move(*analysis))) {
+            return false;
+        }
+        publish(uri);
+        return true;
+    }
+};
+
+} // namespace forma::lsp
@@ -0,0 +1,479 @@
+#pragma once
+
+#include <parser/ir.hpp>
+#include <parser/line_index.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace forma::lsp {
+
+// ============================================================================
+// Document Buffer - Editable source split at top-level declarations
+// ============================================================================
+
+// A rope whose leaves are the top-level declarations of a document. Each
+// segment owns its text together with the RuntimeDocument parsed from it,
+// so an edit re-parses only the segments it touches and every other
+// segment keeps its parse. Segment text is never modified in place (a
+// touched segment is replaced), which keeps the string_views held by its
+// parse valid for as long as the segment lives.
+//
+// The parser looks one token ahead, and error recovery in a malformed
+// declaration can read that token (e.g. `event` directly followed by
+// `enum`). Each segment therefore also stores the first token of the text
+// after it, so parsing it alone gives the same result as parsing the
+// whole document. An edit that changes that token always re-parses the
+// segment, since the segment before an edit is re-parsed with it.
+class DocumentBuffer {
+public:
+    struct Segment {
+        std::string source;  // Segment text followed by the lookahead token
+        size_t length = 0;   // Bytes of source that belong to the segment
+        size_t newlines = 0;
+        forma::TokenBuffer tokens;  // Of source, kept for highlighting
+        forma::RuntimeDocument doc;
+
+        Segment(std::string_view own, std::string_view following)
+            : source(make_source(own, following))
+            , length(own.size())
+            , newlines(static_cast<size_t>(std::count(own.begin(), own.end(), '\n')))
+            , tokens(source)
+            , doc(forma::parse_document_runtime(tokens, [this](size_t pos) { return pos < length; })) {}
+
+        std::string_view text() const { return std::string_view(source).substr(0, length); }
+
+    private:
+        static std::string make_source(std::string_view own, std::string_view following) {
+            forma::Lexer lexer{following, 0};
+            forma::next_token(lexer);
+            std::string out;
+            out.reserve(own.size() + lexer.pos);
+            out += own;
+            out += following.substr(0, lexer.pos);
+            return out;
+        }
+    };
+
+    using SegmentList = std::vector<std::shared_ptr<const Segment>>;
+
+    // The per-segment parses combined into one document equivalent to
+    // parsing the whole text in one go: declaration indices, instance child
+    // indices and source locations are rebased onto the whole document. The
+    // merge holds the segments it was built from, so the document's
+    // string_views stay valid for as long as the document is.
+    struct Merge {
+        // List sizes and text position after a segment
+        struct Mark {
+            size_t types = 0, enums = 0, events = 0, imports = 0, instances = 0, symbols = 0;
+            size_t offset = 0, line = 0, column = 0;
+        };
+
+        SegmentList segments;
+        std::vector<Mark> marks;  // One per segment
+        forma::RuntimeDocument doc;
+
+        explicit Merge(size_t arena_bytes) : doc(arena_bytes) {}
+
+        static std::shared_ptr<Merge> create(const SegmentList& segments) {
+            size_t types = 0, enums = 0, events = 0, imports = 0, instances = 0, symbols = 0;
+            for (const auto& segment : segments) {
+                types += segment->doc.type_count;
+                enums += segment->doc.enum_count;
+                events += segment->doc.event_count;
+                imports += segment->doc.import_count;
+                instances += segment->doc.instances.count;
+                symbols += segment->doc.symbols.count;
+            }
+
+            auto merge = std::make_shared<Merge>(
+                types * sizeof(TypeDecl) + enums * sizeof(EnumDecl) + events * sizeof(EventDecl) +
+                imports * sizeof(ImportDecl) + instances * sizeof(InstanceDecl) + 4096);
+            auto& doc = merge->doc;
+            doc.types.reserve(types);
+            doc.enums.reserve(enums);
+            doc.events.reserve(events);
+            doc.imports.reserve(imports);
+            doc.instances.instances.reserve(instances);
+            doc.symbols.reserve(symbols);
+            merge->rebuild(segments, 0);
+            return merge;
+        }
+
+        // Keep what the first `keep` segments contributed and append the
+        // rest of `next`, whose first `keep` segments must be ours
+        void rebuild(const SegmentList& next, size_t keep) {
+            Mark mark = keep > 0 ? marks[keep - 1] : Mark{};
+            truncate(doc.types, doc.type_count, mark.types);
+            truncate(doc.enums, doc.enum_count, mark.enums);
+            truncate(doc.events, doc.event_count, mark.events);
+            truncate(doc.imports, doc.import_count, mark.imports);
+            doc.instances.truncate(mark.instances);
+            doc.symbols.truncate(mark.symbols);
+
+            segments = next;
+            marks.resize(keep);
+            for (size_t i = keep; i < segments.size(); ++i) {
+                append(*segments[i], mark);
+                marks.push_back(mark);
+            }
+        }
+
+    private:
+        template <typename T>
+        static void truncate(std::pmr::vector<T>& list, size_t& count, size_t n) {
+            list.erase(list.begin() + static_cast<std::ptrdiff_t>(n), list.end());
+            count = n;
+        }
+
+        // Append one segment's declarations; `mark` is the position after
+        // the previous segment and is advanced past this one
+        void append(const Segment& segment, Mark& mark) {
+            // Segment-local positions move down by the lines before the
+            // segment; only those on its first line also move right
+            auto rebase = [&](forma::SourceLocation loc) {
+                if (loc.line == 0) {
+                    loc.column += mark.column;
+                }
+                loc.line += mark.line;
+                loc.offset += mark.offset;
+                return loc;
+            };
+
+            const auto& part = segment.doc;
+            size_t type_base = doc.type_count;
+            size_t enum_base = doc.enum_count;
+            size_t event_base = doc.event_count;
+            size_t instance_base = doc.instances.count;
+
+            for (size_t i = 0; i < part.type_count; ++i) {
+                append_decl(doc.types, doc.type_count, part.types[i]);
+            }
+            for (size_t i = 0; i < part.enum_count; ++i) {
+                append_decl(doc.enums, doc.enum_count, part.enums[i]);
+            }
+            for (size_t i = 0; i < part.event_count; ++i) {
+                append_decl(doc.events, doc.event_count, part.events[i]);
+            }
+            for (size_t i = 0; i < part.import_count; ++i) {
+                ImportDecl import = part.imports[i];
+                import.location = rebase(import.location);
+                append_decl(doc.imports, doc.import_count, import);
+            }
+            for (size_t i = 0; i < part.instances.count; ++i) {
+                InstanceDecl inst = part.instances.get(i);
+                for (size_t c = 0; c < inst.child_count; ++c) {
+                    inst.child_indices[c] += instance_base;
+                }
+                doc.instances.add_instance(inst);
+            }
+            for (size_t i = 0; i < part.symbols.count; ++i) {
+                Symbol sym = part.symbols.symbols[i];
+                sym.location = rebase(sym.location);
+                switch (sym.kind) {
+                    case Symbol::Kind::Type: sym.decl_index += type_base; break;
+                    case Symbol::Kind::Enum: sym.decl_index += enum_base; break;
+                    case Symbol::Kind::Event: sym.decl_index += event_base; break;
+                    case Symbol::Kind::Property: break;
+                }
+                doc.symbols.add_symbol(sym.kind, sym.name, sym.location, sym.decl_index);
+            }
+
+            mark.types = doc.type_count;
+            mark.enums = doc.enum_count;
+            mark.events = doc.event_count;
+            mark.imports = doc.import_count;
+            mark.instances = doc.instances.count;
+            mark.symbols = doc.symbols.count;
+            mark.offset += segment.length;
+            if (segment.newlines > 0) {
+                mark.line += segment.newlines;
+                mark.column = segment.length - segment.text().rfind('\n') - 1;
+            } else {
+                mark.column += segment.length;
+            }
+        }
+    };
+
+    // Recent merges of one buffer, shared with its snapshots. Copying every
+    // declaration on each analysis would cost time proportional to the
+    // document per keystroke, so a snapshot with the same segments as a kept
+    // merge shares its document, and a kept merge nobody else references is
+    // rewritten in place from the first segment that differs. Only when
+    // every kept merge is still in use is a new one built.
+    class MergeCache {
+    public:
+        std::shared_ptr<const forma::RuntimeDocument> build(const SegmentList& segments) {
+            std::lock_guard lock(mutex);
+            for (const auto& merge : merges) {
+                if (merge->segments == segments) {
+                    return std::shared_ptr<const forma::RuntimeDocument>(merge, &merge->doc);
+                }
+            }
+
+            std::shared_ptr<Merge>* reusable = nullptr;
+            size_t reused_prefix = 0;
+            for (auto& merge : merges) {
+                if (merge.use_count() > 1) {
+                    continue;
+                }
+                auto mismatch = std::mismatch(merge->segments.begin(), merge->segments.end(),
+                                              segments.begin(), segments.end());
+                size_t prefix = static_cast<size_t>(mismatch.first - merge->segments.begin());
+                if (!reusable || prefix > reused_prefix) {
+                    reusable = &merge;
+                    reused_prefix = prefix;
+                }
+            }
+
+            if (reusable) {
+                (*reusable)->rebuild(segments, reused_prefix);
+                return std::shared_ptr<const forma::RuntimeDocument>(*reusable, &(*reusable)->doc);
+            }
+            if (merges.size() == MAX_MERGES) {
+                merges.erase(merges.begin());
+            }
+            merges.push_back(Merge::create(segments));
+            return std::shared_ptr<const forma::RuntimeDocument>(merges.back(), &merges.back()->doc);
+        }
+
+    private:
+        static constexpr size_t MAX_MERGES = 2;
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Merge>> merges;
+    };
+
+    // Immutable view of the buffer at one point in time. Segments are
+    // shared, so taking a snapshot only copies pointers, and holding one
+    // keeps its text alive while the buffer goes on being edited; this is
+    // what lets analysis run on another thread.
+    struct Snapshot {
+        SegmentList segments;
+        size_t total_size = 0;
+        forma::LineIndex lines;  // Of text()
+        std::shared_ptr<MergeCache> merges;  // The buffer's; null in a default snapshot
+
+        std::string text() const {
+            std::string out;
+            out.reserve(total_size);
+            for (const auto& segment : segments) {
+                out += segment->text();
+            }
+            return out;
+        }
+
+        struct Token {
+            forma::TokenKind kind;
+            size_t offset;  // In text()
+            size_t length;  // Source span, quotes included
+        };
+
+        // Every token of text() in order, read from the segments' token
+        // buffers without re-lexing. The lookahead token stored after each
+        // segment is left out.
+        std::vector<Token> tokens() const {
+            size_t count = 0;
+            for (const auto& segment : segments) {
+                count += segment->tokens.size();
+            }
+            std::vector<Token> out;
+            out.reserve(count);
+            size_t base = 0;
+            for (const auto& segment : segments) {
+                const auto& buffer = segment->tokens;
+                for (size_t i = 0; i < buffer.size() && buffer.offset(i) < segment->length; ++i) {
+                    if (buffer.kind(i) != forma::TokenKind::EndOfFile) {
+                        out.push_back({buffer.kind(i), base + buffer.offset(i), buffer.length(i)});
+                    }
+                }
+                base += segment->length;
+            }
+            return out;
+        }
+
+        // Combine the per-segment parses into one document equivalent to
+        // parsing text() in one go. The document keeps the segment text it
+        // points into alive, and is shared with other snapshots of the same
+        // text, so it must not be modified.
+        std::shared_ptr<const forma::RuntimeDocument> build_document() const {
+            if (merges) {
+                return merges->build(segments);
+            }
+            auto merge = Merge::create(segments);
+            return std::shared_ptr<const forma::RuntimeDocument>(merge, &merge->doc);
+        }
+    };
+
+    // Replace the whole content and parse it from scratch
+    void assign(std::string_view source) {
+        segments.clear();
+        lines.build(source);
+        auto bounds = decl_offsets(source);
+        append_segments(segments, source, bounds, {});
+        total_size = source.size();
+        reparsed = segments.size();
+    }
+
+    // Replace the bytes in [start, end) with `replacement`. Offsets past the
+    // end are clamped.
+    void replace(size_t start, size_t end, std::string_view replacement) {
+        start = std::min(start, total_size);
+        end = std::clamp(end, start, total_size);
+        lines.update(start, end, replacement);
+        if (segments.empty()) {
+            assign(replacement);
+            return;
+        }
+
+        // Segments holding the two ends of the edit. An edit at the very end
+        // of the document belongs to the last segment.
+        size_t first = segments.size() - 1;
+        size_t last = segments.size() - 1;
+        size_t first_start = total_size - segments.back()->length;
+        size_t pos = 0;
+        bool first_found = false;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            size_t seg_end = pos + segments[i]->length;
+            if (!first_found && start < seg_end) {
+                first = i;
+                first_start = pos;
+                first_found = true;
+            }
+            if (first_found && end <= seg_end) {
+                last = i;
+                break;
+            }
+            pos = seg_end;
+        }
+
+        // The edit can also change how the preceding declaration ends
+        // (e.g. extending an import path), so it is always re-parsed too.
+        size_t lo = first > 0 ? first - 1 : first;
+        size_t region_start = first_start - (lo < first ? segments[lo]->length : 0);
+        size_t hi = last + 1;
+
+        std::string region;
+        for (size_t i = lo; i < hi; ++i) {
+            region += segments[i]->text();
+        }
+        region.replace(start - region_start, end - start, replacement);
+
+        // Pull in following segments until the parse of the edited region
+        // starts a declaration exactly where an old segment begins; from
+        // there on the old parse is still correct. The look-ahead doubles
+        // each round so an unterminated brace costs linear, not quadratic,
+        // work.
+        std::vector<size_t> bounds;
+        size_t lookahead = 1;
+        for (;;) {
+            if (hi == segments.size()) {
+                bounds = decl_offsets(region);
+                break;
+            }
+
+            size_t take = std::min(lookahead, segments.size() - hi);
+            std::string candidate = region;
+            std::vector<size_t> seg_starts;
+            for (size_t i = hi; i < hi + take; ++i) {
+                seg_starts.push_back(candidate.size());
+                candidate += segments[i]->text();
+            }
+            bounds = decl_offsets(candidate);
+
+            size_t synced = take;
+            for (size_t k = 0; k < take; ++k) {
+                if (std::binary_search(bounds.begin(), bounds.end(), seg_starts[k])) {
+                    synced = k;
+                    break;
+                }
+            }
+
+            for (size_t k = 0; k < synced; ++k) {
+                region += segments[hi + k]->text();
+            }
+            hi += synced;
+            if (synced < take) {
+                bounds.erase(std::lower_bound(bounds.begin(), bounds.end(), region.size()), bounds.end());
+                break;
+            }
+            lookahead *= 2;
+        }
+
+        std::vector<std::shared_ptr<const Segment>> fresh;
+        append_segments(fresh, region, bounds,
+                        hi < segments.size() ? segments[hi]->text() : std::string_view{});
+        reparsed = fresh.size();
+
+        segments.erase(segments.begin() + static_cast<std::ptrdiff_t>(lo),
+                       segments.begin() + static_cast<std::ptrdiff_t>(hi));
+        segments.insert(segments.begin() + static_cast<std::ptrdiff_t>(lo),
+                        std::make_move_iterator(fresh.begin()),
+                        std::make_move_iterator(fresh.end()));
+        total_size = total_size - (end - start) + replacement.size();
+    }
+
+    // Byte offset of a line/character position. Characters past the end of
+    // a line clamp to the line end, lines past the end to the document end.
+    size_t offset_at(size_t line, size_t character) const {
+        return lines.offset(line, character);
+    }
+
+    const forma::LineIndex& line_index() const { return lines; }
+
+    std::string text() const {
+        return snapshot().text();
+    }
+
+    Snapshot snapshot() const {
+        return Snapshot{segments, total_size, lines, merges};
+    }
+
+    size_t size() const { return total_size; }
+    size_t segment_count() const { return segments.size(); }
+    const Segment& segment(size_t index) const { return *segments[index]; }
+
+    // Segments parsed by the last assign() or replace()
+    size_t last_reparsed() const { return reparsed; }
+
+    // Combine the per-segment parses into one document
+    std::shared_ptr<const forma::RuntimeDocument> build_document() const {
+        return snapshot().build_document();
+    }
+
+private:
+    SegmentList segments;
+    std::shared_ptr<MergeCache> merges = std::make_shared<MergeCache>();
+    size_t total_size = 0;
+    size_t reparsed = 0;
+    forma::LineIndex lines;  // Kept in step with every edit
+
+    static std::vector<size_t> decl_offsets(std::string_view source) {
+        std::vector<size_t> bounds;
+        forma::parse_document_runtime(source, [&](size_t pos) { bounds.push_back(pos); });
+        return bounds;
+    }
+
+    // Cut `text` into one segment per declaration. Anything before the
+    // first declaration (whitespace, comments) goes into the first segment.
+    // `following` is the text after `text`, for the last segment's lookahead.
+    static void append_segments(std::vector<std::shared_ptr<const Segment>>& out, std::string_view text,
+                                const std::vector<size_t>& bounds, std::string_view following) {
+        size_t start = 0;
+        for (size_t i = 1; i < bounds.size(); ++i) {
+            size_t bound = bounds[i];
+            if (bound > start && bound < text.size()) {
+                out.push_back(std::make_shared<Segment>(text.substr(start, bound - start), text.substr(bound)));
+                start = bound;
+            }
+        }
+        if (start < text.size()) {
+            out.push_back(std::make_shared<Segment>(text.substr(start), following));
+        }
+    }
+};
+
+} // namespace forma::lsp
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "document_buffer.hpp"
+#include "semantic_tokens.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace forma::lsp {
+
+// ============================================================================
+// Document Symbols - Outline of declarations and instance trees
+// ============================================================================
+
+// LSP SymbolKind values
+enum class SymbolKind : int {
+    Class = 5,
+    Method = 6,
+    Property = 7,
+    Enum = 10,
+    Object = 19,
+    EnumMember = 22,
+    Event = 24,
+};
+
+struct DocumentSymbol {
+    std::string_view name;
+    std::string_view detail;  // Property type, base class, ...
+    SymbolKind kind = SymbolKind::Object;
+    size_t start = 0;  // Whole declaration, byte offsets
+    size_t end = 0;
+    size_t name_start = 0;  // Its name
+    size_t name_end = 0;
+    std::vector<DocumentSymbol> children;
+};
+
+// Walks the token stream for ranges and pairs classes and instances with
+// the declarations the parser produced, which supply details (property
+// types, base classes, return types). Declarations are paired in order and by name, so text the
+// parser recovered from differently only loses its details.
+template <typename DocType>
+class DocumentSymbolBuilder {
+public:
+    using Token = DocumentBuffer::Snapshot::Token;
+
+    DocumentSymbolBuilder(const std::vector<Token>& tokens, std::string_view source, const DocType& doc)
+        : tokens(tokens), source(source), doc(doc) {
+        std::vector<bool> is_child(doc.instances.count, false);
+        for (size_t i = 0; i < doc.instances.count; ++i) {
+            const auto& inst = doc.instances.get(i);
+            for (size_t c = 0; c < inst.child_count; ++c) {
+                if (inst.child_indices[c] < is_child.size()) {
+                    is_child[inst.child_indices[c]] = true;
+                }
+            }
+        }
+        for (size_t i = 0; i < doc.instances.count; ++i) {
+            if (!is_child[i]) {
+                top_level.push_back(i);
+            }
+        }
+    }
+
+    std::vector<DocumentSymbol> build() {
+        std::vector<DocumentSymbol> out;
+        size_t i = 0;
+        while (i < tokens.size()) {
+            // A class starts at `class` or at a @requires(...) before it
+            size_t name = tokens.size();
+            if (kind(i) == TokenKind::At) {
+                size_t after = close_of(i + 2, TokenKind::LParen, TokenKind::RParen) + 1;
+                name = kind(after) == TokenKind::Class ? after + 1 : after;
+            } else if (kind(i) == TokenKind::Class) {
+                name = i + 1;
+            }
+
+            if (name < tokens.size()) {
+                i = add_class(out, i, name);
+            } else if (kind(i) == TokenKind::Enum) {
+                i = add_enum(out, i);
+            } else if (kind(i) == TokenKind::Event) {
+                i = add_event(out, i);
+            } else if (kind(i) == TokenKind::Identifier && kind(i + 1) == TokenKind::LBrace) {
+                const InstanceDecl* decl = nullptr;
+                if (next_top_level < top_level.size() &&
+                    doc.instances.get(top_level[next_top_level]).type_name == text(i)) {
+                    decl = &doc.instances.get(top_level[next_top_level++]);
+                }
+                i = add_instance(out, i, decl);
+            } else {
+                ++i;
+            }
+        }
+        return out;
+    }
+
+private:
+    using TokenKind = forma::TokenKind;
+
+    const std::vector<Token>& tokens;
+    std::string_view source;
+    const DocType& doc;
+    std::vector<size_t> top_level;  // Instances that are nobody's child
+    size_t next_type = 0;
+    size_t next_top_level = 0;
+
+    TokenKind kind(size_t i) const { return i < tokens.size() ? tokens[i].kind : TokenKind::EndOfFile; }
+    std::string_view text(size_t i) const { return source.substr(tokens[i].offset, tokens[i].length); }
+    size_t token_end(size_t i) const { return tokens[i].offset + tokens[i].length; }
+
+    // Index of the token closing the group opened at `open`, or the last
+    // token when it is never closed. `open` not being `opener` gives open - 1.
+    size_t close_of(size_t open, TokenKind opener, TokenKind closer) const {
+        if (kind(open) != opener) {
+            return open - 1;
+        }
+        int depth = 0;
+        for (size_t i = open; i < tokens.size(); ++i) {
+            if (tokens[i].kind == opener) ++depth;
+            if (tokens[i].kind == closer && --depth == 0) return i;
+        }
+        return tokens.size() - 1;
+    }
+
+    DocumentSymbol make(size_t first, size_t last, size_t name, SymbolKind symbol_kind) const {
+        DocumentSymbol symbol;
+        symbol.kind = symbol_kind;
+        last = std::min(std::max(first, last), tokens.size() - 1);
+        symbol.start = tokens[first].offset;
+        symbol.end = token_end(last);
+        if (name < tokens.size() && kind(name) == TokenKind::Identifier) {
+            symbol.name = text(name);
+            symbol.name_start = tokens[name].offset;
+            symbol.name_end = token_end(name);
+        } else {
+            symbol.name = text(first);
+            symbol.name_start = symbol.start;
+            symbol.name_end = token_end(first);
+        }
+        return symbol;
+    }
+
+    // `name` is the index of the class name token
+    size_t add_class(std::vector<DocumentSymbol>& out, size_t first, size_t name) {
+        const TypeDecl* decl = nullptr;
+        if (next_type < doc.type_count && kind(name) == TokenKind::Identifier && doc.types[next_type].name == text(name)) {
+            decl = &doc.types[next_type++];
+        }
+        size_t open = name + 1;
+        if (kind(open) == TokenKind::Colon) {
+            open += 2;  // : BaseType
+        }
+        size_t close = close_of(open, TokenKind::LBrace, TokenKind::RBrace);
+        DocumentSymbol symbol = make(first, close, name, SymbolKind::Class);
+        if (decl) {
+            symbol.detail = decl->base_type;
+        }
+
+        // Members run from their keyword to the next member or the brace
+        size_t props = 0, methods = 0;
+        for (size_t i = open + 1; i < close;) {
+            size_t next = i + 1;
+            while (next < close && kind(next) != TokenKind::Property && kind(next) != TokenKind::Method) {
+                ++next;
+            }
+            if (kind(i) == TokenKind::Property) {
+                DocumentSymbol member = make(i, next - 1, i + 1, SymbolKind::Property);
+                if (decl && props < decl->prop_count && decl->properties[props].name == member.name) {
+                    member.detail = decl->properties[props++].type.name;
+                }
+                symbol.children.push_back(std::move(member));
+            } else if (kind(i) == TokenKind::Method) {
+                size_t method_name = i + 1;
+                while (method_name + 1 < next && kind(method_name + 1) != TokenKind::LParen) {
+                    ++method_name;
+                }
+                DocumentSymbol member = make(i, next - 1, method_name, SymbolKind::Method);
+                if (decl && methods < decl->method_count && decl->methods[methods].name == member.name) {
+                    member.detail = decl->methods[methods++].return_type.name;
+                }
+                symbol.children.push_back(std::move(member));
+            }
+            i = next;
+        }
+        out.push_back(std::move(symbol));
+        return close + 1;
+    }
+
+    size_t add_enum(std::vector<DocumentSymbol>& out, size_t first) {
+        size_t close = close_of(first + 2, TokenKind::LBrace, TokenKind::RBrace);
+        DocumentSymbol symbol = make(first, close, first + 1, SymbolKind::Enum);
+        for (size_t i = first + 3; i < close; ++i) {
+            if (kind(i) == TokenKind::Identifier) {
+                symbol.children.push_back(make(i, i, i, SymbolKind::EnumMember));
+            }
+        }
+        out.push_back(std::move(symbol));
+        return close + 1;
+    }
+
+    size_t add_event(std::vector<DocumentSymbol>& out, size_t first) {
+        size_t close = close_of(first + 2, TokenKind::LParen, TokenKind::RParen);
+        close = std::max(close, first + 1);
+        out.push_back(make(first, close, first + 1, SymbolKind::Event));
+        return close + 1;
+    }
+
+    // `first` is the type name; nested `Name {` blocks are child instances,
+    // other blocks (when, animate, preview) are skipped whole
+    size_t add_instance(std::vector<DocumentSymbol>& out, size_t first, const InstanceDecl* decl) {
+        size_t close = close_of(first + 1, TokenKind::LBrace, TokenKind::RBrace);
+        DocumentSymbol symbol = make(first, close, first, SymbolKind::Object);
+        size_t child = 0;
+        for (size_t i = first + 2; i < close;) {
+            if (kind(i) == TokenKind::Identifier && kind(i + 1) == TokenKind::LBrace) {
+                const InstanceDecl* child_decl = nullptr;
+                if (decl && child < decl->child_count && decl->child_indices[child] < doc.instances.count &&
+                    doc.instances.get(decl->child_indices[child]).type_name == text(i)) {
+                    child_decl = &doc.instances.get(decl->child_indices[child++]);
+                }
+                i = add_instance(symbol.children, i, child_decl);
+            } else if (kind(i) == TokenKind::LBrace) {
+                i = close_of(i, TokenKind::LBrace, TokenKind::RBrace) + 1;
+            } else {
+                ++i;
+            }
+        }
+        out.push_back(std::move(symbol));
+        return close + 1;
+    }
+};
+
+namespace detail {
+
+inline void append_range(std::string& out, const forma::LineIndex& lines, size_t start, size_t end) {
+    auto from = lines.position(start);
+    auto to = lines.position(end);
+    out += "{\"start\":{\"line\":";
+    append_uint(out, from.line);
+    out += ",\"character\":";
+    append_uint(out, from.column);
+    out += "},\"end\":{\"line\":";
+    append_uint(out, to.line);
+    out += ",\"character\":";
+    append_uint(out, to.column);
+    out += "}}";
+}
+
+inline void append_symbols(std::string& out, const forma::LineIndex& lines, const std::vector<DocumentSymbol>& symbols) {
+    out += '[';
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        const auto& symbol = symbols[i];
+        if (i > 0) out += ',';
+        // Names and details are identifiers or dotted type names: no escaping
+        out += "{\"name\":\"";
+        out += symbol.name;
+        out += "\",\"detail\":\"";
+        out += symbol.detail;
+        out += "\",\"kind\":";
+        append_uint(out, static_cast<uint64_t>(symbol.kind));
+        out += ",\"range\":";
+        append_range(out, lines, symbol.start, symbol.end);
+        out += ",\"selectionRange\":";
+        append_range(out, lines, symbol.name_start, symbol.name_end);
+        out += ",\"children\":";
+        append_symbols(out, lines, symbol.children);
+        out += '}';
+    }
+    out += ']';
+}
+
+} // namespace detail
+
+template <typename DocType>
+std::vector<DocumentSymbol> build_document_symbols(const DocumentBuffer::Snapshot& snapshot, std::string_view source,
+                                                   const DocType& doc) {
+    auto tokens = snapshot.tokens();
+    return DocumentSymbolBuilder<DocType>(tokens, source, doc).build();
+}
+
+// DocumentSymbol[] result
+inline std::string encode_document_symbols(const std::vector<DocumentSymbol>& symbols, const forma::LineIndex& lines) {
+    std::string out;
+    detail::append_symbols(out, lines, symbols);
+    return out;
+}
+
+} // namespace forma::lsp
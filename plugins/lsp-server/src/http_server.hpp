@@ -1,195 +1,618 @@
 #pragma once
 
+#include <core/thread_pool.hpp>
+#include "json_parser.hpp"
+#include <algorithm>
 #include <string>
 #include <string_view>
 #include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
-#include <sstream>
 #include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace forma::http {
 
 // Simple JSON builder for responses
 struct JsonBuilder {
     std::string json;
-    
+
     void start_object() { json += "{"; }
     void end_object() { json += "}"; }
     void start_array() { json += "["; }
     void end_array() { json += "]"; }
-    
+
     void add_string(std::string_view key, std::string_view value) {
         if (json.back() != '{' && json.back() != '[') json += ",";
         json += "\"" + std::string(key) + "\":\"" + std::string(value) + "\"";
     }
-    
+
     void add_number(std::string_view key, int value) {
         if (json.back() != '{' && json.back() != '[') json += ",";
         json += "\"" + std::string(key) + "\":" + std::to_string(value);
     }
-    
+
     void add_bool(std::string_view key, bool value) {
         if (json.back() != '{' && json.back() != '[') json += ",";
         json += "\"" + std::string(key) + "\":" + (value ? "true" : "false");
     }
-    
+
     void add_object_start(std::string_view key) {
         if (json.back() != '{' && json.back() != '[') json += ",";
         json += "\"" + std::string(key) + "\":{";
     }
-    
+
     void add_array_start(std::string_view key) {
         if (json.back() != '{' && json.back() != '[') json += ",";
         json += "\"" + std::string(key) + "\":[";
     }
 };
 
-// Simple JSON parser for extracting values
-inline std::string_view extract_string(std::string_view json, std::string_view key) {
-    std::string search = "\"" + std::string(key) + "\":\"";
-    size_t pos = json.find(search);
-    if (pos == std::string_view::npos) return "";
-    
-    pos += search.size();
-    size_t end = json.find("\"", pos);
-    if (end == std::string_view::npos) return "";
-    
-    return json.substr(pos, end - pos);
+// ============================================================================
+// HTTP/1.1 Framing
+// ============================================================================
+
+struct HttpRequest {
+    std::string_view method;   // "POST", "OPTIONS", ...
+    std::string_view body;
+    bool keep_alive = true;
+    size_t size = 0;           // Bytes of header and body consumed
+};
+
+enum class HttpParseStatus {
+    Incomplete,  // Need more bytes
+    Complete,
+    Invalid,
+    TooLarge
+};
+
+inline bool header_name_equals(std::string_view name, std::string_view expected) {
+    if (name.size() != expected.size()) return false;
+    for (size_t i = 0; i < name.size(); ++i) {
+        if ((name[i] | 0x20) != expected[i]) return false;
+    }
+    return true;
 }
 
-inline int extract_number(std::string_view json, std::string_view key) {
-    std::string search = "\"" + std::string(key) + "\":";
-    size_t pos = json.find(search);
-    if (pos == std::string_view::npos) return 0;
-    
-    pos += search.size();
-    return std::atoi(json.data() + pos);
+inline std::string_view trim_header_value(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+    return value;
 }
 
-inline std::string_view extract_object(std::string_view json, std::string_view key) {
-    std::string search = "\"" + std::string(key) + "\":";
-    size_t pos = json.find(search);
-    if (pos == std::string_view::npos) return "";
-    
-    pos += search.size();
-    if (pos >= json.size()) return "";
-    
-    // Skip whitespace
-    while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\n')) pos++;
-    
-    if (json[pos] == '{') {
-        size_t start = pos;
-        int depth = 0;
-        while (pos < json.size()) {
-            if (json[pos] == '{') depth++;
-            else if (json[pos] == '}') {
-                depth--;
-                if (depth == 0) return json.substr(start, pos - start + 1);
+// Parse one request from the front of `data`. The body is located by its
+// Content-Length, so it may arrive over any number of reads, and bytes
+// past it belong to the next (pipelined) request.
+inline constexpr size_t MAX_HTTP_HEADER = 16 * 1024;
+
+inline HttpParseStatus parse_http_request(std::string_view data, HttpRequest& out, size_t max_body) {
+    size_t header_end = data.find("\r\n\r\n");
+    if (header_end == std::string_view::npos) {
+        return data.size() > MAX_HTTP_HEADER ? HttpParseStatus::Invalid : HttpParseStatus::Incomplete;
+    }
+
+    std::string_view head = data.substr(0, header_end);
+    size_t line_end = head.find("\r\n");
+    std::string_view request_line = head.substr(0, line_end);
+
+    size_t sp1 = request_line.find(' ');
+    size_t sp2 = request_line.rfind(' ');
+    if (sp1 == std::string_view::npos || sp2 == sp1) {
+        return HttpParseStatus::Invalid;
+    }
+    out.method = request_line.substr(0, sp1);
+    std::string_view version = request_line.substr(sp2 + 1);
+    out.keep_alive = version == "HTTP/1.1";
+
+    size_t content_length = 0;
+    std::string_view headers = line_end == std::string_view::npos ? std::string_view{} : head.substr(line_end + 2);
+    while (!headers.empty()) {
+        size_t eol = headers.find("\r\n");
+        std::string_view line = headers.substr(0, eol);
+        headers = eol == std::string_view::npos ? std::string_view{} : headers.substr(eol + 2);
+
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            return HttpParseStatus::Invalid;
+        }
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = trim_header_value(line.substr(colon + 1));
+
+        if (header_name_equals(name, "content-length")) {
+            content_length = 0;
+            if (value.empty()) return HttpParseStatus::Invalid;
+            for (char c : value) {
+                if (c < '0' || c > '9') return HttpParseStatus::Invalid;
+                content_length = content_length * 10 + static_cast<size_t>(c - '0');
+                if (content_length > max_body) return HttpParseStatus::TooLarge;
             }
-            pos++;
+        } else if (header_name_equals(name, "connection")) {
+            if (header_name_equals(value, "close")) out.keep_alive = false;
+            else if (header_name_equals(value, "keep-alive")) out.keep_alive = true;
+        } else if (header_name_equals(name, "transfer-encoding")) {
+            return HttpParseStatus::Invalid;  // Chunked bodies are not supported
         }
     }
-    
-    return "";
+
+    size_t body_start = header_end + 4;
+    if (data.size() - body_start < content_length) {
+        return HttpParseStatus::Incomplete;
+    }
+    out.body = data.substr(body_start, content_length);
+    out.size = body_start + content_length;
+    return HttpParseStatus::Complete;
 }
 
+inline std::string build_http_response(int status, std::string_view reason, std::string_view body, bool keep_alive) {
+    std::string response;
+    response.reserve(body.size() + 192);
+    response += "HTTP/1.1 " + std::to_string(status) + " ";
+    response += reason;
+    response += "\r\nContent-Type: application/json\r\nContent-Length: ";
+    response += std::to_string(body.size());
+    response += "\r\nAccess-Control-Allow-Origin: *\r\n";
+    if (status == 204) {
+        // CORS preflight from the browser IDE
+        response += "Access-Control-Allow-Methods: POST, OPTIONS\r\n";
+        response += "Access-Control-Allow-Headers: Content-Type\r\n";
+        response += "Access-Control-Max-Age: 86400\r\n";
+    }
+    response += keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    response += body;
+    return response;
+}
+
+// ============================================================================
+// HTTP Server
+// ============================================================================
+
 // Simple HTTP server for LSP
+//
+// One thread runs an epoll loop that accepts connections, assembles
+// requests and writes responses; connections stay open between requests
+// (HTTP/1.1 keep-alive). Complete requests are handed to a worker pool and
+// the response comes back through an eventfd. Requests on one connection
+// are answered in order: the next one is dispatched only after the
+// previous response was sent. While a request is being served, at most
+// MAX_PIPELINED_INPUT bytes are buffered behind it; beyond that the
+// connection stops reading until the client catches up.
+//
+// Workers share the document manager under a mutex that is held to apply
+// edits and read results, but not while analysing, so analyses of
+// different documents run in parallel.
+//
+// didChange notifications for one document may arrive on different
+// connections and reach the workers in any order. They are applied
+// strictly by version: a change whose version is ahead of the document's
+// next one waits until the versions before it arrive, and a change that
+// is not newer than the document is dropped.
 template<typename LSPManager>
 class HttpServer {
-    int server_fd = -1;
-    int port;
-    LSPManager& lsp_manager;
-    std::string document_storage; // Store document text since string_view needs backing storage
-    
 public:
-    HttpServer(int p, LSPManager& manager) : port(p), lsp_manager(manager) {}
-    
+    static constexpr size_t MAX_BODY = 64 * 1024 * 1024;
+    static constexpr size_t MAX_PIPELINED_INPUT = 1024 * 1024;
+    static constexpr size_t MAX_DEFERRED_CHANGES = 64;  // Per document
+
+    HttpServer(int p, LSPManager& manager, size_t worker_count = forma::ThreadPool::default_thread_count())
+        : port(p), lsp_manager(manager), worker_count(worker_count) {}
+
     ~HttpServer() {
+        workers.reset();  // Finish in-flight requests before the fds go away
+        for (auto& [fd, conn] : connections) {
+            close(fd);
+        }
+        if (wake_fd >= 0) close(wake_fd);
+        if (epoll_fd >= 0) close(epoll_fd);
         if (server_fd >= 0) close(server_fd);
     }
-    
+
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
     bool start() {
-        server_fd = socket(AF_INET, SOCK_STREAM, 0);
+        server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
         if (server_fd < 0) return false;
-        
+
         int opt = 1;
         setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-        
+
         sockaddr_in address{};
         address.sin_family = AF_INET;
         address.sin_addr.s_addr = INADDR_ANY;
-        address.sin_port = htons(port);
-        
+        address.sin_port = htons(static_cast<uint16_t>(port));
+
         if (bind(server_fd, (sockaddr*)&address, sizeof(address)) < 0) return false;
-        if (listen(server_fd, 3) < 0) return false;
-        
+        if (listen(server_fd, SOMAXCONN) < 0) return false;
+
+        // Port 0 binds an ephemeral port; report the real one
+        socklen_t len = sizeof(address);
+        if (getsockname(server_fd, (sockaddr*)&address, &len) == 0) {
+            port = ntohs(address.sin_port);
+        }
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd < 0 || wake_fd < 0) return false;
+
+        if (!watch(server_fd, EPOLLIN, EPOLL_CTL_ADD) || !watch(wake_fd, EPOLLIN, EPOLL_CTL_ADD)) return false;
+
+        workers = std::make_unique<forma::ThreadPool>(worker_count);
         return true;
     }
-    
-    void handle_request(int client_socket) {
-        std::array<char, 4096> buffer;
-        ssize_t bytes_read = read(client_socket, buffer.data(), buffer.size() - 1);
-        if (bytes_read <= 0) return;
-        
-        buffer[bytes_read] = '\0';
-        std::string_view request(buffer.data(), bytes_read);
-        
-        // Find the JSON body (after \r\n\r\n)
-        size_t body_start = request.find("\r\n\r\n");
-        if (body_start == std::string_view::npos) {
-            send_error(client_socket, "Invalid request");
-            return;
+
+    int bound_port() const { return port; }
+
+    // Event loop; returns after stop()
+    void run() {
+        std::array<epoll_event, 64> events;
+        while (!stopping.load(std::memory_order_relaxed)) {
+            int n = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == server_fd) {
+                    accept_connections();
+                } else if (fd == wake_fd) {
+                    uint64_t count;
+                    (void)!read(wake_fd, &count, sizeof(count));
+                    deliver_completions();
+                } else {
+                    handle_event(fd, events[i].events);
+                }
+            }
+        }
+    }
+
+    // Safe to call from another thread or a signal handler
+    void stop() {
+        stopping.store(true, std::memory_order_relaxed);
+        uint64_t one = 1;
+        (void)!write(wake_fd, &one, sizeof(one));
+    }
+
+    // Dispatch one JSON-RPC message and return the response body. The
+    // message is parsed in place, so `body` is taken by value.
+    // Thread-safe; called from the worker pool.
+    std::string handle_message(std::string body) {
+        forma::lsp::JsonParser json;
+        if (!json.parse(body)) {
+            return build_error_response(0, -32700, "Parse error");
         }
-        
-        body_start += 4;
-        std::string_view json_body = request.substr(body_start);
-        
-        // Extract JSON-RPC fields
-        std::string_view method = extract_string(json_body, "method");
-        int id = extract_number(json_body, "id");
-        std::string_view params_str = extract_object(json_body, "params");
-        
+        JsonView root = json.root();
+        std::string_view method = root["method"].string();
+        int id = root["id"].integer(0);
+        JsonView params = root["params"];
+
         // Route to appropriate LSP method
-        std::string response;
         if (method == "initialize") {
-            response = handle_initialize(id, params_str);
+            return handle_initialize(id, params);
         } else if (method == "textDocument/didOpen") {
-            response = handle_did_open(id, params_str);
+            return handle_did_open(id, params);
         } else if (method == "textDocument/didChange") {
-            response = handle_did_change(id, params_str);
+            return handle_did_change(id, params);
         } else if (method == "textDocument/didClose") {
-            response = handle_did_close(id, params_str);
+            return handle_did_close(id, params);
         } else if (method == "textDocument/diagnostic") {
-            response = handle_diagnostic(id, params_str);
-        } else {
-            response = build_error_response(id, -32601, "Method not found");
+            return handle_diagnostic(id, params);
         }
-        
-        send_http_response(client_socket, response);
+        return build_error_response(id, -32601, "Method not found");
     }
-    
-    void run() {
-        while (true) {
-            sockaddr_in address{};
-            socklen_t addrlen = sizeof(address);
-            int client_socket = accept(server_fd, (sockaddr*)&address, &addrlen);
-            
-            if (client_socket < 0) continue;
-            
-            handle_request(client_socket);
-            close(client_socket);
-        }
-    }
-    
+
 private:
-    std::string handle_initialize(int id, std::string_view params) {
-        int process_id = extract_number(params, "processId");
-        std::string_view root_uri = extract_string(params, "rootUri");
-        
-        auto result = lsp_manager.initialize(process_id, root_uri);
-        
+    using JsonView = forma::lsp::JsonParser::View;
+
+    struct Connection {
+        uint64_t id = 0;
+        std::string input;           // Received, not yet parsed
+        std::string output;          // Queued for sending
+        size_t output_sent = 0;
+        bool busy = false;           // A request is with the workers
+        bool reading = true;         // Registered for EPOLLIN
+        bool want_write = false;     // Registered for EPOLLOUT
+        bool close_after_write = false;
+        bool peer_closed = false;
+    };
+
+    struct Completion {
+        int fd;
+        uint64_t connection_id;
+        std::string response;
+        bool keep_alive;
+    };
+
+    struct UriHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view uri) const { return std::hash<std::string_view>{}(uri); }
+    };
+
+    // A deferred didChange notification, copied out of its message.
+    // `changes` points into `texts`; moving the struct moves the vectors'
+    // storage, so the views survive.
+    struct ContentChanges {
+        std::vector<std::string> texts;
+        std::vector<forma::lsp::TextDocumentContentChangeEvent> changes;
+    };
+
+    int server_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    int port;
+    LSPManager& lsp_manager;
+    std::mutex manager_mutex;
+
+    // Changes that arrived ahead of their predecessors, by URI and then
+    // version; guarded by manager_mutex
+    std::unordered_map<std::string, std::map<int, ContentChanges>, UriHash, std::equal_to<>> deferred_changes;
+    size_t worker_count;
+    std::atomic<bool> stopping{false};
+
+    std::unordered_map<int, Connection> connections;  // Event loop thread only
+    uint64_t next_connection_id = 1;
+
+    std::mutex completions_mutex;
+    std::vector<Completion> completions;
+
+    // Declared last so it is destroyed first: tasks refer to the members above
+    std::unique_ptr<forma::ThreadPool> workers;
+
+    bool watch(int fd, uint32_t events, int op) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        return epoll_ctl(epoll_fd, op, fd, &ev) == 0;
+    }
+
+    void accept_connections() {
+        for (;;) {
+            int fd = accept4(server_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;  // EAGAIN: backlog drained (or a transient error)
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (!watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD)) {
+                close(fd);
+                continue;
+            }
+            connections[fd].id = next_connection_id++;
+        }
+    }
+
+    void handle_event(int fd, uint32_t events) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& conn = it->second;
+
+        if (events & EPOLLERR) {
+            close_connection(fd);
+            return;
+        }
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+            if (!receive(fd, conn, events)) return;
+        }
+        if (events & EPOLLOUT) {
+            flush(fd, conn);
+            if (!connections.count(fd)) return;
+        }
+        process(fd, conn);
+    }
+
+    // Bytes waiting behind the request being served are capped; otherwise
+    // the buffer only has to hold the request being assembled
+    bool input_full(const Connection& conn) const {
+        bool serving = conn.busy || conn.output_sent < conn.output.size();
+        return conn.input.size() >= (serving ? MAX_PIPELINED_INPUT : MAX_BODY + MAX_HTTP_HEADER);
+    }
+
+    // Read what the socket has, up to the buffering limit. A round stops
+    // at MAX_PIPELINED_INPUT so queued requests are dispatched before more
+    // is read; a larger request is assembled over several rounds. Returns
+    // false if the connection was closed.
+    bool receive(int fd, Connection& conn, uint32_t events) {
+        if (!conn.reading || input_full(conn)) {
+            // Reading is paused, but a full hangup cannot be waited out
+            if (events & EPOLLHUP) {
+                close_connection(fd);
+                return false;
+            }
+            return true;
+        }
+        std::array<char, 64 * 1024> buffer;
+        size_t start = conn.input.size();
+        while (conn.input.size() - start < MAX_PIPELINED_INPUT && !input_full(conn)) {
+            ssize_t n = read(fd, buffer.data(), buffer.size());
+            if (n > 0) {
+                conn.input.append(buffer.data(), static_cast<size_t>(n));
+                continue;
+            }
+            if (n == 0) {
+                conn.peer_closed = true;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                close_connection(fd);
+                return false;
+            }
+            break;
+        }
+        return true;
+    }
+
+    // Dispatch complete requests in order until one goes to the workers,
+    // the socket stops taking output or the input runs out. Answers that
+    // need no worker are sent from this loop, so a long pipeline does not
+    // grow the stack.
+    void process(int fd, Connection& conn) {
+        uint64_t id = conn.id;
+        while (!conn.busy && !conn.close_after_write && conn.output_sent == conn.output.size()) {
+            HttpRequest request;
+            switch (parse_http_request(conn.input, request, MAX_BODY)) {
+                case HttpParseStatus::Incomplete:
+                    if (conn.peer_closed) {
+                        close_connection(fd);
+                        return;
+                    }
+                    update_watch(fd, conn);
+                    return;
+                case HttpParseStatus::Invalid:
+                    queue_response(fd, conn, build_http_response(400, "Bad Request", "{\"error\":\"Invalid request\"}", false), false);
+                    break;
+                case HttpParseStatus::TooLarge:
+                    queue_response(fd, conn, build_http_response(413, "Payload Too Large", "{\"error\":\"Request too large\"}", false), false);
+                    break;
+                case HttpParseStatus::Complete:
+                    dispatch(fd, conn, request);
+                    break;
+            }
+            if (!is_live(fd, id)) return;  // The flush closed the connection
+        }
+        update_watch(fd, conn);
+    }
+
+    void dispatch(int fd, Connection& conn, const HttpRequest& request) {
+        bool keep_alive = request.keep_alive && !conn.peer_closed;
+        if (request.method == "OPTIONS") {
+            std::string response = build_http_response(204, "No Content", "", keep_alive);
+            conn.input.erase(0, request.size);
+            queue_response(fd, conn, std::move(response), keep_alive);
+            return;
+        }
+        if (request.method != "POST") {
+            std::string response = build_http_response(405, "Method Not Allowed", "{\"error\":\"Use POST\"}", keep_alive);
+            conn.input.erase(0, request.size);
+            queue_response(fd, conn, std::move(response), keep_alive);
+            return;
+        }
+
+        std::string body(request.body);
+        conn.input.erase(0, request.size);
+        conn.busy = true;
+        uint64_t connection_id = conn.id;
+        workers->submit([this, fd, connection_id, keep_alive, body = std::move(body)]() mutable {
+            std::string response = build_http_response(200, "OK", handle_message(std::move(body)), keep_alive);
+            {
+                std::lock_guard lock(completions_mutex);
+                completions.push_back(Completion{fd, connection_id, std::move(response), keep_alive});
+            }
+            uint64_t one = 1;
+            (void)!write(wake_fd, &one, sizeof(one));
+        });
+    }
+
+    void deliver_completions() {
+        std::vector<Completion> ready;
+        {
+            std::lock_guard lock(completions_mutex);
+            ready.swap(completions);
+        }
+        for (auto& completion : ready) {
+            if (!is_live(completion.fd, completion.connection_id)) {
+                continue;  // Connection closed while the request was running
+            }
+            Connection& conn = connections[completion.fd];
+            conn.busy = false;
+            queue_response(completion.fd, conn, std::move(completion.response), completion.keep_alive);
+            // Pipelined requests may already be waiting
+            if (is_live(completion.fd, completion.connection_id)) {
+                process(completion.fd, conn);
+            }
+        }
+    }
+
+    bool is_live(int fd, uint64_t connection_id) const {
+        auto it = connections.find(fd);
+        return it != connections.end() && it->second.id == connection_id;
+    }
+
+    // Append a response and send as much of it as the socket takes; may
+    // close the connection
+    void queue_response(int fd, Connection& conn, std::string response, bool keep_alive) {
+        conn.output += response;
+        if (!keep_alive) {
+            conn.close_after_write = true;
+        }
+        flush(fd, conn);
+    }
+
+    void flush(int fd, Connection& conn) {
+        while (conn.output_sent < conn.output.size()) {
+            ssize_t n = send(fd, conn.output.data() + conn.output_sent,
+                             conn.output.size() - conn.output_sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                conn.output_sent += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return;  // update_watch() asks for EPOLLOUT
+            }
+            if (n < 0 && errno == EINTR) continue;
+            close_connection(fd);
+            return;
+        }
+
+        conn.output.clear();
+        conn.output_sent = 0;
+        if (conn.close_after_write) {
+            close_connection(fd);
+        }
+    }
+
+    // Register for the events the connection can act on now. Reading
+    // pauses while the input buffer is full or the peer has stopped
+    // sending, so neither a flood nor a half-closed socket keeps the loop
+    // busy.
+    void update_watch(int fd, Connection& conn) {
+        bool reading = !conn.peer_closed && !input_full(conn);
+        bool writing = conn.output_sent < conn.output.size();
+        if (reading == conn.reading && writing == conn.want_write) return;
+
+        uint32_t events = (reading ? EPOLLIN | EPOLLRDHUP : 0u) | (writing ? EPOLLOUT : 0u);
+        if (watch(fd, events, EPOLL_CTL_MOD)) {
+            conn.reading = reading;
+            conn.want_write = writing;
+        }
+    }
+
+    void close_connection(int fd) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections.erase(fd);
+    }
+
+    // Run analysis outside the manager lock and install the result if the
+    // document has not changed in the meantime
+    void analyze_and_install(std::string_view uri, int version, forma::lsp::DocumentBuffer::Snapshot snapshot) {
+        auto analysis = LSPManager::analyze_snapshot(version, std::move(snapshot), [] { return false; });
+        std::lock_guard lock(manager_mutex);
+        lsp_manager.install_analysis(uri, std::move(*analysis));
+    }
+
+    std::string handle_initialize(int id, JsonView params) {
+        int process_id = params["processId"].integer(0);
+        std::string_view root_uri = params["rootUri"].string();
+
+        auto result = [&] {
+            std::lock_guard lock(manager_mutex);
+            return lsp_manager.initialize(process_id, root_uri);
+        }();
+
         JsonBuilder json;
         json.start_object();
         json.add_number("jsonrpc", 2);
@@ -208,73 +631,152 @@ private:
         json.end_object(); // serverInfo
         json.end_object(); // result
         json.end_object();
-        
+
         return json.json;
     }
-    
-    std::string handle_did_open(int id, std::string_view params) {
-        std::string_view text_doc = extract_object(params, "textDocument");
-        std::string_view uri = extract_string(text_doc, "uri");
-        std::string_view language_id = extract_string(text_doc, "languageId");
-        int version = extract_number(text_doc, "version");
-        std::string_view text = extract_string(text_doc, "text");
-        
-        // Store text in our storage
-        document_storage = std::string(text);
-        
+
+    std::string handle_did_open(int id, JsonView params) {
+        JsonView text_doc = params["textDocument"];
+        std::string_view uri = text_doc["uri"].string();
+        std::string_view language_id = text_doc["languageId"].string();
+        int version = text_doc["version"].integer(0);
+        std::string_view text = text_doc["text"].string();
+
         forma::lsp::TextDocumentItem item;
         item.uri = uri;
         item.language_id = language_id;
         item.version = version;
-        item.text = document_storage;
-        
-        lsp_manager.did_open(item);
-        
+        item.text = text;
+
+        forma::lsp::DocumentBuffer::Snapshot snapshot;
+        {
+            std::lock_guard lock(manager_mutex);
+            auto* doc = lsp_manager.open_document(item);
+            if (!doc) return build_empty_response(id);
+            drop_deferred_changes(uri);  // They were against the previous text
+            snapshot = doc->buffer.snapshot();
+        }
+        analyze_and_install(uri, version, std::move(snapshot));
+
         // didOpen is a notification, no response needed
         return build_empty_response(id);
     }
-    
-    std::string handle_did_change(int id, std::string_view params) {
-        std::string_view text_doc = extract_object(params, "textDocument");
-        std::string_view uri = extract_string(text_doc, "uri");
-        int version = extract_number(text_doc, "version");
-        
-        // Extract the new text from contentChanges array
-        // Simplified: assumes full document sync
-        size_t changes_pos = params.find("contentChanges");
-        if (changes_pos != std::string_view::npos) {
-            std::string_view remaining = params.substr(changes_pos);
-            std::string_view text = extract_string(remaining, "text");
-            document_storage = std::string(text);
-            
-            forma::lsp::VersionedTextDocumentIdentifier id_obj;
-            id_obj.uri = uri;
-            id_obj.version = version;
-            
-            lsp_manager.did_change(id_obj, document_storage);
-        }
-        
+
+    std::string handle_did_change(int id, JsonView params) {
+        JsonView text_doc = params["textDocument"];
+
+        forma::lsp::VersionedTextDocumentIdentifier id_obj;
+        id_obj.uri = text_doc["uri"].string();
+        id_obj.version = text_doc["version"].integer(0);
+
+        // Incremental sync: apply every entry in order, each with its own
+        // range; an entry without one replaces the whole document. The
+        // texts point into the message.
+        std::vector<forma::lsp::TextDocumentContentChangeEvent> changes;
+        for (JsonView element : params["contentChanges"]) {
+            forma::lsp::TextDocumentContentChangeEvent change(element["text"].string());
+            JsonView range = element["range"];
+            if (range.is(forma::lsp::JsonParser::Kind::Object)) {
+                JsonView start = range["start"];
+                JsonView end = range["end"];
+                change.has_range = true;
+                change.range = forma::lsp::Range(start["line"].integer(0), start["character"].integer(0),
+                                                 end["line"].integer(0), end["character"].integer(0));
+            }
+            changes.push_back(change);
+        }
+        if (changes.empty()) {
+            return build_empty_response(id);
+        }
+
+        forma::lsp::DocumentBuffer::Snapshot snapshot;
+        int version = 0;
+        {
+            std::lock_guard lock(manager_mutex);
+            auto* doc = lsp_manager.find_document(id_obj.uri);
+            if (!doc || id_obj.version <= doc->version) {
+                return build_empty_response(id);  // Closed, or already superseded
+            }
+            if (id_obj.version > doc->version + 1) {
+                // Earlier versions are still on their way; apply this one after them
+                auto& waiting = deferred_changes[std::string(id_obj.uri)];
+                if (waiting.size() < MAX_DEFERRED_CHANGES) {
+                    waiting.emplace(id_obj.version, own_changes(changes));
+                }
+                return build_empty_response(id);
+            }
+
+            doc = lsp_manager.apply_changes(id_obj, changes);
+            apply_deferred_changes(id_obj.uri, doc->version);
+            version = doc->version;
+            snapshot = doc->buffer.snapshot();
+        }
+        analyze_and_install(id_obj.uri, version, std::move(snapshot));
+
         return build_empty_response(id);
     }
-    
-    std::string handle_did_close(int id, std::string_view params) {
-        std::string_view text_doc = extract_object(params, "textDocument");
-        std::string_view uri = extract_string(text_doc, "uri");
-        
+
+    // Copy of `changes` that no longer points into the message
+    static ContentChanges own_changes(std::span<const forma::lsp::TextDocumentContentChangeEvent> changes) {
+        ContentChanges owned;
+        owned.texts.reserve(changes.size());
+        owned.changes.reserve(changes.size());
+        for (const auto& change : changes) {
+            owned.texts.emplace_back(change.text);
+            owned.changes.push_back(change);
+            owned.changes.back().text = owned.texts.back();
+        }
+        return owned;
+    }
+
+    // Apply the changes that were waiting for `version` to be reached, in
+    // order, for as long as they follow on; manager_mutex must be held
+    void apply_deferred_changes(std::string_view uri, int version) {
+        auto waiting = deferred_changes.find(uri);
+        if (waiting == deferred_changes.end()) {
+            return;
+        }
+        auto& queue = waiting->second;
+        while (!queue.empty() && queue.begin()->first <= version + 1) {
+            auto next = queue.extract(queue.begin());
+            if (next.key() == version + 1) {
+                forma::lsp::VersionedTextDocumentIdentifier id_obj;
+                id_obj.uri = uri;
+                id_obj.version = next.key();
+                lsp_manager.apply_changes(id_obj, next.mapped().changes);
+                version = next.key();
+            }
+        }
+        if (queue.empty()) {
+            deferred_changes.erase(waiting);
+        }
+    }
+
+    void drop_deferred_changes(std::string_view uri) {
+        if (auto waiting = deferred_changes.find(uri); waiting != deferred_changes.end()) {
+            deferred_changes.erase(waiting);
+        }
+    }
+
+    std::string handle_did_close(int id, JsonView params) {
+        std::string_view uri = params["textDocument"]["uri"].string();
+
         forma::lsp::TextDocumentIdentifier id_obj;
         id_obj.uri = uri;
-        
+
+        std::lock_guard lock(manager_mutex);
         lsp_manager.did_close(id_obj);
-        
+        drop_deferred_changes(uri);
+
         return build_empty_response(id);
     }
-    
-    std::string handle_diagnostic(int id, std::string_view params) {
-        std::string_view text_doc = extract_object(params, "textDocument");
-        std::string_view uri = extract_string(text_doc, "uri");
-        
-        auto* doc = lsp_manager.find_document(uri);
-        
+
+    std::string handle_diagnostic(int id, JsonView params) {
+        std::string_view uri = params["textDocument"]["uri"].string();
+
+        std::lock_guard lock(manager_mutex);
+        const auto* doc = std::as_const(lsp_manager).find_document(uri);
+
         JsonBuilder json;
         json.start_object();
         json.add_string("jsonrpc", "2.0");
@@ -282,7 +784,7 @@ private:
         json.add_object_start("result");
         json.add_string("kind", "full");
         json.add_array_start("items");
-        
+
         if (doc) {
             for (size_t i = 0; i < doc->diagnostic_count; ++i) {
                 const auto& diag = doc->diagnostics[i];
@@ -304,18 +806,18 @@ private:
                 json.end_object();
             }
         }
-        
+
         json.end_array(); // items
         json.end_object(); // result
         json.end_object();
-        
+
         return json.json;
     }
-    
+
     std::string build_empty_response(int id) {
         return "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id) + ",\"result\":null}";
     }
-    
+
     std::string build_error_response(int id, int code, std::string_view message) {
         JsonBuilder json;
         json.start_object();
@@ -328,24 +830,6 @@ private:
         json.end_object();
         return json.json;
     }
-    
-    void send_http_response(int socket, const std::string& body) {
-        std::ostringstream response;
-        response << "HTTP/1.1 200 OK\r\n";
-        response << "Content-Type: application/json\r\n";
-        response << "Content-Length: " << body.size() << "\r\n";
-        response << "Access-Control-Allow-Origin: *\r\n";
-        response << "\r\n";
-        response << body;
-        
-        std::string resp = response.str();
-        write(socket, resp.c_str(), resp.size());
-    }
-    
-    void send_error(int socket, std::string_view message) {
-        std::string body = "{\"error\":\"" + std::string(message) + "\"}";
-        send_http_response(socket, body);
-    }
 };
 
 } // namespace forma::http
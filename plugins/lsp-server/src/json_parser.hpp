@@ -0,0 +1,258 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace forma::lsp {
+
+// ============================================================================
+// JSON - Single-pass, in-place tokenizer
+// ============================================================================
+
+// Tokenizes a whole message in one pass over a mutable buffer. String
+// escapes are decoded in place (the decoded form is never longer than the
+// escaped one), so every string_view handed out points into the message
+// itself and document text is not copied. Values are recorded on a flat
+// tape where each entry knows where its last descendant ends, which lets
+// lookups step over nested values without looking at the text again.
+class JsonParser {
+public:
+    enum class Kind : uint8_t { Object, Array, String, Number, True, False, Null };
+
+    struct Node {
+        Kind kind;
+        uint32_t end;           // Tape index one past the last descendant
+        std::string_view text;  // Decoded string, or the literal's text
+    };
+
+    // Read-only cursor into a parsed message. Lookups that find nothing
+    // return an empty view, so chains like root["params"]["uri"] are safe.
+    class View {
+    public:
+        View() = default;
+        View(const std::vector<Node>* tape, size_t index) : tape(tape), index(index) {}
+
+        bool exists() const { return tape != nullptr; }
+        bool is(Kind kind) const { return tape && node().kind == kind; }
+
+        // Member of an object
+        View operator[](std::string_view key) const {
+            if (!is(Kind::Object)) return {};
+            size_t i = index + 1;
+            while (i < node().end) {
+                size_t value = i + 1;
+                if ((*tape)[i].text == key) return View(tape, value);
+                i = (*tape)[value].end;
+            }
+            return {};
+        }
+
+        // String contents; empty for other kinds
+        std::string_view string() const {
+            return is(Kind::String) ? node().text : std::string_view{};
+        }
+
+        int integer(int fallback = -1) const {
+            if (!is(Kind::Number)) return fallback;
+            int value = fallback;
+            auto text = node().text;
+            auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            return ec == std::errc() && ptr == text.data() + text.size() ? value : fallback;
+        }
+
+        // Iteration over the elements of an array
+        class Iterator {
+        public:
+            Iterator(const std::vector<Node>* tape, size_t index) : tape(tape), index(index) {}
+            View operator*() const { return View(tape, index); }
+            Iterator& operator++() { index = (*tape)[index].end; return *this; }
+            bool operator!=(const Iterator& other) const { return index != other.index; }
+        private:
+            const std::vector<Node>* tape;
+            size_t index;
+        };
+
+        Iterator begin() const { return is(Kind::Array) ? Iterator(tape, index + 1) : Iterator(nullptr, 0); }
+        Iterator end() const { return is(Kind::Array) ? Iterator(tape, node().end) : Iterator(nullptr, 0); }
+
+    private:
+        const std::vector<Node>* tape = nullptr;
+        size_t index = 0;
+
+        const Node& node() const { return (*tape)[index]; }
+    };
+
+    // Parse `text` in place. Views into the result stay valid until the
+    // next parse or until the buffer is reused. Returns false if malformed.
+    bool parse(std::span<char> text) {
+        tape.clear();
+        data = text.data();
+        size = text.size();
+        pos = 0;
+        if (!parse_value(0)) {
+            tape.clear();
+            return false;
+        }
+        skip_whitespace();
+        if (pos != size) {
+            tape.clear();
+            return false;
+        }
+        return true;
+    }
+
+    View root() const {
+        return tape.empty() ? View() : View(&tape, 0);
+    }
+
+private:
+    static constexpr size_t MAX_DEPTH = 256;
+
+    std::vector<Node> tape;  // Reused between messages
+    char* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+
+    void skip_whitespace() {
+        while (pos < size && (data[pos] == ' ' || data[pos] == '\n' || data[pos] == '\r' || data[pos] == '\t')) {
+            ++pos;
+        }
+    }
+
+    bool consume(char c) {
+        skip_whitespace();
+        if (pos < size && data[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool parse_value(size_t depth) {
+        skip_whitespace();
+        if (pos >= size || depth > MAX_DEPTH) return false;
+
+        char c = data[pos];
+        if (c == '{' || c == '[') {
+            bool object = c == '{';
+            size_t index = tape.size();
+            tape.push_back(Node{object ? Kind::Object : Kind::Array, 0, {}});
+            ++pos;
+            if (!consume(object ? '}' : ']')) {
+                do {
+                    if (object) {
+                        skip_whitespace();
+                        if (pos >= size || data[pos] != '"' || !parse_string() || !consume(':')) return false;
+                    }
+                    if (!parse_value(depth + 1)) return false;
+                } while (consume(','));
+                if (!consume(object ? '}' : ']')) return false;
+            }
+            tape[index].end = static_cast<uint32_t>(tape.size());
+            return true;
+        }
+        if (c == '"') {
+            return parse_string();
+        }
+
+        size_t start = pos;
+        while (pos < size && data[pos] != ',' && data[pos] != '}' && data[pos] != ']' &&
+               data[pos] != ' ' && data[pos] != '\n' && data[pos] != '\r' && data[pos] != '\t') {
+            ++pos;
+        }
+        std::string_view literal(data + start, pos - start);
+        Kind kind;
+        if (literal == "true") kind = Kind::True;
+        else if (literal == "false") kind = Kind::False;
+        else if (literal == "null") kind = Kind::Null;
+        else if (c == '-' || (c >= '0' && c <= '9')) kind = Kind::Number;
+        else return false;
+        tape.push_back(Node{kind, static_cast<uint32_t>(tape.size() + 1), literal});
+        return true;
+    }
+
+    bool parse_string() {
+        size_t start = ++pos;
+
+        // Fast path: nothing to decode before the closing quote
+        while (pos < size && data[pos] != '"' && data[pos] != '\\') ++pos;
+        size_t out = pos;
+
+        while (pos < size && data[pos] != '"') {
+            char c = data[pos++];
+            if (c != '\\') {
+                data[out++] = c;
+                continue;
+            }
+            if (pos >= size) return false;
+            char e = data[pos++];
+            switch (e) {
+                case 'n': data[out++] = '\n'; break;
+                case 'r': data[out++] = '\r'; break;
+                case 't': data[out++] = '\t'; break;
+                case 'b': data[out++] = '\b'; break;
+                case 'f': data[out++] = '\f'; break;
+                case '"': case '\\': case '/': data[out++] = e; break;
+                case 'u': {
+                    uint32_t cp = 0;
+                    if (!read_hex4(cp) || (cp >= 0xDC00 && cp < 0xE000)) return false;
+                    // Combine a surrogate pair into one code point; a high
+                    // surrogate must be followed by a low one
+                    if (cp >= 0xD800 && cp < 0xDC00) {
+                        if (pos + 1 >= size || data[pos] != '\\' || data[pos + 1] != 'u') return false;
+                        pos += 2;
+                        uint32_t low = 0;
+                        if (!read_hex4(low) || low < 0xDC00 || low >= 0xE000) return false;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    out = write_utf8(out, cp);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        if (pos >= size) return false;
+
+        ++pos;  // Closing quote
+        tape.push_back(Node{Kind::String, static_cast<uint32_t>(tape.size() + 1),
+                            std::string_view(data + start, out - start)});
+        return true;
+    }
+
+    bool read_hex4(uint32_t& value) {
+        if (pos + 4 > size) return false;
+        for (size_t i = 0; i < 4; ++i) {
+            char h = data[pos++];
+            uint32_t digit;
+            if (h >= '0' && h <= '9') digit = static_cast<uint32_t>(h - '0');
+            else if ((h | 0x20) >= 'a' && (h | 0x20) <= 'f') digit = static_cast<uint32_t>((h | 0x20) - 'a' + 10);
+            else return false;
+            value = value * 16 + digit;
+        }
+        return true;
+    }
+
+    size_t write_utf8(size_t out, uint32_t cp) {
+        if (cp < 0x80) {
+            data[out++] = static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            data[out++] = static_cast<char>(0xC0 | (cp >> 6));
+            data[out++] = static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            data[out++] = static_cast<char>(0xE0 | (cp >> 12));
+            data[out++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            data[out++] = static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            data[out++] = static_cast<char>(0xF0 | (cp >> 18));
+            data[out++] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            data[out++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            data[out++] = static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        return out;
+    }
+};
+
+} // namespace forma::lsp
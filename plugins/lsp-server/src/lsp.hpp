@@ -2,13 +2,22 @@
 
 #include <parser/ir.hpp>
 #include <parser/semantic.hpp>
+#include "document_buffer.hpp"
+#include "semantic_tokens.hpp"
+#include "document_symbols.hpp"
+#include "workspace_index.hpp"
+#include "completion.hpp"
 // Note: core/pipeline.hpp provides forma::pipeline::resolve_imports,
 // forma::pipeline::run_semantic_analysis, and forma::pipeline::collect_assets
 // for full compilation. LSP uses direct APIs for faster interactive feedback.
 #include <string_view>
 #include <string>
 #include <array>
+#include <functional>
+#include <unordered_map>
 #include <memory>
+#include <optional>
+#include <span>
 #include <iostream>
 
 namespace forma::lsp {
@@ -69,12 +78,17 @@ struct Diagnostic {
 
 struct TextDocumentSyncOptions {
     bool open_close = true;
-    int change = 1; // 1 = Full sync
+    int change = 2; // 2 = Incremental sync
 };
 
 struct ServerCapabilities {
     TextDocumentSyncOptions text_document_sync;
     bool diagnostic_provider = true;
+    bool semantic_tokens_provider = true;  // full and full/delta
+    bool document_symbol_provider = true;
+    bool completion_provider = true;        // Triggered by '.' and ':'
+    bool references_provider = true;        // Needs a workspace index
+    bool workspace_symbol_provider = true;
     
     constexpr ServerCapabilities() = default;
 };
@@ -114,33 +128,85 @@ struct VersionedTextDocumentIdentifier {
     constexpr VersionedTextDocumentIdentifier() = default;
 };
 
+// One entry of didChange's contentChanges. Without a range the text
+// replaces the whole document.
+struct TextDocumentContentChangeEvent {
+    bool has_range = false;
+    Range range;
+    std::string_view text;
+    
+    constexpr TextDocumentContentChangeEvent() = default;
+    constexpr TextDocumentContentChangeEvent(std::string_view t) : text(t) {}
+    constexpr TextDocumentContentChangeEvent(Range r, std::string_view t)
+        : has_range(true), range(r), text(t) {}
+};
+
 // ============================================================================
 // LSP Document Management
 // ============================================================================
 
+// Open documents are kept in a hash map keyed by URI, so lookups do not
+// depend on how many files are open. `MaxDocs` only sizes the map up
+// front; more documents are added as they are opened.
 template<size_t MaxDocs = 16>
 struct LSPDocumentManager {
     struct Document {
         std::string uri;  // Owned storage for URI
         std::string_view text;
         int version = 0;
-        bool active = false;
+        bool active = false;  // Closed documents are removed
         
         // Diagnostics for this document
         std::array<Diagnostic, 32> diagnostics;
         size_t diagnostic_count = 0;
         
-        // Cached parsed document (owned storage)
+        // Source split at top-level declarations; edits re-parse only the
+        // declarations they touch
+        DocumentBuffer buffer;
+        
+        // Cached analysis (owned storage). When analysis runs in the
+        // background this lags behind `buffer` until the next result is
+        // installed; the snapshot keeps the text that the AST and the
+        // diagnostics point into alive.
+        DocumentBuffer::Snapshot cached_snapshot;
         std::string cached_source;  // Store the source we last parsed
-        std::unique_ptr<forma::Document<32, 16, 16, 32, 64, 64>> cached_ast; // Cached AST on heap
+        std::shared_ptr<const forma::RuntimeDocument> cached_ast; // Cached AST, grows with the source
+        int analyzed_version = 0;    // Version the cache was built from
         bool cache_valid = false;    // Is the cache valid?
+        
+        // Last semantic tokens sent, the base of the next delta
+        SemanticTokens semantic_tokens;
+        
+        // Declarations of cached_ast, sorted for prefix lookups
+        CompletionIndex completions;
     };
     
-    std::array<Document, MaxDocs> documents;
-    size_t document_count = 0;
+    // Result of analysing one version of a document. Produced without
+    // touching the manager, so it can be computed on another thread and
+    // installed afterwards.
+    struct Analysis {
+        int version = 0;
+        DocumentBuffer::Snapshot snapshot;
+        std::string source;
+        std::shared_ptr<const forma::RuntimeDocument> ast;
+        std::array<Diagnostic, 32> diagnostics;
+        size_t diagnostic_count = 0;
+    };
+    
+    struct UriHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view uri) const { return std::hash<std::string_view>{}(uri); }
+    };
+    
+    // Node-based, so Document pointers stay valid while others open and close
+    std::unordered_map<std::string, Document, UriHash, std::equal_to<>> documents;
     bool initialized = false;
     
-    LSPDocumentManager() = default;
+    // Declarations in other files; analysed documents are re-indexed as
+    // their results are installed. Optional, not owned.
+    WorkspaceIndex* workspace = nullptr;
+    
+    LSPDocumentManager() { documents.reserve(MaxDocs); }
     
     InitializeResult initialize(int process_id, DocumentUri root_uri) {
         (void)process_id;  // unused
@@ -150,72 +216,90 @@ struct LSPDocumentManager {
     }
     
     Document* find_document(DocumentUri uri) {
-        std::cerr << "  Debug: find_document called with uri='" << uri << "', document_count=" << document_count << std::endl;
-        for (size_t i = 0; i < document_count; ++i) {
-            std::cerr << "  Debug: Comparing with doc[" << i << "].uri='" << documents[i].uri << "', active=" << documents[i].active << std::endl;
-            if (documents[i].uri == uri && documents[i].active) {
-                std::cerr << "  Debug: Found match at index " << i << std::endl;
-                return &documents[i];
-            }
-        }
-        std::cerr << "  Debug: No match found" << std::endl;
-        return nullptr;
+        auto it = documents.find(uri);
+        return it != documents.end() ? &it->second : nullptr;
     }
     
     const Document* find_document(DocumentUri uri) const {
-        for (size_t i = 0; i < document_count; ++i) {
-            if (documents[i].uri == uri && documents[i].active) {
-                return &documents[i];
-            }
-        }
-        return nullptr;
+        auto it = documents.find(uri);
+        return it != documents.end() ? &it->second : nullptr;
+    }
+    
+    size_t document_count() const {
+        return documents.size();
     }
     
     void did_open(const TextDocumentItem& item) {
-        // Find or create document slot
-        Document* doc = find_document(item.uri);
-        if (!doc && document_count < MaxDocs) {
-            doc = &documents[document_count++];
+        if (Document* doc = open_document(item)) {
+            // Run diagnostics
+            analyze_document(*doc);
+        }
+    }
+    
+    // Store an opened document without analysing it
+    Document* open_document(const TextDocumentItem& item) {
+        // Find or create the document
+        auto it = documents.find(item.uri);
+        if (it == documents.end()) {
+            it = documents.try_emplace(std::string(item.uri)).first;
+            it->second.uri = it->first;  // Store as owned string
         }
         
-        if (doc) {
-            doc->uri = std::string(item.uri.data(), item.uri.size());  // Store as owned string
-            doc->version = item.version;
-            doc->active = true;
-            doc->diagnostic_count = 0;
-            doc->cache_valid = false; // Invalidate cache
-            
-            // Store the text in cached_source (owned storage)
-            // and point text view to it
-            doc->cached_source = std::string(item.text.data(), item.text.size());
-            doc->text = doc->cached_source;
-            
+        Document* doc = &it->second;
+        doc->version = item.version;
+        doc->active = true;
+        doc->diagnostic_count = 0;
+        doc->cache_valid = false;
+        doc->buffer.assign(item.text);
+        return doc;
+    }
+    
+    // Full document sync: `new_text` replaces the whole content
+    void did_change(const VersionedTextDocumentIdentifier& id, std::string_view new_text) {
+        TextDocumentContentChangeEvent change(new_text);
+        did_change(id, std::span<const TextDocumentContentChangeEvent>(&change, 1));
+    }
+    
+    // Incremental sync: changes are applied in order, each against the
+    // text produced by the previous one
+    void did_change(const VersionedTextDocumentIdentifier& id,
+                    std::span<const TextDocumentContentChangeEvent> changes) {
+        if (Document* doc = apply_changes(id, changes)) {
             // Run diagnostics
             analyze_document(*doc);
         }
     }
     
-    void did_change(const VersionedTextDocumentIdentifier& id, std::string_view new_text) {
+    // Apply changes to the buffer without analysing. The cached analysis
+    // and diagnostics stay in place until a newer one is installed.
+    Document* apply_changes(const VersionedTextDocumentIdentifier& id,
+                            std::span<const TextDocumentContentChangeEvent> changes) {
         Document* doc = find_document(id.uri);
         if (doc) {
             doc->version = id.version;
-            doc->diagnostic_count = 0;
-            doc->cache_valid = false; // Invalidate cache on change
-            
-            // Store the text and update the view
-            doc->cached_source = std::string(new_text.data(), new_text.size());
-            doc->text = doc->cached_source;
             
-            // Run diagnostics
-            analyze_document(*doc);
+            for (const auto& change : changes) {
+                if (change.has_range) {
+                    size_t start = doc->buffer.offset_at(static_cast<size_t>(change.range.start.line),
+                                                         static_cast<size_t>(change.range.start.character));
+                    size_t end = doc->buffer.offset_at(static_cast<size_t>(change.range.end.line),
+                                                       static_cast<size_t>(change.range.end.character));
+                    doc->buffer.replace(start, end, change.text);
+                } else {
+                    doc->buffer.assign(change.text);
+                }
+            }
         }
+        return doc;
     }
     
     void did_close(const TextDocumentIdentifier& id) {
-        Document* doc = find_document(id.uri);
-        if (doc) {
-            doc->active = false;
-            doc->diagnostic_count = 0;
+        auto it = documents.find(id.uri);
+        if (it != documents.end()) {
+            if (workspace) {
+                workspace->close_document(id.uri);
+            }
+            documents.erase(it);
         }
     }
     
@@ -223,66 +307,40 @@ struct LSPDocumentManager {
     bool find_definition(DocumentUri uri, Position pos, Location& out_location) {
         Document* doc = find_document(uri);
         if (!doc || !doc->cache_valid || !doc->cached_ast) {
-            std::cerr << "  Debug: Document not found or cache invalid" << std::endl;
             return false;
         }
         
         // Extract the identifier at the cursor position from source text
         std::string_view source = doc->cached_source;
-        std::string_view identifier = extract_identifier_at_position(source, pos);
-        
-        std::cerr << "  Debug: Extracted identifier: '" << identifier << "'" << std::endl;
+        const forma::LineIndex& lines = doc->cached_snapshot.lines;
+        std::string_view identifier = extract_identifier_at_position(source, lines, pos);
         
         if (identifier.empty()) {
-            std::cerr << "  Debug: Identifier is empty" << std::endl;
             return false;
         }
         
-        // First, search the symbol table for this identifier
+        // First, look the identifier up in the symbol table's hash index
         const auto& symbols = doc->cached_ast->symbols;
-        std::cerr << "  Debug: Searching " << symbols.count << " symbols" << std::endl;
-        for (size_t i = 0; i < symbols.count; ++i) {
-            const auto& sym = symbols.symbols[i];
-            
-            if (sym.name == identifier) {
-                // Convert offset to line/column if needed
-                size_t line, col;
-                if (sym.location.line == 0 && sym.location.column == 0 && sym.location.offset > 0) {
-                    // Location stored as offset, convert it
-                    auto [l, c] = offset_to_position(source, sym.location.offset);
-                    line = l;
-                    col = c;
-                    std::cerr << "  Debug: Found in symbol table at offset " << sym.location.offset 
-                             << " = line " << line << ", col " << col << std::endl;
-                } else {
-                    // Location already has line/column
-                    line = sym.location.line;
-                    col = sym.location.column;
-                    std::cerr << "  Debug: Found in symbol table at line " << line << std::endl;
-                }
-                
-                // Found the definition in symbol table
-                out_location.uri = uri;
-                out_location.range.start.line = static_cast<int>(line);
-                out_location.range.start.character = static_cast<int>(col);
-                out_location.range.end.line = static_cast<int>(line);
-                out_location.range.end.character = static_cast<int>(col + sym.name.size());
-                return true;
-            }
+        if (const auto* sym = symbols.find(identifier)) {
+            // The parser fills in line/column
+            size_t line = sym->location.line;
+            size_t col = sym->location.column;
+            out_location.uri = uri;
+            out_location.range.start.line = static_cast<int>(line);
+            out_location.range.start.character = static_cast<int>(col);
+            out_location.range.end.line = static_cast<int>(line);
+            out_location.range.end.character = static_cast<int>(col + sym->name.size());
+            return true;
         }
         
         // If not in symbol table, search type declarations directly
-        std::cerr << "  Debug: Not in symbol table, searching " << doc->cached_ast->type_count << " type declarations" << std::endl;
         for (size_t i = 0; i < doc->cached_ast->type_count; ++i) {
             const auto& type = doc->cached_ast->types[i];
-            std::cerr << "  Debug: Checking type '" << type.name << "'" << std::endl;
             if (type.name == identifier) {
                 // Found type declaration - search for it in source
                 size_t type_pos = find_in_source(source, identifier);
-                std::cerr << "  Debug: Found type, searching in source, offset: " << type_pos << std::endl;
                 if (type_pos != std::string_view::npos) {
-                    auto [line, col] = offset_to_position(source, type_pos);
-                    std::cerr << "  Debug: Converted to line " << line << ", col " << col << std::endl;
+                    auto [line, col] = lines.position(type_pos);
                     out_location.uri = uri;
                     out_location.range.start.line = static_cast<int>(line);
                     out_location.range.start.character = static_cast<int>(col);
@@ -299,7 +357,7 @@ struct LSPDocumentManager {
             if (enum_decl.name == identifier) {
                 size_t enum_pos = find_in_source(source, identifier);
                 if (enum_pos != std::string_view::npos) {
-                    auto [line, col] = offset_to_position(source, enum_pos);
+                    auto [line, col] = lines.position(enum_pos);
                     out_location.uri = uri;
                     out_location.range.start.line = static_cast<int>(line);
                     out_location.range.start.character = static_cast<int>(col);
@@ -316,7 +374,7 @@ struct LSPDocumentManager {
             if (event.name == identifier) {
                 size_t event_pos = find_in_source(source, identifier);
                 if (event_pos != std::string_view::npos) {
-                    auto [line, col] = offset_to_position(source, event_pos);
+                    auto [line, col] = lines.position(event_pos);
                     out_location.uri = uri;
                     out_location.range.start.line = static_cast<int>(line);
                     out_location.range.start.character = static_cast<int>(col);
@@ -327,43 +385,161 @@ struct LSPDocumentManager {
             }
         }
         
+        // Declared in another file of the workspace
+        if (workspace) {
+            auto definitions = workspace->definitions(identifier);
+            if (!definitions.empty()) {
+                out_location = to_location(definitions.front());
+                return true;
+            }
+        }
+        
         return false;
     }
     
-    void analyze_document(Document& doc) {
-        if (doc.text.empty()) {
-            return; // No diagnostics for empty document
+    static Location to_location(const SymbolLocation& symbol) {
+        int line = static_cast<int>(symbol.line);
+        int column = static_cast<int>(symbol.column);
+        return Location(symbol.uri, Range(line, column, line, column + static_cast<int>(symbol.length)));
+    }
+    
+    // Every use of the identifier at `pos` across the workspace. False
+    // without a workspace index or when there is no identifier there.
+    bool find_references(DocumentUri uri, Position pos, bool include_declaration, std::vector<Location>& out) const {
+        const Document* doc = find_document(uri);
+        if (!workspace || !doc || !doc->cache_valid) {
+            return false;
         }
+        std::string_view identifier = extract_identifier_at_position(doc->cached_source, doc->cached_snapshot.lines, pos);
+        if (identifier.empty()) {
+            return false;
+        }
+        out.clear();
+        for (const auto& reference : workspace->references(identifier, include_declaration)) {
+            out.push_back(to_location(reference));
+        }
+        return true;
+    }
+    
+    // Completion items at `pos`. The context comes from the current buffer,
+    // so text typed since the last analysis counts; declarations and class
+    // properties come from the last analysis, and classes and enums of
+    // other files from the workspace index. False until the document has
+    // been analysed. `incomplete` is set when items were cut at `limit`.
+    bool completion(DocumentUri uri, Position pos, std::vector<CompletionItem>& out, bool& incomplete,
+                    size_t limit = 200) const {
+        const Document* doc = find_document(uri);
+        if (!doc || !doc->cache_valid || !doc->cached_ast || pos.line < 0 || pos.character < 0) {
+            return false;
+        }
+        size_t offset = doc->buffer.offset_at(static_cast<size_t>(pos.line), static_cast<size_t>(pos.character));
+        CompletionContext context = completion_context(doc->buffer, offset);
+        out = complete(context, doc->completions, *doc->cached_ast, limit);
         
-        // Check if we need to parse (cache invalid or source changed)
-        std::string_view current_source = doc.text;
-        bool need_parse = !doc.cache_valid || doc.cached_source != current_source;
-        
-        if (need_parse) {
-            // Parse and cache using forma parser
-            std::cerr << "  Debug: Parsing document, source length=" << doc.cached_source.size() << std::endl;
-            auto parsed = forma::parse_document(doc.cached_source);
-            if (!doc.cached_ast) {
-                doc.cached_ast = std::make_unique<forma::Document<32, 16, 16, 32, 64, 64>>();
+        using Kind = CompletionContext::Kind;
+        bool wants_types = context.kind == Kind::Type || context.kind == Kind::Member || context.kind == Kind::TopLevel;
+        incomplete = out.size() >= limit;
+        if (workspace && wants_types && !incomplete) {
+            bool enums = context.kind == Kind::Type;
+            std::vector<WorkspaceSymbol> symbols;
+            bool complete_list = workspace->symbols_with_prefix(context.prefix, limit - out.size(),
+                [&](SymbolKind kind, std::string_view symbol_uri) {
+                    return (kind == SymbolKind::Class || (enums && kind == SymbolKind::Enum)) && symbol_uri != uri;
+                }, symbols);
+            for (auto& symbol : symbols) {
+                auto item_kind = symbol.kind == SymbolKind::Enum ? CompletionItemKind::Enum : CompletionItemKind::Class;
+                out.push_back({std::move(symbol.name), uri_to_path(symbol.location.uri), item_kind});
             }
-            *doc.cached_ast = parsed;
-            doc.cache_valid = true;
-            std::cerr << "  Debug: Parsed - types=" << doc.cached_ast->type_count 
-                     << ", enums=" << doc.cached_ast->enum_count 
-                     << ", events=" << doc.cached_ast->event_count 
-                     << ", symbols=" << doc.cached_ast->symbols.count << std::endl;
+            incomplete = !complete_list;
+        }
+        return true;
+    }
+    
+    // Semantic tokens of the last analysed version. The result is kept on
+    // the document so the next request can be answered with a delta; the
+    // result it replaces is moved into `previous`. nullptr until the
+    // document has been analysed.
+    const SemanticTokens* update_semantic_tokens(DocumentUri uri, SemanticTokens& previous) {
+        Document* doc = find_document(uri);
+        if (!doc || !doc->cache_valid || !doc->cached_ast) {
+            return nullptr;
+        }
+        previous = std::move(doc->semantic_tokens);
+        doc->semantic_tokens.result_id = previous.result_id + 1;
+        doc->semantic_tokens.data = build_semantic_tokens(doc->cached_snapshot, doc->cached_source, *doc->cached_ast);
+        return &doc->semantic_tokens;
+    }
+    
+    // Outline of the last analysed version; false until it has been analysed
+    bool document_symbols(DocumentUri uri, std::vector<DocumentSymbol>& out) const {
+        const Document* doc = find_document(uri);
+        if (!doc || !doc->cache_valid || !doc->cached_ast) {
+            return false;
+        }
+        out = build_document_symbols(doc->cached_snapshot, doc->cached_source, *doc->cached_ast);
+        return true;
+    }
+    
+    // Analyse the current buffer and install the result
+    void analyze_document(Document& doc) {
+        install(doc, *analyze_snapshot(doc.version, doc.buffer.snapshot(), [] { return false; }));
+    }
+    
+    // Merge the segment parses and run semantic analysis on a snapshot.
+    // `is_cancelled` is polled between phases; once it returns true the
+    // work is abandoned and nullopt returned.
+    template <typename IsCancelled>
+    static std::optional<Analysis> analyze_snapshot(int version, DocumentBuffer::Snapshot snapshot,
+                                                    IsCancelled&& is_cancelled) {
+        Analysis analysis;
+        analysis.version = version;
+        analysis.ast = snapshot.build_document();
+        if (is_cancelled()) {
+            return std::nullopt;
         }
         
+        analysis.source = snapshot.text();
+        analysis.snapshot = std::move(snapshot);
+        
         // Run semantic analysis using forma::analyze_document
         // Note: LSP doesn't need import resolution or asset collection for basic diagnostics
         // Those would require file system access and slow down interactive editing
-        if (doc.cached_ast) {
-            auto sem_diagnostics = forma::analyze_document(*doc.cached_ast);
-            convert_diagnostics(doc, sem_diagnostics);
+        auto sem_diagnostics = forma::analyze_document(*analysis.ast);
+        if (is_cancelled()) {
+            return std::nullopt;
         }
+        convert_diagnostics(analysis, sem_diagnostics);
+        return analysis;
+    }
+    
+    // Install a result computed by analyze_snapshot. Returns false when the
+    // document was closed or has changed since the snapshot was taken.
+    bool install_analysis(DocumentUri uri, Analysis&& analysis) {
+        Document* doc = find_document(uri);
+        if (!doc || doc->version != analysis.version) {
+            return false;
+        }
+        install(*doc, std::move(analysis));
+        return true;
     }
     
 private:
+    void install(Document& doc, Analysis&& analysis) {
+        doc.cached_snapshot = std::move(analysis.snapshot);
+        doc.cached_source = std::move(analysis.source);
+        doc.text = doc.cached_source;
+        doc.cached_ast = std::move(analysis.ast);
+        doc.diagnostics = analysis.diagnostics;
+        doc.diagnostic_count = analysis.diagnostic_count;
+        doc.analyzed_version = analysis.version;
+        doc.cache_valid = true;
+        index_document_completions(doc.completions, doc.cached_snapshot);
+        if (workspace) {
+            workspace->index_document(doc.uri, doc.cached_snapshot, doc.cached_source, *doc.cached_ast);
+        }
+    }
+
+    
     // Find first occurrence of identifier in source (simple search)
     static size_t find_in_source(std::string_view source, std::string_view identifier) {
         size_t pos = 0;
@@ -387,47 +563,17 @@ private:
         return std::string_view::npos;
     }
     
-    // Convert offset to line/column position
-    static std::pair<size_t, size_t> offset_to_position(std::string_view source, size_t offset) {
-        size_t line = 0;
-        size_t col = 0;
-        
-        for (size_t i = 0; i < offset && i < source.size(); ++i) {
-            if (source[i] == '\n') {
-                line++;
-                col = 0;
-            } else {
-                col++;
-            }
-        }
-        
-        return {line, col};
-    }
-    
     // Extract identifier at a given position from source text
-    static std::string_view extract_identifier_at_position(std::string_view source, Position pos) {
-        // Convert line/character position to offset
-        size_t offset = 0;
-        int current_line = 0;
-        int current_char = 0;
-        
-        for (size_t i = 0; i < source.size(); ++i) {
-            if (current_line == pos.line && current_char == pos.character) {
-                offset = i;
-                break;
-            }
-            
-            if (source[i] == '\n') {
-                current_line++;
-                current_char = 0;
-            } else {
-                current_char++;
-            }
+    static std::string_view extract_identifier_at_position(std::string_view source, const forma::LineIndex& lines,
+                                                           Position pos) {
+        if (pos.line < 0 || pos.character < 0 || static_cast<size_t>(pos.line) >= lines.line_count()) {
+            std::cerr << "  Debug: Position out of bounds (line=" << pos.line << ")" << std::endl;
+            return "";
         }
-        
-        // If we didn't find the position, try end of source
-        if (current_line < pos.line || (current_line == pos.line && current_char < pos.character)) {
-            std::cerr << "  Debug: Position out of bounds (line=" << current_line << ", char=" << current_char << ")" << std::endl;
+        size_t line = static_cast<size_t>(pos.line);
+        size_t offset = lines.line_start(line) + static_cast<size_t>(pos.character);
+        if (offset > lines.line_end(line)) {
+            std::cerr << "  Debug: Position out of bounds (char=" << pos.character << ")" << std::endl;
             return "";
         }
         
@@ -463,18 +609,19 @@ private:
     }
     
     template<size_t N>
-    void convert_diagnostics(Document& doc, const forma::DiagnosticList<N>& sem_diagnostics) {
+    static void convert_diagnostics(Analysis& doc, const forma::DiagnosticList<N>& sem_diagnostics) {
         doc.diagnostic_count = 0;
         
         // Convert semantic diagnostics to LSP diagnostics
         for (size_t i = 0; i < sem_diagnostics.count && doc.diagnostic_count < doc.diagnostics.size(); ++i) {
             const auto& sem_diag = sem_diagnostics.diagnostics[i];
+            forma::SourceLocation loc = doc.snapshot.lines.locate(sem_diag.location);
             
             Diagnostic lsp_diag;
-            lsp_diag.range.start.line = static_cast<int>(sem_diag.location.line);
-            lsp_diag.range.start.character = static_cast<int>(sem_diag.location.column);
-            lsp_diag.range.end.line = static_cast<int>(sem_diag.location.line);
-            lsp_diag.range.end.character = static_cast<int>(sem_diag.location.column + sem_diag.location.length);
+            lsp_diag.range.start.line = static_cast<int>(loc.line);
+            lsp_diag.range.start.character = static_cast<int>(loc.column);
+            lsp_diag.range.end.line = static_cast<int>(loc.line);
+            lsp_diag.range.end.character = static_cast<int>(loc.column + loc.length);
             
             // Map severity
             lsp_diag.severity = (sem_diag.severity == forma::DiagnosticSeverity::Error) 
@@ -3,10 +3,14 @@
 #include <iostream>
 #include <signal.h>
 
-bool running = true;
+using Server = forma::http::HttpServer<forma::lsp::LSPDocumentManager<16>>;
+
+Server* active_server = nullptr;
 
 void signal_handler(int) {
-    running = false;
+    if (active_server) {
+        active_server->stop();
+    }
 }
 
 int main(int argc, char* argv[]) {
@@ -15,11 +19,8 @@ int main(int argc, char* argv[]) {
         port = std::atoi(argv[1]);
     }
     
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-    
     forma::lsp::LSPDocumentManager<16> lsp_manager;
-    forma::http::HttpServer server(port, lsp_manager);
+    Server server(port, lsp_manager);
     
     if (!server.start()) {
         std::cerr << "Failed to start server on port " << port << std::endl;
@@ -29,6 +30,10 @@ int main(int argc, char* argv[]) {
     std::cout << "Forma LSP Server running on http://localhost:" << port << std::endl;
     std::cout << "Press Ctrl+C to stop\n" << std::endl;
     
+    active_server = &server;
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    
     server.run();
     
     return 0;
@@ -1,52 +1,160 @@
 #include "lsp.hpp"
+#include "diagnostics_worker.hpp"
 #include "stdio_transport.hpp"
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace forma::lsp;
 
+using Manager = LSPDocumentManager<64>;
+
+// Edits arriving within this window are analysed together
+constexpr auto DIAGNOSTICS_DEBOUNCE = std::chrono::milliseconds(100);
+
+// Send the current diagnostics of `uri` as a publishDiagnostics notification
+template <typename Manager>
+static void publish_diagnostics(Manager& lsp_manager, const std::string& uri) {
+    const auto* doc = lsp_manager.find_document(uri);
+    
+    std::ostringstream diag_json;
+    diag_json << "{\"uri\":\"" << uri << "\",\"diagnostics\":[";
+    
+    if (doc) {
+        bool first = true;
+        for (size_t i = 0; i < doc->diagnostic_count; ++i) {
+            if (!first) diag_json << ",";
+            first = false;
+            
+            const auto& diag = doc->diagnostics[i];
+            diag_json << "{"
+                << "\"range\":{"
+                    << "\"start\":{\"line\":" << diag.range.start.line << ",\"character\":" << diag.range.start.character << "},"
+                    << "\"end\":{\"line\":" << diag.range.end.line << ",\"character\":" << diag.range.end.character << "}"
+                << "},"
+                << "\"severity\":" << static_cast<int>(diag.severity) << ","
+                << "\"message\":\"" << diag.message << "\""
+                << "}";
+        }
+        std::cerr << "Sent " << doc->diagnostic_count << " diagnostics" << std::endl;
+    }
+    
+    diag_json << "]}";
+    
+    std::string notification = StdioTransport::make_notification(
+        "textDocument/publishDiagnostics",
+        diag_json.str()
+    );
+    StdioTransport::write_message(notification);
+}
+
+static void append_location(std::string& out, const Location& location) {
+    out += "{\"uri\":\"";
+    out += location.uri;
+    out += "\",\"range\":{\"start\":{\"line\":" + std::to_string(location.range.start.line) +
+           ",\"character\":" + std::to_string(location.range.start.character) +
+           "},\"end\":{\"line\":" + std::to_string(location.range.end.line) +
+           ",\"character\":" + std::to_string(location.range.end.character) + "}}}";
+}
+
 int main() {
     // Allocate on heap to avoid stack overflow
     // Use 64 document slots to handle larger workspaces
-    auto lsp_manager = std::make_unique<LSPDocumentManager<64>>();
+    auto lsp_manager = std::make_unique<Manager>();
     bool running = true;
     
+    // Analysis runs on the diagnostics worker; this thread only applies
+    // edits and answers requests, holding the mutex while it touches the
+    // manager
+    std::mutex manager_mutex;
+    
+    // Built in the background after initialize; it has its own lock, so
+    // queries are answered (from what is indexed so far) while it fills
+    WorkspaceIndex workspace;
+    lsp_manager->workspace = &workspace;
+    std::jthread indexer;
+    
+    DiagnosticsWorker<Manager> diagnostics(*lsp_manager, manager_mutex,
+        [&](const std::string& uri) { publish_diagnostics(*lsp_manager, uri); },
+        DIAGNOSTICS_DEBOUNCE);
+    
+    // Messages are read into one reusable buffer and parsed in place;
+    // the views below point into it and are valid for one iteration
+    MessageReader reader(STDIN_FILENO);
+    JsonParser json;
+    std::vector<TextDocumentContentChangeEvent> changes;
+    
     // Write to stderr for logging (stdout is for LSP messages)
     std::cerr << "Forma LSP Server (stdio) started" << std::endl;
     
-    while (running && std::cin.good()) {
+    while (running) {
         try {
             // Read incoming message
-            std::string message = StdioTransport::read_message();
-            if (message.empty()) {
+            auto message = reader.next();
+            if (!message) {
+                if (!reader.error().empty()) {
+                    std::cerr << "Unreadable input: " << reader.error() << std::endl;
+                }
                 break; // EOF or error
             }
             
-            std::cerr << "Received: " << message.substr(0, 100) << "..." << std::endl;
+            std::cerr << "Received: " << std::string_view(message->data(), std::min(message->size(), size_t(100))) << "..." << std::endl;
+            
+            if (!json.parse(*message)) {
+                std::cerr << "Malformed message" << std::endl;
+                continue;
+            }
             
             // Parse method and id
-            std::string method = StdioTransport::get_string_field(message, "method");
-            int id = StdioTransport::get_int_field(message, "id");
+            JsonParser::View root = json.root();
+            std::string_view method = root["method"].string();
+            int id = root["id"].integer();
             
             std::cerr << "Method: " << method << ", ID: " << id << std::endl;
             
             // Handle requests
             if (method == "initialize") {
+                JsonParser::View params = root["params"];
+                std::string root_path = uri_to_path(params["rootUri"].string());
+                if (root_path.empty()) {
+                    root_path = params["rootPath"].string();
+                }
+                if (!root_path.empty()) {
+                    indexer = std::jthread([&workspace, root_path] {
+                        forma::ThreadPool pool;
+                        auto start = std::chrono::steady_clock::now();
+                        size_t files = workspace.index_directory(root_path, pool);
+                        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+                        std::cerr << "Indexed " << files << " files under " << root_path << " in " << ms.count() << " ms" << std::endl;
+                    });
+                }
+                
                 std::string response = StdioTransport::make_response(id,
                     "{"
                     "\"capabilities\":{"
                         "\"textDocumentSync\":{"
                             "\"openClose\":true,"
-                            "\"change\":1"
+                            "\"change\":2"
                         "},"
                         "\"diagnosticProvider\":true,"
                         "\"completionProvider\":{"
                             "\"triggerCharacters\":[\".\",\":\"]"
                         "},"
                         "\"hoverProvider\":true,"
-                        "\"definitionProvider\":true"
+                        "\"definitionProvider\":true,"
+                        "\"referencesProvider\":true,"
+                        "\"workspaceSymbolProvider\":true,"
+                        "\"documentSymbolProvider\":true,"
+                        "\"semanticTokensProvider\":{"
+                            "\"legend\":" + std::string(SEMANTIC_TOKENS_LEGEND) + ","
+                            "\"full\":{\"delta\":true}"
+                        "}"
                     "},"
                     "\"serverInfo\":{"
                         "\"name\":\"forma-lsp\","
@@ -72,11 +180,10 @@ int main() {
                 
             } else if (method == "textDocument/didOpen") {
                 // Extract document info
-                std::string params = StdioTransport::get_object_field(message, "params");
-                std::string textDocument = StdioTransport::get_object_field(params, "textDocument");
-                std::string uri = StdioTransport::get_string_field(textDocument, "uri");
-                std::string text = StdioTransport::get_string_field(textDocument, "text");
-                int version = StdioTransport::get_int_field(textDocument, "version");
+                JsonParser::View textDocument = root["params"]["textDocument"];
+                std::string_view uri = textDocument["uri"].string();
+                std::string_view text = textDocument["text"].string();
+                int version = textDocument["version"].integer();
                 
                 std::cerr << "Document opened: " << uri << " (" << text.length() << " bytes)" << std::endl;
                 std::cerr << "Debug: First 200 chars of text: " << text.substr(0, std::min(size_t(200), text.size())) << std::endl;
@@ -88,80 +195,74 @@ int main() {
                 item.version = version;
                 item.language_id = "forma";
                 
-                std::cerr << "Debug: Calling did_open..." << std::endl;
-                lsp_manager->did_open(item);
-                std::cerr << "Debug: did_open complete" << std::endl;
-                
-                // Get diagnostics from the document
-                const auto* doc = lsp_manager->find_document(uri);
-                
-                // Send diagnostics
-                std::ostringstream diag_json;
-                diag_json << "{\"uri\":\"" << uri << "\",\"diagnostics\":[";
-                
-                if (doc) {
-                    bool first = true;
-                    for (size_t i = 0; i < doc->diagnostic_count; ++i) {
-                        if (!first) diag_json << ",";
-                        first = false;
-                        
-                        const auto& diag = doc->diagnostics[i];
-                        diag_json << "{"
-                            << "\"range\":{"
-                                << "\"start\":{\"line\":" << diag.range.start.line << ",\"character\":" << diag.range.start.character << "},"
-                                << "\"end\":{\"line\":" << diag.range.end.line << ",\"character\":" << diag.range.end.character << "}"
-                            << "},"
-                            << "\"severity\":" << static_cast<int>(diag.severity) << ","
-                            << "\"message\":\"" << diag.message << "\""
-                            << "}";
-                    }
-                    std::cerr << "Sent " << doc->diagnostic_count << " diagnostics" << std::endl;
+                {
+                    std::lock_guard lock(manager_mutex);
+                    lsp_manager->open_document(item);
                 }
-                
-                diag_json << "]}";
-                
-                std::string notification = StdioTransport::make_notification(
-                    "textDocument/publishDiagnostics",
-                    diag_json.str()
-                );
-                StdioTransport::write_message(notification);
+                diagnostics.schedule_now(uri);
                 
             } else if (method == "textDocument/didChange") {
-                std::string params = StdioTransport::get_object_field(message, "params");
-                std::string textDocument = StdioTransport::get_object_field(params, "textDocument");
-                std::string uri = StdioTransport::get_string_field(textDocument, "uri");
+                JsonParser::View params = root["params"];
+                JsonParser::View textDocument = params["textDocument"];
+                std::string_view uri = textDocument["uri"].string();
                 
-                // For simplicity, get the full text from contentChanges[0].text
-                // This assumes full document sync
-                std::string contentChanges = StdioTransport::get_object_field(params, "contentChanges");
+                // Incremental sync: each change carries a range, except a
+                // full replacement which only has text
+                changes.clear();
+                for (JsonParser::View element : params["contentChanges"]) {
+                    TextDocumentContentChangeEvent change(element["text"].string());
+                    if (JsonParser::View range = element["range"]; range.exists()) {
+                        JsonParser::View start = range["start"];
+                        JsonParser::View end = range["end"];
+                        change.has_range = true;
+                        change.range = Range(start["line"].integer(), start["character"].integer(),
+                                             end["line"].integer(), end["character"].integer());
+                    }
+                    changes.push_back(change);
+                }
+                
+                VersionedTextDocumentIdentifier doc_id;
+                doc_id.uri = uri;
+                doc_id.version = textDocument["version"].integer();
+                {
+                    std::lock_guard lock(manager_mutex);
+                    lsp_manager->apply_changes(doc_id, changes);
+                }
+                diagnostics.schedule(uri);
                 
-                std::cerr << "Document changed: " << uri << std::endl;
-                // Note: Full implementation would parse contentChanges array and extract text
+                std::cerr << "Document changed: " << uri << " (" << changes.size() << " changes)" << std::endl;
                 
             } else if (method == "textDocument/didClose") {
-                std::string params = StdioTransport::get_object_field(message, "params");
-                std::string textDocument = StdioTransport::get_object_field(params, "textDocument");
-                std::string uri = StdioTransport::get_string_field(textDocument, "uri");
+                std::string_view uri = root["params"]["textDocument"]["uri"].string();
                 
                 TextDocumentIdentifier id;
                 id.uri = uri;
-                lsp_manager->did_close(id);
+                diagnostics.cancel(uri);
+                {
+                    std::lock_guard lock(manager_mutex);
+                    lsp_manager->did_close(id);
+                }
                 std::cerr << "Document closed: " << uri << std::endl;
                 
             } else if (method == "textDocument/definition") {
-                std::string params = StdioTransport::get_object_field(message, "params");
-                std::string textDocument = StdioTransport::get_object_field(params, "textDocument");
-                std::string uri = StdioTransport::get_string_field(textDocument, "uri");
-                std::string position_str = StdioTransport::get_object_field(params, "position");
+                JsonParser::View params = root["params"];
+                std::string_view uri = params["textDocument"]["uri"].string();
+                JsonParser::View position = params["position"];
                 
                 Position pos;
-                pos.line = StdioTransport::get_int_field(position_str, "line");
-                pos.character = StdioTransport::get_int_field(position_str, "character");
+                pos.line = position["line"].integer();
+                pos.character = position["character"].integer();
                 
                 std::cerr << "Definition request at " << uri << " (" << pos.line << ":" << pos.character << ")" << std::endl;
                 
+                // Answered from the last analysed version of the document
                 Location def_location;
-                if (lsp_manager->find_definition(uri, pos, def_location)) {
+                bool found = false;
+                {
+                    std::lock_guard lock(manager_mutex);
+                    found = lsp_manager->find_definition(uri, pos, def_location);
+                }
+                if (found) {
                     std::ostringstream result;
                     result << "{"
                         << "\"uri\":\"" << def_location.uri << "\","
@@ -181,11 +282,115 @@ int main() {
                     std::cerr << "No definition found" << std::endl;
                 }
                 
+            } else if (method == "textDocument/references") {
+                JsonParser::View params = root["params"];
+                std::string_view uri = params["textDocument"]["uri"].string();
+                Position pos(params["position"]["line"].integer(), params["position"]["character"].integer());
+                bool include_declaration = params["context"]["includeDeclaration"].is(JsonParser::Kind::True);
+                
+                std::string result = "null";
+                {
+                    std::lock_guard lock(manager_mutex);
+                    std::vector<Location> references;
+                    if (std::as_const(*lsp_manager).find_references(uri, pos, include_declaration, references)) {
+                        result = "[";
+                        for (size_t i = 0; i < references.size(); ++i) {
+                            if (i > 0) result += ',';
+                            append_location(result, references[i]);
+                        }
+                        result += ']';
+                    }
+                }
+                StdioTransport::write_message(StdioTransport::make_response(id, result));
+                
+            } else if (method == "workspace/symbol") {
+                std::string_view query = root["params"]["query"].string();
+                
+                // SymbolInformation[]; names are identifiers, no escaping needed
+                std::string result = "[";
+                auto symbols = workspace.symbols(query);
+                for (size_t i = 0; i < symbols.size(); ++i) {
+                    const auto& symbol = symbols[i];
+                    if (i > 0) result += ',';
+                    result += "{\"name\":\"" + symbol.name + "\",\"kind\":" +
+                              std::to_string(static_cast<int>(symbol.kind)) + ",\"containerName\":\"" +
+                              symbol.container + "\",\"location\":";
+                    append_location(result, Manager::to_location(symbol.location));
+                    result += '}';
+                }
+                result += ']';
+                StdioTransport::write_message(StdioTransport::make_response(id, result));
+                
+            } else if (method == "workspace/didChangeWatchedFiles") {
+                // FileChangeType: 1 created, 2 changed, 3 deleted. Open
+                // documents keep their editor content.
+                for (JsonParser::View change : root["params"]["changes"]) {
+                    std::string_view uri = change["uri"].string();
+                    if (change["type"].integer() == 3) {
+                        workspace.remove(uri);
+                    } else if (is_forma_source(uri_to_path(uri))) {
+                        workspace.index_file(uri_to_path(uri));
+                    }
+                }
+                
+            } else if (method == "textDocument/semanticTokens/full" ||
+                       method == "textDocument/semanticTokens/full/delta") {
+                JsonParser::View params = root["params"];
+                std::string_view uri = params["textDocument"]["uri"].string();
+                std::string_view previous_id = params["previousResultId"].string();
+                
+                // Encoded while the manager is locked: the data lives on the document
+                std::string result = "null";
+                {
+                    std::lock_guard lock(manager_mutex);
+                    SemanticTokens previous;
+                    if (const SemanticTokens* tokens = lsp_manager->update_semantic_tokens(uri, previous)) {
+                        bool delta = method.ends_with("/delta") && !previous_id.empty() && previous.result_id != 0 &&
+                                     previous_id == std::to_string(previous.result_id);
+                        result = delta
+                            ? encode_semantic_tokens_delta(tokens->result_id, diff_semantic_tokens(previous.data, tokens->data))
+                            : encode_semantic_tokens(*tokens);
+                    }
+                }
+                StdioTransport::write_message(StdioTransport::make_response(id, result));
+                
+            } else if (method == "textDocument/completion") {
+                JsonParser::View params = root["params"];
+                std::string_view uri = params["textDocument"]["uri"].string();
+                Position pos(params["position"]["line"].integer(), params["position"]["character"].integer());
+                
+                std::string result = "null";
+                std::vector<CompletionItem> items;
+                bool incomplete = false;
+                bool found = false;
+                {
+                    std::lock_guard lock(manager_mutex);
+                    found = std::as_const(*lsp_manager).completion(uri, pos, items, incomplete);
+                }
+                if (found) {
+                    result = encode_completions(items, incomplete);
+                }
+                StdioTransport::write_message(StdioTransport::make_response(id, result));
+                
+            } else if (method == "textDocument/documentSymbol") {
+                std::string_view uri = root["params"]["textDocument"]["uri"].string();
+                
+                std::string result = "null";
+                {
+                    std::lock_guard lock(manager_mutex);
+                    std::vector<DocumentSymbol> symbols;
+                    const auto& manager = std::as_const(*lsp_manager);
+                    if (manager.document_symbols(uri, symbols)) {
+                        result = encode_document_symbols(symbols, manager.find_document(uri)->cached_snapshot.lines);
+                    }
+                }
+                StdioTransport::write_message(StdioTransport::make_response(id, result));
+                
             } else {
                 // Unknown method
                 if (id >= 0) {
                     std::string response = StdioTransport::make_error_response(
-                        id, -32601, "Method not found: " + method
+                        id, -32601, "Method not found: " + std::string(method)
                     );
                     StdioTransport::write_message(response);
                 }
@@ -0,0 +1,271 @@
+#pragma once
+
+#include "document_buffer.hpp"
+#include <parser/widget_registry.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace forma::lsp {
+
+// ============================================================================
+// Semantic Tokens - Highlighting from the token buffers and the cached AST
+// ============================================================================
+
+// Indices into the legend advertised in the initialize response
+enum class SemanticTokenType : uint32_t {
+    Keyword,
+    String,
+    Number,
+    Class,
+    Enum,
+    EnumMember,
+    Event,
+    Property,
+    Method,
+    Parameter,
+    Type,
+    Variable,
+};
+
+enum SemanticTokenModifier : uint32_t {
+    Declaration = 1u << 0,
+    DefaultLibrary = 1u << 1,
+};
+
+inline constexpr std::string_view SEMANTIC_TOKENS_LEGEND =
+    "{\"tokenTypes\":[\"keyword\",\"string\",\"number\",\"class\",\"enum\",\"enumMember\",\"event\","
+    "\"property\",\"method\",\"parameter\",\"type\",\"variable\"],"
+    "\"tokenModifiers\":[\"declaration\",\"defaultLibrary\"]}";
+
+// Tokens in the LSP wire format: five integers per token (line delta,
+// start delta, length, type, modifiers), relative to the previous token
+struct SemanticTokens {
+    uint64_t result_id = 0;
+    std::vector<uint32_t> data;
+};
+
+// One replacement turning the previous data into the current one
+struct SemanticTokensEdit {
+    size_t start = 0;
+    size_t delete_count = 0;
+    std::span<const uint32_t> data;
+};
+
+namespace detail {
+
+constexpr bool is_builtin_type(std::string_view name) {
+    return name == "int" || name == "float" || name == "string" || name == "bool" || name == "void";
+}
+
+// Appends one token, split at line breaks: clients without multiline token
+// support drop tokens that span lines
+class SemanticTokenEncoder {
+public:
+    SemanticTokenEncoder(const forma::LineIndex& lines, std::vector<uint32_t>& out) : lines(lines), out(out) {}
+
+    void add(size_t offset, size_t length, SemanticTokenType type, uint32_t modifiers) {
+        // Tokens arrive in order, so the line only moves forward
+        while (line + 1 < lines.line_count() && lines.line_start(line + 1) <= offset) {
+            ++line;
+        }
+        size_t end = offset + length;
+        while (offset < end) {
+            size_t piece_end = std::min(end, lines.line_end(line));
+            if (piece_end > offset) {
+                size_t column = offset - lines.line_start(line);
+                out.push_back(static_cast<uint32_t>(line - prev_line));
+                out.push_back(static_cast<uint32_t>(line == prev_line ? column - prev_column : column));
+                out.push_back(static_cast<uint32_t>(piece_end - offset));
+                out.push_back(static_cast<uint32_t>(type));
+                out.push_back(modifiers);
+                prev_line = line;
+                prev_column = column;
+            }
+            if (piece_end == end || line + 1 >= lines.line_count()) {
+                break;
+            }
+            ++line;
+            offset = lines.line_start(line);
+        }
+    }
+
+private:
+    const forma::LineIndex& lines;
+    std::vector<uint32_t>& out;
+    size_t line = 0;
+    size_t prev_line = 0;
+    size_t prev_column = 0;
+};
+
+inline void append_uint(std::string& out, uint64_t value) {
+    char digits[20];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+inline void append_data(std::string& out, std::span<const uint32_t> data) {
+    out += '[';
+    for (size_t i = 0; i < data.size(); ++i) {
+        if (i > 0) out += ',';
+        append_uint(out, data[i]);
+    }
+    out += ']';
+}
+
+} // namespace detail
+
+// Classify every token of an analysed snapshot. Keywords and literals come
+// from the token kind; identifiers from their position (after `class`,
+// before `:`, ...) and from the document's declarations.
+template <typename DocType>
+std::vector<uint32_t> build_semantic_tokens(const DocumentBuffer::Snapshot& snapshot, std::string_view source,
+                                            const DocType& doc) {
+    using forma::TokenKind;
+    auto tokens = snapshot.tokens();
+
+    std::unordered_set<std::string_view> enum_members;
+    for (size_t i = 0; i < doc.enum_count; ++i) {
+        for (size_t v = 0; v < doc.enums[i].value_count; ++v) {
+            enum_members.insert(doc.enums[i].values[v].name);
+        }
+    }
+
+    std::vector<uint32_t> data;
+    data.reserve(tokens.size() * 5);
+    detail::SemanticTokenEncoder encoder(snapshot.lines, data);
+
+    auto kind_at = [&](size_t i) { return i < tokens.size() ? tokens[i].kind : TokenKind::EndOfFile; };
+    bool in_params = false;  // Inside a method or event parameter list
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const auto& tok = tokens[i];
+        TokenKind prev = i > 0 ? tokens[i - 1].kind : TokenKind::EndOfFile;
+        TokenKind next = kind_at(i + 1);
+
+        switch (tok.kind) {
+            case TokenKind::StringLiteral:
+                encoder.add(tok.offset, tok.length, SemanticTokenType::String, 0);
+                continue;
+            case TokenKind::IntegerLiteral:
+            case TokenKind::FloatLiteral:
+                encoder.add(tok.offset, tok.length, SemanticTokenType::Number, 0);
+                continue;
+            case TokenKind::Property: case TokenKind::Method: case TokenKind::When: case TokenKind::On:
+            case TokenKind::Import: case TokenKind::Preview: case TokenKind::Enum: case TokenKind::Event:
+            case TokenKind::Or: case TokenKind::Class: case TokenKind::Animate: case TokenKind::Requires:
+            case TokenKind::BoolLiteral:
+                encoder.add(tok.offset, tok.length, SemanticTokenType::Keyword, 0);
+                continue;
+            case TokenKind::RParen:
+                in_params = false;
+                continue;
+            case TokenKind::Identifier:
+                break;
+            default:
+                continue;
+        }
+
+        std::string_view text = source.substr(tok.offset, tok.length);
+        SemanticTokenType type = SemanticTokenType::Variable;
+        uint32_t modifiers = 0;
+
+        if (prev == TokenKind::Class) {
+            type = SemanticTokenType::Class;
+            modifiers = Declaration;
+        } else if (prev == TokenKind::Enum) {
+            type = SemanticTokenType::Enum;
+            modifiers = Declaration;
+        } else if (prev == TokenKind::Event) {
+            type = SemanticTokenType::Event;
+            modifiers = Declaration;
+            in_params = next == TokenKind::LParen;
+        } else if (prev == TokenKind::Property) {
+            type = SemanticTokenType::Property;
+            modifiers = Declaration;
+        } else if (next == TokenKind::LParen && (prev == TokenKind::Method || kind_at(i - 2) == TokenKind::Method)) {
+            type = SemanticTokenType::Method;
+            modifiers = Declaration;
+            in_params = true;
+        } else if (next == TokenKind::Colon) {
+            type = SemanticTokenType::Property;
+            if (in_params) {
+                type = SemanticTokenType::Parameter;
+                modifiers = Declaration;
+            }
+        } else if (const auto* symbol = doc.symbols.find(text)) {
+            switch (symbol->kind) {
+                case forma::Symbol::Kind::Type: type = SemanticTokenType::Class; break;
+                case forma::Symbol::Kind::Enum: type = SemanticTokenType::Enum; break;
+                case forma::Symbol::Kind::Event: type = SemanticTokenType::Event; break;
+                case forma::Symbol::Kind::Property: type = SemanticTokenType::Property; break;
+            }
+        } else if (detail::is_builtin_type(text)) {
+            type = SemanticTokenType::Type;
+            modifiers = DefaultLibrary;
+        } else if (forma::widgets::is_widget(text)) {
+            type = SemanticTokenType::Class;
+            modifiers = DefaultLibrary;
+        } else if (enum_members.contains(text)) {
+            type = SemanticTokenType::EnumMember;
+        }
+        encoder.add(tok.offset, tok.length, type, modifiers);
+    }
+    return data;
+}
+
+// The smallest single edit from `previous` to `current`: everything
+// between their common prefix and common suffix. Typing in a large file
+// touches a few tokens, so the edit stays small.
+inline SemanticTokensEdit diff_semantic_tokens(std::span<const uint32_t> previous, std::span<const uint32_t> current) {
+    size_t prefix = 0;
+    size_t limit = std::min(previous.size(), current.size());
+    while (prefix < limit && previous[prefix] == current[prefix]) {
+        ++prefix;
+    }
+    size_t suffix = 0;
+    while (suffix < limit - prefix &&
+           previous[previous.size() - 1 - suffix] == current[current.size() - 1 - suffix]) {
+        ++suffix;
+    }
+    return {prefix, previous.size() - prefix - suffix, current.subspan(prefix, current.size() - prefix - suffix)};
+}
+
+// SemanticTokens result: {"resultId":"..","data":[..]}
+inline std::string encode_semantic_tokens(const SemanticTokens& tokens) {
+    std::string out;
+    out.reserve(tokens.data.size() * 4 + 32);
+    out += "{\"resultId\":\"";
+    detail::append_uint(out, tokens.result_id);
+    out += "\",\"data\":";
+    detail::append_data(out, tokens.data);
+    out += '}';
+    return out;
+}
+
+// SemanticTokensDelta result: {"resultId":"..","edits":[..]}
+inline std::string encode_semantic_tokens_delta(uint64_t result_id, const SemanticTokensEdit& edit) {
+    std::string out;
+    out.reserve(edit.data.size() * 4 + 64);
+    out += "{\"resultId\":\"";
+    detail::append_uint(out, result_id);
+    out += "\",\"edits\":[";
+    if (edit.delete_count > 0 || !edit.data.empty()) {
+        out += "{\"start\":";
+        detail::append_uint(out, edit.start);
+        out += ",\"deleteCount\":";
+        detail::append_uint(out, edit.delete_count);
+        out += ",\"data\":";
+        detail::append_data(out, edit.data);
+        out += '}';
+    }
+    out += "]}";
+    return out;
+}
+
+} // namespace forma::lsp
@@ -1,56 +1,161 @@
 #pragma once
 
+#include "json_parser.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <string>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <sstream>
-#include <cstring>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
 
 namespace forma::lsp {
 
-// Simple JSON-RPC 2.0 reader/writer for stdio transport
-class StdioTransport {
+// ============================================================================
+// Stdio Transport
+// ============================================================================
+
+// Content-Length framing over a raw file descriptor. Reads go straight
+// into one reusable buffer, which grows to the largest message seen, and
+// a message is handed out as a span of that buffer rather than copied.
+// A header block without a valid Content-Length, or one announcing more
+// than MAX_CONTENT_LENGTH, ends the stream: the next message boundary
+// cannot be known, and the buffer is never grown for it.
+class MessageReader {
 public:
-    // Read a JSON-RPC message from stdin
-    static std::string read_message() {
-        std::string content;
-        size_t content_length = 0;
-        
-        // Read headers
-        while (true) {
-            std::string line;
-            std::getline(std::cin, line);
-            
-            // Remove \r if present
-            if (!line.empty() && line.back() == '\r') {
-                line.pop_back();
+    static constexpr size_t MAX_CONTENT_LENGTH = 64 * 1024 * 1024;
+    static constexpr size_t MAX_HEADER = 16 * 1024;
+
+    explicit MessageReader(int fd = STDIN_FILENO, size_t initial_capacity = 64 * 1024)
+        : fd(fd), buffer(initial_capacity) {}
+
+    // Body of the next message, or nullopt at end of input or when the
+    // input cannot be framed (see error()). The span stays valid until the
+    // next call and may be modified (JsonParser decodes strings in place).
+    std::optional<std::span<char>> next() {
+        begin = consumed;
+        for (;;) {
+            if (!failure.empty()) return std::nullopt;
+            size_t content_length = 0;
+            size_t header_size = parse_header(content_length);
+            if (!failure.empty()) return std::nullopt;
+            if (header_size == 0) {
+                if (end - begin > MAX_HEADER) {
+                    failure = "Header too large";
+                    return std::nullopt;
+                }
+                if (!fill(end - begin + 1)) return std::nullopt;
+                continue;
             }
-            
-            // Empty line marks end of headers
-            if (line.empty()) {
-                break;
+
+            size_t total = header_size + content_length;
+            while (end - begin < total) {
+                if (!fill(total)) return std::nullopt;
             }
-            
-            // Parse Content-Length header
-            const char* prefix = "Content-Length: ";
-            if (line.compare(0, strlen(prefix), prefix) == 0) {
-                content_length = std::stoul(line.substr(strlen(prefix)));
+            consumed = begin + total;
+            return std::span<char>(buffer.data() + begin + header_size, content_length);
+        }
+    }
+
+    // Bytes received but not yet returned as messages
+    size_t buffered() const { return end - consumed; }
+
+    // Why the stream ended early, or empty if it did not
+    std::string_view error() const { return failure; }
+
+private:
+    int fd;
+    std::vector<char> buffer;
+    size_t begin = 0;     // Start of the current message
+    size_t consumed = 0;  // End of the last returned message
+    size_t end = 0;       // End of received data
+    std::string_view failure;
+
+    // Size of the header block at `begin` (including the blank line), or 0
+    // if it is not complete yet or invalid (failure is set). Lines may end
+    // in \r\n or \n.
+    size_t parse_header(size_t& content_length) {
+        bool has_length = false;
+        size_t line = begin;
+        while (line < end) {
+            const char* newline = static_cast<const char*>(std::memchr(buffer.data() + line, '\n', end - line));
+            if (!newline) return 0;
+            size_t line_end = static_cast<size_t>(newline - buffer.data());
+            std::string_view text(buffer.data() + line, line_end - line);
+            if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+            line = line_end + 1;
+
+            if (text.empty()) {
+                if (!has_length) {
+                    failure = "Missing Content-Length";
+                    return 0;
+                }
+                return line - begin;
+            }
+            constexpr std::string_view name = "content-length:";
+            if (text.size() > name.size() && std::equal(name.begin(), name.end(), text.begin(),
+                    [](char a, char b) { return a == (b | 0x20); })) {
+                std::string_view value = text.substr(name.size());
+                while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+                while (!value.empty() && value.back() == ' ') value.remove_suffix(1);
+                auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), content_length);
+                if (value.empty() || ec != std::errc() || ptr != value.data() + value.size()) {
+                    failure = "Invalid Content-Length";
+                    return 0;
+                }
+                if (content_length > MAX_CONTENT_LENGTH) {
+                    failure = "Content-Length too large";
+                    return 0;
+                }
+                has_length = true;
             }
         }
-        
-        // Read content
-        if (content_length > 0) {
-            content.resize(content_length);
-            std::cin.read(&content[0], static_cast<std::streamsize>(content_length));
+        return 0;
+    }
+
+    // Read until at least `needed` bytes of the current message are
+    // buffered, or fewer if no more are available right now. Moves the
+    // message to the front and grows the buffer as required.
+    bool fill(size_t needed) {
+        if (begin + needed > buffer.size()) {
+            std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            consumed -= begin;
+            begin = 0;
+            if (needed > buffer.size()) {
+                buffer.resize(std::max(needed, buffer.size() * 2));
+            }
+        }
+        for (;;) {
+            ssize_t n = read(fd, buffer.data() + end, buffer.size() - end);
+            if (n > 0) {
+                end += static_cast<size_t>(n);
+                return true;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            return false;
         }
-        
-        return content;
     }
-    
-    // Write a JSON-RPC message to stdout
+};
+
+// Simple JSON-RPC 2.0 writer for stdio transport
+class StdioTransport {
+public:
+    // Write a JSON-RPC message to stdout. Responses and diagnostics are
+    // written from different threads; the lock keeps messages whole.
     static void write_message(const std::string& content) {
         std::ostringstream header;
         header << "Content-Length: " << content.length() << "\r\n\r\n";
         
+        static std::mutex write_mutex;
+        std::lock_guard lock(write_mutex);
         std::cout << header.str() << content;
         std::cout.flush();
     }
@@ -77,91 +182,6 @@ public:
              << "\",\"params\":" << params << "}";
         return json.str();
     }
-    
-    // Parse simple JSON fields (minimal parser for LSP)
-    static std::string get_string_field(const std::string& json, const std::string& field) {
-        std::string search = "\"" + field + "\":\"";
-        size_t pos = json.find(search);
-        if (pos == std::string::npos) return "";
-        
-        pos += search.length();
-        
-        // Find the closing quote, handling escape sequences
-        std::string result;
-        bool escaped = false;
-        for (size_t i = pos; i < json.length(); ++i) {
-            char c = json[i];
-            
-            if (escaped) {
-                // Handle escape sequences
-                switch (c) {
-                    case 'n': result += '\n'; break;
-                    case 'r': result += '\r'; break;
-                    case 't': result += '\t'; break;
-                    case '\\': result += '\\'; break;
-                    case '"': result += '"'; break;
-                    case '/': result += '/'; break;
-                    default: result += c; break;  // Unknown escape, keep as-is
-                }
-                escaped = false;
-            } else if (c == '\\') {
-                escaped = true;
-            } else if (c == '"') {
-                // Found unescaped closing quote
-                return result;
-            } else {
-                result += c;
-            }
-        }
-        
-        return result;  // No closing quote found, return what we have
-    }
-    
-    static int get_int_field(const std::string& json, const std::string& field) {
-        std::string search = "\"" + field + "\":";
-        size_t pos = json.find(search);
-        if (pos == std::string::npos) return -1;
-        
-        pos += search.length();
-        size_t end = json.find_first_of(",}", pos);
-        if (end == std::string::npos) return -1;
-        
-        std::string value = json.substr(pos, end - pos);
-        try {
-            return std::stoi(value);
-        } catch (...) {
-            return -1;
-        }
-    }
-    
-    static std::string get_object_field(const std::string& json, const std::string& field) {
-        std::string search = "\"" + field + "\":";
-        size_t pos = json.find(search);
-        if (pos == std::string::npos) return "{}";
-        
-        pos += search.length();
-        
-        // Skip whitespace
-        while (pos < json.length() && std::isspace(json[pos])) pos++;
-        
-        if (pos >= json.length() || json[pos] != '{') return "{}";
-        
-        // Find matching closing brace
-        int depth = 0;
-        size_t start = pos;
-        while (pos < json.length()) {
-            if (json[pos] == '{') depth++;
-            else if (json[pos] == '}') {
-                depth--;
-                if (depth == 0) {
-                    return json.substr(start, pos - start + 1);
-                }
-            }
-            pos++;
-        }
-        
-        return "{}";
-    }
 };
 
 } // namespace forma::lsp
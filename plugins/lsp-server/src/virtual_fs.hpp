@@ -1,245 +1,255 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
-#include <array>
-#include <optional>
+#include <unordered_map>
+#include <vector>
 
 namespace forma::vfs {
 
+// Immutable file content, shared between the filesystem and any snapshot
+// taken of it. A write replaces the pointer and never touches the string,
+// so holders of an older snapshot keep reading the text they took.
+using FileContent = std::shared_ptr<const std::string>;
+
 // Virtual file entry
 struct VirtualFile {
     std::string uri;
-    std::string content;
+    FileContent content;
     int version = 0;
-    bool exists = false;
+
+    std::string_view text() const { return content ? std::string_view(*content) : std::string_view{}; }
 };
 
-// Simple virtual filesystem for testing
-template<size_t MaxFiles = 64>
+// One version of a file, independent of later writes. Taking one copies
+// a pointer, so it can be handed to a background analysis.
+struct FileSnapshot {
+    FileContent content;
+    int version = 0;
+
+    std::string_view text() const { return content ? std::string_view(*content) : std::string_view{}; }
+};
+
+// Virtual filesystem for testing. Files are found by URI through a hash
+// map (no capacity limit), and contents are reference counted: reads and
+// snapshots share the stored string instead of copying it.
 class VirtualFS {
-    std::array<VirtualFile, MaxFiles> files;
-    size_t file_count = 0;
-    
+    struct UriHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view uri) const { return std::hash<std::string_view>{}(uri); }
+    };
+
+    std::unordered_map<std::string, VirtualFile, UriHash, std::equal_to<>> files;
+
 public:
-    constexpr VirtualFS() = default;
-    
-    // Add or update a file
+    VirtualFS() = default;
+
+    // Add or update a file; the content is copied once
     bool write_file(std::string_view uri, std::string_view content, int version = 1) {
-        // Try to find existing file
-        VirtualFile* file = find_file(uri);
-        
-        if (file) {
-            // Update existing
-            file->content = std::string(content);
-            file->version = version;
-            return true;
-        }
-        
-        // Add new file
-        if (file_count < MaxFiles) {
-            files[file_count].uri = std::string(uri);
-            files[file_count].content = std::string(content);
-            files[file_count].version = version;
-            files[file_count].exists = true;
-            file_count++;
-            return true;
-        }
-        
-        return false; // No space
+        return write_file(uri, std::make_shared<const std::string>(content), version);
+    }
+
+    // Add or update a file with content that may be shared with others
+    bool write_file(std::string_view uri, FileContent content, int version = 1) {
+        VirtualFile& file = entry(uri);
+        file.content = std::move(content);
+        file.version = version;
+        return true;
     }
-    
-    // Read a file
+
+    // Read a file. The view is valid until the file is next written or
+    // removed; take a snapshot to keep the text longer.
     std::optional<std::string_view> read_file(std::string_view uri) const {
-        const VirtualFile* file = find_file(uri);
-        if (file && file->exists) {
-            return file->content;
+        if (const VirtualFile* file = find_file(uri)) {
+            return file->text();
         }
         return std::nullopt;
     }
-    
+
+    // Current content and version of a file
+    std::optional<FileSnapshot> snapshot(std::string_view uri) const {
+        if (const VirtualFile* file = find_file(uri)) {
+            return FileSnapshot{file->content, file->version};
+        }
+        return std::nullopt;
+    }
+
     // Check if file exists
     bool exists(std::string_view uri) const {
-        const VirtualFile* file = find_file(uri);
-        return file && file->exists;
+        return find_file(uri) != nullptr;
     }
-    
+
     // Delete a file
     bool remove_file(std::string_view uri) {
-        VirtualFile* file = find_file(uri);
-        if (file) {
-            file->exists = false;
-            return true;
+        auto it = files.find(uri);
+        if (it == files.end()) {
+            return false;
         }
-        return false;
+        files.erase(it);
+        return true;
     }
-    
+
     // Get file version
     int get_version(std::string_view uri) const {
         const VirtualFile* file = find_file(uri);
-        if (file && file->exists) {
-            return file->version;
-        }
-        return 0;
+        return file ? file->version : 0;
     }
-    
-    // List all files
-    std::array<std::string_view, MaxFiles> list_files() const {
-        std::array<std::string_view, MaxFiles> result{};
-        size_t count = 0;
-        
-        for (size_t i = 0; i < file_count && count < MaxFiles; ++i) {
-            if (files[i].exists) {
-                result[count++] = files[i].uri;
-            }
+
+    // List all files, in no particular order
+    std::vector<std::string_view> list_files() const {
+        std::vector<std::string_view> result;
+        result.reserve(files.size());
+        for (const auto& [uri, file] : files) {
+            result.push_back(uri);
         }
-        
         return result;
     }
-    
+
     // Get file count
     size_t count() const {
-        size_t active_count = 0;
-        for (size_t i = 0; i < file_count; ++i) {
-            if (files[i].exists) {
-                active_count++;
-            }
-        }
-        return active_count;
+        return files.size();
     }
-    
+
     // Clear all files
     void clear() {
-        for (size_t i = 0; i < file_count; ++i) {
-            files[i].exists = false;
-        }
-        file_count = 0;
+        files.clear();
     }
-    
-private:
+
     VirtualFile* find_file(std::string_view uri) {
-        for (size_t i = 0; i < file_count; ++i) {
-            if (files[i].uri == uri && files[i].exists) {
-                return &files[i];
-            }
-        }
-        return nullptr;
+        auto it = files.find(uri);
+        return it != files.end() ? &it->second : nullptr;
     }
-    
+
     const VirtualFile* find_file(std::string_view uri) const {
-        for (size_t i = 0; i < file_count; ++i) {
-            if (files[i].uri == uri && files[i].exists) {
-                return &files[i];
-            }
+        auto it = files.find(uri);
+        return it != files.end() ? &it->second : nullptr;
+    }
+
+private:
+    // The entry for `uri`, created empty (version 0) if missing
+    VirtualFile& entry(std::string_view uri) {
+        auto it = files.find(uri);
+        if (it == files.end()) {
+            it = files.emplace(std::string(uri), VirtualFile{std::string(uri), nullptr, 0}).first;
         }
-        return nullptr;
+        return it->second;
     }
 };
 
 // LSP workspace with virtual filesystem
-template<typename LSPManager, size_t MaxFiles = 64>
+template<typename LSPManager>
 class VirtualWorkspace {
-    VirtualFS<MaxFiles> fs;
+    VirtualFS fs;
     LSPManager& lsp_manager;
-    
+
 public:
     VirtualWorkspace(LSPManager& manager) : lsp_manager(manager) {}
-    
+
     // Initialize the LSP server
     auto initialize(int process_id = 0, std::string_view root_uri = "file:///workspace") {
         return lsp_manager.initialize(process_id, root_uri);
     }
-    
+
     // Create or update a file and notify LSP
     bool create_file(std::string_view uri, std::string_view content) {
-        bool is_new = !fs.exists(uri);
-        int version = is_new ? 1 : fs.get_version(uri) + 1;
-        
-        if (!fs.write_file(uri, content, version)) {
-            return false;
-        }
-        
-        if (is_new) {
-            // Open document in LSP
-            forma::lsp::TextDocumentItem item;
-            item.uri = uri;
-            item.language_id = "forma";
-            item.version = version;
-            item.text = *fs.read_file(uri);
-            lsp_manager.did_open(item);
-        } else {
-            // Update document in LSP
-            forma::lsp::VersionedTextDocumentIdentifier id;
-            id.uri = uri;
-            id.version = version;
-            lsp_manager.did_change(id, *fs.read_file(uri));
+        return create_file(uri, std::make_shared<const std::string>(content));
+    }
+
+    bool create_file(std::string_view uri, FileContent content) {
+        VirtualFile* file = fs.find_file(uri);
+        if (file) {
+            return store(*file, std::move(content));
         }
-        
+
+        fs.write_file(uri, std::move(content), 1);
+        file = fs.find_file(uri);
+
+        // Open document in LSP
+        forma::lsp::TextDocumentItem item;
+        item.uri = uri;
+        item.language_id = "forma";
+        item.version = file->version;
+        item.text = file->text();
+        lsp_manager.did_open(item);
         return true;
     }
-    
+
     // Update file content
     bool update_file(std::string_view uri, std::string_view content) {
-        if (!fs.exists(uri)) {
-            return false;
-        }
-        
-        int version = fs.get_version(uri) + 1;
-        fs.write_file(uri, content, version);
-        
-        forma::lsp::VersionedTextDocumentIdentifier id;
-        id.uri = uri;
-        id.version = version;
-        lsp_manager.did_change(id, *fs.read_file(uri));
-        
-        return true;
+        return update_file(uri, std::make_shared<const std::string>(content));
     }
-    
+
+    bool update_file(std::string_view uri, FileContent content) {
+        VirtualFile* file = fs.find_file(uri);
+        return file && store(*file, std::move(content));
+    }
+
     // Delete a file and notify LSP
     bool delete_file(std::string_view uri) {
         if (!fs.exists(uri)) {
             return false;
         }
-        
+
         forma::lsp::TextDocumentIdentifier id;
         id.uri = uri;
         lsp_manager.did_close(id);
-        
+
         return fs.remove_file(uri);
     }
-    
+
     // Get diagnostics for a file
     auto get_diagnostics(std::string_view uri) const {
         return lsp_manager.find_document(uri);
     }
-    
+
     // Read file content
     std::optional<std::string_view> read_file(std::string_view uri) const {
         return fs.read_file(uri);
     }
-    
+
+    // Content and version of a file, valid after later updates
+    std::optional<FileSnapshot> snapshot(std::string_view uri) const {
+        return fs.snapshot(uri);
+    }
+
     // Check if file exists
     bool exists(std::string_view uri) const {
         return fs.exists(uri);
     }
-    
+
     // List all files
     auto list_files() const {
         return fs.list_files();
     }
-    
+
     // Get file count
     size_t file_count() const {
         return fs.count();
     }
-    
+
     // Access the filesystem directly
-    VirtualFS<MaxFiles>& filesystem() { return fs; }
-    const VirtualFS<MaxFiles>& filesystem() const { return fs; }
-    
+    VirtualFS& filesystem() { return fs; }
+    const VirtualFS& filesystem() const { return fs; }
+
     // Access the LSP manager directly
     LSPManager& lsp() { return lsp_manager; }
     const LSPManager& lsp() const { return lsp_manager; }
+
+private:
+    // New content for an existing file: bump the version and sync the LSP
+    bool store(VirtualFile& file, FileContent content) {
+        file.content = std::move(content);
+        file.version += 1;
+
+        forma::lsp::VersionedTextDocumentIdentifier id;
+        id.uri = file.uri;
+        id.version = file.version;
+        lsp_manager.did_change(id, file.text());
+        return true;
+    }
 };
 
 } // namespace forma::vfs
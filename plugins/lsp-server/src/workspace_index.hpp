@@ -0,0 +1,491 @@
+#pragma once
+
+#include "document_buffer.hpp"
+#include "document_symbols.hpp"
+#include <core/thread_pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace forma::lsp {
+
+// ============================================================================
+// Workspace Index - Declarations and identifier uses across all files
+// ============================================================================
+
+// file:// URIs, percent-decoded; anything else is returned unchanged
+inline std::string uri_to_path(std::string_view uri) {
+    constexpr std::string_view scheme = "file://";
+    if (uri.starts_with(scheme)) {
+        uri.remove_prefix(scheme.size());
+    }
+    auto hex = [](char c) {
+        return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+    };
+    std::string out;
+    out.reserve(uri.size());
+    for (size_t i = 0; i < uri.size(); ++i) {
+        if (uri[i] == '%' && i + 2 < uri.size() && hex(uri[i + 1]) >= 0 && hex(uri[i + 2]) >= 0) {
+            out += static_cast<char>(hex(uri[i + 1]) * 16 + hex(uri[i + 2]));
+            i += 2;
+        } else {
+            out += uri[i];
+        }
+    }
+    return out;
+}
+
+// Reserved characters are percent-encoded, as VS Code sends them
+inline std::string path_to_uri(std::string_view path) {
+    constexpr char digits[] = "0123456789ABCDEF";
+    std::string out = "file://";
+    out.reserve(out.size() + path.size());
+    for (char c : path) {
+        bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                     c == '/' || c == '-' || c == '_' || c == '.' || c == '~';
+        if (plain) {
+            out += c;
+        } else {
+            out += '%';
+            out += digits[static_cast<unsigned char>(c) >> 4];
+            out += digits[static_cast<unsigned char>(c) & 0xF];
+        }
+    }
+    return out;
+}
+
+inline bool is_forma_source(const std::filesystem::path& path) {
+    return path.extension() == ".fml" || path.extension() == ".forma";
+}
+
+// A name in an indexed file. `uri` points into the index and stays valid
+// as long as the index does.
+struct SymbolLocation {
+    std::string_view uri;
+    size_t line = 0;    // 0-based
+    size_t column = 0;  // 0-based, in bytes
+    size_t length = 0;
+};
+
+struct WorkspaceSymbol {
+    std::string name;
+    std::string container;  // Class of a member, enum of a value
+    SymbolKind kind = SymbolKind::Object;
+    SymbolLocation location;
+};
+
+// Every declaration (classes and their members, enums and their values,
+// events, instances) and every identifier use of every file, keyed by
+// name. Lookups are one hash probe, so definition and reference queries
+// do not depend on the workspace size. Declared names are also kept in
+// case-insensitive order, so prefix queries (completion) are a binary
+// search rather than a scan.
+//
+// Files are scanned (parse, declarations, identifier tokens) without the
+// lock and merged under it, so a workspace is indexed in parallel and
+// queries keep being answered while it is. Re-indexing one file first
+// drops what it contributed before; nothing else is touched.
+//
+// Open documents are indexed from the editor's buffer and shadow the file
+// on disk until they are closed.
+class WorkspaceIndex {
+public:
+    // Index `source` as the content on disk of `uri`. Ignored while the
+    // document is open in the editor.
+    void index_source(std::string_view uri, std::string_view source) {
+        DocumentBuffer buffer;
+        buffer.assign(source);
+        auto snapshot = buffer.snapshot();
+        auto doc = snapshot.build_document();
+        std::string text = snapshot.text();
+        merge(uri, scan(snapshot, text, *doc), false);
+    }
+
+    // Read and index a file; a file that cannot be read is dropped
+    bool index_file(const std::filesystem::path& path) {
+        std::string source;
+        std::string uri = path_to_uri(path.string());
+        if (!read_file(path, source)) {
+            remove(uri);
+            return false;
+        }
+        index_source(uri, source);
+        return true;
+    }
+
+    // Index an analysed editor buffer. The document stays open (shadowing
+    // the disk content) until close_document().
+    template <typename DocType>
+    void index_document(std::string_view uri, const DocumentBuffer::Snapshot& snapshot, std::string_view source,
+                        const DocType& doc) {
+        merge(uri, scan(snapshot, source, doc), true);
+    }
+
+    // The editor closed the document: fall back to the file on disk
+    void close_document(std::string_view uri) {
+        {
+            std::unique_lock lock(mutex);
+            auto it = file_ids.find(uri);
+            if (it == file_ids.end()) {
+                return;
+            }
+            files[it->second].open = false;
+        }
+        if (uri.starts_with("file://")) {
+            index_file(uri_to_path(uri));
+        }
+    }
+
+    void remove(std::string_view uri) {
+        std::unique_lock lock(mutex);
+        auto it = file_ids.find(uri);
+        if (it != file_ids.end()) {
+            drop(it->second);
+        }
+    }
+
+    // Index every Forma source under `root` on `pool`, skipping hidden
+    // directories. Returns the number of files indexed.
+    size_t index_directory(const std::filesystem::path& root, forma::ThreadPool& pool) {
+        std::vector<std::filesystem::path> paths;
+        std::error_code ec;
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        for (auto it = std::filesystem::recursive_directory_iterator(root, options, ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            if (it->is_directory(ec) && name.starts_with('.')) {
+                it.disable_recursion_pending();
+            } else if (it->is_regular_file(ec) && is_forma_source(it->path())) {
+                paths.push_back(it->path());
+            }
+        }
+
+        std::atomic<size_t> indexed{0};
+        for (const auto& path : paths) {
+            pool.submit([this, &path, &indexed] {
+                if (index_file(path)) {
+                    indexed.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        pool.wait();
+        return indexed.load();
+    }
+
+    // Where `name` is declared as a class, enum or event. Members and
+    // instances are left out: a property name is declared by many classes
+    // and an instance is a use of its type.
+    std::vector<SymbolLocation> definitions(std::string_view name) const {
+        std::shared_lock lock(mutex);
+        std::vector<SymbolLocation> out;
+        if (const Postings* postings = find(name)) {
+            for (const auto& decl : postings->declarations) {
+                if (decl.kind == SymbolKind::Class || decl.kind == SymbolKind::Enum || decl.kind == SymbolKind::Event) {
+                    out.push_back(location(decl.file, decl.line, decl.column, name.size()));
+                }
+            }
+        }
+        return out;
+    }
+
+    // Every use of the identifier `name`, optionally with its declarations
+    std::vector<SymbolLocation> references(std::string_view name, bool include_declaration) const {
+        std::shared_lock lock(mutex);
+        std::vector<SymbolLocation> out;
+        const Postings* postings = find(name);
+        if (!postings) {
+            return out;
+        }
+        out.reserve(postings->uses.size());
+        for (const auto& use : postings->uses) {
+            if (include_declaration || !use.declaration) {
+                out.push_back(location(use.file, use.line, use.column, name.size()));
+            }
+        }
+        return out;
+    }
+
+    // Declarations whose name contains the characters of `query` in order,
+    // ignoring case (what editors expect of workspace/symbol)
+    std::vector<WorkspaceSymbol> symbols(std::string_view query, size_t limit = 256) const {
+        std::shared_lock lock(mutex);
+        std::vector<WorkspaceSymbol> out;
+        for (const auto& [name, postings] : names) {
+            if (postings.declarations.empty() || !fuzzy_match(name, query)) {
+                continue;
+            }
+            for (const auto& decl : postings.declarations) {
+                if (out.size() == limit) {
+                    return out;
+                }
+                out.push_back({name, decl.container, decl.kind,
+                               location(decl.file, decl.line, decl.column, name.size())});
+            }
+        }
+        return out;
+    }
+
+    // Declarations whose name starts with `prefix`, ignoring case, in name
+    // order, for which `accept(kind, uri)` holds. Returns false when more
+    // than `limit` matched and the rest were left out.
+    template <typename Accept>
+    bool symbols_with_prefix(std::string_view prefix, size_t limit, Accept&& accept,
+                             std::vector<WorkspaceSymbol>& out) const {
+        std::shared_lock lock(mutex);
+        for (auto it = declared_names.lower_bound(FoldedKey{prefix}); it != declared_names.end(); ++it) {
+            std::string_view name = *it;
+            if (name.size() < prefix.size() || compare_folded(name.substr(0, prefix.size()), prefix) != 0) {
+                break;
+            }
+            for (const auto& decl : find(name)->declarations) {
+                if (!accept(decl.kind, std::string_view(files[decl.file].uri))) {
+                    continue;
+                }
+                if (out.size() == limit) {
+                    return false;
+                }
+                out.push_back({std::string(name), decl.container, decl.kind,
+                               location(decl.file, decl.line, decl.column, name.size())});
+            }
+        }
+        return true;
+    }
+
+    size_t file_count() const {
+        std::shared_lock lock(mutex);
+        return file_ids.size();
+    }
+
+private:
+    // Positions are stored as line/column, so a file's source need not be
+    // kept once it is indexed
+    struct Declaration {
+        uint32_t file;
+        uint32_t line;
+        uint32_t column;
+        SymbolKind kind;
+        std::string container;
+    };
+
+    struct Use {
+        uint32_t file;
+        uint32_t line;
+        uint32_t column;
+        bool declaration;  // The name in a declaration
+    };
+
+    struct Postings {
+        std::vector<Declaration> declarations;
+        std::vector<Use> uses;
+    };
+
+    struct File {
+        std::string uri;  // Never changes: Locations point into it
+        std::vector<std::string_view> names;  // Keys this file contributed to
+        bool open = false;
+    };
+
+    // One file's contribution, gathered without the lock
+    struct Scan {
+        struct Entry {
+            std::string_view name;
+            std::string_view container;
+            SymbolKind kind;
+            forma::LinePosition position;
+        };
+        std::vector<Entry> declarations;
+        struct Use {
+            std::string_view name;
+            forma::LinePosition position;
+            bool declaration;
+        };
+        std::vector<Use> uses;
+    };
+
+    static constexpr char lower(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    static int compare_folded(std::string_view a, std::string_view b) {
+        for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
+            if (lower(a[i]) != lower(b[i])) {
+                return lower(a[i]) < lower(b[i]) ? -1 : 1;
+            }
+        }
+        return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+    }
+
+    // Prefix searches compare ignoring case only; the order is consistent
+    // with NameOrder, which breaks ties between "Card" and "card"
+    struct FoldedKey {
+        std::string_view text;
+    };
+
+    struct NameOrder {
+        using is_transparent = void;
+        bool operator()(std::string_view a, std::string_view b) const {
+            int folded = compare_folded(a, b);
+            return folded != 0 ? folded < 0 : a < b;
+        }
+        bool operator()(std::string_view a, FoldedKey b) const { return compare_folded(a, b.text) < 0; }
+        bool operator()(FoldedKey a, std::string_view b) const { return compare_folded(a.text, b) < 0; }
+    };
+
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    mutable std::shared_mutex mutex;
+    std::deque<File> files;  // Stable addresses: SymbolLocation::uri views File::uri
+    std::unordered_map<std::string, uint32_t, NameHash, std::equal_to<>> file_ids;
+    std::unordered_map<std::string, Postings, NameHash, std::equal_to<>> names;
+    std::set<std::string_view, NameOrder> declared_names;  // Keys of `names` with declarations
+
+    template <typename DocType>
+    static Scan scan(const DocumentBuffer::Snapshot& snapshot, std::string_view source, const DocType& doc) {
+        Scan out;
+        const forma::LineIndex& lines = snapshot.lines;
+        std::unordered_set<size_t> declared;  // Offsets of declared names
+        auto add = [&](const DocumentSymbol& symbol, std::string_view container, auto& self) -> void {
+            out.declarations.push_back({symbol.name, container, symbol.kind, lines.position(symbol.name_start)});
+            if (symbol.kind != SymbolKind::Object) {
+                // An instance is a use of its type, not a declaration
+                declared.insert(symbol.name_start);
+            }
+            for (const auto& child : symbol.children) {
+                // Child instances are nested, not members
+                self(child, symbol.kind == SymbolKind::Object ? std::string_view{} : symbol.name, self);
+            }
+        };
+        for (const auto& symbol : build_document_symbols(snapshot, source, doc)) {
+            add(symbol, {}, add);
+        }
+
+        // Tokens arrive in order, so the line is found walking forward
+        size_t line = 0;
+        for (const auto& token : snapshot.tokens()) {
+            if (token.kind != forma::TokenKind::Identifier) {
+                continue;
+            }
+            while (line + 1 < lines.line_count() && lines.line_start(line + 1) <= token.offset) {
+                ++line;
+            }
+            out.uses.push_back({source.substr(token.offset, token.length),
+                                forma::LinePosition{line, token.offset - lines.line_start(line)},
+                                declared.contains(token.offset)});
+        }
+        return out;
+    }
+
+    void merge(std::string_view uri, const Scan& scan, bool from_editor) {
+        std::unique_lock lock(mutex);
+        auto it = file_ids.find(uri);
+        if (it == file_ids.end()) {
+            files.push_back({std::string(uri), {}, false});
+            it = file_ids.emplace(std::string(uri), static_cast<uint32_t>(files.size() - 1)).first;
+        }
+        uint32_t id = it->second;
+        File& file = files[id];
+        if (file.open && !from_editor) {
+            return;
+        }
+        drop(id);
+        file.open = from_editor;
+
+        auto postings_for = [&](std::string_view name) -> Postings& {
+            auto entry = names.find(name);
+            if (entry == names.end()) {
+                entry = names.emplace(std::string(name), Postings{}).first;
+            }
+            if (file.names.empty() || file.names.back() != entry->first) {
+                file.names.push_back(entry->first);
+            }
+            return entry->second;
+        };
+        for (const auto& decl : scan.declarations) {
+            Postings& postings = postings_for(decl.name);
+            if (postings.declarations.empty()) {
+                declared_names.insert(file.names.back());
+            }
+            postings.declarations.push_back({id, static_cast<uint32_t>(decl.position.line),
+                                             static_cast<uint32_t>(decl.position.column), decl.kind,
+                                             std::string(decl.container)});
+        }
+        for (const auto& use : scan.uses) {
+            postings_for(use.name).uses.push_back({id, static_cast<uint32_t>(use.position.line),
+                                                   static_cast<uint32_t>(use.position.column), use.declaration});
+        }
+    }
+
+    // Remove what file `id` contributed; called with the lock held
+    void drop(uint32_t id) {
+        File& file = files[id];
+        std::ranges::sort(file.names);
+        auto [first, last] = std::ranges::unique(file.names);
+        file.names.erase(first, last);
+        for (std::string_view name : file.names) {
+            auto entry = names.find(name);
+            if (entry == names.end()) {
+                continue;
+            }
+            Postings& postings = entry->second;
+            std::erase_if(postings.declarations, [id](const Declaration& decl) { return decl.file == id; });
+            std::erase_if(postings.uses, [id](const Use& use) { return use.file == id; });
+            if (postings.declarations.empty()) {
+                declared_names.erase(name);
+            }
+            if (postings.declarations.empty() && postings.uses.empty()) {
+                names.erase(entry);
+            }
+        }
+        file.names.clear();
+    }
+
+    const Postings* find(std::string_view name) const {
+        auto entry = names.find(name);
+        return entry != names.end() ? &entry->second : nullptr;
+    }
+
+    SymbolLocation location(uint32_t file, uint32_t line, uint32_t column, size_t length) const {
+        return {files[file].uri, line, column, length};
+    }
+
+    static bool fuzzy_match(std::string_view name, std::string_view query) {
+        size_t q = 0;
+        for (size_t i = 0; i < name.size() && q < query.size(); ++i) {
+            if (lower(name[i]) == lower(query[q])) {
+                ++q;
+            }
+        }
+        return q == query.size();
+    }
+
+    static bool read_file(const std::filesystem::path& path, std::string& out) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            return false;
+        }
+        auto size = file.tellg();
+        if (size < 0) {
+            return false;
+        }
+        out.resize(static_cast<size_t>(size));
+        file.seekg(0);
+        return static_cast<bool>(file.read(out.data(), size));
+    }
+};
+
+} // namespace forma::lsp
@@ -0,0 +1,263 @@
+#include <bugspray/bugspray.hpp>
+#include "../src/lsp.hpp"
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr std::string_view URI = "file:///completion.fml";
+
+constexpr std::string_view SOURCE =
+    "enum Mode { Light, Dark }\n"
+    "class Card : Panel {\n"
+    "    property title: string\n"
+    "    property mode: Mode\n"
+    "}\n"
+    "class Badge : Card {\n"
+    "    property count: int\n"
+    "}\n"
+    "event refreshed()\n"
+    "Badge {\n"
+    "    \n"
+    "}\n";
+
+using Items = std::vector<forma::lsp::CompletionItem>;
+
+bool has(const Items& items, std::string_view label) {
+    return std::ranges::any_of(items, [&](const auto& item) { return item.label == label; });
+}
+
+struct Fixture {
+    std::unique_ptr<forma::lsp::LSPDocumentManager<>> manager = std::make_unique<forma::lsp::LSPDocumentManager<>>();
+
+    Fixture() {
+        forma::lsp::TextDocumentItem item;
+        item.uri = URI;
+        item.version = 1;
+        item.text = SOURCE;
+        manager->did_open(item);
+    }
+
+    // Type `text` at line 10 (the empty line inside Badge) and complete
+    // at its end, without analysing the edit
+    Items complete_after(std::string_view text, int line = 10, int column = 4) {
+        forma::lsp::VersionedTextDocumentIdentifier id;
+        id.uri = URI;
+        id.version = 2;
+        forma::lsp::TextDocumentContentChangeEvent change(forma::lsp::Range(line, column, line, column), text);
+        manager->apply_changes(id, std::span(&change, 1));
+
+        // The cursor ends up after the inserted text
+        size_t newline = text.rfind('\n');
+        if (newline != std::string_view::npos) {
+            line += static_cast<int>(std::ranges::count(text, '\n'));
+            column = 0;
+            text.remove_prefix(newline + 1);
+        }
+        Items items;
+        bool incomplete = false;
+        REQUIRE(std::as_const(*manager).completion(URI, forma::lsp::Position(line, column + static_cast<int>(text.size())),
+                                                   items, incomplete));
+        return items;
+    }
+};
+
+} // namespace
+
+TEST_CASE("LSP - Completion Index")
+{
+    forma::lsp::CompletionIndex index;
+    index.add("Button", "", forma::lsp::CompletionItemKind::Class);
+    index.add("bar", "", forma::lsp::CompletionItemKind::Property);
+    index.add("Badge", "", forma::lsp::CompletionItemKind::Class);
+    index.add("card", "", forma::lsp::CompletionItemKind::Property);
+    index.sort();
+
+    auto ba = index.with_prefix("ba");
+    REQUIRE(ba.size() == 2);
+    CHECK(ba[0].label == "Badge");
+    CHECK(ba[1].label == "bar");
+    CHECK(index.with_prefix("B").size() == 3);
+    CHECK(index.with_prefix("").size() == 4);
+    CHECK(index.with_prefix("x").empty());
+    CHECK(index.with_prefix("cards").empty());
+}
+
+TEST_CASE("LSP - Completion Index Updates")
+{
+    using Names = std::vector<std::string_view>;
+    Names widgets{"Button", "Badge"};
+    Names fields{"bar", "card"};
+    Names more{"Banner"};
+    int filled = 0;
+    auto fill = [&](const Names& names, forma::lsp::CompletionIndex& added) {
+        ++filled;
+        for (auto name : names) {
+            added.add(name, "", forma::lsp::CompletionItemKind::Class, &names);
+        }
+    };
+
+    forma::lsp::CompletionIndex index;
+    index.update(std::vector<const Names*>{&widgets, &fields}, fill);
+    CHECK(filled == 2);
+    CHECK(index.size() == 4);
+
+    // Kept origins are not read again
+    index.update(std::vector<const Names*>{&fields, &more}, fill);
+    CHECK(filled == 3);
+    auto ba = index.with_prefix("ba");
+    REQUIRE(ba.size() == 2);
+    CHECK(ba[0].label == "Banner");
+    CHECK(ba[1].label == "bar");
+    CHECK(index.with_prefix("bu").empty());
+    CHECK(index.size() == 3);
+}
+
+TEST_CASE("LSP - Completion")
+{
+    Fixture fixture;
+
+    SECTION("Inside an instance: inherited properties, widgets and children")
+    {
+        auto items = fixture.complete_after("");
+        CHECK(has(items, "count"));
+        CHECK(has(items, "title"));  // From Card
+        CHECK(has(items, "mode"));
+        CHECK(has(items, "width"));  // Widget property
+        CHECK(has(items, "Label"));  // Child widget
+        CHECK(has(items, "Card"));   // Child class
+        CHECK(!has(items, "Light"));
+
+        // The nearest class's properties come first
+        CHECK(items[0].label == "count");
+        CHECK(items[0].kind == forma::lsp::CompletionItemKind::Property);
+        CHECK(items[0].detail == "int");
+    }
+
+    SECTION("The prefix before the cursor filters, ignoring case")
+    {
+        auto items = fixture.complete_after("Ti");
+        REQUIRE(!items.empty());
+        CHECK(has(items, "title"));
+        CHECK(!has(items, "count"));
+        for (const auto& item : items) {
+            CHECK(forma::lsp::CompletionIndex::starts_with(item.label, "ti"));
+        }
+    }
+
+    SECTION("Values of an enum-typed property are its members")
+    {
+        auto items = fixture.complete_after("mode: ");
+        REQUIRE(items.size() == 2);
+        CHECK(items[0].label == "Light");
+        CHECK(items[1].detail == "Mode");
+    }
+
+    SECTION("A qualified enum value completes its member")
+    {
+        auto qualified = fixture.complete_after("mode: Mode.D");
+        REQUIRE(qualified.size() == 1);
+        CHECK(qualified[0].label == "Dark");
+    }
+
+    SECTION("Analysed edits replace the edited declarations' entries")
+    {
+        forma::lsp::VersionedTextDocumentIdentifier id;
+        id.uri = URI;
+        id.version = 2;
+        forma::lsp::TextDocumentContentChangeEvent rename(forma::lsp::Range(0, 5, 0, 9), "Theme");
+        fixture.manager->did_change(id, std::span(&rename, 1));
+
+        auto items = fixture.complete_after("property other: ", 4, 0);
+        CHECK(has(items, "Theme"));
+        CHECK(!has(items, "Mode"));
+        CHECK(has(items, "Card"));
+        CHECK(has(items, "Badge"));
+    }
+
+    SECTION("Property types list classes, enums and built-in types")
+    {
+        // Inside Card, after `property mode:`
+        auto items = fixture.complete_after("property other: ", 4, 0);
+        CHECK(has(items, "Mode"));
+        CHECK(has(items, "Card"));
+        CHECK(has(items, "int"));
+        CHECK(!has(items, "title"));
+    }
+
+    SECTION("Top level offers declarations and root instances")
+    {
+        auto items = fixture.complete_after("\n", 11, 1);
+        CHECK(has(items, "class"));
+        CHECK(has(items, "Badge"));
+        CHECK(has(items, "Button"));
+        CHECK(!has(items, "count"));
+    }
+
+    SECTION("Nothing inside strings or when naming a declaration")
+    {
+        CHECK(fixture.complete_after("title: \"Ca").empty());
+        CHECK(fixture.complete_after("\nclass Ca", 11, 1).empty());
+    }
+
+    SECTION("Classes of other workspace files are offered")
+    {
+        forma::lsp::WorkspaceIndex workspace;
+        workspace.index_source("file:///other.fml", "class Carousel { }\nenum Size { S }\n");
+        fixture.manager->workspace = &workspace;
+
+        auto items = fixture.complete_after("Car");
+        REQUIRE(has(items, "Carousel"));
+        CHECK(has(items, "Card"));
+        CHECK(std::ranges::count_if(items, [](const auto& item) { return item.label == "Card"; }) == 1);
+        CHECK(!has(items, "Size"));  // Enums only where a type is expected
+    }
+
+    SECTION("Widgets and properties registered by plugins are offered")
+    {
+        forma::widgets::overlay().add_widget("Gauge", "lv_scale");
+        forma::widgets::overlay().add_property("needle", "lv_scale_set_needle");
+        CHECK(has(fixture.complete_after("Gau"), "Gauge"));
+        CHECK(has(Fixture().complete_after("nee"), "needle"));
+
+        forma::widgets::overlay().clear();
+        CHECK(!has(Fixture().complete_after("Gau"), "Gauge"));
+    }
+
+    SECTION("Workspace prefix matches are not crowded out by fuzzy ones")
+    {
+        forma::lsp::WorkspaceIndex workspace;
+        std::string many;
+        for (int i = 0; i < 300; ++i) {
+            many += "class CoolAvatar" + std::to_string(i) + " { }\n";  // C..a..r, but no prefix
+        }
+        for (int i = 0; i < 10; ++i) {
+            many += "class Cargo" + std::to_string(i) + " { }\n";
+        }
+        workspace.index_source("file:///other.fml", many);
+        fixture.manager->workspace = &workspace;
+
+        auto items = fixture.complete_after("Car");
+        CHECK(has(items, "Cargo0"));
+        CHECK(has(items, "Cargo9"));
+        CHECK(!has(items, "CoolAvatar0"));
+
+        Items limited;
+        bool incomplete = false;
+        REQUIRE(std::as_const(*fixture.manager).completion(URI, forma::lsp::Position(10, 7), limited, incomplete, 5));
+        CHECK(limited.size() == 5);
+        CHECK(incomplete);
+    }
+
+    SECTION("Results are encoded as a CompletionList")
+    {
+        Items items{{"title", "string", forma::lsp::CompletionItemKind::Property},
+                    {"Dark", "", forma::lsp::CompletionItemKind::EnumMember}};
+        CHECK(forma::lsp::encode_completions(items, true) ==
+              R"({"isIncomplete":true,"items":[{"label":"title","kind":10,"detail":"string"},{"label":"Dark","kind":20}]})");
+    }
+}
@@ -0,0 +1,116 @@
+#include <bugspray/bugspray.hpp>
+#include "../src/lsp.hpp"
+#include "../src/diagnostics_worker.hpp"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Manager = forma::lsp::LSPDocumentManager<>;
+
+constexpr std::string_view URI = "file:///test.fml";
+
+void open(Manager& manager, std::string_view text) {
+    forma::lsp::TextDocumentItem item;
+    item.uri = URI;
+    item.version = 1;
+    item.text = text;
+    manager.open_document(item);
+}
+
+void change(Manager& manager, int version, std::string_view text) {
+    forma::lsp::VersionedTextDocumentIdentifier id;
+    id.uri = URI;
+    id.version = version;
+    forma::lsp::TextDocumentContentChangeEvent event(text);
+    manager.apply_changes(id, std::span<const forma::lsp::TextDocumentContentChangeEvent>(&event, 1));
+}
+
+} // namespace
+
+TEST_CASE("LSP - Diagnostics Worker")
+{
+    auto manager = std::make_unique<Manager>();
+    std::mutex manager_mutex;
+    std::vector<std::pair<int, size_t>> published;  // (analysed version, diagnostic count)
+
+    SECTION("Rapid changes are coalesced into one analysis of the last version")
+    {
+        forma::lsp::DiagnosticsWorker<Manager> worker(*manager, manager_mutex,
+            [&](const std::string& uri) {
+                const auto* doc = manager->find_document(uri);
+                published.emplace_back(doc->analyzed_version, doc->diagnostic_count);
+            },
+            std::chrono::milliseconds(50));
+
+        {
+            std::lock_guard lock(manager_mutex);
+            open(*manager, "class Card { property title: string }");
+        }
+        worker.schedule_now(URI);
+        worker.wait_idle();
+        REQUIRE(published.size() == static_cast<size_t>(1));
+        CHECK(published[0].first == 1);
+        CHECK(published[0].second == static_cast<size_t>(0));
+
+        for (int version = 2; version <= 6; ++version) {
+            std::lock_guard lock(manager_mutex);
+            change(*manager, version, version % 2 == 0
+                ? "class Card { property title: Missing }"
+                : "class Card { property title: string }");
+            worker.schedule(URI);
+        }
+        worker.wait_idle();
+
+        REQUIRE(published.size() == static_cast<size_t>(2));
+        CHECK(published[1].first == 6);
+        CHECK(published[1].second > static_cast<size_t>(0));
+
+        const auto* doc = manager->find_document(URI);
+        REQUIRE(doc != nullptr);
+        CHECK(doc->text == "class Card { property title: Missing }");
+    }
+
+    SECTION("Edits are visible in the buffer before analysis finishes")
+    {
+        forma::lsp::DiagnosticsWorker<Manager> worker(*manager, manager_mutex,
+            [&](const std::string&) { published.emplace_back(0, 0); },
+            std::chrono::milliseconds(10000));
+
+        {
+            std::lock_guard lock(manager_mutex);
+            open(*manager, "class Card { }");
+            change(*manager, 2, "class Card { property title: string }");
+            worker.schedule(URI);
+
+            const auto* doc = manager->find_document(URI);
+            CHECK(doc->buffer.text() == "class Card { property title: string }");
+            CHECK(doc->cache_valid == false);
+        }
+
+        // Closing the document drops the pending analysis
+        worker.cancel(URI);
+        worker.wait_idle();
+        CHECK(published.empty());
+    }
+
+    SECTION("Results for a superseded version are not installed")
+    {
+        {
+            std::lock_guard lock(manager_mutex);
+            open(*manager, "class Card { }");
+        }
+        auto* doc = manager->find_document(URI);
+        auto analysis = Manager::analyze_snapshot(1, doc->buffer.snapshot(), [] { return false; });
+        REQUIRE(analysis.has_value());
+
+        change(*manager, 2, "class Card { property title: string }");
+        CHECK(manager->install_analysis(URI, std::move(*analysis)) == false);
+        CHECK(doc->cache_valid == false);
+
+        auto cancelled = Manager::analyze_snapshot(2, doc->buffer.snapshot(), [] { return true; });
+        CHECK(cancelled.has_value() == false);
+    }
+}
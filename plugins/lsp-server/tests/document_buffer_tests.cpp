@@ -0,0 +1,262 @@
+#include <bugspray/bugspray.hpp>
+#include "../src/lsp.hpp"
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::string_view SOURCE =
+    "// Header comment\n"
+    "import forma.color\n"
+    "class Card {\n"
+    "    property title: string\n"
+    "}\n"
+    "enum Mode { Light, Dark }\n"
+    "Card {\n"
+    "    title: \"Hello\"\n"
+    "    Card { title: \"Nested\" }\n"
+    "}\n";
+
+// The combined document must match a parse of the whole text
+bool matches_full_parse(const forma::lsp::DocumentBuffer& buffer) {
+    std::string text = buffer.text();
+    auto full = forma::parse_document_runtime(text);
+    auto merged = buffer.build_document();
+
+    if (merged->type_count != full.type_count || merged->enum_count != full.enum_count ||
+        merged->event_count != full.event_count || merged->import_count != full.import_count ||
+        merged->instances.count != full.instances.count || merged->symbols.count != full.symbols.count) {
+        return false;
+    }
+    for (size_t i = 0; i < full.type_count; ++i) {
+        if (merged->types[i].name != full.types[i].name) return false;
+    }
+    for (size_t i = 0; i < full.import_count; ++i) {
+        const auto& a = merged->imports[i];
+        const auto& b = full.imports[i];
+        if (a.module_path != b.module_path || a.location.offset != b.location.offset ||
+            a.location.line != b.location.line || a.location.column != b.location.column) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < full.instances.count; ++i) {
+        const auto& a = merged->instances.get(i);
+        const auto& b = full.instances.get(i);
+        if (a.type_name != b.type_name || a.child_count != b.child_count) return false;
+        for (size_t c = 0; c < b.child_count; ++c) {
+            if (a.child_indices[c] != b.child_indices[c]) return false;
+        }
+    }
+    for (size_t i = 0; i < full.symbols.count; ++i) {
+        const auto& a = merged->symbols.symbols[i];
+        const auto& b = full.symbols.symbols[i];
+        if (a.name != b.name || a.location.offset != b.location.offset || a.decl_index != b.decl_index ||
+            a.location.line != b.location.line || a.location.column != b.location.column) {
+            return false;
+        }
+    }
+    
+    // The incrementally updated line index must match a fresh one
+    forma::LineIndex fresh(text);
+    const auto& lines = buffer.line_index();
+    if (lines.line_count() != fresh.line_count() || lines.size() != fresh.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < fresh.line_count(); ++i) {
+        if (lines.line_start(i) != fresh.line_start(i)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("LSP - Document Buffer")
+{
+    SECTION("Source is split at top-level declarations")
+    {
+        forma::lsp::DocumentBuffer buffer;
+        buffer.assign(SOURCE);
+
+        CHECK(buffer.text() == SOURCE);
+        CHECK(buffer.size() == SOURCE.size());
+        CHECK(buffer.segment_count() == static_cast<size_t>(4));
+        CHECK(buffer.segment(0).text().starts_with("// Header comment\nimport"));
+        CHECK(buffer.segment(2).text().starts_with("enum Mode"));
+        CHECK(matches_full_parse(buffer));
+    }
+
+    SECTION("Position to offset")
+    {
+        forma::lsp::DocumentBuffer buffer;
+        buffer.assign(SOURCE);
+
+        CHECK(buffer.offset_at(0, 0) == static_cast<size_t>(0));
+        CHECK(buffer.offset_at(2, 6) == SOURCE.find("Card {"));
+        CHECK(buffer.offset_at(5, 5) == SOURCE.find("Mode"));
+        CHECK(buffer.offset_at(4, 100) == SOURCE.find("}\nenum") + 1);  // Clamped to line end
+        CHECK(buffer.offset_at(100, 0) == SOURCE.size());
+    }
+
+    SECTION("Declarations sharing a line keep their columns")
+    {
+        forma::lsp::DocumentBuffer buffer;
+        buffer.assign("enum A { X } enum B { Y }\nenum C { Z }");
+        CHECK(buffer.segment_count() == static_cast<size_t>(3));
+        CHECK(matches_full_parse(buffer));
+
+        auto merged = buffer.build_document();
+        const auto* b = merged->symbols.find("B");
+        REQUIRE(b != nullptr);
+        CHECK(b->location.line == static_cast<size_t>(0));
+        CHECK(b->location.column == static_cast<size_t>(13));
+        const auto* c = merged->symbols.find("C");
+        REQUIRE(c != nullptr);
+        CHECK(c->location.line == static_cast<size_t>(1));
+        CHECK(c->location.column == static_cast<size_t>(0));
+    }
+
+    SECTION("Edit inside a declaration re-parses only its neighbourhood")
+    {
+        forma::lsp::DocumentBuffer buffer;
+        buffer.assign(SOURCE);
+
+        std::string expected(SOURCE);
+        size_t at = expected.find("Dark") + 4;
+        expected.insert(at, ", Auto");
+        buffer.replace(at, at, ", Auto");
+
+        CHECK(buffer.text() == expected);
+        CHECK(buffer.last_reparsed() <= static_cast<size_t>(3));
+        CHECK(buffer.segment_count() == static_cast<size_t>(4));
+        CHECK(matches_full_parse(buffer));
+    }
+
+    SECTION("Removing a closing brace merges declarations, restoring it splits them")
+    {
+        forma::lsp::DocumentBuffer buffer;
+        buffer.assign(SOURCE);
+
+        std::string expected(SOURCE);
+        size_t at = expected.find("}\nenum");
+        expected.erase(at, 1);
+        buffer.replace(at, at + 1, "");
+        CHECK(buffer.text() == expected);
+        CHECK(matches_full_parse(buffer));
+
+        expected.insert(at, "}");
+        buffer.replace(at, at, "}");
+        CHECK(buffer.text() == expected);
+        CHECK(buffer.segment_count() == static_cast<size_t>(4));
+        CHECK(matches_full_parse(buffer));
+    }
+
+    SECTION("Typing a declaration keystroke by keystroke")
+    {
+        forma::lsp::DocumentBuffer buffer;
+        buffer.assign(SOURCE);
+
+        std::string expected(SOURCE);
+        std::string_view typed = "event onTap(x: int)\nclass Extra { property y: int }\n";
+        size_t at = expected.find("enum Mode");
+        for (char c : typed) {
+            expected.insert(at, 1, c);
+            buffer.replace(at, at, std::string_view(&c, 1));
+            ++at;
+            REQUIRE(buffer.text() == expected);
+            REQUIRE(matches_full_parse(buffer));
+        }
+        CHECK(buffer.segment_count() == static_cast<size_t>(6));
+    }
+
+    SECTION("Merged documents are shared, and rewritten only when unused")
+    {
+        forma::lsp::DocumentBuffer buffer;
+        buffer.assign(SOURCE);
+
+        auto held = buffer.build_document();
+        CHECK(buffer.snapshot().build_document() == held);
+
+        // The held document is not touched by an edit
+        size_t at = SOURCE.find("Dark") + 4;
+        buffer.replace(at, at, ", Auto");
+        auto edited = buffer.build_document();
+        CHECK(edited != held);
+        CHECK(held->enums[0].value_count == static_cast<size_t>(2));
+        CHECK(edited->enums[0].value_count == static_cast<size_t>(3));
+
+        // Once released, a document is reused for the next edit
+        const auto* released = held.get();
+        held.reset();
+        buffer.replace(at, at + 6, "");
+        auto reused = buffer.build_document();
+        CHECK(reused.get() == released);
+        CHECK(reused->enums[0].value_count == static_cast<size_t>(2));
+        CHECK(edited->enums[0].value_count == static_cast<size_t>(3));
+        CHECK(matches_full_parse(buffer));
+    }
+
+    SECTION("Deleting everything")
+    {
+        forma::lsp::DocumentBuffer buffer;
+        buffer.assign(SOURCE);
+        buffer.replace(0, SOURCE.size(), "");
+
+        CHECK(buffer.size() == static_cast<size_t>(0));
+        CHECK(buffer.text().empty());
+
+        buffer.replace(0, 0, "Card { }");
+        CHECK(buffer.text() == "Card { }");
+        CHECK(matches_full_parse(buffer));
+    }
+}
+
+TEST_CASE("LSP - Incremental Sync")
+{
+    forma::lsp::LSPDocumentManager<> manager;
+    manager.initialized = true;
+    CHECK(manager.initialize(1, "file:///workspace").capabilities.text_document_sync.change == 2);
+
+    forma::lsp::TextDocumentItem item;
+    item.uri = "file:///test.fml";
+    item.version = 1;
+    item.text = "class Card {\n    property title: string\n}\n";
+    manager.did_open(item);
+
+    forma::lsp::VersionedTextDocumentIdentifier id;
+    id.uri = "file:///test.fml";
+    id.version = 2;
+
+    SECTION("Ranged changes apply in order")
+    {
+        std::vector<forma::lsp::TextDocumentContentChangeEvent> changes = {
+            {forma::lsp::Range(1, 13, 1, 18), "heading"},
+            {forma::lsp::Range(3, 0, 3, 0), "class Other { }\n"},
+        };
+        manager.did_change(id, changes);
+
+        auto doc = manager.find_document("file:///test.fml");
+        REQUIRE(doc != nullptr);
+        CHECK(doc->text == "class Card {\n    property heading: string\n}\nclass Other { }\n");
+        CHECK(doc->version == 2);
+        REQUIRE(doc->cached_ast != nullptr);
+        CHECK(doc->cached_ast->type_count == static_cast<size_t>(2));
+    }
+
+    SECTION("Diagnostics follow the edited text")
+    {
+        auto doc = manager.find_document("file:///test.fml");
+        REQUIRE(doc != nullptr);
+        size_t before = doc->diagnostic_count;
+
+        std::vector<forma::lsp::TextDocumentContentChangeEvent> changes = {
+            {forma::lsp::Range(1, 20, 1, 26), "MissingType"},
+        };
+        manager.did_change(id, changes);
+        CHECK(doc->text == "class Card {\n    property title: MissingType\n}\n");
+        CHECK(doc->diagnostic_count > before);
+
+        changes = {{forma::lsp::Range(1, 20, 1, 31), "string"}};
+        manager.did_change(id, changes);
+        CHECK(doc->diagnostic_count == before);
+    }
+}
@@ -0,0 +1,315 @@
+#include <bugspray/bugspray.hpp>
+#include "../src/lsp.hpp"
+#include "../src/http_server.hpp"
+#include <arpa/inet.h>
+#include <string>
+#include <thread>
+
+namespace {
+
+using Manager = forma::lsp::LSPDocumentManager<>;
+
+std::string post(std::string_view body, std::string_view extra_headers = "") {
+    return "POST / HTTP/1.1\r\nHost: localhost\r\n" + std::string(extra_headers) +
+           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + std::string(body);
+}
+
+int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void send_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n <= 0) return;
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+}
+
+// Read one response from `fd`; leftover bytes stay in `buffer`
+std::string read_response(int fd, std::string& buffer) {
+    forma::http::HttpRequest response;
+    std::array<char, 4096> chunk;
+    for (;;) {
+        auto status = forma::http::parse_http_request(buffer, response, SIZE_MAX);
+        if (status == forma::http::HttpParseStatus::Complete) {
+            std::string body(response.body);
+            buffer.erase(0, response.size);
+            return body;
+        }
+        if (status != forma::http::HttpParseStatus::Incomplete) return "";
+        ssize_t n = read(fd, chunk.data(), chunk.size());
+        if (n <= 0) return "";
+        buffer.append(chunk.data(), static_cast<size_t>(n));
+    }
+}
+
+} // namespace
+
+TEST_CASE("HTTP - Request Framing")
+{
+    forma::http::HttpRequest request;
+
+    SECTION("Body is located by Content-Length")
+    {
+        std::string data = post("{\"id\":1}") + "POST";
+        REQUIRE(forma::http::parse_http_request(data, request, 1024) == forma::http::HttpParseStatus::Complete);
+        CHECK(request.method == "POST");
+        CHECK(request.body == "{\"id\":1}");
+        CHECK(request.keep_alive == true);
+        CHECK(request.size == data.size() - 4);  // Pipelined bytes are left alone
+    }
+
+    SECTION("Partial headers and bodies are incomplete")
+    {
+        std::string data = post("{\"id\":1}");
+        CHECK(forma::http::parse_http_request(std::string_view(data).substr(0, 20), request, 1024) ==
+              forma::http::HttpParseStatus::Incomplete);
+        CHECK(forma::http::parse_http_request(std::string_view(data).substr(0, data.size() - 1), request, 1024) ==
+              forma::http::HttpParseStatus::Incomplete);
+    }
+
+    SECTION("Header names are case-insensitive")
+    {
+        std::string data = "POST / HTTP/1.1\r\ncontent-length: 2\r\nCONNECTION: close\r\n\r\n{}";
+        REQUIRE(forma::http::parse_http_request(data, request, 1024) == forma::http::HttpParseStatus::Complete);
+        CHECK(request.body == "{}");
+        CHECK(request.keep_alive == false);
+    }
+
+    SECTION("HTTP/1.0 closes unless asked to keep alive")
+    {
+        std::string data = "POST / HTTP/1.0\r\nContent-Length: 0\r\n\r\n";
+        REQUIRE(forma::http::parse_http_request(data, request, 1024) == forma::http::HttpParseStatus::Complete);
+        CHECK(request.keep_alive == false);
+
+        data = "POST / HTTP/1.0\r\nConnection: Keep-Alive\r\nContent-Length: 0\r\n\r\n";
+        REQUIRE(forma::http::parse_http_request(data, request, 1024) == forma::http::HttpParseStatus::Complete);
+        CHECK(request.keep_alive == true);
+    }
+
+    SECTION("Malformed and oversized requests")
+    {
+        CHECK(forma::http::parse_http_request("POST / HTTP/1.1\r\nContent-Length: x\r\n\r\n", request, 1024) ==
+              forma::http::HttpParseStatus::Invalid);
+        CHECK(forma::http::parse_http_request("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n", request, 1024) ==
+              forma::http::HttpParseStatus::Invalid);
+        CHECK(forma::http::parse_http_request("POST / HTTP/1.1\r\nContent-Length: 2048\r\n\r\n", request, 1024) ==
+              forma::http::HttpParseStatus::TooLarge);
+    }
+
+    SECTION("Messages are read with the shared JSON parser")
+    {
+        Manager manager;
+        forma::http::HttpServer server(0, manager, 1);
+
+        // Keys inside string values and nested objects never match
+        std::string hidden = server.handle_message(
+            "{\"jsonrpc\":\"2.0\",\"id\":5,\"params\":{\"text\":\"\\\"method\\\":\\\"initialize\\\"\","
+            "\"nested\":{\"method\":\"initialize\"}}}");
+        CHECK(hidden.find("-32601") != std::string::npos);
+        CHECK(hidden.find("\"id\":5") != std::string::npos);
+
+        CHECK(server.handle_message("{\"id\":1,\"method\":").find("-32700") != std::string::npos);
+        CHECK(server.handle_message("{\"id\":1,\"text\":\"\\ud83d\"}").find("-32700") != std::string::npos);
+
+        // Escaped document text is decoded, surrogate pairs included
+        CHECK(server.handle_message(
+                  "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"textDocument/didOpen\",\"params\":{\"textDocument\":"
+                  "{\"uri\":\"file:///t.fml\",\"languageId\":\"forma\",\"version\":1,"
+                  "\"text\":\"class A {\\n}\\n// \\\"\\u00e9\\ud83d\\ude00\\\"\\n\"}}}")
+                  .find("\"result\":null") != std::string::npos);
+        const auto* doc = manager.find_document("file:///t.fml");
+        REQUIRE(doc != nullptr);
+        CHECK(doc->buffer.snapshot().text() == "class A {\n}\n// \"\xC3\xA9\xF0\x9F\x98\x80\"\n");
+    }
+}
+
+TEST_CASE("HTTP - Server")
+{
+    Manager manager;
+    forma::http::HttpServer server(0, manager, 2);
+    REQUIRE(server.start());
+    std::thread loop([&] { server.run(); });
+
+    int fd = connect_to(server.bound_port());
+    REQUIRE(fd >= 0);
+    std::string buffer;
+
+    SECTION("Requests share one keep-alive connection")
+    {
+        send_all(fd, post("{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"initialize\",\"params\":{\"processId\":1,\"rootUri\":\"file:///w\"}}"));
+        CHECK(read_response(fd, buffer).find("\"capabilities\"") != std::string::npos);
+
+        send_all(fd, post("{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"unknown\",\"params\":{}}"));
+        CHECK(read_response(fd, buffer).find("-32601") != std::string::npos);
+    }
+
+    SECTION("Pipelined requests are answered in order")
+    {
+        std::string open = post(
+            "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"textDocument/didOpen\",\"params\":{\"textDocument\":"
+            "{\"uri\":\"file:///a.fml\",\"languageId\":\"forma\",\"version\":1,"
+            "\"text\":\"class Card {\\n    property title: Missing\\n}\\n\"}}}");
+        std::string diagnostic = post(
+            "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"textDocument/diagnostic\",\"params\":{\"textDocument\":"
+            "{\"uri\":\"file:///a.fml\"}}}");
+        send_all(fd, open + diagnostic);
+
+        CHECK(read_response(fd, buffer).find("\"id\":1") != std::string::npos);
+        std::string response = read_response(fd, buffer);
+        CHECK(response.find("\"id\":2") != std::string::npos);
+        CHECK(response.find("Missing") != std::string::npos);
+    }
+
+    SECTION("Bodies larger than one read are assembled")
+    {
+        std::string text;
+        for (int i = 0; i < 2000; ++i) {
+            text += "class Widget" + std::to_string(i) + " {\\n    property value: int\\n}\\n";
+        }
+        std::string request = post(
+            "{\"jsonrpc\":\"2.0\",\"id\":7,\"method\":\"textDocument/didOpen\",\"params\":{\"textDocument\":"
+            "{\"uri\":\"file:///big.fml\",\"languageId\":\"forma\",\"version\":1,\"text\":\"" + text + "\"}}}");
+        REQUIRE(request.size() > static_cast<size_t>(64 * 1024));
+
+        // Trickle the request in two halves
+        send_all(fd, std::string_view(request).substr(0, request.size() / 2));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        send_all(fd, std::string_view(request).substr(request.size() / 2));
+        CHECK(read_response(fd, buffer).find("\"id\":7") != std::string::npos);
+
+        send_all(fd, post("{\"jsonrpc\":\"2.0\",\"id\":8,\"method\":\"textDocument/diagnostic\",\"params\":"
+                          "{\"textDocument\":{\"uri\":\"file:///big.fml\"}}}"));
+        CHECK(read_response(fd, buffer).find("\"items\":[]") != std::string::npos);
+
+        const auto* doc = manager.find_document("file:///big.fml");
+        REQUIRE(doc != nullptr);
+        REQUIRE(doc->cached_ast != nullptr);
+        CHECK(doc->cached_ast->type_count == static_cast<size_t>(2000));
+    }
+
+    SECTION("A long pipeline is answered without unbounded buffering")
+    {
+        // Far more than the server buffers ahead: it has to stop reading
+        // while the client is not taking responses, then catch up
+        constexpr int count = 50000;
+        std::string get = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        std::thread sender([&] {
+            std::string batch;
+            for (int i = 0; i < count; ++i) batch += get;
+            send_all(fd, batch);
+            send_all(fd, post("{\"jsonrpc\":\"2.0\",\"id\":9,\"method\":\"unknown\"}"));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        int answered = 0;
+        for (int i = 0; i < count; ++i) {
+            if (read_response(fd, buffer).find("Use POST") != std::string::npos) ++answered;
+        }
+        sender.join();
+        CHECK(answered == count);
+        CHECK(read_response(fd, buffer).find("\"id\":9") != std::string::npos);
+    }
+
+    SECTION("Every change in one didChange is applied with its own range")
+    {
+        send_all(fd, post(
+            "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"textDocument/didOpen\",\"params\":{\"textDocument\":"
+            "{\"uri\":\"file:///e.fml\",\"languageId\":\"forma\",\"version\":1,"
+            "\"text\":\"class Card {\\n    property title: string\\n}\\n\"}}}"));
+        CHECK(read_response(fd, buffer).find("\"id\":1") != std::string::npos);
+
+        // Two ranged edits batched into one notification; the second one's
+        // positions are relative to the text after the first
+        send_all(fd, post(
+            "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"textDocument/didChange\",\"params\":{\"textDocument\":"
+            "{\"uri\":\"file:///e.fml\",\"version\":2},\"contentChanges\":["
+            "{\"range\":{\"start\":{\"line\":0,\"character\":6},\"end\":{\"line\":0,\"character\":10}},"
+            "\"text\":\"Panel\"},"
+            "{\"range\":{\"start\":{\"line\":1,\"character\":13},\"end\":{\"line\":1,\"character\":18}},"
+            "\"text\":\"heading\"}]}}"));
+        CHECK(read_response(fd, buffer).find("\"id\":2") != std::string::npos);
+
+        const auto* doc = manager.find_document("file:///e.fml");
+        REQUIRE(doc != nullptr);
+        CHECK(doc->buffer.snapshot().text() == "class Panel {\n    property heading: string\n}\n");
+
+        // A full replacement followed by a ranged edit: the range belongs to
+        // the second entry only
+        send_all(fd, post(
+            "{\"jsonrpc\":\"2.0\",\"id\":3,\"method\":\"textDocument/didChange\",\"params\":{\"textDocument\":"
+            "{\"uri\":\"file:///e.fml\",\"version\":3},\"contentChanges\":["
+            "{\"text\":\"class Box {\\n}\\n\"},"
+            "{\"range\":{\"start\":{\"line\":0,\"character\":6},\"end\":{\"line\":0,\"character\":9}},"
+            "\"text\":\"Row\"}]}}"));
+        CHECK(read_response(fd, buffer).find("\"id\":3") != std::string::npos);
+        CHECK(doc->buffer.snapshot().text() == "class Row {\n}\n");
+    }
+
+    SECTION("Changes are applied in version order across connections")
+    {
+        send_all(fd, post(
+            "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"textDocument/didOpen\",\"params\":{\"textDocument\":"
+            "{\"uri\":\"file:///o.fml\",\"languageId\":\"forma\",\"version\":1,"
+            "\"text\":\"class Card {\\n}\\n\"}}}"));
+        CHECK(read_response(fd, buffer).find("\"id\":1") != std::string::npos);
+
+        // Edit 3 inserts after the text edit 2 adds, so it only makes sense
+        // on top of it
+        std::string edit2 = post(
+            "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"textDocument/didChange\",\"params\":{\"textDocument\":"
+            "{\"uri\":\"file:///o.fml\",\"version\":2},\"contentChanges\":["
+            "{\"range\":{\"start\":{\"line\":1,\"character\":0},\"end\":{\"line\":1,\"character\":0}},"
+            "\"text\":\"    property title: string\\n\"}]}}");
+        std::string edit3 = post(
+            "{\"jsonrpc\":\"2.0\",\"id\":3,\"method\":\"textDocument/didChange\",\"params\":{\"textDocument\":"
+            "{\"uri\":\"file:///o.fml\",\"version\":3},\"contentChanges\":["
+            "{\"range\":{\"start\":{\"line\":1,\"character\":13},\"end\":{\"line\":1,\"character\":18}},"
+            "\"text\":\"heading\"}]}}");
+
+        int other = connect_to(server.bound_port());
+        REQUIRE(other >= 0);
+        std::string other_buffer;
+        send_all(other, edit3);
+        CHECK(read_response(other, other_buffer).find("\"id\":3") != std::string::npos);
+
+        const auto* doc = manager.find_document("file:///o.fml");
+        REQUIRE(doc != nullptr);
+        CHECK(doc->version == 1);  // Waiting for edit 2
+        CHECK(doc->buffer.snapshot().text() == "class Card {\n}\n");
+
+        send_all(fd, edit2);
+        CHECK(read_response(fd, buffer).find("\"id\":2") != std::string::npos);
+        CHECK(doc->version == 3);
+        CHECK(doc->buffer.snapshot().text() == "class Card {\n    property heading: string\n}\n");
+
+        // A repeated, already applied version changes nothing
+        send_all(other, edit2);
+        CHECK(read_response(other, other_buffer).find("\"id\":2") != std::string::npos);
+        CHECK(doc->version == 3);
+        CHECK(doc->buffer.snapshot().text() == "class Card {\n    property heading: string\n}\n");
+        close(other);
+    }
+
+    SECTION("Connection: close is honoured")
+    {
+        send_all(fd, post("{\"jsonrpc\":\"2.0\",\"id\":3,\"method\":\"unknown\"}", "Connection: close\r\n"));
+        CHECK(read_response(fd, buffer).find("\"id\":3") != std::string::npos);
+        std::array<char, 16> rest;
+        CHECK(read(fd, rest.data(), rest.size()) == 0);
+    }
+
+    close(fd);
+    server.stop();
+    loop.join();
+}
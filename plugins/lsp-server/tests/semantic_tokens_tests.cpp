@@ -0,0 +1,223 @@
+#include <bugspray/bugspray.hpp>
+#include "../src/lsp.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using forma::lsp::SemanticTokenType;
+
+constexpr std::string_view URI = "file:///tokens.fml";
+
+constexpr std::string_view SOURCE =
+    "class Card : Panel {\n"
+    "    property title: string\n"
+    "    method int area(width: int)\n"
+    "}\n"
+    "enum Mode { Light, Dark }\n"
+    "event clicked(x: int)\n"
+    "Card {\n"
+    "    title: \"Hello\"\n"
+    "    Button { text: \"a\n"
+    "b\" }\n"
+    "}\n";
+
+struct DecodedToken {
+    uint32_t line;
+    uint32_t column;
+    uint32_t length;
+    SemanticTokenType type;
+    uint32_t modifiers;
+};
+
+// Undo the relative encoding
+std::vector<DecodedToken> decode(const std::vector<uint32_t>& data) {
+    std::vector<DecodedToken> out;
+    uint32_t line = 0, column = 0;
+    for (size_t i = 0; i + 4 < data.size(); i += 5) {
+        line += data[i];
+        column = data[i] == 0 ? column + data[i + 1] : data[i + 1];
+        out.push_back({line, column, data[i + 2], static_cast<SemanticTokenType>(data[i + 3]), data[i + 4]});
+    }
+    return out;
+}
+
+const DecodedToken* token_at(const std::vector<DecodedToken>& tokens, uint32_t line, uint32_t column) {
+    for (const auto& tok : tokens) {
+        if (tok.line == line && tok.column == column) return &tok;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<forma::lsp::LSPDocumentManager<>> open(std::string_view text) {
+    auto manager = std::make_unique<forma::lsp::LSPDocumentManager<>>();
+    manager->initialized = true;
+    forma::lsp::TextDocumentItem item;
+    item.uri = URI;
+    item.version = 1;
+    item.text = text;
+    manager->did_open(item);
+    return manager;
+}
+
+} // namespace
+
+TEST_CASE("LSP - Semantic Tokens")
+{
+    SECTION("Tokens are classified from their kind, position and the declarations")
+    {
+        auto manager = open(SOURCE);
+        forma::lsp::SemanticTokens previous;
+        const auto* result = manager->update_semantic_tokens(URI, previous);
+        REQUIRE(result != nullptr);
+        CHECK(result->result_id == 1);
+        CHECK(result->data.size() % 5 == 0);
+
+        auto tokens = decode(result->data);
+        auto type_at = [&](uint32_t line, uint32_t column) {
+            const auto* tok = token_at(tokens, line, column);
+            return tok ? tok->type : static_cast<SemanticTokenType>(~0u);
+        };
+
+        CHECK(type_at(0, 0) == SemanticTokenType::Keyword);     // class
+        CHECK(type_at(0, 6) == SemanticTokenType::Class);       // Card
+        CHECK(token_at(tokens, 0, 6)->modifiers == forma::lsp::Declaration);
+        CHECK(type_at(1, 13) == SemanticTokenType::Property);   // title
+        CHECK(type_at(1, 20) == SemanticTokenType::Type);       // string
+        CHECK(type_at(2, 15) == SemanticTokenType::Method);     // area
+        CHECK(type_at(2, 20) == SemanticTokenType::Parameter);  // width
+        CHECK(type_at(4, 5) == SemanticTokenType::Enum);        // Mode
+        CHECK(type_at(5, 6) == SemanticTokenType::Event);       // clicked
+        CHECK(type_at(5, 14) == SemanticTokenType::Parameter);  // x
+        CHECK(type_at(6, 0) == SemanticTokenType::Class);       // Card instance
+        CHECK(type_at(7, 4) == SemanticTokenType::Property);    // title:
+        CHECK(type_at(7, 11) == SemanticTokenType::String);
+        CHECK(type_at(8, 4) == SemanticTokenType::Class);       // Button
+        CHECK(token_at(tokens, 8, 4)->modifiers == forma::lsp::DefaultLibrary);
+    }
+
+    SECTION("Multiline strings are split at line breaks")
+    {
+        auto manager = open(SOURCE);
+        forma::lsp::SemanticTokens previous;
+        auto tokens = decode(manager->update_semantic_tokens(URI, previous)->data);
+
+        const auto* first = token_at(tokens, 8, 19);
+        const auto* second = token_at(tokens, 9, 0);
+        REQUIRE(first != nullptr);
+        REQUIRE(second != nullptr);
+        CHECK(first->type == SemanticTokenType::String);
+        CHECK(first->length == 2);  // "a
+        CHECK(second->type == SemanticTokenType::String);
+        CHECK(second->length == 2);  // b"
+    }
+
+    SECTION("Nothing is produced before the document is analysed")
+    {
+        forma::lsp::LSPDocumentManager<> manager;
+        forma::lsp::SemanticTokens previous;
+        CHECK(manager.update_semantic_tokens(URI, previous) == nullptr);
+    }
+
+    SECTION("An edit produces one small delta that rebuilds the new data")
+    {
+        auto manager = open(SOURCE);
+        forma::lsp::SemanticTokens previous;
+        manager->update_semantic_tokens(URI, previous);
+
+        std::string edited(SOURCE);
+        edited.replace(edited.find("\"Hello\""), 7, "42");
+        forma::lsp::VersionedTextDocumentIdentifier id;
+        id.uri = URI;
+        id.version = 2;
+        manager->did_change(id, edited);
+
+        const auto* current = manager->update_semantic_tokens(URI, previous);
+        REQUIRE(current != nullptr);
+        CHECK(previous.result_id == 1);
+        CHECK(current->result_id == 2);
+
+        auto edit = forma::lsp::diff_semantic_tokens(previous.data, current->data);
+        CHECK(edit.delete_count <= 5);
+        CHECK(edit.data.size() <= 5);
+
+        std::vector<uint32_t> rebuilt = previous.data;
+        rebuilt.erase(rebuilt.begin() + edit.start, rebuilt.begin() + edit.start + edit.delete_count);
+        rebuilt.insert(rebuilt.begin() + edit.start, edit.data.begin(), edit.data.end());
+        CHECK(rebuilt == current->data);
+    }
+
+    SECTION("Results are encoded as the LSP expects")
+    {
+        forma::lsp::SemanticTokens tokens{7, {0, 4, 5, 3, 1}};
+        CHECK(forma::lsp::encode_semantic_tokens(tokens) == R"({"resultId":"7","data":[0,4,5,3,1]})");
+
+        std::vector<uint32_t> before{0, 0, 5, 0, 0, 1, 2, 3, 1, 0};
+        std::vector<uint32_t> after{0, 0, 5, 0, 0, 1, 2, 4, 1, 0};
+        auto edit = forma::lsp::diff_semantic_tokens(before, after);
+        CHECK(forma::lsp::encode_semantic_tokens_delta(8, edit) ==
+              R"({"resultId":"8","edits":[{"start":7,"deleteCount":1,"data":[4]}]})");
+
+        auto none = forma::lsp::diff_semantic_tokens(before, before);
+        CHECK(forma::lsp::encode_semantic_tokens_delta(9, none) == R"({"resultId":"9","edits":[]})");
+    }
+}
+
+TEST_CASE("LSP - Document Symbols")
+{
+    auto manager = open(SOURCE);
+    std::vector<forma::lsp::DocumentSymbol> symbols;
+    REQUIRE(manager->document_symbols(URI, symbols));
+    REQUIRE(symbols.size() == 4);
+
+    SECTION("Classes list their members with types")
+    {
+        const auto& card = symbols[0];
+        CHECK(card.name == "Card");
+        CHECK(card.kind == forma::lsp::SymbolKind::Class);
+        CHECK(card.detail == "Panel");
+        CHECK(card.start == 0);
+        CHECK(SOURCE.substr(card.end - 1, 1) == "}");
+        REQUIRE(card.children.size() == 2);
+        CHECK(card.children[0].name == "title");
+        CHECK(card.children[0].kind == forma::lsp::SymbolKind::Property);
+        CHECK(card.children[0].detail == "string");
+        CHECK(card.children[1].name == "area");
+        CHECK(card.children[1].kind == forma::lsp::SymbolKind::Method);
+        CHECK(card.children[1].detail == "int");
+    }
+
+    SECTION("Enums list their members")
+    {
+        const auto& mode = symbols[1];
+        CHECK(mode.name == "Mode");
+        CHECK(mode.kind == forma::lsp::SymbolKind::Enum);
+        REQUIRE(mode.children.size() == 2);
+        CHECK(mode.children[0].name == "Light");
+        CHECK(mode.children[1].name == "Dark");
+        CHECK(mode.children[1].kind == forma::lsp::SymbolKind::EnumMember);
+    }
+
+    SECTION("Instances nest and events span their parameters")
+    {
+        CHECK(symbols[2].name == "clicked");
+        CHECK(symbols[2].kind == forma::lsp::SymbolKind::Event);
+        CHECK(SOURCE.substr(symbols[2].start, symbols[2].end - symbols[2].start) == "event clicked(x: int)");
+
+        const auto& root = symbols[3];
+        CHECK(root.name == "Card");
+        CHECK(root.kind == forma::lsp::SymbolKind::Object);
+        REQUIRE(root.children.size() == 1);
+        CHECK(root.children[0].name == "Button");
+        CHECK(root.children[0].name_start == SOURCE.find("Button"));
+    }
+
+    SECTION("Ranges are encoded as line/character positions")
+    {
+        const auto* doc = manager->find_document(URI);
+        std::string json = forma::lsp::encode_document_symbols(symbols, doc->cached_snapshot.lines);
+        CHECK(json.starts_with(R"([{"name":"Card","detail":"Panel","kind":5,"range":{"start":{"line":0,"character":0},"end":{"line":3,"character":1}})"));
+        CHECK(json.find(R"({"name":"Button","detail":"","kind":19,"range":{"start":{"line":8,"character":4},"end":{"line":9,"character":4}})") != std::string::npos);
+    }
+}
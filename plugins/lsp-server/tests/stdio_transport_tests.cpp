@@ -0,0 +1,167 @@
+#include <bugspray/bugspray.hpp>
+#include "../src/stdio_transport.hpp"
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+std::string frame(std::string_view body, std::string_view header = "Content-Length: ") {
+    return std::string(header) + std::to_string(body.size()) + "\r\n\r\n" + std::string(body);
+}
+
+void write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = write(fd, data.data(), data.size());
+        if (n <= 0) return;
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+}
+
+std::string as_string(const std::optional<std::span<char>>& message) {
+    return message ? std::string(message->data(), message->size()) : std::string("<eof>");
+}
+
+} // namespace
+
+TEST_CASE("LSP - Message Reader")
+{
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+
+    SECTION("Messages are split by Content-Length")
+    {
+        std::string input = frame("{\"id\":1}") + frame("{\"id\":2}", "content-length:") +
+                            "Content-Length: 8\nContent-Type: application/vscode-jsonrpc\n\n{\"id\":3}";
+        write_all(fds[1], input);
+        close(fds[1]);
+
+        forma::lsp::MessageReader reader(fds[0], 16);
+        CHECK(as_string(reader.next()) == "{\"id\":1}");
+        CHECK(as_string(reader.next()) == "{\"id\":2}");
+        CHECK(as_string(reader.next()) == "{\"id\":3}");
+        CHECK(reader.next().has_value() == false);
+    }
+
+    SECTION("Large messages arriving in pieces are assembled")
+    {
+        std::string body = "{\"text\":\"" + std::string(1 << 20, 'x') + "\"}";
+        std::string input = frame(body) + frame("{}");
+        std::thread writer([&] {
+            for (size_t i = 0; i < input.size(); i += 4093) {
+                write_all(fds[1], std::string_view(input).substr(i, 4093));
+            }
+            close(fds[1]);
+        });
+
+        forma::lsp::MessageReader reader(fds[0], 1024);
+        auto message = reader.next();
+        CHECK(as_string(message) == body);
+        CHECK(as_string(reader.next()) == "{}");
+        CHECK(reader.next().has_value() == false);
+        writer.join();
+    }
+
+    SECTION("Truncated input ends the stream")
+    {
+        write_all(fds[1], "Content-Length: 100\r\n\r\n{\"id\":");
+        close(fds[1]);
+
+        forma::lsp::MessageReader reader(fds[0]);
+        CHECK(reader.next().has_value() == false);
+    }
+
+    SECTION("Missing, malformed and oversized lengths end the stream")
+    {
+        std::string length = std::to_string(forma::lsp::MessageReader::MAX_CONTENT_LENGTH + 1);
+        for (std::string header : {std::string("Content-Type: x\r\n\r\n{}"), std::string("Content-Length: 2x\r\n\r\n{}"),
+                                   std::string("Content-Length: 99999999999999999999999\r\n\r\n{}"),
+                                   "Content-Length: " + length + "\r\n\r\n{}"}) {
+            int pair[2];
+            REQUIRE(pipe(pair) == 0);
+            write_all(pair[1], frame("{\"id\":1}") + header);
+            close(pair[1]);
+
+            forma::lsp::MessageReader reader(pair[0], 16);
+            CHECK(as_string(reader.next()) == "{\"id\":1}");
+            CHECK(reader.next().has_value() == false);
+            CHECK(!reader.error().empty());
+            CHECK(reader.buffered() < static_cast<size_t>(1024));
+            close(pair[0]);
+        }
+        close(fds[1]);
+    }
+
+    close(fds[0]);
+}
+
+TEST_CASE("LSP - JSON Parser")
+{
+    forma::lsp::JsonParser json;
+
+    SECTION("Fields of nested objects and arrays")
+    {
+        std::string message =
+            "{\"jsonrpc\":\"2.0\",\"id\":7,\"method\":\"textDocument/didChange\",\"params\":{"
+            "\"textDocument\":{\"uri\":\"file:///a.fml\",\"version\":3},"
+            "\"contentChanges\":[{\"range\":{\"start\":{\"line\":1,\"character\":2},"
+            "\"end\":{\"line\":1,\"character\":4}},\"text\":\"ab\"},{\"text\":\"full\"}]}}";
+        REQUIRE(json.parse(message));
+
+        auto root = json.root();
+        CHECK(root["id"].integer() == 7);
+        CHECK(root["method"].string() == "textDocument/didChange");
+        CHECK(root["params"]["textDocument"]["uri"].string() == "file:///a.fml");
+        CHECK(root["params"]["textDocument"]["version"].integer() == 3);
+
+        std::vector<std::string_view> texts;
+        std::vector<int> lines;
+        for (auto change : root["params"]["contentChanges"]) {
+            texts.push_back(change["text"].string());
+            lines.push_back(change["range"]["start"]["line"].integer());
+        }
+        REQUIRE(texts.size() == static_cast<size_t>(2));
+        CHECK(texts[0] == "ab");
+        CHECK(texts[1] == "full");
+        CHECK(lines[0] == 1);
+        CHECK(lines[1] == -1);  // No range
+    }
+
+    SECTION("Strings are decoded in place")
+    {
+        std::string message = "{\"text\":\"class A {\\n  \\\"q\\\" \\u00e9 \\ud83d\\ude00 \\\\\"}";
+        REQUIRE(json.parse(message));
+
+        std::string_view text = json.root()["text"].string();
+        CHECK(text == "class A {\n  \"q\" \xC3\xA9 \xF0\x9F\x98\x80 \\");
+        CHECK(text.data() >= message.data());
+        CHECK(text.data() + text.size() <= message.data() + message.size());
+    }
+
+    SECTION("Brackets inside strings do not end values")
+    {
+        std::string message = "{\"text\":\"}]{\",\"after\":true}";
+        REQUIRE(json.parse(message));
+        CHECK(json.root()["text"].string() == "}]{");
+        CHECK(json.root()["after"].is(forma::lsp::JsonParser::Kind::True));
+    }
+
+    SECTION("Missing fields and malformed input")
+    {
+        std::string message = "{\"id\":\"abc\"}";
+        REQUIRE(json.parse(message));
+        CHECK(json.root()["id"].integer() == -1);
+        CHECK(json.root()["params"]["uri"].string().empty());
+        CHECK(json.root()["params"].exists() == false);
+
+        for (std::string bad : {"{\"id\":1", "{\"id\" 1}", "{\"text\":\"open}", "[1,]", "{} x", "{\"a\":\"\\q\"}"}) {
+            CHECK(json.parse(bad) == false);
+        }
+
+        // Surrogates must come in high/low pairs
+        for (std::string bad : {"\"\\ud83d\"", "\"\\ud83dx\"", "\"\\ud83d\\u0041\"", "\"\\ude00\"", "\"\\u12g4\""}) {
+            CHECK(json.parse(bad) == false);
+        }
+    }
+}
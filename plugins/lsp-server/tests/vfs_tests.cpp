@@ -1,13 +1,15 @@
 #include <bugspray/bugspray.hpp>
 #include "../src/lsp.hpp"
 #include "../src/virtual_fs.hpp"
+#include <memory>
+#include <string>
 
 using namespace forma::lsp;
 using namespace forma::vfs;
 
 TEST_CASE("VirtualFS - Basic File Operations")
 {
-    VirtualFS<32> fs;
+    VirtualFS fs;
     
     SECTION("Write and read file")
     {
@@ -67,3 +69,103 @@ TEST_CASE("VirtualFS - Basic File Operations")
         CHECK(content.value() == "v3");
     }
 }
+
+TEST_CASE("VirtualFS - Shared Contents")
+{
+    VirtualFS fs;
+    
+    SECTION("Snapshots keep their version after later writes")
+    {
+        fs.write_file("file:///test.fml", "v1", 1);
+        auto before = fs.snapshot("file:///test.fml");
+        REQUIRE(before.has_value());
+        
+        fs.write_file("file:///test.fml", "v2", 2);
+        CHECK(before->text() == "v1");
+        CHECK(before->version == 1);
+        CHECK(fs.snapshot("file:///test.fml")->text() == "v2");
+        
+        fs.remove_file("file:///test.fml");
+        CHECK(before->text() == "v1");
+        CHECK(!fs.snapshot("file:///test.fml").has_value());
+    }
+    
+    SECTION("Reads and snapshots share the stored content")
+    {
+        auto content = std::make_shared<const std::string>("Point {}");
+        fs.write_file("file:///a.fml", content);
+        fs.write_file("file:///b.fml", content);
+        
+        CHECK(fs.snapshot("file:///a.fml")->content == content);
+        CHECK(fs.read_file("file:///b.fml")->data() == content->data());
+        CHECK(content.use_count() == 3);
+    }
+    
+    SECTION("No capacity limit")
+    {
+        for (int i = 0; i < 5000; ++i) {
+            REQUIRE(fs.write_file("file:///f" + std::to_string(i) + ".fml", "Point {}"));
+        }
+        CHECK(fs.count() == static_cast<size_t>(5000));
+        CHECK(fs.list_files().size() == static_cast<size_t>(5000));
+        CHECK(fs.read_file("file:///f4999.fml").value() == "Point {}");
+        
+        REQUIRE(fs.remove_file("file:///f0.fml"));
+        CHECK(fs.count() == static_cast<size_t>(4999));
+        CHECK(!fs.exists("file:///f0.fml"));
+    }
+}
+
+TEST_CASE("VirtualWorkspace - Versions and Snapshots")
+{
+    auto lsp = std::make_unique<LSPDocumentManager<>>();
+    VirtualWorkspace workspace(*lsp);
+    workspace.initialize();
+    
+    REQUIRE(workspace.create_file("file:///point.fml", "class Point { property x: int }"));
+    auto first = workspace.snapshot("file:///point.fml");
+    REQUIRE(first.has_value());
+    CHECK(first->version == 1);
+    
+    // Creating an existing file updates it
+    REQUIRE(workspace.create_file("file:///point.fml", "class Point { property y: int }"));
+    REQUIRE(workspace.update_file("file:///point.fml", "class Point { property z: int }"));
+    CHECK(workspace.filesystem().get_version("file:///point.fml") == 3);
+    CHECK(lsp->find_document("file:///point.fml")->version == 3);
+    CHECK(first->text() == "class Point { property x: int }");
+    
+    CHECK(!workspace.update_file("file:///missing.fml", "class Missing {}"));
+    REQUIRE(workspace.delete_file("file:///point.fml"));
+    CHECK(workspace.file_count() == static_cast<size_t>(0));
+}
+
+TEST_CASE("VirtualWorkspace - Thousands of open files")
+{
+    auto lsp = std::make_unique<LSPDocumentManager<>>();
+    VirtualWorkspace workspace(*lsp);
+    workspace.initialize();
+    
+    constexpr int file_count = 3000;
+    auto uri_of = [](int i) { return "file:///f" + std::to_string(i) + ".fml"; };
+    for (int i = 0; i < file_count; ++i) {
+        REQUIRE(workspace.create_file(uri_of(i), "class Point { property x: int }"));
+    }
+    CHECK(lsp->document_count() == static_cast<size_t>(file_count));
+    
+    for (int i = 0; i < file_count; ++i) {
+        REQUIRE(workspace.update_file(uri_of(i), "class Point { property y: int }"));
+    }
+    
+    const auto* last = lsp->find_document(uri_of(file_count - 1));
+    REQUIRE(last != nullptr);
+    CHECK(last->version == 2);
+    CHECK(last->buffer.text() == "class Point { property y: int }");
+    
+    REQUIRE(workspace.delete_file(uri_of(0)));
+    CHECK(lsp->find_document(uri_of(0)) == nullptr);
+    CHECK(lsp->document_count() == static_cast<size_t>(file_count - 1));
+    
+    // Reopening a closed file gets a fresh document
+    REQUIRE(workspace.create_file(uri_of(0), "class Point {}"));
+    CHECK(lsp->find_document(uri_of(0))->version == 1);
+}
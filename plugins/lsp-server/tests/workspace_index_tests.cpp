@@ -0,0 +1,192 @@
+#include <bugspray/bugspray.hpp>
+#include "../src/lsp.hpp"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr std::string_view WIDGETS =
+    "class Card : Panel {\n"
+    "    property title: string\n"
+    "}\n"
+    "enum Mode { Light, Dark }\n";
+
+constexpr std::string_view SCREEN =
+    "import widgets\n"
+    "class Screen {\n"
+    "    property card: Card\n"
+    "}\n"
+    "Card {\n"
+    "    title: \"Hello\"\n"
+    "}\n";
+
+} // namespace
+
+TEST_CASE("LSP - Workspace Index")
+{
+    forma::lsp::WorkspaceIndex index;
+    index.index_source("file:///w/widgets.fml", WIDGETS);
+    index.index_source("file:///w/screen.fml", SCREEN);
+    CHECK(index.file_count() == 2);
+
+    SECTION("Definitions are found in other files")
+    {
+        auto card = index.definitions("Card");
+        REQUIRE(card.size() == 1);
+        CHECK(card[0].uri == "file:///w/widgets.fml");
+        CHECK(card[0].line == 0);
+        CHECK(card[0].column == 6);
+        CHECK(card[0].length == 4);
+
+        CHECK(index.definitions("Mode").size() == 1);
+        CHECK(index.definitions("title").empty());  // Members are not definitions
+        CHECK(index.definitions("Unknown").empty());
+    }
+
+    SECTION("References cover every file; instances are uses")
+    {
+        auto with = index.references("Card", true);
+        auto without = index.references("Card", false);
+        CHECK(with.size() == 3);  // Declaration, property type, instance
+        REQUIRE(without.size() == 2);
+        CHECK(without[0].uri == "file:///w/screen.fml");
+        CHECK(without[1].uri == "file:///w/screen.fml");
+        CHECK(without[1].line == 4);
+    }
+
+    SECTION("Re-indexing a file replaces what it contributed")
+    {
+        index.index_source("file:///w/widgets.fml", "class Tile { }\n");
+        CHECK(index.definitions("Card").empty());
+        CHECK(index.references("Card", true).size() == 2);
+        CHECK(index.definitions("Tile").size() == 1);
+
+        index.remove("file:///w/screen.fml");
+        CHECK(index.references("Card", true).empty());
+    }
+
+    SECTION("Open documents shadow the disk content")
+    {
+        auto manager = std::make_unique<forma::lsp::LSPDocumentManager<>>();
+        manager->workspace = &index;
+        forma::lsp::TextDocumentItem item;
+        item.uri = "file:///w/widgets.fml";
+        item.version = 1;
+        item.text = "class Badge { }\n";
+        manager->did_open(item);
+
+        CHECK(index.definitions("Badge").size() == 1);
+        index.index_source("file:///w/widgets.fml", WIDGETS);  // Disk catches up late
+        CHECK(index.definitions("Card").empty());
+        CHECK(index.definitions("Badge").size() == 1);
+    }
+
+    SECTION("Workspace symbols match the query's characters in order")
+    {
+        auto symbols = index.symbols("crd");
+        CHECK(symbols.size() == 3);  // The class, its instance and Screen's `card`
+        for (const auto& symbol : symbols) {
+            CHECK((symbol.name == "Card" || symbol.name == "card"));
+        }
+
+        auto title = index.symbols("TITLE");
+        REQUIRE(title.size() == 1);
+        CHECK(title[0].container == "Card");
+        CHECK(title[0].kind == forma::lsp::SymbolKind::Property);
+        CHECK(title[0].location.line == 1);
+
+        CHECK(index.symbols("dark")[0].container == "Mode");
+        CHECK(index.symbols("", 3).size() == 3);
+    }
+
+    SECTION("Prefix queries are ordered, ignore case and report truncation")
+    {
+        index.index_source("file:///w/more.fml", "class cardinal { }\nclass Carousel { }\nclass Scar { }\n");
+        auto any = [](forma::lsp::SymbolKind, std::string_view) { return true; };
+
+        std::vector<forma::lsp::WorkspaceSymbol> out;
+        CHECK(index.symbols_with_prefix("CAR", 10, any, out));
+        REQUIRE(out.size() == 5);  // Card (class and instance), card, cardinal, Carousel
+        CHECK(out[0].name == "Card");
+        CHECK(out[2].name == "card");
+        CHECK(out[3].name == "cardinal");
+        CHECK(out[4].name == "Carousel");
+
+        out.clear();
+        auto classes = [](forma::lsp::SymbolKind kind, std::string_view) { return kind == forma::lsp::SymbolKind::Class; };
+        CHECK(!index.symbols_with_prefix("car", 2, classes, out));
+        CHECK(out.size() == 2);
+
+        index.remove("file:///w/more.fml");
+        out.clear();
+        CHECK(index.symbols_with_prefix("car", 10, classes, out));
+        REQUIRE(out.size() == 1);
+        CHECK(out[0].name == "Card");
+    }
+}
+
+TEST_CASE("LSP - Workspace Index on disk")
+{
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "forma_workspace_index_test";
+    fs::remove_all(root);
+    fs::create_directories(root / "components");
+    fs::create_directories(root / ".cache");
+    std::ofstream(root / "components" / "card.fml") << WIDGETS;
+    std::ofstream(root / "my screen.fml") << SCREEN;
+    std::ofstream(root / ".cache" / "stale.fml") << "class Stale { }\n";
+    std::ofstream(root / "notes.txt") << "class Notes { }\n";
+
+    forma::lsp::WorkspaceIndex index;
+    forma::ThreadPool pool(4);
+    CHECK(index.index_directory(root, pool) == 2);
+    CHECK(index.definitions("Stale").empty());
+    CHECK(index.definitions("Notes").empty());
+
+    SECTION("Paths and URIs convert both ways")
+    {
+        std::string uri = forma::lsp::path_to_uri((root / "my screen.fml").string());
+        CHECK(uri.starts_with("file:///"));
+        CHECK(uri.ends_with("/my%20screen.fml"));
+        CHECK(forma::lsp::uri_to_path(uri) == (root / "my screen.fml").string());
+        CHECK(index.references("Screen", true).at(0).uri == uri);
+    }
+
+    SECTION("Go to definition falls back to the workspace")
+    {
+        auto manager = std::make_unique<forma::lsp::LSPDocumentManager<>>();
+        manager->workspace = &index;
+        forma::lsp::TextDocumentItem item;
+        std::string uri = forma::lsp::path_to_uri((root / "my screen.fml").string());
+        item.uri = uri;
+        item.version = 1;
+        item.text = SCREEN;
+        manager->did_open(item);
+
+        forma::lsp::Location location;
+        REQUIRE(manager->find_definition(uri, forma::lsp::Position(2, 20), location));
+        CHECK(location.uri == forma::lsp::path_to_uri((root / "components" / "card.fml").string()));
+        CHECK(location.range.start.line == 0);
+        CHECK(location.range.start.character == 6);
+
+        std::vector<forma::lsp::Location> references;
+        REQUIRE(std::as_const(*manager).find_references(uri, forma::lsp::Position(4, 1), false, references));
+        CHECK(references.size() == 2);
+
+        // Closing re-reads the file from disk
+        forma::lsp::VersionedTextDocumentIdentifier id;
+        id.uri = uri;
+        id.version = 2;
+        manager->did_change(id, "class Other { }\n");
+        CHECK(index.definitions("Screen").empty());
+        manager->did_close(forma::lsp::TextDocumentIdentifier(uri));
+        CHECK(index.definitions("Screen").size() == 1);
+        CHECK(index.definitions("Other").empty());
+    }
+
+    fs::remove_all(root);
+}
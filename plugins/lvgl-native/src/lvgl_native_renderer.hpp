@@ -29,7 +29,7 @@ public:
 
             if (auto toml_content = io.open_read(config_path)) {
                 try {
-                    auto toml_doc = toml::parse<16>(*toml_content);
+                    auto toml_doc = toml::parse_runtime(std::string(*toml_content));
 
                     if (auto tbl = toml_doc.get_table("native-lvgl")) {
                         if (auto v = tbl->get_string("sdl3_version")) sdl3_version = std::string(*v);
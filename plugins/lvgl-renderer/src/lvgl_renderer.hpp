@@ -1,8 +1,11 @@
 #pragma once
 
 #include <parser/ir.hpp>
+#include <core/assets.hpp>
+#include <core/io/output_sink.hpp>
 #include <array>
 #include <string_view>
+#include <vector>
 
 namespace forma::lvgl {
 
@@ -32,69 +35,34 @@ enum class Platform {
 // LVGL C Code Generator
 // ============================================================================
 
-template <size_t MaxOutput = 16384>
-class LVGLRenderer {
+// Sink is any forma::io::OutputSink. LVGLRenderer<N> keeps the original
+// fixed-buffer behaviour (usable at compile time); use ChunkedBufferSink or
+// WriteStreamSink when the output size is not known up front.
+template <forma::io::OutputSink Sink>
+class BasicLVGLRenderer {
 private:
-    std::array<char, MaxOutput> output_buffer{};
-    size_t output_pos = 0;
+    Sink sink;
     size_t indent_level = 0;
     size_t callback_count = 0;  // Track number of callbacks generated
     Platform target_platform = Platform::Linux;  // Default platform
     
     // Mapping from Forma types to LVGL widget types
     constexpr const char* map_type_to_lvgl(std::string_view type_name) const {
-        if (type_name == "Button") return "lv_btn";
-        if (type_name == "Label") return "lv_label";
-        if (type_name == "Panel" || type_name == "Container") return "lv_obj";
-        if (type_name == "Slider") return "lv_slider";
-        if (type_name == "Switch") return "lv_switch";
-        if (type_name == "Checkbox") return "lv_checkbox";
-        if (type_name == "Dropdown") return "lv_dropdown";
-        if (type_name == "TextArea") return "lv_textarea";
-        if (type_name == "Image") return "lv_img";
-        if (type_name == "Arc") return "lv_arc";
-        if (type_name == "Bar") return "lv_bar";
-        if (type_name == "Spinner") return "lv_spinner";
-        if (type_name == "List") return "lv_list";
-        if (type_name == "Chart") return "lv_chart";
-        if (type_name == "Table") return "lv_table";
-        if (type_name == "Calendar") return "lv_calendar";
-        if (type_name == "Keyboard") return "lv_keyboard";
-        if (type_name == "Roller") return "lv_roller";
-        if (type_name == "Textarea") return "lv_textarea";
-        
-        // Default to generic object
-        return "lv_obj";
+        const char* lvgl_type = widgets::lvgl_widget(type_name);
+        return lvgl_type ? lvgl_type : "lv_obj";  // Default to generic object
     }
     
     // Map Forma property names to LVGL API calls
     constexpr const char* map_property_to_lvgl_setter(std::string_view prop_name) const {
-        if (prop_name == "text") return "lv_label_set_text";
-        if (prop_name == "width") return "lv_obj_set_width";
-        if (prop_name == "height") return "lv_obj_set_height";
-        if (prop_name == "x") return "lv_obj_set_x";
-        if (prop_name == "y") return "lv_obj_set_y";
-        if (prop_name == "visible") return "lv_obj_set_hidden";
-        if (prop_name == "enabled") return "lv_obj_set_enabled";
-        if (prop_name == "value") return "lv_slider_set_value";
-        if (prop_name == "min") return "lv_slider_set_range";
-        if (prop_name == "max") return "lv_slider_set_range";
-        if (prop_name == "checked") return "lv_checkbox_set_checked";
-        
-        return nullptr;  // Unknown property
+        return widgets::lvgl_setter(prop_name);  // nullptr for unknown properties
     }
     
     constexpr void append(const char* str) {
-        while (*str && output_pos < MaxOutput - 1) {
-            output_buffer[output_pos++] = *str++;
-        }
+        sink.write(std::string_view(str));
     }
     
     constexpr void append(std::string_view str) {
-        for (char c : str) {
-            if (output_pos >= MaxOutput - 1) break;
-            output_buffer[output_pos++] = c;
-        }
+        sink.write(str);
     }
     
     constexpr void append_line(const char* str = "") {
@@ -119,12 +87,12 @@ private:
         }
         
         // Convert path to valid C identifier
-        for (size_t i = start; i < uri.size() && output_pos < MaxOutput - 1; ++i) {
+        for (size_t i = start; i < uri.size(); ++i) {
             char c = uri[i];
             if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
-                output_buffer[output_pos++] = (c >= 'A' && c <= 'Z') ? (c + ('a' - 'A')) : c;
+                sink.put((c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c);
             } else {
-                output_buffer[output_pos++] = '_';
+                sink.put('_');
             }
         }
     }
@@ -166,9 +134,7 @@ private:
         }
         
         while (idx > 0) {
-            if (output_pos < MaxOutput - 1) {
-                output_buffer[output_pos++] = temp[--idx];
-            }
+            sink.put(temp[--idx]);
         }
     }
     
@@ -204,10 +170,55 @@ private:
             generate_asset_symbol_name(asset.uri);
             append("_size;");
             append_line();
+
+            // Images are bundled with an LVGL image descriptor
+            if (asset.type == AssetDecl::Type::Image) {
+                append("extern const lv_image_dsc_t ");
+                generate_asset_symbol_name(asset.uri);
+                append("_dsc;");
+                append_line();
+            }
+        }
+
+        // Fonts are rasterized once per size instances select
+        for (size_t i = 0; i < document.instances.count; ++i) {
+            const auto& inst = document.instances.get(i);
+            const Value* font = find_font_asset(inst);
+            if (!font) continue;
+            bool declared = false;
+            for (size_t j = 0; j < i && !declared; ++j) {
+                const Value* other = find_font_asset(document.instances.get(j));
+                declared = other && other->text == font->text &&
+                           instance_font_size(document.instances.get(j)) == instance_font_size(inst);
+            }
+            if (declared) continue;
+            append("extern const lv_font_t ");
+            generate_font_symbol_name(*font, inst);
+            append(";");
+            append_line();
         }
         
         append_line();
     }
+
+    // The forma:// font an instance selects with `font`, if any
+    constexpr const Value* find_font_asset(const InstanceDecl& inst) const {
+        for (size_t i = 0; i < inst.prop_count; ++i) {
+            const auto& prop = inst.properties[i];
+            if (prop.name == "font" && prop.value.is_forma_uri() &&
+                AssetBundler<1>{}.get_asset_type(prop.value.text) == AssetDecl::Type::Font) {
+                return &prop.value;
+            }
+        }
+        return nullptr;
+    }
+
+    // Bitmap font generated for the font at the instance's font_size
+    constexpr void generate_font_symbol_name(const Value& font, const InstanceDecl& inst) {
+        generate_asset_symbol_name(font.text);
+        append("_");
+        append_int(instance_font_size(inst));
+    }
     
     constexpr void generate_variable_name(std::string_view type_name, size_t instance_idx) {
         // Convert TypeName to type_name_N format
@@ -219,8 +230,6 @@ private:
         // Convert TypeName to type_name_N format (without lv_obj_t *)
         bool first = true;
         for (char c : type_name) {
-            if (output_pos >= MaxOutput - 1) break;
-            
             // Skip invalid characters
             if (c == '{' || c == '}' || c == ' ' || c == '\n' || c == '\r' || c == '\t') {
                 continue;
@@ -228,11 +237,11 @@ private:
             
             if (c >= 'A' && c <= 'Z') {
                 if (!first) {
-                    output_buffer[output_pos++] = '_';
+                    sink.put('_');
                 }
-                output_buffer[output_pos++] = c + ('a' - 'A');  // to lowercase
+                sink.put(static_cast<char>(c + ('a' - 'A')));  // to lowercase
             } else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_') {
-                output_buffer[output_pos++] = c;
+                sink.put(c);
             }
             first = false;
         }
@@ -241,7 +250,8 @@ private:
         append_int(instance_idx);
     }
     
-    constexpr void generate_instance_creation(const InstanceNode* instances,
+    template <typename Instances>
+    constexpr void generate_instance_creation(const Instances* instances,
                                               const InstanceDecl& inst, 
                                               size_t inst_idx,
                                               size_t parent_idx = 0) {
@@ -284,8 +294,14 @@ private:
             if (prop.value.kind == Value::Kind::String || prop.value.kind == Value::Kind::URI) {
                 if (prop.value.text.size() >= 8 && 
                     prop.value.text.substr(0, 8) == "forma://") {
-                    // Reference bundled asset
-                    generate_asset_symbol_name(prop.value.text);
+                    // Reference bundled asset (its image descriptor, if it is an image)
+                    if (AssetBundler<1>{}.get_asset_type(prop.value.text) == AssetDecl::Type::Image) {
+                        append("&");
+                        generate_asset_symbol_name(prop.value.text);
+                        append("_dsc");
+                    } else {
+                        generate_asset_symbol_name(prop.value.text);
+                    }
                 } else {
                     // Regular string path (file system)
                     append("\"");
@@ -340,13 +356,8 @@ private:
     
     // Map event names to LVGL event codes
     constexpr const char* map_event_to_lvgl(std::string_view event_name) const {
-        if (event_name == "onClick" || event_name == "clicked") return "LV_EVENT_CLICKED";
-        if (event_name == "onPressed" || event_name == "pressed") return "LV_EVENT_PRESSED";
-        if (event_name == "onReleased" || event_name == "released") return "LV_EVENT_RELEASED";
-        if (event_name == "onValueChanged" || event_name == "value_changed") return "LV_EVENT_VALUE_CHANGED";
-        if (event_name == "onFocused" || event_name == "focused") return "LV_EVENT_FOCUSED";
-        if (event_name == "onDefocused" || event_name == "defocused") return "LV_EVENT_DEFOCUSED";
-        return "LV_EVENT_CLICKED";  // Default
+        const char* code = widgets::lvgl_event(event_name);
+        return code ? code : "LV_EVENT_CLICKED";  // Default
     }
     
     // Generate callback function for when blocks
@@ -412,23 +423,13 @@ private:
     
     // Map easing names to LVGL animation paths
     constexpr const char* map_easing_to_lvgl(std::string_view easing) const {
-        if (easing.empty() || easing == "linear") return "lv_anim_path_linear";
-        if (easing == "ease_in") return "lv_anim_path_ease_in";
-        if (easing == "ease_out") return "lv_anim_path_ease_out";
-        if (easing == "ease_in_out") return "lv_anim_path_ease_in_out";
-        if (easing == "overshoot") return "lv_anim_path_overshoot";
-        if (easing == "bounce") return "lv_anim_path_bounce";
-        return "lv_anim_path_linear";  // Default
+        const char* path = widgets::lvgl_easing(easing);
+        return path ? path : "lv_anim_path_linear";  // Default, also for no easing
     }
     
     // Map property names to LVGL animation setter callbacks
     constexpr const char* map_property_to_anim_setter(std::string_view prop_name) const {
-        if (prop_name == "x") return "lv_obj_set_x";
-        if (prop_name == "y") return "lv_obj_set_y";
-        if (prop_name == "width") return "lv_obj_set_width";
-        if (prop_name == "height") return "lv_obj_set_height";
-        if (prop_name == "opacity") return "lv_obj_set_style_opa";
-        return nullptr;
+        return widgets::lvgl_anim_setter(prop_name);
     }
     
     // Generate animation initialization
@@ -542,7 +543,8 @@ private:
         append(");\n");
     }
     
-    constexpr void generate_instance_recursive(const InstanceNode& instances,
+    template <typename Instances>
+    constexpr void generate_instance_recursive(const Instances& instances,
                                                size_t inst_idx,
                                                size_t parent_idx = 0) {
         const auto& inst = instances.get(inst_idx);
@@ -552,6 +554,15 @@ private:
         
         // Set properties
         for (size_t i = 0; i < inst.prop_count; ++i) {
+            if (&inst.properties[i].value == find_font_asset(inst)) {
+                for (size_t j = 0; j < indent_level; ++j) append("    ");
+                append("lv_obj_set_style_text_font(");
+                generate_variable_name_only(inst.type_name, inst_idx);
+                append(", &");
+                generate_font_symbol_name(inst.properties[i].value, inst);
+                append(", 0);\n");
+                continue;
+            }
             generate_property_setter(inst.properties[i], inst_idx, inst.type_name);
         }
         
@@ -576,7 +587,8 @@ private:
     }
     
     // Generate all callback functions (must be called before main function)
-    constexpr void generate_all_callbacks(const InstanceNode& instances, size_t inst_idx = 0) {
+    template <typename Instances>
+    constexpr void generate_all_callbacks(const Instances& instances, size_t inst_idx = 0) {
         if (inst_idx >= instances.count) return;
         
         const auto& inst = instances.get(inst_idx);
@@ -597,8 +609,10 @@ private:
     }
 
 public:
-    constexpr LVGLRenderer() = default;
+    constexpr BasicLVGLRenderer() = default;
     
+    constexpr explicit BasicLVGLRenderer(Sink output)
+        : sink(std::move(output)) {}
     
     constexpr void set_platform(Platform platform) {
         target_platform = platform;
@@ -606,7 +620,7 @@ public:
     
     // Generate C99 code for the entire document
     constexpr void generate(const auto& document) {
-        output_pos = 0;
+        sink.clear();
         indent_level = 0;
         callback_count = 0;
         
@@ -691,14 +705,14 @@ public:
         // Generate instances
         if (document.instances.count > 0) {
             // Find root instances (those that are not children of any other instance)
-            bool is_child[64] = {}; // Track which instances are children
+            std::vector<bool> is_child(document.instances.count, false); // Track which instances are children
             
             for (size_t i = 0; i < document.instances.count; ++i) {
                 const auto& inst = document.instances.get(i);
                 // Mark all children of this instance
                 for (size_t j = 0; j < inst.child_count; ++j) {
                     size_t child_idx = inst.child_indices[j];
-                    if (child_idx < 64) {
+                    if (child_idx < is_child.size()) {
                         is_child[child_idx] = true;
                     }
                 }
@@ -762,21 +776,50 @@ public:
         indent_level--;
         append_line("}");
         append_line();
-        
-        // Null-terminate
-        if (output_pos < MaxOutput) {
-            output_buffer[output_pos] = '\0';
-        }
     }
     
+    // True when the sink could not take all generated code (fixed buffer
+    // full or stream write failure); the output is then incomplete
+    constexpr bool overflowed() const {
+        return sink.overflowed();
+    }
+    
+    constexpr size_t output_size() const {
+        return sink.size();
+    }
     
-    constexpr std::string_view get_output() const {
-        return std::string_view(output_buffer.data(), output_pos);
+    constexpr const Sink& output_sink() const {
+        return sink;
     }
     
-    constexpr const char* c_str() const {
-        return output_buffer.data();
+    constexpr Sink& output_sink() {
+        return sink;
+    }
+    
+    constexpr std::string_view get_output() const
+        requires requires(const Sink& s) { s.view(); } {
+        return sink.view();
+    }
+    
+    constexpr const char* c_str() const
+        requires requires(const Sink& s) { s.c_str(); } {
+        return sink.c_str();
     }
 };
 
+template <size_t MaxOutput = 16384>
+using LVGLRenderer = BasicLVGLRenderer<forma::io::FixedBufferSink<MaxOutput>>;
+
+// Generate code for `document` straight into `stream`. Returns false if the
+// stream rejected a write; `bytes_written` receives the generated size.
+template <typename DocType>
+inline bool render_to_stream(const DocType& document, forma::io::IWriteStream& stream,
+                             size_t& bytes_written) {
+    BasicLVGLRenderer<forma::io::WriteStreamSink> renderer{forma::io::WriteStreamSink(stream)};
+    renderer.generate(document);
+    renderer.output_sink().flush();
+    bytes_written = renderer.output_size();
+    return !renderer.overflowed();
+}
+
 } // namespace forma::lvgl
@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <core/fs/i_file_system.hpp>
 #include <cstring>
 
 namespace forma::lvgl {
@@ -22,23 +23,21 @@ bool lvgl_builtin_render(const void* doc_ptr, const char* input_path, const char
         // Cast the document pointer
         const auto* doc = static_cast<const forma::Document<32,16,16,32,64,64>*>(doc_ptr);
         
-        // Create renderer
-        forma::lvgl::LVGLRenderer<65536> renderer;
-        
-        // Generate code
-        renderer.generate(*doc);
-        
-        // Write output file
-        std::ofstream out(output_path);
+        // Stream generated code to the output file
+        forma::fs::RealFileSystem realfs;
+        auto out = realfs.open_write_stream(output_path);
         if (!out) {
             std::cerr << "[LVGL Renderer] Error: cannot write to " << output_path << "\n";
             return false;
         }
         
-        out << renderer.get_output();
-        out.close();
+        size_t bytes = 0;
+        if (!forma::lvgl::render_to_stream(*doc, *out, bytes)) {
+            std::cerr << "[LVGL Renderer] Error: output truncated while writing " << output_path << "\n";
+            return false;
+        }
         
-        std::cout << "[LVGL Renderer] Generated " << renderer.get_output().size() 
+        std::cout << "[LVGL Renderer] Generated " << bytes 
                   << " bytes to " << output_path << "\n";
         
         return true;
@@ -6,6 +6,8 @@
 #include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <core/fs/i_file_system.hpp>
+#include <core/host_context.hpp>
 
 // Plugin metadata - computed from forma.toml (single source of truth)
 static const uint64_t METADATA_HASH = FORMA_PLUGIN_TOML_HASH("LVGL Renderer", ../forma.toml);
@@ -31,23 +33,21 @@ bool forma_render(const void* doc_ptr, const char* input_path, const char* outpu
         // Cast the document pointer
         const auto* doc = static_cast<const forma::Document<32,16,16,32,64,64>*>(doc_ptr);
         
-        // Create renderer
-        forma::lvgl::LVGLRenderer<65536> renderer;
-        
-        // Generate code
-        renderer.generate(*doc);
-        
-        // Write output file
-        std::ofstream out(output_path);
+        // Stream generated code to the output file
+        forma::fs::RealFileSystem realfs;
+        auto out = realfs.open_write_stream(output_path);
         if (!out) {
             std::cerr << "[LVGL Renderer] Error: cannot write to " << output_path << "\n";
             return false;
         }
         
-        out << renderer.get_output();
-        out.close();
+        size_t bytes = 0;
+        if (!forma::lvgl::render_to_stream(*doc, *out, bytes)) {
+            std::cerr << "[LVGL Renderer] Error: output truncated while writing " << output_path << "\n";
+            return false;
+        }
         
-        std::cout << "[LVGL Renderer] Generated " << renderer.get_output().size() 
+        std::cout << "[LVGL Renderer] Generated " << bytes 
                   << " bytes to " << output_path << "\n";
         
         return true;
@@ -64,17 +64,21 @@ bool forma_render_host(void* host_ptr, const void* doc_ptr, const char* input_pa
     if (!doc_ptr || !output_path) return false;
     try {
         const auto* doc = static_cast<const forma::Document<32,16,16,32,64,64>*>(doc_ptr);
-        forma::lvgl::LVGLRenderer<65536> renderer;
-        renderer.generate(*doc);
-        auto out_str = renderer.get_output();
-        if (host && host->stream_io.open_write(output_path, out_str)) {
-            std::cout << "[LVGL Renderer] Generated " << out_str.size() << " bytes to " << output_path << "\n";
-            return true;
+        forma::io::WriteStreamPtr out;
+        if (host && host->stream_io.open_write_stream) {
+            out = host->stream_io.open_write_stream(output_path);
+        }
+        if (!out) {
+            forma::fs::RealFileSystem realfs;
+            out = realfs.open_write_stream(output_path);
         }
-        std::ofstream out(output_path);
         if (!out) return false;
-        out << out_str;
-        out.close();
+        size_t bytes = 0;
+        if (!forma::lvgl::render_to_stream(*doc, *out, bytes)) {
+            std::cerr << "[LVGL Renderer] Error: output truncated while writing " << output_path << "\n";
+            return false;
+        }
+        std::cout << "[LVGL Renderer] Generated " << bytes << " bytes to " << output_path << "\n";
         return true;
     } catch (...) { return false; }
 }
@@ -1,5 +1,6 @@
 #include <bugspray/bugspray.hpp>
 #include "../src/lvgl_renderer.hpp"
+#include <string>
 
 using namespace forma;
 using namespace forma::lvgl;
@@ -259,3 +260,89 @@ TEST_CASE("LVGL - Animations")
         CHECK(output.find("lv_anim_start") != std::string_view::npos);
     }
 }
+
+TEST_CASE("LVGL - Fonts")
+{
+    SECTION("Font assets select the bitmap font for their size")
+    {
+        auto doc = parse_document_runtime(R"(
+Label {
+    text: "Title"
+    font: "forma://fonts/roboto.ttf"
+    font_size: 24
+}
+Label {
+    text: "Body"
+    font: "forma://fonts/roboto.ttf"
+}
+Label {
+    text: "Caption"
+    font: "forma://fonts/roboto.ttf"
+    font_size: 24
+}
+)");
+        auto bundler = collect_assets(doc);
+        doc.assets.push_back(bundler.assets[0]);
+        doc.asset_count = bundler.asset_count;
+
+        BasicLVGLRenderer<forma::io::ChunkedBufferSink> renderer;
+        renderer.generate(doc);
+        auto output = renderer.output_sink().str();
+
+        CHECK(output.find("extern const lv_font_t asset_fonts_roboto_ttf_24;") != std::string::npos);
+        CHECK(output.find("extern const lv_font_t asset_fonts_roboto_ttf_16;") != std::string::npos);
+        CHECK(output.find("asset_fonts_roboto_ttf_24;", output.find("ttf_24;") + 1) == std::string::npos);
+        CHECK(output.find("lv_obj_set_style_text_font(label_0, &asset_fonts_roboto_ttf_24, 0);") != std::string::npos);
+        CHECK(output.find("lv_obj_set_style_text_font(label_1, &asset_fonts_roboto_ttf_16, 0);") != std::string::npos);
+        CHECK(output.find("font_size") == std::string::npos);
+    }
+}
+
+TEST_CASE("LVGL - Output Sinks")
+{
+    std::string source;
+    for (int i = 0; i < 100; ++i) {
+        source += "Label {\n    text: \"Row " + std::to_string(i) + "\"\n}\n";
+    }
+    auto doc = parse_document_runtime(source);
+    
+    SECTION("Fixed buffer reports overflow")
+    {
+        LVGLRenderer<1024> renderer;
+        renderer.generate(doc);
+        
+        CHECK(renderer.overflowed());
+        CHECK(renderer.get_output().size() == 1023ul);
+    }
+    
+    SECTION("Chunked buffer keeps every instance")
+    {
+        BasicLVGLRenderer<forma::io::ChunkedBufferSink> renderer;
+        renderer.generate(doc);
+        auto output = renderer.output_sink().str();
+        
+        CHECK(!renderer.overflowed());
+        CHECK(output.size() == renderer.output_size());
+        CHECK(output.find("label_99") != std::string::npos);
+        CHECK(output.find("\"Row 99\"") != std::string::npos);
+    }
+    
+    SECTION("Stream sink matches buffered output")
+    {
+        struct StringStream : forma::io::IWriteStream {
+            std::string data;
+            size_t write(const void* p, size_t len) override {
+                data.append(static_cast<const char*>(p), len);
+                return len;
+            }
+        } stream;
+        
+        size_t bytes = 0;
+        REQUIRE(render_to_stream(doc, stream, bytes));
+        
+        BasicLVGLRenderer<forma::io::ChunkedBufferSink> buffered;
+        buffered.generate(doc);
+        CHECK(bytes == stream.data.size());
+        CHECK(stream.data == buffered.output_sink().str());
+    }
+}
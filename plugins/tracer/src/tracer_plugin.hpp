@@ -27,10 +27,11 @@ private:
     int indent = 0;
     bool in_stage = false;
     std::string current_stage;
+    std::ostream* out = &std::cout;
     
     void print_indent() const {
         for (int i = 0; i < indent; ++i) {
-            std::cout << "  ";
+            *out << "  ";
         }
     }
 
@@ -44,6 +45,15 @@ public:
         return level;
     }
 
+    // Redirect output, e.g. to a per-job buffer that is flushed in order
+    void set_output(std::ostream& stream) {
+        out = &stream;
+    }
+
+    std::ostream& output() const {
+        return *out;
+    }
+
     // Stage tracking
     void begin_stage(std::string_view stage_name) {
         if (level == TraceLevel::Silent) return;
@@ -52,7 +62,7 @@ public:
         in_stage = true;
         
         print_indent();
-        std::cout << "▶ " << stage_name << "\n";
+        *out << "▶ " << stage_name << "\n";
         indent++;
     }
 
@@ -62,7 +72,7 @@ public:
         
         indent--;
         print_indent();
-        std::cout << "✓ " << current_stage << " complete\n";
+        *out << "✓ " << current_stage << " complete\n";
         
         in_stage = false;
         current_stage.clear();
@@ -73,59 +83,59 @@ public:
         if (level == TraceLevel::Silent) return;
         
         print_indent();
-        std::cout << message << "\n";
+        *out << message << "\n";
     }
 
     void verbose(std::string_view message) {
         if (level < TraceLevel::Verbose) return;
         
         print_indent();
-        std::cout << message << "\n";
+        *out << message << "\n";
     }
 
     void debug(std::string_view message) {
         if (level < TraceLevel::Debug) return;
         
         print_indent();
-        std::cout << "  [DEBUG] " << message << "\n";
+        *out << "  [DEBUG] " << message << "\n";
     }
 
     void error(std::string_view message) {
         // Always show errors
         print_indent();
-        std::cout << "  ✗ ERROR: " << message << "\n";
+        *out << "  ✗ ERROR: " << message << "\n";
     }
 
     void warning(std::string_view message) {
         if (level == TraceLevel::Silent) return;
         
         print_indent();
-        std::cout << "  ⚠ WARNING: " << message << "\n";
+        *out << "  ⚠ WARNING: " << message << "\n";
     }
 
     void stat(std::string_view key, std::string_view value) {
         if (level < TraceLevel::Verbose) return;
         
         print_indent();
-        std::cout << "  " << key << ": " << value << "\n";
+        *out << "  " << key << ": " << value << "\n";
     }
 
     void stat(std::string_view key, int value) {
         if (level < TraceLevel::Verbose) return;
         
         print_indent();
-        std::cout << "  " << key << ": " << value << "\n";
+        *out << "  " << key << ": " << value << "\n";
     }
 
     void success(std::string_view message) {
         if (level == TraceLevel::Silent) return;
         
-        std::cout << "\n✓ " << message << "\n";
+        *out << "\n✓ " << message << "\n";
     }
 
     void failure(std::string_view message) {
         // Always show failures
-        std::cout << "\n✗ " << message << "\n";
+        *out << "\n✗ " << message << "\n";
     }
 };
 
@@ -3,12 +3,18 @@
 #include "../core/toml_io.hpp"
 #include "../plugin_loader.hpp"
 #include "../core/pipeline.hpp"
+#include "../core/build_cache.hpp"
+#include "../core/thread_pool.hpp"
 #include "../parser/ir.hpp"
 #include "../../plugins/tracer/src/tracer_plugin.hpp"
+#include <algorithm>
+#include <charconv>
+#include <set>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <mutex>
 #include <vector>
 
 namespace forma::commands {
@@ -19,6 +25,7 @@ struct BuildOptions {
     bool verbose = false;
     bool flash = false;   // Flash after build (for embedded targets)
     bool monitor = false; // Start monitor after flash
+    size_t jobs = 0;      // Parallel compile jobs (0 = [build] jobs, else all cores)
 };
 
 // Read project configuration and find source files
@@ -26,6 +33,9 @@ struct ProjectConfig {
     std::string build_system;  // cmake, esp-idf, meson, etc.
     std::string target;
     std::string renderer;
+    size_t jobs = 0;  // [build] jobs; 0 when unset
+    forma::AssetBundleOptions assets;  // [assets] mode / chunk_size / image_format / rle
+    forma::FontAtlasOptions fonts;     // [assets] font_sizes / font_bpp
     std::vector<std::string> source_files;
     std::vector<std::string> plugins;
 };
@@ -66,8 +76,64 @@ ProjectConfig read_project_config(const std::string& project_dir, forma::tracer:
         if (auto val = build_table->get_string("renderer")) {
             config.renderer = std::string(*val);
         }
+        if (auto val = build_table->get_int("jobs"); val && *val > 0) {
+            config.jobs = static_cast<size_t>(*val);
+        }
     }
     
+    // Get [assets] table
+    if (auto* assets_table = doc.get_table("assets")) {
+        if (auto val = assets_table->get_string("mode")) {
+            if (auto mode = forma::parse_asset_embed_mode(*val)) {
+                config.assets.mode = *mode;
+            } else {
+                tracer.warning(std::string("Unknown [assets] mode '") + std::string(*val) + "', using \"array\"");
+            }
+        }
+        if (auto val = assets_table->get_int("chunk_size"); val && *val > 0) {
+            config.assets.chunk_size = static_cast<size_t>(*val);
+        }
+        if (auto val = assets_table->get_string("image_format")) {
+            if (auto format = forma::image::parse_image_format(*val)) {
+                config.assets.image_format = *format;
+            } else {
+                tracer.warning(std::string("Unknown [assets] image_format '") + std::string(*val) + "', using \"raw\"");
+            }
+        }
+        if (auto val = assets_table->get_bool("rle")) {
+            config.assets.rle = *val;
+        }
+        if (const auto* sizes = assets_table->get_array("font_sizes")) {
+            // Numbers, or strings holding numbers
+            for (const auto& element : *sizes) {
+                int64_t size = element.int_value;
+                bool valid = element.type == forma::toml::ValueType::Integer;
+                if (element.type == forma::toml::ValueType::String) {
+                    auto text = element.string_value;
+                    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), size);
+                    valid = ec == std::errc{} && end == text.data() + text.size();
+                }
+                if (valid && size > 0 && size <= 255) {
+                    config.fonts.sizes.push_back(static_cast<int>(size));
+                } else {
+                    tracer.warning("Ignoring an [assets] font_sizes entry that is not a size from 1 to 255");
+                }
+            }
+        }
+        if (auto val = assets_table->get_int("font_bpp")) {
+            if (*val == 1 || *val == 2 || *val == 4 || *val == 8) {
+                config.fonts.bpp = static_cast<int>(*val);
+            } else {
+                tracer.warning("[assets] font_bpp must be 1, 2, 4 or 8, using 4");
+            }
+        }
+    }
+    config.assets.output_prefix = project_dir + "/src/forma_assets";
+    config.assets.stamp_path = project_dir + "/.forma/asset-bundle";
+    config.fonts.output_prefix = project_dir + "/src/forma_font";
+    config.fonts.cache_dir = project_dir + "/.forma/font-cache";
+    config.fonts.manifest_path = project_dir + "/.forma/fonts";
+    
     // Find all .fml files in src/ directory using IFileSystem
     std::string src_root = project_dir + "/src";
     auto all_files = fs.list_recursive(src_root);
@@ -80,6 +146,85 @@ ProjectConfig read_project_config(const std::string& project_dir, forma::tracer:
     return config;
 }
 
+// Identifies the renderer build for cache keys. Dynamic plugins embed a hash
+// of their plugin.toml; builtin ones fall back to hashing their metadata.
+inline uint64_t renderer_metadata_hash(const forma::LoadedPlugin& plugin) {
+    // Known without opening the library; equals what the library reports
+    // once it is opened and verified
+    if (plugin.metadata_hash) {
+        return plugin.metadata_hash;
+    }
+    if (plugin.functions.get_metadata_hash) {
+        return plugin.functions.get_metadata_hash();
+    }
+    uint64_t hash = forma::fnv1a_hash(plugin.path);
+    if (plugin.metadata) {
+        hash = forma::fnv1a_hash_append(hash, plugin.metadata->name);
+        hash = forma::fnv1a_hash_append(hash, plugin.metadata->api_version);
+        hash = forma::fnv1a_hash_append(hash, plugin.metadata->output_extension);
+    }
+    return hash;
+}
+
+// One source file's trip through parse -> analysis -> render. Jobs run on
+// pool threads, so each gets its own tracer writing into `log`; the logs
+// are printed afterwards in source order. Parsing and analysis run in
+// parallel, but the renderer is called under `render_mutex` so one
+// adapter shared by every job is never entered from two threads.
+struct CompileJob {
+    std::string source_file;
+    std::string source;
+    uint64_t key = 0;
+    std::string output_path;
+    bool ok = false;
+    forma::BuildCacheEntry cache_entry;
+    std::string log;
+};
+
+inline void compile_source(CompileJob& job, const forma::RendererAdapter& renderer_adapter,
+                           std::mutex& render_mutex, forma::fs::IFileSystem& fs,
+                           forma::tracer::TraceLevel level, size_t import_threads) {
+    std::ostringstream log;
+    forma::tracer::TracerPlugin tracer;
+    tracer.set_level(level);
+    tracer.set_output(log);
+
+    tracer.verbose(std::string("Compiling: ") + job.source_file);
+
+    // Parse
+    auto doc = forma::parse_document(job.source);
+
+    // Run pipeline
+    auto imports = forma::pipeline::resolve_imports(doc, job.source_file, tracer, import_threads);
+    if (imports.missing().empty() && forma::pipeline::run_semantic_analysis(doc, tracer) == 0) {
+        forma::pipeline::collect_assets(doc, tracer);
+
+        // Call adapter (it will use IFileSystem to write output back)
+        {
+            std::lock_guard lock(render_mutex);
+            job.ok = renderer_adapter(&doc, job.source_file, job.output_path, fs);
+        }
+        if (!job.ok) {
+            tracer.error(std::string("Code generation failed for: ") + job.source_file);
+        }
+    }
+
+    if (job.ok) {
+        job.cache_entry = forma::BuildCacheEntry{job.key, job.output_path, {}, {}, {}, {}};
+        for (const auto& module : imports.loaded()) {
+            job.cache_entry.deps.emplace_back(module.canonical_path, module.content_hash);
+        }
+        for (size_t i = 0; i < doc.asset_count; ++i) {
+            job.cache_entry.assets.emplace_back(doc.assets[i].uri);
+        }
+        forma::FontUsage usage;
+        forma::scan_font_usage(doc, usage);
+        job.cache_entry.glyphs = forma::encode_utf8(usage.code_points);
+        job.cache_entry.fonts.assign(usage.fonts.begin(), usage.fonts.end());
+    }
+    job.log = log.str();
+}
+
 int run_build_command(const BuildOptions& opts) {
     auto& tracer = forma::tracer::get_tracer();
     
@@ -120,6 +265,8 @@ int run_build_command(const BuildOptions& opts) {
         tracer.begin_stage("Generating code");
         
         forma::PluginLoader plugin_loader_impl;
+        plugin_loader_impl.use_registry_cache();
+        plugin_loader_impl.set_lazy_loading(true);
         forma::IPluginLoader& plugin_loader = plugin_loader_impl;
 
         // Load renderer plugin
@@ -129,51 +276,131 @@ int run_build_command(const BuildOptions& opts) {
             return 1;
         }
 
-        // Compile each source file
-        for (const auto& source_file : config.source_files) {
-            tracer.verbose(std::string("Compiling: ") + source_file);
+        auto plugin = plugin_loader.find_plugin(config.renderer);
+        std::string out_ext = plugin->metadata->output_extension;
 
+        // Sources whose text, imports and renderer are unchanged since the
+        // last successful build keep their previous output
+        forma::BuildCache cache(realfs, project_dir + "/.forma/build-cache");
+        cache.load();
+        uint64_t toolchain = forma::BuildCache::toolchain_hash(config.renderer, renderer_metadata_hash(*plugin));
+        size_t up_to_date = 0;
+
+        // Cache lookups stay on this thread; only stale sources become jobs
+        std::vector<CompileJob> jobs;
+        for (const auto& source_file : config.source_files) {
             // Read source using realfs for now
             std::string source = realfs.read_file(source_file);
 
-            // Parse
-            auto doc = forma::parse_document(source);
-
-            // Run pipeline
-            forma::pipeline::resolve_imports(doc, source_file, tracer);
-            if (forma::pipeline::run_semantic_analysis(doc, tracer) != 0) {
-                return 1;
+            uint64_t key = forma::BuildCache::source_key(source, toolchain);
+            if (cache.is_fresh(source_file, key)) {
+                tracer.verbose(std::string("Up to date: ") + source_file);
+                ++up_to_date;
+                continue;
             }
-            forma::pipeline::collect_assets(doc, tracer);
+            cache.erase(source_file);
 
-            // Get renderer adapter
-            auto renderer_adapter = plugin_loader.get_renderer_adapter(config.renderer);
+            CompileJob job;
+            job.source_file = source_file;
+            job.source = std::move(source);
+            job.key = key;
+            job.output_path = std::filesystem::path(source_file).replace_extension(out_ext).string();
+            jobs.push_back(std::move(job));
+        }
+
+        // The renderer library is only opened when something needs rendering
+        forma::RendererAdapter renderer_adapter;
+        if (!jobs.empty()) {
+            renderer_adapter = plugin_loader.get_renderer_adapter(config.renderer);
             if (!renderer_adapter) {
-                tracer.error("Renderer plugin does not provide render adapter");
+                if (!plugin->load_error.empty()) {
+                    tracer.error(std::string("Failed to load renderer plugin: ") + plugin->load_error);
+                } else {
+                    tracer.error("Renderer plugin does not provide render adapter");
+                }
                 return 1;
             }
+        }
 
-            // Generate output path (use metadata)
-            auto plugin = plugin_loader.find_plugin(config.renderer);
-            std::string out_ext = plugin->metadata->output_extension;
-            std::string output_path = std::filesystem::path(source_file).replace_extension(out_ext).string();
+        size_t job_count = opts.jobs ? opts.jobs : config.jobs ? config.jobs : forma::ThreadPool::default_thread_count();
+        job_count = std::min(job_count, jobs.size());
+        tracer.verbose(std::string("Compile jobs: ") + std::to_string(job_count));
 
-            // Call adapter (it will use IFileSystem to write output back)
-            if (!renderer_adapter(&doc, source_file, output_path, realfs)) {
-                tracer.error(std::string("Code generation failed for: ") + source_file);
-                return 1;
+        std::mutex render_mutex;
+        if (job_count <= 1) {
+            for (auto& job : jobs) {
+                compile_source(job, renderer_adapter, render_mutex, realfs, tracer.get_level(),
+                               forma::ThreadPool::default_thread_count());
+            }
+        } else {
+            forma::ThreadPool pool(job_count);
+            for (auto& job : jobs) {
+                pool.submit([&job, &renderer_adapter, &render_mutex, &realfs, level = tracer.get_level()] {
+                    // Files are the unit of parallelism; imports load serially
+                    compile_source(job, renderer_adapter, render_mutex, realfs, level, 1);
+                });
+            }
+            pool.wait();
+        }
+
+        // Report in source order so output is identical for any job count
+        bool failed = false;
+        for (auto& job : jobs) {
+            tracer.output() << job.log;
+            if (!job.ok) {
+                failed = true;
+                continue;
             }
+            cache.record(job.source_file, std::move(job.cache_entry));
+            tracer.info(std::string("✓ Generated: ") + job.output_path);
+        }
 
-            tracer.info(std::string("✓ Generated: ") + output_path);
+        if (failed) {
+            cache.save();
+            return 1;
         }
+
+        cache.save();
+        tracer.stat("Up to date", static_cast<int>(up_to_date));
         
         tracer.end_stage();
+
+        // Assets and glyphs used by any source, including up-to-date ones
+        std::vector<std::string> asset_uris;
+        forma::FontUsage font_usage;
+        for (const auto& source_file : config.source_files) {
+            if (const auto* entry = cache.find(source_file)) {
+                for (const auto& uri : entry->assets) {
+                    if (std::find(asset_uris.begin(), asset_uris.end(), uri) == asset_uris.end()) {
+                        asset_uris.push_back(uri);
+                    }
+                }
+                forma::append_code_points(entry->glyphs, font_usage.code_points);
+                font_usage.fonts.insert(entry->fonts.begin(), entry->fonts.end());
+            }
+        }
+
+        // Rasterized fonts replace the font file in the bundle
+        std::vector<std::string> font_uris;
+        for (const auto& uri : asset_uris) {
+            if (forma::AssetBundler<1>{}.get_asset_type(uri) == forma::AssetDecl::Type::Font) {
+                font_uris.push_back(uri);
+            }
+        }
+        auto rasterized = forma::pipeline::build_fonts(font_uris, font_usage, project_dir, config.fonts, realfs, tracer);
+        std::set<std::string> replaced(rasterized.begin(), rasterized.end());
+        std::erase_if(asset_uris, [&](const std::string& uri) { return replaced.count(uri) > 0; });
+        if (!forma::pipeline::bundle_assets(asset_uris, project_dir, config.assets, realfs, tracer)) {
+            return 1;
+        }
     }
     
     // Step 2: Invoke build system plugin
     tracer.begin_stage("Building project");
     
     forma::PluginLoader build_plugin_loader_impl;
+    build_plugin_loader_impl.use_registry_cache();
+    build_plugin_loader_impl.set_lazy_loading(true);
     forma::IPluginLoader& build_plugin_loader = build_plugin_loader_impl;
 
     // Load build system plugin
@@ -188,6 +415,11 @@ int run_build_command(const BuildOptions& opts) {
     // Get build adapter
     auto build_adapter = build_plugin_loader.get_build_adapter(config.build_system);
     if (!build_adapter) {
+        auto* build_plugin = build_plugin_loader.find_plugin(config.build_system);
+        if (build_plugin && !build_plugin->load_error.empty()) {
+            tracer.error(std::string("Failed to load build plugin '") + config.build_system + "': " + build_plugin->load_error);
+            return 1;
+        }
         tracer.error("Build plugin does not provide build adapter");
         tracer.info("Build plugins must export a 'forma_build' function or adapter");
         return 1;
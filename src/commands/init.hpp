@@ -165,7 +165,7 @@ bool write_project_files(const InitOptions& opts, forma::fs::IFileSystem& fsys)
         }
 
         // Write .gitignore
-        std::string gitignore = "build/\n*.o\n*.so\n*.a\n" + opts.project_name + "\n.vscode/\n.DS_Store\n";
+        std::string gitignore = "build/\n.forma/\n*.o\n*.so\n*.a\n" + opts.project_name + "\n.vscode/\n.DS_Store\n";
         fsys.write_file(opts.project_dir + "/.gitignore", gitignore);
 
         if (opts.verbose) {
@@ -0,0 +1,689 @@
+#pragma once
+
+#include "assets.hpp"
+#include "fs/i_file_system.hpp"
+#include "image_convert.hpp"
+#include "thread_pool.hpp"
+#include "../plugin_hash.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace forma {
+
+// ============================================================================
+// Asset Bundle - Writes forma:// assets into generated C sources
+// ============================================================================
+
+// Read-only mapping of a whole file. Asset bytes are hashed and encoded
+// straight from the mapping, so large fonts and images are never copied
+// into memory owned by the build.
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            size = static_cast<size_t>(st.st_size);
+            valid = true;
+            if (size > 0) {
+                void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped == MAP_FAILED) {
+                    valid = false;
+                    size = 0;
+                } else {
+                    data = static_cast<const unsigned char*>(mapped);
+                    madvise(mapped, size, MADV_SEQUENTIAL);
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (data) {
+            munmap(const_cast<unsigned char*>(data), size);
+        }
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+        : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)),
+          valid(std::exchange(other.valid, false)) {}
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(valid, other.valid);
+        return *this;
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok() const { return valid; }
+    std::span<const unsigned char> bytes() const { return {data, size}; }
+
+private:
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    bool valid = false;
+};
+
+// How asset bytes end up in the generated sources
+enum class AssetEmbedMode {
+    Array,   // Hex-encoded C arrays (any C compiler)
+    Incbin,  // GNU assembler .incbin (GCC/Clang, ELF targets)
+    Embed    // C23 #embed
+};
+
+constexpr std::optional<AssetEmbedMode> parse_asset_embed_mode(std::string_view name) {
+    if (name == "array") return AssetEmbedMode::Array;
+    if (name == "incbin") return AssetEmbedMode::Incbin;
+    if (name == "embed") return AssetEmbedMode::Embed;
+    return std::nullopt;
+}
+
+struct AssetBundleOptions {
+    AssetEmbedMode mode = AssetEmbedMode::Array;
+    // Asset bytes per generated translation unit; larger assets get a unit
+    // of their own. Keeps each generated file quick to compile.
+    size_t chunk_size = 1024 * 1024;
+    // Files are written as <output_prefix>_<n>.c
+    std::string output_prefix;
+    // Records what was last written; when it matches, nothing is rewritten
+    // so the generated sources keep their timestamps. Empty disables it.
+    std::string stamp_path;
+    // PNG/BMP images are decoded and stored in this LVGL color format
+    image::ImageFormat image_format = image::ImageFormat::Raw;
+    // RLE-compress converted images (LVGL decompresses them on load)
+    bool rle = false;
+};
+
+struct BundledAsset {
+    std::string uri;
+    std::string path;     // File on disk
+    std::string symbol;   // asset_<path>, as referenced by renderers
+    size_t size = 0;
+    uint64_t hash = 0;    // Content hash
+    size_t canonical = 0; // First asset with identical contents (itself if unique)
+    size_t unit = 0;      // Translation unit the asset is defined in
+    // Images also define `const lv_image_dsc_t <symbol>_dsc`. When the
+    // image was converted, descriptor.data replaces the file bytes.
+    bool has_descriptor = false;
+    image::ConvertedImage descriptor;
+};
+
+struct AssetBundleResult {
+    std::vector<BundledAsset> assets;
+    std::vector<std::string> outputs;  // Generated sources, whether rewritten or not
+    std::vector<std::string> errors;
+    std::vector<std::string> warnings; // Images embedded unconverted
+    size_t unique_bytes = 0;           // Asset bytes after deduplication
+    size_t converted = 0;              // Images converted to a native color format
+    // False when the stamp matched. Images are then not decoded again:
+    // descriptors stay empty and `converted` is the stamp's count.
+    bool written = false;
+};
+
+namespace detail {
+
+// "0xNN," for every byte value, padded to 8 bytes so each byte is encoded
+// with one fixed-size copy (the 3 padding bytes are overwritten by the
+// next entry)
+inline constexpr auto HEX_BYTE_TABLE = [] {
+    constexpr char digits[] = "0123456789abcdef";
+    std::array<std::array<char, 8>, 256> table{};
+    for (size_t i = 0; i < 256; ++i) {
+        table[i] = {'0', 'x', digits[i >> 4], digits[i & 15], ',', 0, 0, 0};
+    }
+    return table;
+}();
+
+// Buffered writer over an IWriteStream, flushed in fixed-size blocks
+class ChunkedWriter {
+public:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    explicit ChunkedWriter(forma::io::IWriteStream& stream) : stream(stream) {}
+    ~ChunkedWriter() { flush(); }
+
+    ChunkedWriter(const ChunkedWriter&) = delete;
+    ChunkedWriter& operator=(const ChunkedWriter&) = delete;
+
+    void write(std::string_view text) {
+        while (!text.empty()) {
+            size_t n = std::min(text.size(), BLOCK_SIZE - used);
+            std::memcpy(buffer.data() + used, text.data(), n);
+            used += n;
+            text.remove_prefix(n);
+            if (used == BLOCK_SIZE) {
+                flush();
+            }
+        }
+    }
+
+    // Bytes as comma-separated hex literals, 16 per line
+    void write_hex(std::span<const unsigned char> bytes) {
+        constexpr size_t PER_LINE = 16;
+        constexpr size_t LINE_SIZE = PER_LINE * 5 + 1;
+        // Room for one full line plus the padding of its last entry
+        constexpr size_t RESERVE = LINE_SIZE + 3;
+
+        const unsigned char* p = bytes.data();
+        const unsigned char* end = p + bytes.size();
+        while (p < end) {
+            if (BLOCK_SIZE - used < RESERVE) {
+                flush();
+            }
+            size_t n = std::min(PER_LINE, static_cast<size_t>(end - p));
+            char* out = buffer.data() + used;
+            for (size_t i = 0; i < n; ++i) {
+                std::memcpy(out, HEX_BYTE_TABLE[p[i]].data(), 8);
+                out += 5;
+            }
+            *out++ = '\n';
+            used = static_cast<size_t>(out - buffer.data());
+            p += n;
+        }
+    }
+
+    void flush() {
+        if (used > 0) {
+            stream.write(buffer.data(), used);
+            used = 0;
+        }
+    }
+
+private:
+    forma::io::IWriteStream& stream;
+    std::array<char, BLOCK_SIZE + 8> buffer;
+    size_t used = 0;
+};
+
+// Content hash for deduplication and change detection. Reads eight bytes
+// at a time over four independent lanes, so it runs at memory speed on
+// multi-megabyte assets where byte-wise FNV-1a would dominate bundling.
+// Matches found through it are confirmed with memcmp.
+inline uint64_t content_hash(std::span<const unsigned char> bytes) {
+    constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ULL;
+    auto mix = [](uint64_t h, uint64_t v) {
+        h ^= v * PRIME;
+        h = (h << 31) | (h >> 33);
+        return h * 0xC2B2AE3D27D4EB4FULL;
+    };
+
+    std::array<uint64_t, 4> lanes = {PRIME, PRIME + 1, PRIME + 2, PRIME + 3};
+    const unsigned char* p = bytes.data();
+    size_t n = bytes.size();
+    for (; n >= 32; p += 32, n -= 32) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            uint64_t v;
+            std::memcpy(&v, p + lane * 8, 8);
+            lanes[lane] = mix(lanes[lane], v);
+        }
+    }
+    uint64_t h = bytes.size();
+    for (uint64_t lane : lanes) {
+        h = mix(h, lane);
+    }
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        h = mix(h, v);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p, n);
+    h = mix(h, tail);
+    return h ^ (h >> 29);
+}
+
+inline std::string asset_symbol(std::string_view uri) {
+    std::array<char, 256> name{};
+    AssetBundler<1>{}.generate_symbol_name(name.data(), name.size(), uri);
+    return std::string(name.data());
+}
+
+// Quote a path for a C string literal / assembler directive
+inline std::string quote_path(const std::string& path) {
+    std::string out = "\"";
+    for (char c : path) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+inline std::string unit_path(const std::string& prefix, size_t unit) {
+    return prefix + "_" + std::to_string(unit) + ".c";
+}
+
+inline void write_descriptor(ChunkedWriter& out, const BundledAsset& asset) {
+    const auto& image = asset.descriptor;
+    out.write("const lv_image_dsc_t " + asset.symbol + "_dsc = {\n");
+    out.write("    .header.magic = LV_IMAGE_HEADER_MAGIC,\n");
+    out.write(std::string("    .header.cf = ") + image::color_format_name(image.cf) + ",\n");
+    out.write(image.flags & image::IMAGE_FLAG_COMPRESSED ? "    .header.flags = LV_IMAGE_FLAGS_COMPRESSED,\n"
+                                                         : "    .header.flags = 0,\n");
+    out.write("    .header.w = " + std::to_string(image.width) + ",\n");
+    out.write("    .header.h = " + std::to_string(image.height) + ",\n");
+    out.write("    .header.stride = " + std::to_string(image.stride) + ",\n");
+    out.write("    .data_size = " + std::to_string(asset.size) + ",\n");
+    out.write("    .data = " + asset.symbol + ",\n};\n");
+}
+
+// `contents[i]` holds the bytes of asset i: the mapped file, or the
+// converted image
+inline void write_unit(ChunkedWriter& out, const std::vector<BundledAsset>& assets,
+                       const std::vector<std::span<const unsigned char>>& contents, size_t unit,
+                       AssetEmbedMode default_mode) {
+    out.write("/* Generated by forma: bundled assets. Do not edit. */\n\n");
+    for (const auto& asset : assets) {
+        if (asset.unit == unit && asset.has_descriptor) {
+            out.write("#include \"lvgl.h\"\n\n");
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < assets.size(); ++i) {
+        const auto& asset = assets[i];
+        if (asset.unit != unit || asset.canonical != i) {
+            continue;
+        }
+        // Converted pixels exist only in memory, so they are always encoded
+        bool converted = !asset.descriptor.data.empty();
+        AssetEmbedMode mode = converted ? AssetEmbedMode::Array : default_mode;
+        std::string size = std::to_string(asset.size);
+        // C has no zero-length arrays; an empty asset keeps one byte
+        std::string array_size = asset.size ? size : "1";
+
+        // Assets with the same contents share the bytes: extra labels for
+        // .incbin, aliases for C definitions
+        std::vector<const BundledAsset*> aliases;
+        for (size_t j = i + 1; j < assets.size(); ++j) {
+            if (assets[j].canonical == i) {
+                aliases.push_back(&assets[j]);
+            }
+        }
+
+        if (converted) {
+            out.write("/* " + asset.uri + " (" + std::to_string(asset.descriptor.width) + "x" +
+                      std::to_string(asset.descriptor.height) + " " + image::color_format_name(asset.descriptor.cf) +
+                      (asset.descriptor.flags & image::IMAGE_FLAG_COMPRESSED ? ", RLE" : "") + ", " + size +
+                      " bytes) */\n");
+        } else {
+            out.write("/* " + asset.uri + " (" + size + " bytes) */\n");
+        }
+        if (mode == AssetEmbedMode::Incbin) {
+            std::string absolute = std::filesystem::absolute(asset.path).string();
+            out.write("__asm__(\n    \"  .section .rodata\\n\"\n");
+            out.write("    \"  .global " + asset.symbol + "\\n\"\n");
+            for (const auto* alias : aliases) {
+                out.write("    \"  .global " + alias->symbol + "\\n\"\n");
+            }
+            out.write("    \"  .balign 4\\n\"\n");
+            out.write("    \"" + asset.symbol + ":\\n\"\n");
+            for (const auto* alias : aliases) {
+                out.write("    \"" + alias->symbol + ":\\n\"\n");
+            }
+            std::string quoted = quote_path(absolute);
+            std::string escaped;
+            for (char c : quoted) {
+                if (c == '"' || c == '\\') escaped += '\\';
+                escaped += c;
+            }
+            out.write("    \"  .incbin " + escaped + "\\n\"\n");
+            out.write("    \"  .previous\\n\"\n);\n");
+        } else if (mode == AssetEmbedMode::Embed) {
+            std::string absolute = std::filesystem::absolute(asset.path).string();
+            out.write("const unsigned char " + asset.symbol + "[" + array_size +
+                      "] __attribute__((aligned(4))) = {\n");
+            out.write("#embed " + quote_path(absolute) + " if_empty(0)\n};\n");
+        } else {
+            out.write("const unsigned char " + asset.symbol + "[" + array_size +
+                      "] __attribute__((aligned(4))) = {\n");
+            if (asset.size == 0) {
+                out.write("0x00,\n");
+            } else {
+                out.write_hex(contents[i]);
+            }
+            out.write("};\n");
+        }
+        out.write("const unsigned int " + asset.symbol + "_size = " + size + ";\n");
+        if (asset.has_descriptor) {
+            if (mode == AssetEmbedMode::Incbin) {
+                out.write("extern const unsigned char " + asset.symbol + "[];\n");
+            }
+            write_descriptor(out, asset);
+        }
+
+        for (const auto* alias : aliases) {
+            out.write("\n/* " + alias->uri + ": same contents as " + asset.uri + " */\n");
+            if (mode != AssetEmbedMode::Incbin) {
+                out.write("extern const unsigned char " + alias->symbol + "[" + array_size +
+                          "] __attribute__((alias(\"" + asset.symbol + "\")));\n");
+            }
+            out.write("const unsigned int " + alias->symbol + "_size = " + size + ";\n");
+            if (asset.has_descriptor) {
+                out.write("extern const lv_image_dsc_t " + alias->symbol + "_dsc __attribute__((alias(\"" +
+                          asset.symbol + "_dsc\")));\n");
+            }
+        }
+        out.write("\n");
+    }
+}
+
+// The stamp file holds the inputs' stamp followed by what bundling them
+// produced, so an up-to-date bundle can be reported without redoing it
+inline std::string write_stamp(const std::string& stamp, const AssetBundleResult& result) {
+    std::string out = stamp + "result\t" + std::to_string(result.converted) + "\t" +
+                      std::to_string(result.unique_bytes) + "\n";
+    for (const auto& output : result.outputs) {
+        out += "output\t" + output + "\n";
+    }
+    return out;
+}
+
+// Fill in `result` from a stamp file written for `stamp`; false, leaving
+// `result` alone, if the file belongs to other inputs or is damaged
+inline bool read_stamp(std::string_view contents, std::string_view stamp, AssetBundleResult& result) {
+    if (!contents.starts_with(stamp)) {
+        return false;
+    }
+    contents.remove_prefix(stamp.size());
+    std::vector<std::string> outputs;
+    size_t converted = 0;
+    size_t unique_bytes = 0;
+    bool has_result = false;
+    while (!contents.empty()) {
+        size_t eol = contents.find('\n');
+        if (eol == std::string_view::npos) {
+            return false;
+        }
+        std::string_view line = contents.substr(0, eol);
+        contents.remove_prefix(eol + 1);
+        if (line.starts_with("output\t")) {
+            outputs.emplace_back(line.substr(7));
+        } else if (line.starts_with("result\t")) {
+            line.remove_prefix(7);
+            size_t tab = line.find('\t');
+            if (tab == std::string_view::npos) {
+                return false;
+            }
+            auto [p1, e1] = std::from_chars(line.data(), line.data() + tab, converted);
+            auto [p2, e2] = std::from_chars(line.data() + tab + 1, line.data() + line.size(), unique_bytes);
+            if (e1 != std::errc() || e2 != std::errc()) {
+                return false;
+            }
+            has_result = true;
+        } else {
+            return false;
+        }
+    }
+    if (!has_result) {
+        return false;
+    }
+    result.outputs = std::move(outputs);
+    result.converted = converted;
+    result.unique_bytes = unique_bytes;
+    return true;
+}
+
+// Fill in the image descriptors. With a native image_format, PNG and BMP
+// images are decoded and converted in parallel, one task per unique image;
+// anything that cannot be converted keeps its file bytes and is described
+// as LV_COLOR_FORMAT_RAW for LVGL's runtime decoders.
+inline size_t prepare_images(std::vector<BundledAsset>& assets, const std::vector<MappedFile>& files,
+                             const AssetBundleOptions& options, std::vector<std::string>& warnings) {
+    // A .png sharing its bytes with a .bin still needs the descriptor
+    for (const auto& asset : assets) {
+        if (asset.has_descriptor) {
+            assets[asset.canonical].has_descriptor = true;
+        }
+    }
+
+    std::vector<size_t> jobs;
+    for (size_t i = 0; i < assets.size(); ++i) {
+        auto& asset = assets[i];
+        if (!asset.has_descriptor || asset.canonical != i) {
+            continue;
+        }
+        auto bytes = files[i].bytes();
+        bool png = bytes.size() >= 8 && std::memcmp(bytes.data(), image::detail::PNG_SIGNATURE, 8) == 0;
+        asset.descriptor.cf = png ? image::ColorFormat::RawAlpha : image::ColorFormat::Raw;
+        if (auto dimensions = image::image_dimensions(bytes)) {
+            asset.descriptor.width = dimensions->first;
+            asset.descriptor.height = dimensions->second;
+        }
+        if (options.image_format != image::ImageFormat::Raw) {
+            jobs.push_back(i);
+        }
+    }
+
+    std::vector<std::string> notes(assets.size());
+    std::vector<std::optional<image::ConvertedImage>> converted(assets.size());
+    auto convert = [&](size_t i) {
+        // lv_image_header_t stores width and height in 16 bits; refuse
+        // larger images from their header, before decoding allocates
+        const auto& header = assets[i].descriptor;
+        if (header.width > 0xFFFF || header.height > 0xFFFF ||
+            uint64_t{header.width} * header.height > image::MAX_IMAGE_PIXELS) {
+            notes[i] = "too large for an LVGL image header";
+            return;
+        }
+        auto decoded = image::decode_image(files[i].bytes(), notes[i]);
+        if (!decoded) {
+            return;
+        }
+        auto image = image::convert_image(*decoded, options.image_format, options.rle, notes[i]);
+        // The stride depends on the color format, so it is known only now
+        if (image.width > 0xFFFF || image.height > 0xFFFF || image.stride > 0xFFFF) {
+            notes[i] = "too large for an LVGL image header";
+            return;
+        }
+        converted[i] = std::move(image);
+    };
+    if (jobs.size() > 1) {
+        ThreadPool pool(std::min(jobs.size(), ThreadPool::default_thread_count()));
+        for (size_t i : jobs) {
+            pool.submit([&convert, i] { convert(i); });
+        }
+        pool.wait();
+    } else {
+        for (size_t i : jobs) {
+            convert(i);
+        }
+    }
+
+    size_t count = 0;
+    for (size_t i : jobs) {
+        if (!converted[i]) {
+            warnings.push_back("Cannot convert " + assets[i].uri + " (" + notes[i] + "), embedding the file");
+            continue;
+        }
+        if (!notes[i].empty()) {
+            warnings.push_back(assets[i].uri + ": " + notes[i]);
+        }
+        assets[i].descriptor = std::move(*converted[i]);
+        assets[i].size = assets[i].descriptor.data.size();
+        ++count;
+    }
+
+    for (auto& asset : assets) {
+        const auto& canonical = assets[asset.canonical];
+        asset.has_descriptor = canonical.has_descriptor;
+        asset.size = canonical.size;
+    }
+    return count;
+}
+
+} // namespace detail
+
+// Read every asset, deduplicate by content and write the generated
+// sources through `fs`. `project_dir` resolves forma://<path> to a file.
+// Assets that cannot be read are reported in `errors` and left out.
+inline AssetBundleResult bundle_assets(std::span<const std::string> uris, const std::string& project_dir,
+                                       const AssetBundleOptions& options, forma::fs::IFileSystem& fs) {
+    AssetBundleResult result;
+    std::vector<MappedFile> files;
+    std::unordered_map<uint64_t, std::vector<size_t>> by_hash;
+    std::unordered_map<std::string, size_t> by_symbol;
+
+    for (const auto& uri : uris) {
+        AssetBundler<1> classifier;
+        if (!classifier.add_asset(uri)) {
+            result.errors.push_back("Not a forma:// asset: " + uri);
+            continue;
+        }
+
+        BundledAsset asset;
+        asset.uri = uri;
+        asset.path = (std::filesystem::path(project_dir) / std::string(classifier.assets[0].file_path)).string();
+        asset.symbol = detail::asset_symbol(uri);
+        asset.has_descriptor = classifier.assets[0].type == AssetDecl::Type::Image;
+
+        auto [existing, inserted] = by_symbol.emplace(asset.symbol, result.assets.size());
+        if (!inserted) {
+            if (result.assets[existing->second].uri != uri) {
+                result.errors.push_back("Assets " + result.assets[existing->second].uri + " and " + uri +
+                                        " both map to symbol " + asset.symbol);
+            }
+            continue;
+        }
+
+        MappedFile file(asset.path);
+        if (!file.ok()) {
+            by_symbol.erase(existing);
+            result.errors.push_back("Cannot read asset " + uri + " (" + asset.path + ")");
+            continue;
+        }
+
+        auto bytes = file.bytes();
+        asset.size = bytes.size();
+        asset.hash = detail::content_hash(bytes);
+        asset.canonical = result.assets.size();
+
+        // Identical hash and bytes: share the first copy
+        auto& candidates = by_hash[asset.hash];
+        for (size_t other : candidates) {
+            auto other_bytes = files[other].bytes();
+            if (other_bytes.size() == bytes.size() &&
+                (bytes.empty() || std::memcmp(other_bytes.data(), bytes.data(), bytes.size()) == 0)) {
+                asset.canonical = other;
+                break;
+            }
+        }
+        if (asset.canonical == result.assets.size()) {
+            candidates.push_back(asset.canonical);
+        }
+
+        result.assets.push_back(std::move(asset));
+        files.push_back(std::move(file));
+    }
+
+    // Everything that shapes the output, for the stamp: the options and
+    // the source files. Compared before any image is decoded, so a build
+    // with unchanged assets does no conversion work.
+    std::string stamp = "forma-asset-bundle 3\t" + std::to_string(static_cast<int>(options.mode)) + "\t" +
+                        std::to_string(options.chunk_size) + "\t" +
+                        std::to_string(static_cast<int>(options.image_format)) + "\t" +
+                        std::to_string(options.rle) + "\n";
+    for (const auto& asset : result.assets) {
+        stamp += asset.symbol + "\t" + asset.path + "\t" + hash_to_hex(asset.hash) + "\t" +
+                 std::to_string(asset.size) + "\n";
+    }
+    if (!options.stamp_path.empty() && fs.exists(options.stamp_path) &&
+        detail::read_stamp(fs.read_file(options.stamp_path), stamp, result)) {
+        bool outputs_exist = true;
+        for (const auto& output : result.outputs) {
+            outputs_exist = outputs_exist && fs.exists(output);
+        }
+        if (outputs_exist) {
+            return result;
+        }
+        result.outputs.clear();
+        result.converted = 0;
+        result.unique_bytes = 0;
+    }
+
+    result.converted = detail::prepare_images(result.assets, files, options, result.warnings);
+    std::vector<std::span<const unsigned char>> contents;
+    for (size_t i = 0; i < result.assets.size(); ++i) {
+        const auto& asset = result.assets[i];
+        if (asset.canonical == i) {
+            result.unique_bytes += asset.size;
+        }
+        contents.push_back(asset.descriptor.data.empty() ? files[i].bytes()
+                                                         : std::span<const unsigned char>(asset.descriptor.data));
+    }
+
+    // Pack unique assets into translation units; duplicates live with
+    // their canonical copy so the aliases resolve within one unit
+    size_t unit = 0;
+    size_t unit_bytes = 0;
+    bool unit_used = false;
+    for (auto& asset : result.assets) {
+        if (asset.canonical != static_cast<size_t>(&asset - result.assets.data())) {
+            asset.unit = result.assets[asset.canonical].unit;
+            continue;
+        }
+        if (unit_used && unit_bytes + asset.size > options.chunk_size) {
+            ++unit;
+            unit_bytes = 0;
+        }
+        asset.unit = unit;
+        unit_bytes += asset.size;
+        unit_used = true;
+    }
+    size_t unit_count = unit_used ? unit + 1 : 0;
+    for (size_t u = 0; u < unit_count; ++u) {
+        result.outputs.push_back(detail::unit_path(options.output_prefix, u));
+    }
+
+    for (size_t u = 0; u < unit_count; ++u) {
+        auto stream = fs.open_write_stream(result.outputs[u]);
+        if (!stream) {
+            result.errors.push_back("Cannot write " + result.outputs[u]);
+            return result;
+        }
+        detail::ChunkedWriter out(*stream);
+        detail::write_unit(out, result.assets, contents, u, options.mode);
+    }
+
+    // Units left over from a previous, larger bundle would define the same
+    // symbols again; empty them
+    for (size_t u = unit_count; fs.exists(detail::unit_path(options.output_prefix, u)); ++u) {
+        fs.write_file(detail::unit_path(options.output_prefix, u), "/* Generated by forma: no assets. */\n");
+    }
+
+    if (!options.stamp_path.empty()) {
+        auto parent = std::filesystem::path(options.stamp_path).parent_path();
+        if (!parent.empty()) {
+            fs.create_dirs(parent.string());
+        }
+        fs.write_file(options.stamp_path, detail::write_stamp(stamp, result));
+    }
+    result.written = true;
+    return result;
+}
+
+} // namespace forma
@@ -9,6 +9,30 @@ namespace forma {
 // Asset Bundler - Collects and processes forma:// URIs
 // ============================================================================
 
+// Pixel size fonts are rasterized at when an instance sets `font` without
+// `font_size`
+inline constexpr int DEFAULT_FONT_SIZE = 16;
+
+// Font size an instance asks for: its integer `font_size`, or
+// DEFAULT_FONT_SIZE. A rasterized font is named <asset symbol>_<size>.
+constexpr int instance_font_size(const InstanceDecl& inst) {
+    for (size_t i = 0; i < inst.prop_count; ++i) {
+        const auto& prop = inst.properties[i];
+        if (prop.name != "font_size" || prop.value.kind != Value::Kind::Integer) {
+            continue;
+        }
+        int size = 0;
+        for (char c : prop.value.text) {
+            if (c < '0' || c > '9' || size > 1000) {
+                return DEFAULT_FONT_SIZE;
+            }
+            size = size * 10 + (c - '0');
+        }
+        return size > 0 ? size : DEFAULT_FONT_SIZE;
+    }
+    return DEFAULT_FONT_SIZE;
+}
+
 template <size_t MaxAssets = 64>
 struct AssetBundler {
     std::array<AssetDecl, MaxAssets> assets{};
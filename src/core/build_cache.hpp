@@ -0,0 +1,201 @@
+#pragma once
+
+#include "fs/i_file_system.hpp"
+#include "../plugin_hash.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef FORMA_VERSION_STRING
+#define FORMA_VERSION_STRING "0.1.0"
+#endif
+
+namespace forma {
+
+// ============================================================================
+// Build Cache - Skips rendering of sources whose inputs did not change
+// ============================================================================
+
+// One entry per compiled source file. The key covers the source text and
+// everything that affects how it is rendered (forma version, renderer
+// identity); deps records the content hash of every transitively imported
+// file so changes to an import invalidate its importers. assets lists the
+// forma:// URIs the source references, so the asset bundle can be rebuilt
+// without re-parsing up-to-date sources; glyphs and fonts do the same for
+// the font atlas (the UTF-8 text of its string literals and the font URIs
+// and pixel sizes its instances select).
+struct BuildCacheEntry {
+    uint64_t key = 0;
+    std::string output_path;
+    std::vector<std::pair<std::string, uint64_t>> deps;
+    std::vector<std::string> assets;
+    std::string glyphs;
+    std::vector<std::pair<std::string, int>> fonts;
+};
+
+// Persisted as plain text, one record per line, tab-separated:
+//   S <source path> <key hex> <output path>
+//   D <import path> <content hash hex>      (belongs to the preceding S)
+//   A <asset uri>                           (belongs to the preceding S)
+//   G <utf-8 code points>                   (belongs to the preceding S)
+//   F <font uri> <pixel size>               (belongs to the preceding S)
+class BuildCache {
+public:
+    static constexpr std::string_view FORMAT_HEADER = "forma-build-cache 3";
+
+    BuildCache(forma::fs::IFileSystem& fs, std::string cache_path)
+        : fs(fs), cache_path(std::move(cache_path)) {}
+
+    // Hash of everything besides the source that determines the output
+    static uint64_t toolchain_hash(std::string_view renderer_name, uint64_t renderer_metadata_hash) {
+        uint64_t hash = fnv1a_hash(FORMA_VERSION_STRING);
+        hash = fnv1a_hash_append(hash, "\n");
+        hash = fnv1a_hash_append(hash, renderer_name);
+        hash = fnv1a_hash_append(hash, "\n");
+        return fnv1a_hash_append(hash, hash_to_hex(renderer_metadata_hash));
+    }
+
+    static uint64_t source_key(std::string_view source, uint64_t toolchain) {
+        return fnv1a_hash_append(toolchain, source);
+    }
+
+    // Load entries from disk. A missing or unrecognised file leaves the
+    // cache empty, which simply rebuilds everything.
+    void load() {
+        entries.clear();
+        if (!fs.exists(cache_path)) {
+            return;
+        }
+        std::string content = fs.read_file(cache_path);
+        std::string_view rest = content;
+
+        BuildCacheEntry* current = nullptr;
+        bool header_seen = false;
+        while (!rest.empty()) {
+            size_t eol = rest.find('\n');
+            std::string_view line = rest.substr(0, eol);
+            rest = eol == std::string_view::npos ? std::string_view{} : rest.substr(eol + 1);
+
+            if (!header_seen) {
+                if (line != FORMAT_HEADER) {
+                    return;
+                }
+                header_seen = true;
+                continue;
+            }
+
+            auto fields = split_tabs(line);
+            if (fields.size() == 4 && fields[0] == "S") {
+                auto& entry = entries[std::string(fields[1])];
+                entry = BuildCacheEntry{parse_hex(fields[2]), std::string(fields[3]), {}, {}, {}, {}};
+                current = &entry;
+            } else if (fields.size() == 3 && fields[0] == "D" && current) {
+                current->deps.emplace_back(std::string(fields[1]), parse_hex(fields[2]));
+            } else if (fields.size() == 2 && fields[0] == "A" && current) {
+                current->assets.emplace_back(fields[1]);
+            } else if (fields.size() == 2 && fields[0] == "G" && current) {
+                current->glyphs = std::string(fields[1]);
+            } else if (fields.size() == 3 && fields[0] == "F" && current) {
+                current->fonts.emplace_back(std::string(fields[1]), std::atoi(std::string(fields[2]).c_str()));
+            }
+        }
+    }
+
+    void save() {
+        std::string out(FORMAT_HEADER);
+        out += '\n';
+        for (const auto& [source, entry] : entries) {
+            out += "S\t" + source + "\t" + hash_to_hex(entry.key) + "\t" + entry.output_path + "\n";
+            for (const auto& [path, hash] : entry.deps) {
+                out += "D\t" + path + "\t" + hash_to_hex(hash) + "\n";
+            }
+            for (const auto& uri : entry.assets) {
+                out += "A\t" + uri + "\n";
+            }
+            if (!entry.glyphs.empty()) {
+                out += "G\t" + entry.glyphs + "\n";
+            }
+            for (const auto& [uri, size] : entry.fonts) {
+                out += "F\t" + uri + "\t" + std::to_string(size) + "\n";
+            }
+        }
+        auto parent = std::filesystem::path(cache_path).parent_path();
+        if (!parent.empty()) {
+            fs.create_dirs(parent.string());
+        }
+        fs.write_file(cache_path, out);
+    }
+
+    // True when the recorded output for `source_path` was produced from the
+    // same key and none of its imports changed since.
+    bool is_fresh(const std::string& source_path, uint64_t key) {
+        auto it = entries.find(source_path);
+        if (it == entries.end() || it->second.key != key) {
+            return false;
+        }
+        if (!fs.exists(it->second.output_path)) {
+            return false;
+        }
+        for (const auto& [path, hash] : it->second.deps) {
+            if (!fs.exists(path) || file_hash(path) != hash) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void record(const std::string& source_path, BuildCacheEntry entry) {
+        entries[source_path] = std::move(entry);
+    }
+
+    const BuildCacheEntry* find(const std::string& source_path) const {
+        auto it = entries.find(source_path);
+        return it == entries.end() ? nullptr : &it->second;
+    }
+
+    void erase(const std::string& source_path) {
+        entries.erase(source_path);
+    }
+
+    size_t size() const { return entries.size(); }
+
+private:
+    forma::fs::IFileSystem& fs;
+    std::string cache_path;
+    std::unordered_map<std::string, BuildCacheEntry> entries;
+    // Imports shared by many sources are only read and hashed once per build
+    std::unordered_map<std::string, uint64_t> file_hashes;
+
+    uint64_t file_hash(const std::string& path) {
+        auto it = file_hashes.find(path);
+        if (it != file_hashes.end()) {
+            return it->second;
+        }
+        uint64_t hash = fnv1a_hash(fs.read_file(path));
+        file_hashes.emplace(path, hash);
+        return hash;
+    }
+
+    static std::vector<std::string_view> split_tabs(std::string_view line) {
+        std::vector<std::string_view> fields;
+        size_t start = 0;
+        for (size_t i = 0; i <= line.size(); ++i) {
+            if (i == line.size() || line[i] == '\t') {
+                fields.push_back(line.substr(start, i - start));
+                start = i + 1;
+            }
+        }
+        return fields;
+    }
+
+    static uint64_t parse_hex(std::string_view text) {
+        return std::strtoull(std::string(text).c_str(), nullptr, 16);
+    }
+};
+
+} // namespace forma
@@ -0,0 +1,446 @@
+#pragma once
+
+#include "asset_bundle.hpp"
+#include "thread_pool.hpp"
+#include "truetype.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace forma {
+
+// ============================================================================
+// Font Atlas - Subsets TTF assets to the glyphs used and pre-rasterizes them
+// into LVGL bitmap fonts
+// ============================================================================
+
+// What a set of documents needs from fonts
+struct FontUsage {
+    std::set<char32_t> code_points;               // From every string literal
+    std::set<std::pair<std::string, int>> fonts;  // `font` URIs with their pixel size
+};
+
+// Decode UTF-8 into `out`, skipping control characters. Invalid sequences
+// are skipped byte by byte.
+inline void append_code_points(std::string_view text, std::set<char32_t>& out) {
+    for (size_t i = 0; i < text.size();) {
+        auto byte = static_cast<unsigned char>(text[i]);
+        size_t length = byte < 0x80 ? 1 : (byte >> 5) == 0x6 ? 2 : (byte >> 4) == 0xE ? 3 : (byte >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || i + length > text.size()) {
+            ++i;
+            continue;
+        }
+        char32_t cp = length == 1 ? byte : byte & (0x7F >> length);
+        bool valid = true;
+        for (size_t k = 1; k < length; ++k) {
+            auto next = static_cast<unsigned char>(text[i + k]);
+            valid = valid && (next & 0xC0) == 0x80;
+            cp = (cp << 6) | (next & 0x3F);
+        }
+        if (!valid) {
+            ++i;
+            continue;
+        }
+        if (cp >= 0x20 && cp != 0x7F && cp <= 0x10FFFF) {
+            out.insert(cp);
+        }
+        i += length;
+    }
+}
+
+inline std::string encode_utf8(const std::set<char32_t>& code_points) {
+    std::string out;
+    for (char32_t cp : code_points) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+    return out;
+}
+
+// Collect the glyphs of every string literal in the document's property
+// assignments and the fonts its instances select with `font`/`font_size`
+template <typename DocType>
+void scan_font_usage(const DocType& doc, FontUsage& usage) {
+    auto scan_value = [&](const Value& value) {
+        if (value.kind == Value::Kind::String && !value.is_forma_uri()) {
+            append_code_points(value.text, usage.code_points);
+        }
+    };
+
+    for (size_t i = 0; i < doc.instances.count; ++i) {
+        const auto& inst = doc.instances.get(i);
+        for (size_t p = 0; p < inst.prop_count; ++p) {
+            const auto& prop = inst.properties[p];
+            scan_value(prop.value);
+            if (prop.has_preview) {
+                scan_value(prop.preview_value);
+            }
+            if (prop.name == "font" && prop.value.is_forma_uri() &&
+                AssetBundler<1>{}.get_asset_type(prop.value.text) == AssetDecl::Type::Font) {
+                usage.fonts.emplace(std::string(prop.value.text), instance_font_size(inst));
+            }
+        }
+        for (size_t w = 0; w < inst.when_count; ++w) {
+            for (size_t a = 0; a < inst.when_stmts[w].assignment_count; ++a) {
+                scan_value(inst.when_stmts[w].assignments[a].value);
+            }
+        }
+    }
+}
+
+struct FontAtlasOptions {
+    std::vector<int> sizes;       // Rendered for every font asset, besides the sizes instances ask for
+    int bpp = 4;                  // Bits per pixel of glyph bitmaps: 1, 2, 4 or 8
+    std::string output_prefix;    // Fonts are written as <prefix>_<path>_<size>.c
+    std::string cache_dir;        // Generated fonts by content key; empty disables caching
+    std::string manifest_path;    // Sources written last time, so unused ones can be emptied
+};
+
+struct GeneratedFont {
+    std::string uri;
+    std::string symbol;  // lv_font_t name: <asset symbol>_<size>
+    int size = 0;
+    std::string output;
+    size_t glyphs = 0;   // Glyphs in the font
+    size_t missing = 0;  // Code points the font has no glyph for
+    bool cached = false; // Taken from the cache instead of rasterized
+};
+
+struct FontAtlasResult {
+    std::vector<GeneratedFont> fonts;
+    std::vector<std::string> warnings;    // Fonts left to be embedded as raw files
+    std::vector<std::string> rasterized;  // Font URIs fully replaced by bitmap fonts
+};
+
+namespace detail {
+
+inline std::string code_point_label(char32_t cp) {
+    std::string hex = hash_to_hex(cp);
+    size_t digits = cp > 0xFFFF ? (cp > 0xFFFFF ? 6 : 5) : 4;
+    return "U+" + hex.substr(hex.size() - digits);
+}
+
+inline std::string hex_bytes(std::span<const uint8_t> bytes) {
+    std::string out;
+    out.reserve(bytes.size() * 5 + bytes.size() / 16 + 1);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        out.append(HEX_BYTE_TABLE[bytes[i]].data(), 5);
+        if (i % 16 == 15 || i + 1 == bytes.size()) {
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+// LVGL lv_font_fmt_txt source for the glyphs of `code_points` the font has.
+// Glyph ids are assigned in code point order; cmaps are sparse lists of
+// offsets, split wherever a range would exceed 16-bit offsets.
+inline std::string generate_lvgl_font(const font::TrueTypeFont& ttf, const std::string& symbol,
+                                      const std::string& uri, int size, int bpp,
+                                      const std::set<char32_t>& code_points, GeneratedFont& info,
+                                      std::string& error) {
+    float scale = static_cast<float>(size) / ttf.units_per_em;
+    int levels = (1 << bpp) - 1;
+
+    std::vector<char32_t> present;
+    std::vector<uint8_t> bitmap;
+    std::string glyph_dsc = "    {.bitmap_index = 0, .adv_w = 0, .box_w = 0, .box_h = 0, .ofs_x = 0, .ofs_y = 0} /* id 0: reserved */,\n";
+    for (char32_t cp : code_points) {
+        uint16_t glyph = ttf.glyph_index(cp);
+        if (glyph == 0) {
+            ++info.missing;
+            continue;
+        }
+        auto raster = ttf.rasterize(glyph, static_cast<float>(size));
+        long advance = std::lround(ttf.advance_width(glyph) * scale * 16);
+        if (raster.width > 255 || raster.height > 255 || advance > 4095 || raster.x_offset < -128 ||
+            raster.x_offset > 127 || raster.y_offset < -128 || raster.y_offset > 127 || bitmap.size() >= (1u << 20)) {
+            error = "glyphs at " + std::to_string(size) + " px exceed LVGL bitmap font limits";
+            return {};
+        }
+
+        glyph_dsc += "    {.bitmap_index = " + std::to_string(bitmap.size()) + ", .adv_w = " + std::to_string(advance) +
+                     ", .box_w = " + std::to_string(raster.width) + ", .box_h = " + std::to_string(raster.height) +
+                     ", .ofs_x = " + std::to_string(raster.x_offset) + ", .ofs_y = " + std::to_string(raster.y_offset) +
+                     "} /* " + code_point_label(cp) + " */,\n";
+
+        // Pixels packed MSB first with no row padding; glyphs start on a byte
+        uint32_t bits = 0;
+        int pending = 0;
+        for (uint8_t coverage : raster.coverage) {
+            bits = (bits << bpp) | static_cast<uint32_t>((coverage * levels + 127) / 255);
+            pending += bpp;
+            if (pending == 8) {
+                bitmap.push_back(static_cast<uint8_t>(bits));
+                bits = 0;
+                pending = 0;
+            }
+        }
+        if (pending > 0) {
+            bitmap.push_back(static_cast<uint8_t>(bits << (8 - pending)));
+        }
+        present.push_back(cp);
+    }
+    info.glyphs = present.size();
+
+    std::string out = "/* Generated by forma: " + uri + " at " + std::to_string(size) + " px, " +
+                      std::to_string(present.size()) + " glyphs, " + std::to_string(bpp) +
+                      " bpp. Do not edit. */\n\n#include \"lvgl.h\"\n\n";
+    if (bitmap.empty()) {
+        bitmap.push_back(0);  // C has no zero-length arrays
+    }
+    out += "static const uint8_t glyph_bitmap[] = {\n" + hex_bytes(bitmap) + "};\n\n";
+    out += "static const lv_font_fmt_txt_glyph_dsc_t glyph_dsc[] = {\n" + glyph_dsc + "};\n\n";
+
+    std::string cmaps;
+    size_t cmap_count = 0;
+    for (size_t begin = 0; begin < present.size();) {
+        size_t end = begin;
+        while (end < present.size() && present[end] - present[begin] <= 0xFFFF) {
+            ++end;
+        }
+        std::string list = "unicode_list_" + std::to_string(cmap_count);
+        out += "static const uint16_t " + list + "[] = {";
+        for (size_t i = begin; i < end; ++i) {
+            out += (i % 12 == begin % 12 ? "\n    " : " ") + std::to_string(present[i] - present[begin]) + ",";
+        }
+        out += "\n};\n\n";
+        cmaps += "    {.range_start = " + std::to_string(present[begin]) +
+                 ", .range_length = " + std::to_string(present[end - 1] - present[begin] + 1) +
+                 ", .glyph_id_start = " + std::to_string(begin + 1) + ", .unicode_list = " + list +
+                 ", .glyph_id_ofs_list = NULL, .list_length = " + std::to_string(end - begin) +
+                 ", .type = LV_FONT_FMT_TXT_CMAP_SPARSE_TINY},\n";
+        ++cmap_count;
+        begin = end;
+    }
+    if (cmap_count > 0) {
+        out += "static const lv_font_fmt_txt_cmap_t cmaps[] = {\n" + cmaps + "};\n\n";
+    }
+
+    int ascent = static_cast<int>(std::ceil(ttf.ascender * scale));
+    int descent = static_cast<int>(std::ceil(-ttf.descender * scale));
+    out += "#if LVGL_VERSION_MAJOR == 8\nstatic lv_font_fmt_txt_glyph_cache_t cache;\n#endif\n\n";
+    out += "static const lv_font_fmt_txt_dsc_t font_dsc = {\n"
+           "    .glyph_bitmap = glyph_bitmap,\n"
+           "    .glyph_dsc = glyph_dsc,\n";
+    out += cmap_count > 0 ? "    .cmaps = cmaps,\n" : "    .cmaps = NULL,\n";
+    out += "    .kern_dsc = NULL,\n"
+           "    .kern_scale = 0,\n"
+           "    .cmap_num = " + std::to_string(cmap_count) + ",\n"
+           "    .bpp = " + std::to_string(bpp) + ",\n"
+           "    .kern_classes = 0,\n"
+           "    .bitmap_format = 0,\n"
+           "#if LVGL_VERSION_MAJOR == 8\n"
+           "    .cache = &cache,\n"
+           "#endif\n"
+           "};\n\n";
+    out += "const lv_font_t " + symbol + " = {\n"
+           "    .get_glyph_dsc = lv_font_get_glyph_dsc_fmt_txt,\n"
+           "    .get_glyph_bitmap = lv_font_get_bitmap_fmt_txt,\n"
+           "    .line_height = " + std::to_string(ascent + descent) + ",\n"
+           "    .base_line = " + std::to_string(descent) + ",\n"
+           "    .subpx = LV_FONT_SUBPX_NONE,\n"
+           "    .underline_position = " + std::to_string(std::lround(ttf.underline_position * scale)) + ",\n"
+           "    .underline_thickness = " + std::to_string(std::max(1L, std::lround(ttf.underline_thickness * scale))) + ",\n"
+           "    .dsc = &font_dsc,\n"
+           "};\n";
+    return out;
+}
+
+} // namespace detail
+
+// Rasterize every (font, size) pair that is asked for: each font asset in
+// `font_uris` at options.sizes, plus the fonts and sizes in usage.fonts.
+// Glyph sets come from usage.code_points. Results are cached by font
+// contents, glyph set, size and bpp, so unchanged fonts cost one lookup;
+// misses are rasterized in parallel.
+inline FontAtlasResult build_font_atlases(std::span<const std::string> font_uris, const FontUsage& usage,
+                                          const std::string& project_dir, const FontAtlasOptions& options,
+                                          forma::fs::IFileSystem& fs) {
+    FontAtlasResult result;
+    std::map<std::string, std::set<int>> requests;
+    for (const auto& uri : font_uris) {
+        requests[uri].insert(options.sizes.begin(), options.sizes.end());
+    }
+    for (const auto& [uri, size] : usage.fonts) {
+        requests[uri].insert(size);
+    }
+
+    std::string glyphs = encode_utf8(usage.code_points);
+    std::string glyph_key = hash_to_hex(detail::content_hash(
+        std::span<const unsigned char>(reinterpret_cast<const unsigned char*>(glyphs.data()), glyphs.size())));
+
+    struct Job {
+        size_t font;      // Index into fonts
+        size_t result;    // Index into result.fonts
+        std::string cache_path;
+        std::string source;
+        std::string error;
+    };
+    struct LoadedFont {
+        std::string uri;
+        MappedFile file;
+        std::optional<font::TrueTypeFont> ttf;
+    };
+    std::vector<LoadedFont> fonts;
+    std::vector<Job> jobs;
+
+    for (const auto& [uri, sizes] : requests) {
+        if (sizes.empty()) {
+            continue;
+        }
+        AssetBundler<1> classifier;
+        if (!classifier.add_asset(uri)) {
+            result.warnings.push_back("Not a forma:// font: " + uri);
+            continue;
+        }
+        std::string path = (std::filesystem::path(project_dir) / std::string(classifier.assets[0].file_path)).string();
+        MappedFile file(path);
+        if (!file.ok()) {
+            result.warnings.push_back("Cannot read font " + uri + " (" + path + ")");
+            continue;
+        }
+        std::string font_key = hash_to_hex(detail::content_hash(file.bytes()));
+        std::string base_symbol = detail::asset_symbol(uri);
+        fonts.push_back({uri, std::move(file), std::nullopt});
+
+        for (int size : sizes) {
+            GeneratedFont generated;
+            generated.uri = uri;
+            generated.size = size;
+            generated.symbol = base_symbol + "_" + std::to_string(size);
+            generated.output = options.output_prefix + "_" + base_symbol.substr(6) + "_" + std::to_string(size) + ".c";
+
+            Job job{fonts.size() - 1, result.fonts.size(), {}, {}, {}};
+            if (!options.cache_dir.empty()) {
+                job.cache_path = options.cache_dir + "/" + generated.symbol + "-" + font_key + "-" + glyph_key + "-" +
+                                 std::to_string(options.bpp) + ".c";
+                if (fs.exists(job.cache_path)) {
+                    job.source = fs.read_file(job.cache_path);
+                    generated.cached = true;
+                }
+            }
+            result.fonts.push_back(std::move(generated));
+            jobs.push_back(std::move(job));
+        }
+    }
+
+    // Rasterize cache misses; each font is parsed once, before the jobs
+    // that share it run
+    for (auto& job : jobs) {
+        auto& font = fonts[job.font];
+        if (job.source.empty() && !font.ttf) {
+            std::string error;
+            font.ttf = font::TrueTypeFont::parse(font.file.bytes(), error);
+            if (!font.ttf) {
+                result.warnings.push_back("Cannot rasterize " + font.uri + ": " + error);
+            }
+        }
+    }
+    auto rasterize = [&](Job& job) {
+        auto& generated = result.fonts[job.result];
+        const auto& font = fonts[job.font];
+        if (!job.source.empty() || !font.ttf) {
+            return;
+        }
+        job.source = detail::generate_lvgl_font(*font.ttf, generated.symbol, generated.uri, generated.size,
+                                                options.bpp, usage.code_points, generated, job.error);
+    };
+    size_t misses = std::count_if(jobs.begin(), jobs.end(), [](const Job& job) { return job.source.empty(); });
+    if (misses > 1) {
+        ThreadPool pool(std::min(misses, ThreadPool::default_thread_count()));
+        for (auto& job : jobs) {
+            pool.submit([&rasterize, &job] { rasterize(job); });
+        }
+        pool.wait();
+    } else {
+        for (auto& job : jobs) {
+            rasterize(job);
+        }
+    }
+
+    std::set<std::string> failed;
+    std::vector<std::string> outputs;
+    for (auto& job : jobs) {
+        auto& generated = result.fonts[job.result];
+        if (job.source.empty()) {
+            if (!job.error.empty()) {
+                result.warnings.push_back("Cannot rasterize " + generated.uri + ": " + job.error);
+            }
+            failed.insert(generated.uri);
+            continue;
+        }
+        if (!generated.cached && !job.cache_path.empty()) {
+            fs.create_dirs(options.cache_dir);
+            fs.write_file(job.cache_path, job.source);
+        }
+        if (generated.cached) {
+            // Counts are recorded in the header comment
+            auto count_at = job.source.find(" px, ");
+            if (count_at != std::string::npos) {
+                generated.glyphs = std::strtoul(job.source.c_str() + count_at + 5, nullptr, 10);
+            }
+        }
+        // Rewrite only on change so the generated source is not recompiled
+        if (!fs.exists(generated.output) || fs.read_file(generated.output) != job.source) {
+            fs.write_file(generated.output, job.source);
+        }
+        outputs.push_back(generated.output);
+    }
+    for (const auto& font : fonts) {
+        if (!failed.count(font.uri)) {
+            result.rasterized.push_back(font.uri);
+        }
+    }
+
+    // Sizes or fonts no longer used would still be compiled and linked
+    if (!options.manifest_path.empty()) {
+        if (fs.exists(options.manifest_path)) {
+            std::string previous = fs.read_file(options.manifest_path);
+            std::string_view rest = previous;
+            while (!rest.empty()) {
+                size_t eol = rest.find('\n');
+                std::string line(rest.substr(0, eol));
+                rest = eol == std::string_view::npos ? std::string_view{} : rest.substr(eol + 1);
+                if (!line.empty() && std::find(outputs.begin(), outputs.end(), line) == outputs.end() &&
+                    fs.exists(line)) {
+                    fs.write_file(line, "/* Generated by forma: font no longer used. */\n");
+                }
+            }
+        }
+        std::string manifest;
+        for (const auto& output : outputs) {
+            manifest += output + "\n";
+        }
+        auto parent = std::filesystem::path(options.manifest_path).parent_path();
+        if (!parent.empty()) {
+            fs.create_dirs(parent.string());
+        }
+        fs.write_file(options.manifest_path, manifest);
+    }
+    return result;
+}
+
+} // namespace forma
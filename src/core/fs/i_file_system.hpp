@@ -4,6 +4,7 @@
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <filesystem>
 #include <fstream>
 #include <iterator>
@@ -145,12 +146,14 @@ public:
                 return len;
             }
         };
-        // Ensure parent dir exists semantically
+        // Ensure parent dir exists semantically; like opening a real file
+        // for writing, this truncates any previous contents
         {
             std::lock_guard<std::mutex> lk(mu_);
             auto sp = std::string(path);
             auto parent = std::filesystem::path(sp).parent_path().string();
             if (!parent.empty()) dirs_.insert(parent);
+            files_[sp].clear();
         }
         return std::make_unique<MemStream>(this, std::string(path));
     }
@@ -6,6 +6,10 @@
 
 namespace forma {
 
+// Passed to plugins as the `host` argument of forma_register and the
+// *_host entry points. Several renderers may run at once (forma --renderer
+// lvgl,json), so stream_io, once initialized, serializes access to the
+// filesystem behind it; `filesystem` itself is not locked.
 struct HostContext {
     std::unique_ptr<forma::fs::IFileSystem> filesystem;
     forma::tracer::TracerPlugin* tracer = nullptr;
@@ -17,9 +21,9 @@ struct HostContext {
 
     void initialize_stream_io() {
         if (filesystem) {
-            stream_io = forma::io::StreamIO::from_filesystem(*filesystem);
+            stream_io = forma::io::StreamIO::serialized(forma::io::StreamIO::from_filesystem(*filesystem));
         } else {
-            stream_io = forma::io::StreamIO::defaults();
+            stream_io = forma::io::StreamIO::serialized(forma::io::StreamIO::defaults());
         }
     }
 };
@@ -0,0 +1,724 @@
+#pragma once
+
+#include "inflate.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace forma::image {
+
+// ============================================================================
+// Image Conversion - PNG/BMP to LVGL native color formats at build time
+// ============================================================================
+
+// Decoded image, 8-bit RGBA, rows top to bottom without padding
+struct RgbaImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+    bool has_alpha = false;  // Any pixel not fully opaque
+};
+
+// Output format requested in [assets] image_format
+enum class ImageFormat {
+    Raw,       // Embed the encoded file; LVGL decodes it at runtime
+    RGB565,    // RGB565, or RGB565A8 when the image has transparency
+    ARGB8888,
+    Indexed    // I1/I2/I4/I8 with a palette; ARGB8888 above 256 colors
+};
+
+constexpr std::optional<ImageFormat> parse_image_format(std::string_view name) {
+    if (name == "raw") return ImageFormat::Raw;
+    if (name == "rgb565") return ImageFormat::RGB565;
+    if (name == "argb8888") return ImageFormat::ARGB8888;
+    if (name == "indexed") return ImageFormat::Indexed;
+    return std::nullopt;
+}
+
+// lv_color_format_t values (LVGL 9)
+enum class ColorFormat : uint8_t {
+    Raw = 0x01,
+    RawAlpha = 0x02,
+    I1 = 0x07,
+    I2 = 0x08,
+    I4 = 0x09,
+    I8 = 0x0A,
+    ARGB8888 = 0x10,
+    RGB565 = 0x12,
+    RGB565A8 = 0x14
+};
+
+constexpr const char* color_format_name(ColorFormat cf) {
+    switch (cf) {
+        case ColorFormat::Raw: return "LV_COLOR_FORMAT_RAW";
+        case ColorFormat::RawAlpha: return "LV_COLOR_FORMAT_RAW_ALPHA";
+        case ColorFormat::I1: return "LV_COLOR_FORMAT_I1";
+        case ColorFormat::I2: return "LV_COLOR_FORMAT_I2";
+        case ColorFormat::I4: return "LV_COLOR_FORMAT_I4";
+        case ColorFormat::I8: return "LV_COLOR_FORMAT_I8";
+        case ColorFormat::ARGB8888: return "LV_COLOR_FORMAT_ARGB8888";
+        case ColorFormat::RGB565: return "LV_COLOR_FORMAT_RGB565";
+        case ColorFormat::RGB565A8: return "LV_COLOR_FORMAT_RGB565A8";
+    }
+    return "LV_COLOR_FORMAT_UNKNOWN";
+}
+
+// LV_IMAGE_FLAGS_COMPRESSED: data starts with an lv_image_compressed_t header
+inline constexpr uint16_t IMAGE_FLAG_COMPRESSED = 0x0008;
+// LV_IMAGE_COMPRESS_RLE
+inline constexpr uint32_t COMPRESS_RLE = 1;
+
+// Contents of an lv_image_dsc_t
+// Largest image the decoders accept: 16M pixels, 64 MiB as RGBA8. Checked
+// against the header before any pixel memory is allocated.
+inline constexpr uint64_t MAX_IMAGE_PIXELS = uint64_t{1} << 24;
+
+struct ConvertedImage {
+    ColorFormat cf = ColorFormat::Raw;
+    uint16_t flags = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t stride = 0;
+    std::vector<uint8_t> data;
+};
+
+namespace detail {
+
+inline uint32_t read_be32(const uint8_t* p) {
+    return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) | (uint32_t{p[2]} << 8) | p[3];
+}
+
+inline uint32_t read_le32(const uint8_t* p) {
+    return uint32_t{p[0]} | (uint32_t{p[1]} << 8) | (uint32_t{p[2]} << 16) | (uint32_t{p[3]} << 24);
+}
+
+inline uint16_t read_le16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline void write_le32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+inline bool any_transparent(const std::vector<uint8_t>& rgba) {
+    for (size_t i = 3; i < rgba.size(); i += 4) {
+        if (rgba[i] != 255) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline constexpr uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+// Undo PNG scanline filters in place. `raw` holds height rows of
+// (1 filter byte + stride bytes); the result is packed to stride bytes.
+inline bool png_unfilter(std::vector<uint8_t>& raw, size_t stride, uint32_t height, size_t bpp) {
+    std::vector<uint8_t> zero(stride, 0);
+    for (uint32_t y = 0; y < height; ++y) {
+        uint8_t filter = raw[y * (stride + 1)];
+        uint8_t* row = raw.data() + y * (stride + 1) + 1;
+        const uint8_t* prev = y ? raw.data() + (y - 1) * stride : zero.data();
+        uint8_t* dst = raw.data() + y * stride;  // Rows shift down by one byte each
+
+        switch (filter) {
+            case 0:
+                std::memmove(dst, row, stride);
+                break;
+            case 1:
+                for (size_t i = 0; i < stride; ++i) {
+                    dst[i] = static_cast<uint8_t>(row[i] + (i >= bpp ? dst[i - bpp] : 0));
+                }
+                break;
+            case 2:
+                for (size_t i = 0; i < stride; ++i) {
+                    dst[i] = static_cast<uint8_t>(row[i] + prev[i]);
+                }
+                break;
+            case 3:
+                for (size_t i = 0; i < stride; ++i) {
+                    int left = i >= bpp ? dst[i - bpp] : 0;
+                    dst[i] = static_cast<uint8_t>(row[i] + ((left + prev[i]) >> 1));
+                }
+                break;
+            case 4:
+                for (size_t i = 0; i < stride; ++i) {
+                    int a = i >= bpp ? dst[i - bpp] : 0;
+                    int b = prev[i];
+                    int c = i >= bpp ? prev[i - bpp] : 0;
+                    int p = a + b - c;
+                    int pa = std::abs(p - a);
+                    int pb = std::abs(p - b);
+                    int pc = std::abs(p - c);
+                    int predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                    dst[i] = static_cast<uint8_t>(row[i] + predictor);
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+    raw.resize(stride * height);
+    return true;
+}
+
+} // namespace detail
+
+// ----------------------------------------------------------------------------
+// Decoders
+// ----------------------------------------------------------------------------
+
+// Non-interlaced PNG of any color type; 16-bit samples keep their high byte
+inline std::optional<RgbaImage> decode_png(std::span<const uint8_t> file, std::string& error) {
+    if (file.size() < 8 || std::memcmp(file.data(), detail::PNG_SIGNATURE, 8) != 0) {
+        error = "not a PNG file";
+        return std::nullopt;
+    }
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t depth = 0;
+    uint8_t color_type = 0;
+    std::array<uint8_t, 256 * 4> palette{};
+    size_t palette_size = 0;
+    std::array<uint16_t, 3> transparent_key{};
+    bool has_key = false;
+    std::vector<uint8_t> idat;
+    bool seen_header = false;
+
+    for (size_t pos = 8; pos + 12 <= file.size();) {
+        uint32_t length = detail::read_be32(file.data() + pos);
+        if (length > file.size() - pos - 12) {
+            error = "truncated PNG chunk";
+            return std::nullopt;
+        }
+        std::string_view type(reinterpret_cast<const char*>(file.data() + pos + 4), 4);
+        const uint8_t* data = file.data() + pos + 8;
+        pos += 12 + length;
+
+        if (type == "IHDR" && length >= 13) {
+            width = detail::read_be32(data);
+            height = detail::read_be32(data + 4);
+            depth = data[8];
+            color_type = data[9];
+            if (data[10] != 0 || data[11] != 0) {
+                error = "unknown PNG compression or filter method";
+                return std::nullopt;
+            }
+            if (data[12] != 0) {
+                error = "interlaced PNG is not supported";
+                return std::nullopt;
+            }
+            seen_header = true;
+        } else if (type == "PLTE") {
+            palette_size = std::min<size_t>(length / 3, 256);
+            for (size_t i = 0; i < palette_size; ++i) {
+                palette[i * 4] = data[i * 3];
+                palette[i * 4 + 1] = data[i * 3 + 1];
+                palette[i * 4 + 2] = data[i * 3 + 2];
+                palette[i * 4 + 3] = 255;
+            }
+        } else if (type == "tRNS") {
+            if (color_type == 3) {
+                for (size_t i = 0; i < std::min<size_t>(length, 256); ++i) {
+                    palette[i * 4 + 3] = data[i];
+                }
+            } else if (color_type == 0 && length >= 2) {
+                transparent_key[0] = static_cast<uint16_t>((data[0] << 8) | data[1]);
+                has_key = true;
+            } else if (color_type == 2 && length >= 6) {
+                for (size_t c = 0; c < 3; ++c) {
+                    transparent_key[c] = static_cast<uint16_t>((data[c * 2] << 8) | data[c * 2 + 1]);
+                }
+                has_key = true;
+            }
+        } else if (type == "IDAT") {
+            idat.insert(idat.end(), data, data + length);
+        } else if (type == "IEND") {
+            break;
+        }
+    }
+
+    if (!seen_header || width == 0 || height == 0) {
+        error = "missing PNG header";
+        return std::nullopt;
+    }
+
+    size_t channels;
+    switch (color_type) {
+        case 0: channels = 1; break;
+        case 2: channels = 3; break;
+        case 3: channels = 1; break;
+        case 4: channels = 2; break;
+        case 6: channels = 4; break;
+        default:
+            error = "unknown PNG color type";
+            return std::nullopt;
+    }
+    bool depth_ok = depth == 8 || (depth == 16 && color_type != 3) ||
+                    ((depth == 1 || depth == 2 || depth == 4) && (color_type == 0 || color_type == 3));
+    if (!depth_ok) {
+        error = "unsupported PNG bit depth";
+        return std::nullopt;
+    }
+    if (color_type == 3 && palette_size == 0) {
+        error = "palette PNG without PLTE";
+        return std::nullopt;
+    }
+    if (uint64_t{width} * height > MAX_IMAGE_PIXELS) {
+        error = "PNG dimensions too large";
+        return std::nullopt;
+    }
+
+    size_t bits_per_pixel = channels * depth;
+    size_t stride = (width * bits_per_pixel + 7) / 8;
+    size_t bpp = std::max<size_t>(1, bits_per_pixel / 8);
+
+    // Inflate stops at the size the header implies, so a small IDAT
+    // cannot expand without bound
+    size_t raw_size = (stride + 1) * height;
+    std::vector<uint8_t> raw;
+    if (!zlib_decompress(idat, raw, raw_size) || raw.size() < raw_size) {
+        error = "corrupt PNG image data";
+        return std::nullopt;
+    }
+    if (!detail::png_unfilter(raw, stride, height, bpp)) {
+        error = "invalid PNG filter";
+        return std::nullopt;
+    }
+
+    RgbaImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t{width} * height * 4);
+    uint8_t* out = image.pixels.data();
+    size_t step = depth == 16 ? 2 : 1;  // Bytes per sample
+
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* row = raw.data() + y * stride;
+        for (uint32_t x = 0; x < width; ++x, out += 4) {
+            if (depth < 8) {
+                size_t bit = size_t{x} * depth;
+                uint8_t value = static_cast<uint8_t>((row[bit / 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1));
+                if (color_type == 3) {
+                    std::memcpy(out, &palette[value * 4], 4);
+                } else {
+                    uint8_t gray = static_cast<uint8_t>(value * 255 / ((1 << depth) - 1));
+                    out[0] = out[1] = out[2] = gray;
+                    out[3] = has_key && value == transparent_key[0] ? 0 : 255;
+                }
+                continue;
+            }
+
+            const uint8_t* px = row + size_t{x} * channels * step;
+            auto sample = [&](size_t c) { return px[c * step]; };
+            auto full = [&](size_t c) {
+                return static_cast<uint16_t>(step == 2 ? (px[c * 2] << 8) | px[c * 2 + 1] : px[c]);
+            };
+            switch (color_type) {
+                case 0:
+                    out[0] = out[1] = out[2] = sample(0);
+                    out[3] = has_key && full(0) == transparent_key[0] ? 0 : 255;
+                    break;
+                case 2:
+                    out[0] = sample(0);
+                    out[1] = sample(1);
+                    out[2] = sample(2);
+                    out[3] = has_key && full(0) == transparent_key[0] && full(1) == transparent_key[1] &&
+                             full(2) == transparent_key[2] ? 0 : 255;
+                    break;
+                case 3:
+                    std::memcpy(out, &palette[px[0] * 4], 4);
+                    break;
+                case 4:
+                    out[0] = out[1] = out[2] = sample(0);
+                    out[3] = sample(1);
+                    break;
+                default:
+                    out[0] = sample(0);
+                    out[1] = sample(1);
+                    out[2] = sample(2);
+                    out[3] = sample(3);
+                    break;
+            }
+        }
+    }
+    image.has_alpha = detail::any_transparent(image.pixels);
+    return image;
+}
+
+// Uncompressed BMP: 1/4/8-bit palettized, 24-bit and 32-bit
+inline std::optional<RgbaImage> decode_bmp(std::span<const uint8_t> file, std::string& error) {
+    if (file.size() < 54 || file[0] != 'B' || file[1] != 'M') {
+        error = "not a BMP file";
+        return std::nullopt;
+    }
+    uint32_t pixel_offset = detail::read_le32(file.data() + 10);
+    uint32_t header_size = detail::read_le32(file.data() + 14);
+    int32_t width = static_cast<int32_t>(detail::read_le32(file.data() + 18));
+    int32_t height = static_cast<int32_t>(detail::read_le32(file.data() + 22));
+    uint16_t bits = detail::read_le16(file.data() + 28);
+    uint32_t compression = detail::read_le32(file.data() + 30);
+    uint32_t colors_used = detail::read_le32(file.data() + 46);
+
+    bool top_down = height < 0;
+    uint32_t w = static_cast<uint32_t>(width);
+    uint32_t h = top_down ? static_cast<uint32_t>(-static_cast<int64_t>(height)) : static_cast<uint32_t>(height);
+    if (header_size < 40 || width <= 0 || h == 0 || uint64_t{w} * h > MAX_IMAGE_PIXELS) {
+        error = "unsupported BMP header";
+        return std::nullopt;
+    }
+    // BI_RGB, or BI_BITFIELDS with the standard 32-bit BGRA masks. The
+    // masks follow a 40-byte header and are part of V2+ headers: offset 54
+    // either way.
+    if (compression == 3 && file.size() < 66) {
+        error = "truncated BMP";
+        return std::nullopt;
+    }
+    bool standard_masks = compression == 3 && bits == 32 && (header_size == 40 || header_size >= 52) &&
+                          detail::read_le32(file.data() + 54) == 0x00FF0000 &&
+                          detail::read_le32(file.data() + 58) == 0x0000FF00 &&
+                          detail::read_le32(file.data() + 62) == 0x000000FF;
+    if (compression != 0 && !standard_masks) {
+        error = "compressed BMP is not supported";
+        return std::nullopt;
+    }
+    if (bits != 1 && bits != 4 && bits != 8 && bits != 24 && bits != 32) {
+        error = "unsupported BMP bit depth";
+        return std::nullopt;
+    }
+
+    size_t stride = ((size_t{w} * bits + 31) / 32) * 4;
+    if (pixel_offset > file.size() || stride * h > file.size() - pixel_offset) {
+        error = "truncated BMP";
+        return std::nullopt;
+    }
+
+    std::array<uint8_t, 256 * 4> palette{};
+    if (bits <= 8) {
+        size_t count = colors_used ? std::min<size_t>(colors_used, 256) : (size_t{1} << bits);
+        size_t table = 14 + header_size;
+        if (table + count * 4 > file.size()) {
+            error = "truncated BMP palette";
+            return std::nullopt;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const uint8_t* entry = file.data() + table + i * 4;
+            palette[i * 4] = entry[2];
+            palette[i * 4 + 1] = entry[1];
+            palette[i * 4 + 2] = entry[0];
+            palette[i * 4 + 3] = 255;
+        }
+    }
+
+    RgbaImage image;
+    image.width = w;
+    image.height = h;
+    image.pixels.resize(size_t{w} * h * 4);
+    bool alpha_used = false;
+    for (uint32_t y = 0; y < h; ++y) {
+        const uint8_t* row = file.data() + pixel_offset + stride * (top_down ? y : h - 1 - y);
+        uint8_t* out = image.pixels.data() + size_t{y} * w * 4;
+        for (uint32_t x = 0; x < w; ++x, out += 4) {
+            if (bits <= 8) {
+                size_t bit = size_t{x} * bits;
+                uint8_t index = static_cast<uint8_t>((row[bit / 8] >> (8 - bits - bit % 8)) & ((1 << bits) - 1));
+                std::memcpy(out, &palette[index * 4], 4);
+            } else {
+                const uint8_t* px = row + size_t{x} * (bits / 8);
+                out[0] = px[2];
+                out[1] = px[1];
+                out[2] = px[0];
+                out[3] = bits == 32 ? px[3] : 255;
+                alpha_used = alpha_used || (bits == 32 && px[3] != 0);
+            }
+        }
+    }
+    // Plain 32-bit BMPs leave the fourth byte zero: treat them as opaque
+    if (bits == 32 && !alpha_used) {
+        for (size_t i = 3; i < image.pixels.size(); i += 4) {
+            image.pixels[i] = 255;
+        }
+    }
+    image.has_alpha = detail::any_transparent(image.pixels);
+    return image;
+}
+
+// Decoder chosen by file signature; nullopt (with `error`) for anything else
+inline std::optional<RgbaImage> decode_image(std::span<const uint8_t> file, std::string& error) {
+    if (file.size() >= 8 && std::memcmp(file.data(), detail::PNG_SIGNATURE, 8) == 0) {
+        return decode_png(file, error);
+    }
+    if (file.size() >= 2 && file[0] == 'B' && file[1] == 'M') {
+        return decode_bmp(file, error);
+    }
+    error = "unsupported image format (PNG and BMP can be converted)";
+    return std::nullopt;
+}
+
+// Width and height from the file header, without decoding pixels
+inline std::optional<std::pair<uint32_t, uint32_t>> image_dimensions(std::span<const uint8_t> file) {
+    if (file.size() >= 24 && std::memcmp(file.data(), detail::PNG_SIGNATURE, 8) == 0) {
+        return std::pair{detail::read_be32(file.data() + 16), detail::read_be32(file.data() + 20)};
+    }
+    if (file.size() >= 26 && file[0] == 'B' && file[1] == 'M') {
+        int32_t height = static_cast<int32_t>(detail::read_le32(file.data() + 22));
+        return std::pair{detail::read_le32(file.data() + 18),
+                         static_cast<uint32_t>(height < 0 ? -static_cast<int64_t>(height) : height)};
+    }
+    return std::nullopt;
+}
+
+// ----------------------------------------------------------------------------
+// Pixel kernels: RGBA8 input, LVGL byte order output (little-endian RGB565,
+// B,G,R,A for ARGB8888). SSE2 handles four pixels per step; the scalar
+// versions finish the tail and serve targets without SSE2.
+// ----------------------------------------------------------------------------
+
+namespace kernels {
+
+inline void rgba_to_rgb565_scalar(const uint8_t* rgba, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i, rgba += 4, out += 2) {
+        uint16_t c = static_cast<uint16_t>(((rgba[0] & 0xF8) << 8) | ((rgba[1] & 0xFC) << 3) | (rgba[2] >> 3));
+        out[0] = static_cast<uint8_t>(c);
+        out[1] = static_cast<uint8_t>(c >> 8);
+    }
+}
+
+inline void rgba_to_bgra_scalar(const uint8_t* rgba, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i, rgba += 4, out += 4) {
+        out[0] = rgba[2];
+        out[1] = rgba[1];
+        out[2] = rgba[0];
+        out[3] = rgba[3];
+    }
+}
+
+inline void rgba_alpha_scalar(const uint8_t* rgba, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = rgba[i * 4 + 3];
+    }
+}
+
+inline void rgba_to_rgb565(const uint8_t* rgba, uint8_t* out, size_t count) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i red = _mm_set1_epi32(0xF8);
+    const __m128i green = _mm_set1_epi32(0xFC00);
+    const __m128i blue = _mm_set1_epi32(0xF80000);
+    for (; i + 8 <= count; i += 8) {
+        __m128i halves[2];
+        for (int h = 0; h < 2; ++h) {
+            __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + (i + h * 4) * 4));
+            __m128i c = _mm_or_si128(
+                _mm_or_si128(_mm_slli_epi32(_mm_and_si128(px, red), 8), _mm_srli_epi32(_mm_and_si128(px, green), 5)),
+                _mm_srli_epi32(_mm_and_si128(px, blue), 19));
+            // Sign-extend the low 16 bits so the saturating pack keeps them exactly
+            halves[h] = _mm_srai_epi32(_mm_slli_epi32(c, 16), 16);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_packs_epi32(halves[0], halves[1]));
+    }
+#endif
+    rgba_to_rgb565_scalar(rgba + i * 4, out + i * 2, count - i);
+}
+
+inline void rgba_to_bgra(const uint8_t* rgba, uint8_t* out, size_t count) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+    const __m128i low = _mm_set1_epi32(0xFF);
+    for (; i + 4 <= count; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i * 4));
+        __m128i swapped = _mm_or_si128(_mm_and_si128(px, keep),
+                                       _mm_or_si128(_mm_slli_epi32(_mm_and_si128(px, low), 16),
+                                                    _mm_and_si128(_mm_srli_epi32(px, 16), low)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), swapped);
+    }
+#endif
+    rgba_to_bgra_scalar(rgba + i * 4, out + i * 4, count - i);
+}
+
+inline void rgba_alpha(const uint8_t* rgba, uint8_t* out, size_t count) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= count; i += 16) {
+        __m128i a[4];
+        for (int q = 0; q < 4; ++q) {
+            a[q] = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + (i + q * 4) * 4)), 24);
+        }
+        __m128i words = _mm_packs_epi32(a[0], a[1]);
+        __m128i words2 = _mm_packs_epi32(a[2], a[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words2));
+    }
+#endif
+    rgba_alpha_scalar(rgba + i * 4, out + i, count - i);
+}
+
+} // namespace kernels
+
+// ----------------------------------------------------------------------------
+// Conversion
+// ----------------------------------------------------------------------------
+
+// LVGL RLE (lv_rle.c): a control byte with the high bit set is followed by
+// that many literal blocks; otherwise the next block repeats control-byte
+// times. Blocks are one pixel of the color format.
+inline std::vector<uint8_t> rle_compress(std::span<const uint8_t> data, size_t block) {
+    constexpr size_t MAX_RUN = 127;
+    constexpr size_t MIN_REPEAT = 3;  // Shorter repeats stay in literal runs
+    std::vector<uint8_t> out;
+    out.reserve(data.size() / 2);
+
+    size_t blocks = data.size() / block;
+    auto same = [&](size_t a, size_t b) {
+        return std::memcmp(data.data() + a * block, data.data() + b * block, block) == 0;
+    };
+    auto repeat_at = [&](size_t i) {
+        size_t n = 1;
+        while (i + n < blocks && n < MAX_RUN && same(i, i + n)) {
+            ++n;
+        }
+        return n;
+    };
+
+    for (size_t i = 0; i < blocks;) {
+        size_t repeat = repeat_at(i);
+        if (repeat >= MIN_REPEAT) {
+            out.push_back(static_cast<uint8_t>(repeat));
+            out.insert(out.end(), data.begin() + i * block, data.begin() + (i + 1) * block);
+            i += repeat;
+            continue;
+        }
+        size_t literal = 0;
+        while (i + literal < blocks && literal < MAX_RUN && repeat_at(i + literal) < MIN_REPEAT) {
+            ++literal;
+        }
+        out.push_back(static_cast<uint8_t>(0x80 | literal));
+        out.insert(out.end(), data.begin() + i * block, data.begin() + (i + literal) * block);
+        i += literal;
+    }
+    return out;
+}
+
+// Replace `image.data` with an RLE-compressed copy when that is smaller
+inline void compress_rle(ConvertedImage& image, size_t block) {
+    // The decoder works in whole blocks; pad odd-sized planes (RGB565A8)
+    std::vector<uint8_t> source = image.data;
+    source.resize((source.size() + block - 1) / block * block, 0);
+
+    std::vector<uint8_t> packed = rle_compress(source, block);
+    if (packed.size() + 12 >= image.data.size()) {
+        return;
+    }
+    std::vector<uint8_t> data(12 + packed.size());
+    detail::write_le32(data.data(), COMPRESS_RLE);
+    detail::write_le32(data.data() + 4, static_cast<uint32_t>(packed.size()));
+    detail::write_le32(data.data() + 8, static_cast<uint32_t>(source.size()));
+    std::memcpy(data.data() + 12, packed.data(), packed.size());
+    image.data = std::move(data);
+    image.flags |= IMAGE_FLAG_COMPRESSED;
+}
+
+// Palette of at most 256 colors, or nullopt when the image has more
+inline std::optional<ConvertedImage> convert_indexed(const RgbaImage& image) {
+    size_t pixels = size_t{image.width} * image.height;
+    std::unordered_map<uint32_t, uint8_t> index_of;
+    std::vector<uint32_t> colors;
+    std::vector<uint8_t> indices(pixels);
+    for (size_t i = 0; i < pixels; ++i) {
+        uint32_t color;
+        std::memcpy(&color, &image.pixels[i * 4], 4);
+        auto [it, inserted] = index_of.emplace(color, static_cast<uint8_t>(colors.size()));
+        if (inserted) {
+            if (colors.size() == 256) {
+                return std::nullopt;
+            }
+            colors.push_back(color);
+        }
+        indices[i] = it->second;
+    }
+
+    unsigned bits = colors.size() <= 2 ? 1 : colors.size() <= 4 ? 2 : colors.size() <= 16 ? 4 : 8;
+    ConvertedImage out;
+    out.cf = bits == 1 ? ColorFormat::I1 : bits == 2 ? ColorFormat::I2 : bits == 4 ? ColorFormat::I4 : ColorFormat::I8;
+    out.width = image.width;
+    out.height = image.height;
+    out.stride = (image.width * bits + 7) / 8;
+
+    // lv_color32_t palette (B, G, R, A) padded to 2^bits entries, then indices
+    size_t palette_bytes = (size_t{1} << bits) * 4;
+    out.data.assign(palette_bytes + size_t{out.stride} * image.height, 0);
+    std::vector<uint8_t> palette_rgba(palette_bytes, 0);
+    std::memcpy(palette_rgba.data(), colors.data(), colors.size() * 4);
+    kernels::rgba_to_bgra(palette_rgba.data(), out.data.data(), size_t{1} << bits);
+
+    uint8_t* rows = out.data.data() + palette_bytes;
+    for (uint32_t y = 0; y < image.height; ++y) {
+        uint8_t* row = rows + size_t{y} * out.stride;
+        for (uint32_t x = 0; x < image.width; ++x) {
+            size_t bit = size_t{x} * bits;
+            row[bit / 8] |= static_cast<uint8_t>(indices[size_t{y} * image.width + x] << (8 - bits - bit % 8));
+        }
+    }
+    return out;
+}
+
+// Convert a decoded image to `format` (not Raw). `note` explains a
+// fallback to another format, if one was needed.
+inline ConvertedImage convert_image(const RgbaImage& image, ImageFormat format, bool rle, std::string& note) {
+    size_t pixels = size_t{image.width} * image.height;
+    ConvertedImage out;
+    out.width = image.width;
+    out.height = image.height;
+
+    if (format == ImageFormat::Indexed) {
+        if (auto indexed = convert_indexed(image)) {
+            out = std::move(*indexed);
+        } else {
+            note = "more than 256 colors, using ARGB8888";
+            format = ImageFormat::ARGB8888;
+        }
+    }
+
+    size_t block = 1;
+    if (format == ImageFormat::RGB565) {
+        out.cf = image.has_alpha ? ColorFormat::RGB565A8 : ColorFormat::RGB565;
+        out.stride = image.width * 2;
+        out.data.resize(pixels * (image.has_alpha ? 3 : 2));
+        kernels::rgba_to_rgb565(image.pixels.data(), out.data.data(), pixels);
+        if (image.has_alpha) {
+            // A8 plane follows the color plane
+            kernels::rgba_alpha(image.pixels.data(), out.data.data() + pixels * 2, pixels);
+        }
+        block = 2;
+    } else if (format == ImageFormat::ARGB8888) {
+        out.cf = ColorFormat::ARGB8888;
+        out.stride = image.width * 4;
+        out.data.resize(pixels * 4);
+        kernels::rgba_to_bgra(image.pixels.data(), out.data.data(), pixels);
+        block = 4;
+    }
+
+    if (rle) {
+        compress_rle(out, block);
+    }
+    return out;
+}
+
+} // namespace forma::image
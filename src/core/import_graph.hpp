@@ -0,0 +1,189 @@
+#pragma once
+
+#include "../parser/ir.hpp"
+#include "../plugin_hash.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace forma {
+
+// ============================================================================
+// Source Arena - Owns source text that parsed documents point into
+// ============================================================================
+
+// Documents hold string_views into their source, so the text has to live
+// as long as any document parsed from it. Strings are stored in a deque,
+// which never relocates existing elements, and views handed out stay valid
+// until the arena is destroyed.
+class SourceArena {
+public:
+    std::string_view store(std::string text) {
+        std::lock_guard lock(mutex);
+        return sources.emplace_back(std::move(text));
+    }
+
+    size_t size() const {
+        std::lock_guard lock(mutex);
+        return sources.size();
+    }
+
+private:
+    std::deque<std::string> sources;
+    mutable std::mutex mutex;
+};
+
+// Read a whole file with a single sized read
+inline bool read_source(const std::filesystem::path& path, std::string& out) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    auto size = file.tellg();
+    if (size < 0) {
+        return false;
+    }
+    out.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    return static_cast<bool>(file.read(out.data(), size));
+}
+
+// ============================================================================
+// Import Graph - Loads every module reachable from a document's imports
+// ============================================================================
+
+struct ImportedModule {
+    std::string module_path;     // "components.Button"
+    std::string canonical_path;  // Absolute, normalized file path
+    std::unique_ptr<RuntimeDocument> doc;
+    uint64_t content_hash = 0;   // fnv1a_hash of the source text
+    double read_ms = 0.0;
+    double parse_ms = 0.0;
+    bool found = false;
+};
+
+// Modules are discovered breadth first. Each wave holds the not-yet-seen
+// imports of the previous wave; files within a wave are independent, so
+// they are read and parsed concurrently. Deduplication happens on the
+// calling thread between waves, so the canonical path set needs no lock.
+class ImportGraph {
+public:
+    ImportGraph() = default;
+    ImportGraph(ImportGraph&&) = default;
+    ImportGraph& operator=(ImportGraph&&) = default;
+
+    // Load all modules imported (transitively) by `doc`. Import paths are
+    // resolved relative to the directory of `input_file`. Returns false if
+    // any import could not be read; see missing() for which.
+    template <typename DocType>
+    bool load(const DocType& doc, const std::string& input_file,
+              size_t max_threads = ThreadPool::default_thread_count()) {
+        base_dir = std::filesystem::path(input_file).parent_path();
+        loaded_paths.insert(std::filesystem::absolute(input_file).lexically_normal().string());
+
+        std::vector<ImportedModule> wave;
+        enqueue_imports(doc, wave);
+
+        std::unique_ptr<ThreadPool> pool;
+        bool ok = true;
+        while (!wave.empty()) {
+            if (wave.size() == 1 || max_threads <= 1) {
+                for (auto& module : wave) {
+                    load_module(module);
+                }
+            } else {
+                if (!pool) {
+                    pool = std::make_unique<ThreadPool>(max_threads);
+                }
+                for (auto& module : wave) {
+                    pool->submit([this, &module] { load_module(module); });
+                }
+                pool->wait();
+            }
+
+            std::vector<ImportedModule> next_wave;
+            for (auto& module : wave) {
+                if (!module.found) {
+                    ok = false;
+                    missing_modules.push_back(module.module_path);
+                    continue;
+                }
+                enqueue_imports(*module.doc, next_wave);
+                modules.push_back(std::move(module));
+            }
+            wave = std::move(next_wave);
+        }
+
+        return ok;
+    }
+
+    const std::vector<ImportedModule>& loaded() const { return modules; }
+    const std::vector<std::string>& missing() const { return missing_modules; }
+
+    // Files seen, including the root document
+    size_t file_count() const { return loaded_paths.size(); }
+
+    static std::string module_to_file(std::string_view module_path) {
+        // Convert dot notation to file path: components.Button -> components/Button.fml
+        std::string file_path(module_path);
+        std::replace(file_path.begin(), file_path.end(), '.', '/');
+        file_path += ".fml";
+        return file_path;
+    }
+
+private:
+    std::filesystem::path base_dir;
+    std::unique_ptr<SourceArena> sources = std::make_unique<SourceArena>();
+    std::unordered_set<std::string> loaded_paths;
+    std::vector<ImportedModule> modules;
+    std::vector<std::string> missing_modules;
+
+    template <typename DocType>
+    void enqueue_imports(const DocType& doc, std::vector<ImportedModule>& wave) {
+        for (size_t i = 0; i < doc.import_count; ++i) {
+            std::string_view import_path = doc.imports[i].module_path;
+            auto full_path = (base_dir / module_to_file(import_path)).lexically_normal();
+            auto canonical_path = std::filesystem::absolute(full_path).string();
+
+            // Skip if already loaded or queued
+            if (!loaded_paths.insert(canonical_path).second) {
+                continue;
+            }
+
+            ImportedModule module;
+            module.module_path = std::string(import_path);
+            module.canonical_path = std::move(canonical_path);
+            wave.push_back(std::move(module));
+        }
+    }
+
+    void load_module(ImportedModule& module) {
+        using clock = std::chrono::steady_clock;
+
+        auto start = clock::now();
+        std::string text;
+        module.found = read_source(module.canonical_path, text);
+        auto read_done = clock::now();
+        module.read_ms = std::chrono::duration<double, std::milli>(read_done - start).count();
+        if (!module.found) {
+            return;
+        }
+
+        module.content_hash = fnv1a_hash(text);
+        std::string_view source = sources->store(std::move(text));
+        module.doc = std::make_unique<RuntimeDocument>(parse_document_runtime(source));
+        module.parse_ms = std::chrono::duration<double, std::milli>(clock::now() - read_done).count();
+    }
+};
+
+} // namespace forma
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace forma::image {
+
+// ============================================================================
+// Inflate - zlib/DEFLATE decoder (RFC 1950/1951) for PNG image data
+// ============================================================================
+
+namespace detail {
+
+// LSB-first bit reader with a 64-bit reservoir. Reads past the end are
+// padded with zeros and counted, so truncated streams are detected once
+// the padding is actually consumed.
+class BitReader {
+public:
+    explicit BitReader(std::span<const uint8_t> input)
+        : p(input.data()), end(input.data() + input.size()) {}
+
+    uint32_t peek(int n) {
+        if (count < n) {
+            refill();
+        }
+        return static_cast<uint32_t>(bits & ((uint64_t{1} << n) - 1));
+    }
+
+    void consume(int n) {
+        bits >>= n;
+        count -= n;
+    }
+
+    uint32_t take(int n) {
+        uint32_t value = peek(n);
+        consume(n);
+        return value;
+    }
+
+    void align() { consume(count % 8); }
+
+    bool overrun() const { return count < padding * 8; }
+
+    // Input after the last bit consumed, once aligned
+    size_t remaining_bytes() const {
+        return static_cast<size_t>(end - p) + static_cast<size_t>(count / 8) - padding;
+    }
+
+private:
+    void refill() {
+        while (count <= 56) {
+            uint64_t byte = 0;
+            if (p < end) {
+                byte = *p++;
+            } else {
+                ++padding;
+            }
+            bits |= byte << count;
+            count += 8;
+        }
+    }
+
+    const uint8_t* p;
+    const uint8_t* end;
+    uint64_t bits = 0;
+    int count = 0;
+    int padding = 0;
+};
+
+// Canonical Huffman code. Codes up to FAST_BITS long resolve with one
+// table lookup; longer ones fall back to the canonical bit-by-bit walk.
+struct Huffman {
+    static constexpr int MAX_BITS = 15;
+    static constexpr int FAST_BITS = 10;
+
+    std::array<uint16_t, MAX_BITS + 1> count{};
+    std::array<uint16_t, 320> symbol{};
+    std::array<uint16_t, 1 << FAST_BITS> fast{};  // (length << 9) | symbol, 0 = slow path
+
+    // Incomplete codes are allowed (a single distance code is legal);
+    // over-subscribed ones are not
+    bool build(const uint8_t* lengths, int n) {
+        count.fill(0);
+        for (int i = 0; i < n; ++i) {
+            ++count[lengths[i]];
+        }
+        count[0] = 0;
+
+        int left = 1;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            left = (left << 1) - count[len];
+            if (left < 0) {
+                return false;
+            }
+        }
+
+        std::array<uint16_t, MAX_BITS + 2> offsets{};
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            offsets[len + 1] = static_cast<uint16_t>(offsets[len] + count[len]);
+        }
+        for (int i = 0; i < n; ++i) {
+            if (lengths[i]) {
+                symbol[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+            }
+        }
+
+        fast.fill(0);
+        uint32_t code = 0;
+        int index = 0;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            for (int k = 0; k < count[len]; ++k, ++code) {
+                uint16_t sym = symbol[index++];
+                if (len > FAST_BITS) {
+                    continue;
+                }
+                // Deflate sends Huffman codes most significant bit first
+                uint32_t reversed = 0;
+                for (int b = 0; b < len; ++b) {
+                    reversed |= ((code >> b) & 1) << (len - 1 - b);
+                }
+                for (uint32_t r = reversed; r < fast.size(); r += 1u << len) {
+                    fast[r] = static_cast<uint16_t>((len << 9) | sym);
+                }
+            }
+            code <<= 1;
+        }
+        return true;
+    }
+
+    int decode(BitReader& in) const {
+        uint32_t bits = in.peek(MAX_BITS);
+        uint16_t entry = fast[bits & ((1u << FAST_BITS) - 1)];
+        if (entry) {
+            in.consume(entry >> 9);
+            return entry & 511;
+        }
+
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            code |= static_cast<int>((bits >> (len - 1)) & 1);
+            if (code - first < count[len]) {
+                in.consume(len);
+                return symbol[index + code - first];
+            }
+            index += count[len];
+            first = (first + count[len]) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+};
+
+inline constexpr std::array<uint16_t, 29> LENGTH_BASE = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+inline constexpr std::array<uint8_t, 29> LENGTH_EXTRA = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+inline constexpr std::array<uint16_t, 30> DIST_BASE = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+inline constexpr std::array<uint8_t, 30> DIST_EXTRA = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+inline bool inflate_codes(BitReader& in, std::vector<uint8_t>& out, size_t max_size, const Huffman& lit,
+                          const Huffman& dist) {
+    while (true) {
+        int sym = lit.decode(in);
+        if (sym < 0 || in.overrun()) {
+            return false;
+        }
+        if (sym < 256) {
+            if (out.size() >= max_size) {
+                return false;
+            }
+            out.push_back(static_cast<uint8_t>(sym));
+            continue;
+        }
+        if (sym == 256) {
+            return true;
+        }
+        sym -= 257;
+        if (sym >= static_cast<int>(LENGTH_BASE.size())) {
+            return false;
+        }
+        size_t length = LENGTH_BASE[sym] + in.take(LENGTH_EXTRA[sym]);
+
+        int dsym = dist.decode(in);
+        if (dsym < 0 || dsym >= static_cast<int>(DIST_BASE.size())) {
+            return false;
+        }
+        size_t distance = DIST_BASE[dsym] + in.take(DIST_EXTRA[dsym]);
+        if (distance > out.size() || length > max_size - out.size() || in.overrun()) {
+            return false;
+        }
+
+        // Byte-wise: source and destination overlap when distance < length
+        size_t from = out.size() - distance;
+        out.resize(out.size() + length);
+        uint8_t* data = out.data();
+        for (size_t i = 0; i < length; ++i) {
+            data[from + distance + i] = data[from + i];
+        }
+    }
+}
+
+inline bool inflate_dynamic(BitReader& in, std::vector<uint8_t>& out, size_t max_size) {
+    static constexpr std::array<uint8_t, 19> ORDER = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    int nlen = static_cast<int>(in.take(5)) + 257;
+    int ndist = static_cast<int>(in.take(5)) + 1;
+    int ncode = static_cast<int>(in.take(4)) + 4;
+    if (nlen > 286 || ndist > 30) {
+        return false;
+    }
+
+    std::array<uint8_t, 320> lengths{};
+    for (int i = 0; i < ncode; ++i) {
+        lengths[ORDER[i]] = static_cast<uint8_t>(in.take(3));
+    }
+    Huffman code_lengths;
+    if (!code_lengths.build(lengths.data(), 19)) {
+        return false;
+    }
+
+    lengths.fill(0);
+    for (int i = 0; i < nlen + ndist;) {
+        int sym = code_lengths.decode(in);
+        if (sym < 0) {
+            return false;
+        }
+        if (sym < 16) {
+            lengths[i++] = static_cast<uint8_t>(sym);
+            continue;
+        }
+        uint8_t value = 0;
+        int repeat;
+        if (sym == 16) {
+            if (i == 0) {
+                return false;
+            }
+            value = lengths[i - 1];
+            repeat = 3 + static_cast<int>(in.take(2));
+        } else if (sym == 17) {
+            repeat = 3 + static_cast<int>(in.take(3));
+        } else {
+            repeat = 11 + static_cast<int>(in.take(7));
+        }
+        if (i + repeat > nlen + ndist) {
+            return false;
+        }
+        while (repeat--) {
+            lengths[i++] = value;
+        }
+    }
+    if (lengths[256] == 0) {
+        return false;  // No end-of-block code
+    }
+
+    Huffman lit;
+    Huffman dist;
+    if (!lit.build(lengths.data(), nlen) || !dist.build(lengths.data() + nlen, ndist)) {
+        return false;
+    }
+    return inflate_codes(in, out, max_size, lit, dist);
+}
+
+inline bool inflate_fixed(BitReader& in, std::vector<uint8_t>& out, size_t max_size) {
+    static const auto tables = [] {
+        std::array<uint8_t, 288> lengths{};
+        for (int i = 0; i < 144; ++i) lengths[i] = 8;
+        for (int i = 144; i < 256; ++i) lengths[i] = 9;
+        for (int i = 256; i < 280; ++i) lengths[i] = 7;
+        for (int i = 280; i < 288; ++i) lengths[i] = 8;
+        std::array<uint8_t, 30> distances;
+        distances.fill(5);
+        std::pair<Huffman, Huffman> built;
+        built.first.build(lengths.data(), 288);
+        built.second.build(distances.data(), 30);
+        return built;
+    }();
+    return inflate_codes(in, out, max_size, tables.first, tables.second);
+}
+
+inline bool inflate_stored(BitReader& in, std::vector<uint8_t>& out, size_t max_size) {
+    in.align();
+    uint32_t length = in.take(16);
+    uint32_t complement = in.take(16);
+    if ((length ^ 0xFFFF) != complement || length > in.remaining_bytes() || length > max_size - out.size()) {
+        return false;
+    }
+    size_t start = out.size();
+    out.resize(start + length);
+    for (uint32_t i = 0; i < length; ++i) {
+        out[start + i] = static_cast<uint8_t>(in.take(8));
+    }
+    return true;
+}
+
+inline uint32_t adler32(std::span<const uint8_t> data) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (!data.empty()) {
+        // Largest block before the sums can overflow 32 bits
+        size_t n = std::min<size_t>(data.size(), 5552);
+        for (size_t i = 0; i < n; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data = data.subspan(n);
+    }
+    return (b << 16) | a;
+}
+
+} // namespace detail
+
+// Decompress a raw DEFLATE stream, appending to `out`. Fails as soon as
+// `out` would grow past `max_size` bytes.
+inline bool inflate(std::span<const uint8_t> input, std::vector<uint8_t>& out, size_t max_size = SIZE_MAX) {
+    detail::BitReader in(input);
+    bool last = false;
+    while (!last) {
+        last = in.take(1) != 0;
+        bool ok;
+        switch (in.take(2)) {
+            case 0: ok = detail::inflate_stored(in, out, max_size); break;
+            case 1: ok = detail::inflate_fixed(in, out, max_size); break;
+            case 2: ok = detail::inflate_dynamic(in, out, max_size); break;
+            default: ok = false; break;
+        }
+        if (!ok || in.overrun()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decompress a zlib stream (header, DEFLATE data, Adler-32 trailer).
+// Output beyond `max_size` bytes fails the decode, so a tiny stream cannot
+// expand without bound. `max_size` usually comes from an untrusted file
+// header, so it is not reserved up front: the output starts at a few times
+// the input and grows geometrically from there.
+inline bool zlib_decompress(std::span<const uint8_t> input, std::vector<uint8_t>& out, size_t max_size = SIZE_MAX) {
+    if (input.size() < 6) {
+        return false;
+    }
+    uint8_t cmf = input[0];
+    uint8_t flg = input[1];
+    if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) {
+        return false;  // Not deflate, bad check bits, or preset dictionary
+    }
+
+    out.clear();
+    out.reserve(std::min(max_size, input.size() * 4));
+    if (!inflate(input.subspan(2, input.size() - 6), out, max_size)) {
+        return false;
+    }
+
+    const uint8_t* trailer = input.data() + input.size() - 4;
+    uint32_t expected = (uint32_t{trailer[0]} << 24) | (uint32_t{trailer[1]} << 16) |
+                        (uint32_t{trailer[2]} << 8) | trailer[3];
+    return detail::adler32(out) == expected;
+}
+
+} // namespace forma::image
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "write_stream.hpp"
+
+namespace forma::io {
+
+// ============================================================================
+// Output Sinks - Destinations for generated code
+// ============================================================================
+
+// Code generators append through a sink instead of owning a buffer, so the
+// same generator can fill a fixed constexpr buffer, a growable in-memory
+// buffer, or stream straight to a file.
+template <typename S>
+concept OutputSink = requires(S sink, const S csink, char c, std::string_view text) {
+    sink.put(c);
+    sink.write(text);
+    sink.clear();
+    { csink.size() } -> std::convertible_to<size_t>;
+    { csink.overflowed() } -> std::convertible_to<bool>;
+};
+
+// Fixed-capacity buffer, usable at compile time. Output past capacity is
+// dropped and reported through overflowed(); one byte is kept for the
+// terminating NUL so c_str() is always valid.
+template <size_t Capacity>
+class FixedBufferSink {
+public:
+    constexpr void put(char c) {
+        if (pos < Capacity - 1) {
+            buffer[pos++] = c;
+            buffer[pos] = '\0';
+        } else {
+            overflow = true;
+        }
+    }
+
+    constexpr void write(std::string_view text) {
+        for (char c : text) {
+            put(c);
+        }
+    }
+
+    constexpr void clear() {
+        pos = 0;
+        buffer[0] = '\0';
+        overflow = false;
+    }
+
+    constexpr size_t size() const { return pos; }
+    constexpr bool overflowed() const { return overflow; }
+    static constexpr size_t capacity() { return Capacity; }
+
+    constexpr std::string_view view() const { return std::string_view(buffer.data(), pos); }
+    constexpr const char* c_str() const { return buffer.data(); }
+
+private:
+    std::array<char, Capacity> buffer{};
+    size_t pos = 0;
+    bool overflow = false;
+};
+
+// Growable buffer made of fixed-size chunks. Growing never copies what was
+// already written, unlike a single std::string doubling its capacity.
+class ChunkedBufferSink {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    void put(char c) {
+        if (chunks.empty() || chunks.back().size() == CHUNK_SIZE) {
+            next_chunk();
+        }
+        chunks.back().push_back(c);
+        ++total;
+    }
+
+    void write(std::string_view text) {
+        while (!text.empty()) {
+            if (chunks.empty() || chunks.back().size() == CHUNK_SIZE) {
+                next_chunk();
+            }
+            auto& chunk = chunks.back();
+            size_t n = std::min(text.size(), CHUNK_SIZE - chunk.size());
+            chunk.append(text.data(), n);
+            text.remove_prefix(n);
+            total += n;
+        }
+    }
+
+    void clear() {
+        chunks.clear();
+        total = 0;
+    }
+
+    size_t size() const { return total; }
+    bool overflowed() const { return false; }
+
+    const std::vector<std::string>& get_chunks() const { return chunks; }
+
+    // Copy out as one contiguous string
+    std::string str() const {
+        std::string out;
+        out.reserve(total);
+        for (const auto& chunk : chunks) {
+            out += chunk;
+        }
+        return out;
+    }
+
+    // Write all chunks to a stream; returns false on a short write
+    bool write_to(IWriteStream& stream) const {
+        for (const auto& chunk : chunks) {
+            if (stream.write(chunk.data(), chunk.size()) != chunk.size()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<std::string> chunks;
+    size_t total = 0;
+
+    void next_chunk() {
+        chunks.emplace_back();
+        chunks.back().reserve(CHUNK_SIZE);
+    }
+};
+
+// Streams output to an IWriteStream through a small staging buffer, so
+// memory use does not depend on the size of the generated file. A short
+// write from the stream is reported through overflowed(). clear() only
+// discards output that has not been flushed yet.
+class WriteStreamSink {
+public:
+    static constexpr size_t BUFFER_SIZE = 8 * 1024;
+
+    explicit WriteStreamSink(IWriteStream& stream) : stream(&stream) {}
+
+    WriteStreamSink(WriteStreamSink&& other) noexcept
+        : stream(other.stream), buffer(other.buffer), used(other.used),
+          total(other.total), failed(other.failed) {
+        other.stream = nullptr;
+        other.used = 0;
+    }
+
+    WriteStreamSink(const WriteStreamSink&) = delete;
+    WriteStreamSink& operator=(const WriteStreamSink&) = delete;
+    WriteStreamSink& operator=(WriteStreamSink&&) = delete;
+
+    ~WriteStreamSink() {
+        flush();
+    }
+
+    void put(char c) {
+        if (used == BUFFER_SIZE) {
+            flush();
+        }
+        buffer[used++] = c;
+        ++total;
+    }
+
+    void write(std::string_view text) {
+        if (text.size() >= BUFFER_SIZE) {
+            flush();
+            emit(text.data(), text.size());
+            total += text.size();
+            return;
+        }
+        if (used + text.size() > BUFFER_SIZE) {
+            flush();
+        }
+        text.copy(buffer.data() + used, text.size());
+        used += text.size();
+        total += text.size();
+    }
+
+    void clear() {
+        total -= used;
+        used = 0;
+    }
+
+    void flush() {
+        if (used > 0) {
+            emit(buffer.data(), used);
+            used = 0;
+        }
+    }
+
+    size_t size() const { return total; }
+    bool overflowed() const { return failed; }
+
+private:
+    IWriteStream* stream;
+    std::array<char, BUFFER_SIZE> buffer{};
+    size_t used = 0;
+    size_t total = 0;
+    bool failed = false;
+
+    void emit(const char* data, size_t len) {
+        if (!stream || stream->write(data, len) != len) {
+            failed = true;
+        }
+    }
+};
+
+static_assert(OutputSink<FixedBufferSink<16>>);
+static_assert(OutputSink<ChunkedBufferSink>);
+static_assert(OutputSink<WriteStreamSink>);
+
+} // namespace forma::io
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <fstream>
@@ -78,6 +80,33 @@ struct StreamIO {
         return s;
     }
 
+    // The same operations, one at a time: `io` is only entered with a shared
+    // lock held, so it can be handed to plugins rendering concurrently. A
+    // stream is opened under the lock but written without it, so concurrent
+    // streams must target different paths.
+    static StreamIO serialized(StreamIO io) {
+        auto mutex = std::make_shared<std::mutex>();
+        auto inner = std::make_shared<StreamIO>(std::move(io));
+        StreamIO s;
+        s.open_read = [mutex, inner](const std::string& path) -> std::optional<std::string> {
+            std::lock_guard lock(*mutex);
+            return inner->open_read(path);
+        };
+        s.open_write = [mutex, inner](const std::string& path, const std::string& contents) -> bool {
+            std::lock_guard lock(*mutex);
+            return inner->open_write(path, contents);
+        };
+        s.open_write_stream = [mutex, inner](const std::string& path) -> forma::io::WriteStreamPtr {
+            std::lock_guard lock(*mutex);
+            return inner->open_write_stream(path);
+        };
+        s.create_dirs = [mutex, inner](const std::string& path) -> bool {
+            std::lock_guard lock(*mutex);
+            return inner->create_dirs(path);
+        };
+        return s;
+    }
+
     // Default implementations that use the host filesystem (std::ifstream/ofstream)
     static std::optional<std::string> default_open_read(const std::string& path) {
         std::ifstream f(path, std::ios::binary);
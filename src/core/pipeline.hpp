@@ -3,13 +3,13 @@
 #include "../parser/ir.hpp"
 #include "../parser/semantic.hpp"
 #include "assets.hpp"
+#include "asset_bundle.hpp"
+#include "font_atlas.hpp"
+#include "import_graph.hpp"
 #include "../../plugins/tracer/src/tracer_plugin.hpp"
+#include <cstdio>
 #include <string>
 #include <vector>
-#include <fstream>
-#include <sstream>
-#include <filesystem>
-#include <algorithm>
 
 namespace forma::pipeline {
 
@@ -17,70 +17,46 @@ namespace forma::pipeline {
 // Compilation Pipeline - Core compilation stages
 // ============================================================================
 
-// Resolve imports and load imported modules
+// Resolve imports and load imported modules. The returned graph owns the
+// imported documents and their sources; keep it alive while they are used.
+// Unresolved imports are reported through the tracer and listed in
+// graph.missing(); callers decide whether to stop.
 template<typename DocType>
-void resolve_imports(DocType& doc, const std::string& input_file, forma::tracer::TracerPlugin& tracer) {
+[[nodiscard]] forma::ImportGraph resolve_imports(DocType& doc, const std::string& input_file,
+                                                 forma::tracer::TracerPlugin& tracer,
+                                                 size_t max_threads = forma::ThreadPool::default_thread_count()) {
+    forma::ImportGraph graph;
     if (doc.import_count == 0) {
-        return;
+        return graph;
     }
     
     tracer.begin_stage("Resolving imports");
     
-    std::vector<std::string> loaded_files;
-    loaded_files.push_back(std::filesystem::absolute(input_file).string());
+    bool ok = graph.load(doc, input_file, max_threads);
     
-    std::vector<DocType> imported_docs;
-    std::vector<DocType> to_process;
-    to_process.push_back(doc);
-    
-    auto base_dir = std::filesystem::path(input_file).parent_path();
+    // Workers only record timings; all output happens here, in load order
+    for (const auto& module : graph.loaded()) {
+        tracer.verbose(std::string("  Loaded: ") + module.module_path);
+        tracer.verbose(std::string("    Types: ") + std::to_string(module.doc->type_count) + 
+                     ", Enums: " + std::to_string(module.doc->enum_count));
+        char timing[64];
+        std::snprintf(timing, sizeof(timing), "read %.2f ms, parse %.2f ms",
+                      module.read_ms, module.parse_ms);
+        tracer.stat(module.canonical_path, timing);
+    }
     
-    while (!to_process.empty()) {
-        auto current_doc = to_process.back();
-        to_process.pop_back();
-        
-        for (size_t i = 0; i < current_doc.import_count; ++i) {
-            const auto& import_decl = current_doc.imports[i];
-            std::string import_path(import_decl.module_path.data(), import_decl.module_path.size());
-            
-            // Convert dot notation to file path: components.Button -> components/Button.fml
-            std::string file_path = import_path;
-            std::replace(file_path.begin(), file_path.end(), '.', '/');
-            file_path += ".fml";
-            
-            auto full_path = (base_dir / file_path).lexically_normal();
-            auto canonical_path = std::filesystem::absolute(full_path).string();
-            
-            // Skip if already loaded
-            if (std::find(loaded_files.begin(), loaded_files.end(), canonical_path) != loaded_files.end()) {
-                tracer.verbose(std::string("  Already loaded: ") + import_path);
-                continue;
-            }
-            
-            if (!std::filesystem::exists(full_path)) {
-                tracer.error(std::string("Import not found: ") + import_path + " (" + file_path + ")");
-                std::exit(1);
-            }
-            
-            tracer.verbose(std::string("  Loading: ") + import_path);
-            
-            std::ifstream import_file(full_path);
-            std::stringstream import_buffer;
-            import_buffer << import_file.rdbuf();
-            std::string import_source = import_buffer.str();
-            
-            auto imported = forma::parse_document(import_source);
-            imported_docs.push_back(imported);
-            to_process.push_back(imported);
-            loaded_files.push_back(canonical_path);
-            
-            tracer.verbose(std::string("    Types: ") + std::to_string(imported.type_count) + 
-                         ", Enums: " + std::to_string(imported.enum_count));
+    if (!ok) {
+        for (const auto& import_path : graph.missing()) {
+            tracer.error(std::string("Import not found: ") + import_path + " (" +
+                         forma::ImportGraph::module_to_file(import_path) + ")");
         }
+        tracer.end_stage();
+        return graph;
     }
     
-    tracer.stat("Total files loaded", loaded_files.size());
+    tracer.stat("Total files loaded", static_cast<int>(graph.file_count()));
     tracer.end_stage();
+    return graph;
 }
 
 // Run semantic analysis and type checking
@@ -143,4 +119,68 @@ void collect_assets(DocType& doc, forma::tracer::TracerPlugin& tracer) {
     tracer.end_stage();
 }
 
+// Rasterize fonts into LVGL bitmap fonts holding only the glyphs `usage`
+// needs. Returns the font URIs that no longer have to be bundled as files;
+// fonts that cannot be rasterized are left to the asset bundle.
+inline std::vector<std::string> build_fonts(std::span<const std::string> font_uris, const forma::FontUsage& usage,
+                                            const std::string& project_dir, const forma::FontAtlasOptions& options,
+                                            forma::fs::IFileSystem& fs, forma::tracer::TracerPlugin& tracer) {
+    tracer.begin_stage("Building fonts");
+    auto result = forma::build_font_atlases(font_uris, usage, project_dir, options, fs);
+    for (const auto& warning : result.warnings) {
+        tracer.warning(warning);
+    }
+
+    size_t glyphs = 0;
+    size_t cached = 0;
+    for (const auto& font : result.fonts) {
+        glyphs += font.glyphs;
+        cached += font.cached;
+        tracer.verbose("  " + font.symbol + " (" + std::to_string(font.glyphs) + " glyphs" +
+                       (font.missing ? ", " + std::to_string(font.missing) + " missing" : "") +
+                       (font.cached ? ", cached)" : ")"));
+    }
+    tracer.stat("Fonts", result.fonts.size());
+    tracer.stat("Glyphs", glyphs);
+    tracer.stat("Cached", cached);
+    tracer.end_stage();
+    return result.rasterized;
+}
+
+// Write the referenced assets into generated C sources. Returns false if an
+// asset could not be read or the output could not be written.
+inline bool bundle_assets(std::span<const std::string> uris, const std::string& project_dir,
+                          const forma::AssetBundleOptions& options, forma::fs::IFileSystem& fs,
+                          forma::tracer::TracerPlugin& tracer) {
+    tracer.begin_stage("Bundling assets");
+    auto result = forma::bundle_assets(uris, project_dir, options, fs);
+    for (const auto& error : result.errors) {
+        tracer.error(error);
+    }
+    for (const auto& warning : result.warnings) {
+        tracer.warning(warning);
+    }
+
+    size_t duplicates = 0;
+    for (size_t i = 0; i < result.assets.size(); ++i) {
+        if (result.assets[i].canonical != i) {
+            ++duplicates;
+            tracer.verbose("  " + result.assets[i].uri + " (same as " +
+                           result.assets[result.assets[i].canonical].uri + ")");
+        } else {
+            tracer.verbose("  " + result.assets[i].uri + " (" + std::to_string(result.assets[i].size) + " bytes)");
+        }
+    }
+    tracer.stat("Assets bundled", result.assets.size());
+    tracer.stat("Duplicates", duplicates);
+    tracer.stat("Images converted", result.converted);
+    tracer.stat("Bytes", result.unique_bytes);
+    tracer.stat("Generated sources", result.outputs.size());
+    if (!result.written) {
+        tracer.verbose("Asset bundle up to date");
+    }
+    tracer.end_stage();
+    return result.errors.empty();
+}
+
 } // namespace forma::pipeline
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "../plugin_loader.hpp"
+#include "fs/i_file_system.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace forma {
+
+// ============================================================================
+// Render Targets - Several renderers over one parsed document
+// ============================================================================
+
+// Split a --renderer value such as "lvgl, cpp,json" into renderer names,
+// trimmed, without empty or repeated entries
+inline std::vector<std::string> split_renderers(std::string_view renderer) {
+    std::vector<std::string> names;
+    while (!renderer.empty()) {
+        size_t comma = renderer.find(',');
+        std::string_view name = renderer.substr(0, comma);
+        renderer = comma == std::string_view::npos ? std::string_view{} : renderer.substr(comma + 1);
+
+        size_t first = name.find_first_not_of(" \t");
+        if (first == std::string_view::npos) {
+            continue;
+        }
+        name = name.substr(first, name.find_last_not_of(" \t") - first + 1);
+        if (std::find(names.begin(), names.end(), name) == names.end()) {
+            names.emplace_back(name);
+        }
+    }
+    return names;
+}
+
+// Matching renderer plugin: exact name match, then a renderer providing
+// "renderer:<name>". Only metadata is consulted, so lazily loaded plugins
+// that are not selected are never opened.
+inline LoadedPlugin* find_renderer(IPluginLoader& plugin_loader, const std::string& name) {
+    for (const auto& plugin : plugin_loader.get_loaded_plugins()) {
+        if (plugin->metadata && plugin->metadata->is_renderer() && plugin->metadata->name == name) {
+            return plugin.get();
+        }
+    }
+    auto* provider = plugin_loader.find_provider("renderer:" + name);
+    if (provider && provider->metadata->is_renderer()) {
+        return provider;
+    }
+    return nullptr;
+}
+
+// One renderer of a compile, with everything resolved on the main thread
+struct RenderTarget {
+    LoadedPlugin* plugin = nullptr;
+    std::string name;
+    std::string output_file;
+    RendererAdapter adapter;
+    bool ok = false;
+};
+
+inline std::string output_extension(const LoadedPlugin& plugin) {
+    return plugin.metadata->output_extension.empty() ? std::string(".gen")  // default fallback
+                                                     : plugin.metadata->output_extension;
+}
+
+// One target per distinct plugin, in first-mention order: an alias and
+// the plugin's own name (--renderer c,c-codegen) must not become two
+// renders writing the same file. Targets sharing an extension (lvgl and
+// c-codegen both emit .c) get the renderer name in the file name. The
+// adapters are left for the caller to resolve.
+inline std::vector<RenderTarget> plan_render_targets(std::span<LoadedPlugin* const> plugins,
+                                                     const std::string& output_base) {
+    std::vector<LoadedPlugin*> distinct;
+    for (auto* plugin : plugins) {
+        if (std::find(distinct.begin(), distinct.end(), plugin) == distinct.end()) {
+            distinct.push_back(plugin);
+        }
+    }
+
+    std::vector<RenderTarget> targets;
+    targets.reserve(distinct.size());
+    for (auto* plugin : distinct) {
+        std::string extension = output_extension(*plugin);
+        auto sharing = std::count_if(distinct.begin(), distinct.end(),
+                                     [&](const LoadedPlugin* other) { return output_extension(*other) == extension; });
+        RenderTarget target;
+        target.plugin = plugin;
+        target.name = plugin->metadata->name;
+        target.output_file = sharing > 1 ? output_base + "." + target.name + extension : output_base + extension;
+        targets.push_back(std::move(target));
+    }
+    return targets;
+}
+
+// Run every target's adapter against the same document, concurrently
+// when there are several; each target's `ok` reports its result. `fs` is
+// shared by the renders and must be safe to use from several threads.
+template<typename DocType>
+void render_targets(const DocType& doc, const std::string& input_file, std::span<RenderTarget> targets,
+                    fs::IFileSystem& fs) {
+    auto render = [&](RenderTarget& target) {
+        target.ok = target.adapter && target.adapter(&doc, input_file, target.output_file, fs);
+    };
+    if (targets.size() == 1) {
+        render(targets.front());
+        return;
+    }
+    ThreadPool pool(std::min(targets.size(), ThreadPool::default_thread_count()));
+    for (auto& target : targets) {
+        pool.submit([&render, &target] { render(target); });
+    }
+    pool.wait();
+}
+
+} // namespace forma
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace forma {
+
+// ============================================================================
+// Thread Pool - Work-stealing workers, one task deque per worker
+// ============================================================================
+
+// Submitted tasks are spread round-robin over the worker deques. A worker
+// pops from the back of its own deque and, when that is empty, steals from
+// the front of the others, so one slow task (a large screen) does not hold
+// up the tasks queued behind it.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = default_thread_count()) {
+        thread_count = std::max<size_t>(thread_count, 1);
+        queues.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i) {
+            queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        workers.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers.emplace_back([this, i] { worker_loop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(state_mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Safe to call from inside a running task. The counters are raised
+    // before the task is published, so a worker can never take (and finish)
+    // a task the counters do not yet account for.
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard lock(state_mutex);
+            ++pending;
+            ++queued;
+        }
+        auto& queue = *queues[next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+        {
+            std::lock_guard lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        work_available.notify_one();
+    }
+
+    // Block until every submitted task has finished
+    void wait() {
+        std::unique_lock lock(state_mutex);
+        all_done.wait(lock, [this] { return pending == 0; });
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    // Tasks taken from another worker's deque since construction
+    size_t stolen_count() const {
+        return stolen.load(std::memory_order_relaxed);
+    }
+
+    static size_t default_thread_count() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next_queue{0};
+    std::atomic<size_t> stolen{0};
+
+    std::mutex state_mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    size_t pending = 0;  // Submitted and not yet finished
+    size_t queued = 0;   // Submitted and not yet taken by a worker
+    bool stopping = false;
+
+    bool take_task(size_t index, std::function<void()>& task) {
+        {
+            auto& own = *queues[index];
+            std::lock_guard lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            auto& victim = *queues[(index + offset) % queues.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                stolen.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(size_t index) {
+        for (;;) {
+            std::function<void()> task;
+            if (!take_task(index, task)) {
+                std::unique_lock lock(state_mutex);
+                work_available.wait(lock, [this] { return stopping || queued > 0; });
+                if (stopping && queued == 0) {
+                    return; // stopping and drained
+                }
+                continue;
+            }
+
+            {
+                std::lock_guard lock(state_mutex);
+                --queued;
+            }
+
+            task();
+
+            std::lock_guard lock(state_mutex);
+            if (--pending == 0) {
+                all_done.notify_all();
+            }
+        }
+    }
+};
+
+} // namespace forma
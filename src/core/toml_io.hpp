@@ -2,8 +2,12 @@
 
 #include "core/fs/i_file_system.hpp"
 #include "toml/toml.hpp"
+#include <filesystem>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 
 namespace forma::core {
 
@@ -18,23 +22,102 @@ inline bool read_toml_file(forma::fs::IFileSystem& fs, const std::string& path,
     }
 }
 
-// Parse a TOML document from an IFileSystem path. Returns std::optional<Document>.
-template<size_t MaxTables = 16>
-inline std::optional<forma::toml::Document<MaxTables>> parse_toml_from_fs(forma::fs::IFileSystem& fs, const std::string& path) {
+// Parsed TOML files, shared by everything in the process that reads them.
+// forma.toml alone is read by build, run, deploy and release, and every
+// plugin.toml by plugin loading; with the cache each is parsed once. An
+// entry is reused while the file's modification time and size are those
+// it was parsed at, so a file edited during the run is parsed again.
+class TomlCache {
+public:
+    using DocumentPtr = std::shared_ptr<const forma::toml::RuntimeDocument>;
+
+    // The process-wide cache
+    static TomlCache& instance() {
+        static TomlCache cache;
+        return cache;
+    }
+
+    // The parsed file at `path`, or nullptr if it cannot be read
+    DocumentPtr load(const std::filesystem::path& path) {
+        std::error_code ec;
+        auto mtime = std::filesystem::last_write_time(path, ec);
+        if (ec) return nullptr;
+        auto size = std::filesystem::file_size(path, ec);
+        if (ec) return nullptr;
+        std::string key = std::filesystem::absolute(path, ec).lexically_normal().string();
+        if (ec) key = path.string();
+
+        {
+            std::lock_guard lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end() && it->second.mtime == mtime && it->second.size == size) {
+                ++hit_count;
+                return it->second.document;
+            }
+        }
+
+        // Parse outside the lock; two threads missing on the same file
+        // both parse it and the last one's result is kept
+        forma::fs::RealFileSystem realfs;
+        std::string content;
+        if (!read_toml_file(realfs, path.string(), content)) return nullptr;
+        auto document = std::make_shared<const forma::toml::RuntimeDocument>(forma::toml::parse_runtime(std::move(content)));
+
+        std::lock_guard lock(mutex);
+        ++parse_count;
+        entries.insert_or_assign(std::move(key), Entry{mtime, size, document});
+        return document;
+    }
+
+    void clear() {
+        std::lock_guard lock(mutex);
+        entries.clear();
+    }
+
+    // Files parsed and loads answered from the cache, for diagnostics and tests
+    size_t parses() const {
+        std::lock_guard lock(mutex);
+        return parse_count;
+    }
+
+    size_t hits() const {
+        std::lock_guard lock(mutex);
+        return hit_count;
+    }
+
+private:
+    struct Entry {
+        std::filesystem::file_time_type mtime;
+        std::uintmax_t size = 0;
+        DocumentPtr document;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    size_t parse_count = 0;
+    size_t hit_count = 0;
+};
+
+// Parse a TOML document from an IFileSystem path; nullptr if it cannot be
+// read. Files on the real filesystem go through TomlCache; others (such as
+// a MemoryFileSystem) have no modification time and are parsed every time.
+inline std::shared_ptr<const forma::toml::RuntimeDocument> parse_toml_from_fs(forma::fs::IFileSystem& fs, const std::string& path) {
+    if (dynamic_cast<forma::fs::RealFileSystem*>(&fs)) {
+        return TomlCache::instance().load(path);
+    }
     std::string content;
-    if (!read_toml_file(fs, path, content)) return std::nullopt;
-    // Use the parser
-    auto doc = forma::toml::parse<MaxTables>(content);
-    return doc;
+    if (!read_toml_file(fs, path, content)) return nullptr;
+    return std::make_shared<const forma::toml::RuntimeDocument>(forma::toml::parse_runtime(std::move(content)));
 }
 
-// Helper to get a table by name from a TOML file in fs
-template<size_t MaxTables = 16>
-inline const forma::toml::Table<32>* read_toml_table(forma::fs::IFileSystem& fs, const std::string& path, const std::string& table_name) {
-    auto doc_opt = parse_toml_from_fs<MaxTables>(fs, path);
-    if (!doc_opt) return nullptr;
-    auto& doc = *doc_opt;
-    return doc.get_table(table_name);
+// Helper to get a table by name from a TOML file in fs. The table shares
+// ownership of its document.
+inline std::shared_ptr<const forma::toml::RuntimeTable> read_toml_table(forma::fs::IFileSystem& fs, const std::string& path, const std::string& table_name) {
+    auto doc = parse_toml_from_fs(fs, path);
+    if (!doc) return nullptr;
+    const auto* table = doc->get_table(table_name);
+    if (!table) return nullptr;
+    return std::shared_ptr<const forma::toml::RuntimeTable>(doc, table);
 }
 
 } // namespace forma::core
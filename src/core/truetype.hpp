@@ -0,0 +1,553 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace forma::font {
+
+// ============================================================================
+// TrueType - glyph outlines from TTF/OTF (glyf) fonts and an antialiased
+// rasterizer for pre-rendering them at build time
+// ============================================================================
+
+// Outline point in font units; off-curve points are quadratic controls
+struct OutlinePoint {
+    float x = 0;
+    float y = 0;
+    bool on_curve = true;
+};
+
+using Contour = std::vector<OutlinePoint>;
+
+// 8-bit coverage, rows top to bottom. Offsets place the box relative to the
+// pen position: x_offset to its left edge, y_offset from the baseline up to
+// its bottom edge (LVGL's ofs_x / ofs_y).
+struct GlyphBitmap {
+    int width = 0;
+    int height = 0;
+    int x_offset = 0;
+    int y_offset = 0;
+    std::vector<uint8_t> coverage;
+};
+
+namespace detail {
+
+// Big-endian reads that yield 0 past the end instead of reading out of
+// bounds; `ok` records whether that happened
+struct FontReader {
+    std::span<const uint8_t> data;
+    mutable bool ok = true;
+
+    uint8_t u8(size_t at) const {
+        if (at >= data.size()) {
+            ok = false;
+            return 0;
+        }
+        return data[at];
+    }
+    uint16_t u16(size_t at) const { return static_cast<uint16_t>((u8(at) << 8) | u8(at + 1)); }
+    int16_t i16(size_t at) const { return static_cast<int16_t>(u16(at)); }
+    uint32_t u32(size_t at) const { return (uint32_t{u16(at)} << 16) | u16(at + 2); }
+};
+
+struct Segment {
+    float x0, y0, x1, y1;
+};
+
+// Signed-area coverage accumulation: each edge adds its coverage delta to
+// the cells it crosses and a running sum over the buffer yields the
+// winding-weighted coverage per pixel. Rows are contiguous so deltas that
+// fall past the right edge carry into the next row, where they cancel.
+class CoverageBuffer {
+public:
+    CoverageBuffer(int width, int height)
+        : width(width), height(height), cells(static_cast<size_t>(width) * height + 4, 0.0f) {}
+
+    void line(Segment s) {
+        if (std::abs(s.y0 - s.y1) <= 1e-6f) {
+            return;
+        }
+        float dir = 1.0f;
+        if (s.y0 > s.y1) {
+            std::swap(s.x0, s.x1);
+            std::swap(s.y0, s.y1);
+            dir = -1.0f;
+        }
+        float dxdy = (s.x1 - s.x0) / (s.y1 - s.y0);
+        float x = s.x0;
+        if (s.y0 < 0) {
+            x -= s.y0 * dxdy;
+        }
+        int y_start = std::max(0, static_cast<int>(s.y0));
+        int y_end = std::min(height, static_cast<int>(std::ceil(s.y1)));
+        for (int y = y_start; y < y_end; ++y) {
+            size_t row = static_cast<size_t>(y) * width;
+            float dy = std::min(static_cast<float>(y + 1), s.y1) - std::max(static_cast<float>(y), s.y0);
+            float x_next = x + dxdy * dy;
+            float d = dy * dir;
+            float xa = std::clamp(std::min(x, x_next), 0.0f, static_cast<float>(width));
+            float xb = std::clamp(std::max(x, x_next), 0.0f, static_cast<float>(width));
+            float xa_floor = std::floor(xa);
+            int xa_i = static_cast<int>(xa_floor);
+            float xb_ceil = std::ceil(xb);
+            int xb_i = static_cast<int>(xb_ceil);
+
+            if (xb_i <= xa_i + 1) {
+                // Edge stays within one pixel column
+                float xm = 0.5f * (xa + xb) - xa_floor;
+                add(row + xa_i, d - d * xm);
+                add(row + xa_i + 1, d * xm);
+            } else {
+                float s_inv = 1.0f / (xb - xa);
+                float xa_frac = xa - xa_floor;
+                float a0 = 0.5f * s_inv * (1.0f - xa_frac) * (1.0f - xa_frac);
+                float xb_frac = xb - xb_ceil + 1.0f;
+                float am = 0.5f * s_inv * xb_frac * xb_frac;
+                add(row + xa_i, d * a0);
+                if (xb_i == xa_i + 2) {
+                    add(row + xa_i + 1, d * (1.0f - a0 - am));
+                } else {
+                    float a1 = s_inv * (1.5f - xa_frac);
+                    add(row + xa_i + 1, d * (a1 - a0));
+                    for (int xi = xa_i + 2; xi < xb_i - 1; ++xi) {
+                        add(row + xi, d * s_inv);
+                    }
+                    float a2 = a1 + static_cast<float>(xb_i - xa_i - 3) * s_inv;
+                    add(row + xb_i - 1, d * (1.0f - a2 - am));
+                }
+                add(row + xb_i, d * am);
+            }
+            x = x_next;
+        }
+    }
+
+    std::vector<uint8_t> resolve() const {
+        std::vector<uint8_t> out(static_cast<size_t>(width) * height);
+        float sum = 0;
+        for (size_t i = 0; i < out.size(); ++i) {
+            sum += cells[i];
+            float value = std::min(std::abs(sum), 1.0f);
+            out[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+        }
+        return out;
+    }
+
+private:
+    void add(size_t index, float value) {
+        if (index < cells.size()) {
+            cells[index] += value;
+        }
+    }
+
+    int width;
+    int height;
+    std::vector<float> cells;
+};
+
+} // namespace detail
+
+class TrueTypeFont {
+public:
+    uint16_t units_per_em = 0;
+    int ascender = 0;
+    int descender = 0;  // Negative below the baseline
+    int line_gap = 0;
+    int underline_position = 0;
+    int underline_thickness = 0;
+
+    // Fonts with CFF outlines (most .otf files) and font collections are
+    // rejected with `error`; only TrueType (glyf) outlines are read
+    static std::optional<TrueTypeFont> parse(std::span<const uint8_t> data, std::string& error) {
+        TrueTypeFont font;
+        font.reader.data = data;
+        const auto& r = font.reader;
+
+        uint32_t version = r.u32(0);
+        if (version == 0x74746366) {  // 'ttcf'
+            error = "font collections are not supported";
+            return std::nullopt;
+        }
+        if (version != 0x00010000 && version != 0x74727565 && version != 0x4F54544F) {
+            error = "not a TrueType/OpenType font";
+            return std::nullopt;
+        }
+
+        uint16_t tables = r.u16(4);
+        for (uint16_t i = 0; i < tables; ++i) {
+            size_t record = 12 + size_t{i} * 16;
+            std::string_view tag(reinterpret_cast<const char*>(data.data()) + std::min(record, data.size()),
+                                 record + 4 <= data.size() ? 4 : 0);
+            uint32_t offset = r.u32(record + 8);
+            if (tag == "head") font.head = offset;
+            else if (tag == "hhea") font.hhea = offset;
+            else if (tag == "hmtx") font.hmtx = offset;
+            else if (tag == "maxp") font.maxp = offset;
+            else if (tag == "cmap") font.cmap = offset;
+            else if (tag == "loca") font.loca = offset;
+            else if (tag == "glyf") font.glyf = offset;
+            else if (tag == "post") font.post = offset;
+        }
+        if (!font.glyf && version == 0x4F54544F) {
+            error = "CFF-based OpenType outlines are not supported";
+            return std::nullopt;
+        }
+        if (!font.head || !font.hhea || !font.hmtx || !font.maxp || !font.cmap || !font.loca || !font.glyf) {
+            error = "missing required font tables";
+            return std::nullopt;
+        }
+
+        font.units_per_em = r.u16(font.head + 18);
+        font.long_loca = r.i16(font.head + 50) != 0;
+        font.glyph_count = r.u16(font.maxp + 4);
+        font.ascender = r.i16(font.hhea + 4);
+        font.descender = r.i16(font.hhea + 6);
+        font.line_gap = r.i16(font.hhea + 8);
+        font.h_metrics = r.u16(font.hhea + 34);
+        if (font.post) {
+            font.underline_position = r.i16(font.post + 8);
+            font.underline_thickness = r.i16(font.post + 10);
+        }
+        font.select_cmap();
+
+        if (!r.ok || font.units_per_em == 0 || font.h_metrics == 0 || !font.cmap_subtable) {
+            error = "corrupt or unsupported font header";
+            return std::nullopt;
+        }
+        return font;
+    }
+
+    // 0 (.notdef) when the font has no glyph for `code_point`
+    uint16_t glyph_index(char32_t code_point) const {
+        const auto& r = reader;
+        size_t t = cmap_subtable;
+        if (r.u16(t) == 12) {
+            uint32_t groups = r.u32(t + 12);
+            // Groups are sorted by start code
+            uint32_t lo = 0;
+            uint32_t hi = groups;
+            while (lo < hi) {
+                uint32_t mid = (lo + hi) / 2;
+                size_t g = t + 16 + size_t{mid} * 12;
+                if (code_point < r.u32(g)) {
+                    hi = mid;
+                } else if (code_point > r.u32(g + 4)) {
+                    lo = mid + 1;
+                } else {
+                    return static_cast<uint16_t>(r.u32(g + 8) + (code_point - r.u32(g)));
+                }
+            }
+            return 0;
+        }
+
+        // Format 4: BMP only
+        if (code_point > 0xFFFF) {
+            return 0;
+        }
+        uint16_t segments = r.u16(t + 6) / 2;
+        size_t ends = t + 14;
+        size_t starts = ends + size_t{segments} * 2 + 2;
+        size_t deltas = starts + size_t{segments} * 2;
+        size_t range_offsets = deltas + size_t{segments} * 2;
+        for (uint16_t s = 0; s < segments; ++s) {
+            if (code_point > r.u16(ends + s * 2)) {
+                continue;
+            }
+            uint16_t start = r.u16(starts + s * 2);
+            if (code_point < start) {
+                return 0;
+            }
+            uint16_t delta = r.u16(deltas + s * 2);
+            uint16_t range_offset = r.u16(range_offsets + s * 2);
+            if (range_offset == 0) {
+                return static_cast<uint16_t>(code_point + delta);
+            }
+            size_t at = range_offsets + s * 2 + range_offset + (code_point - start) * 2;
+            uint16_t glyph = r.u16(at);
+            return glyph ? static_cast<uint16_t>(glyph + delta) : 0;
+        }
+        return 0;
+    }
+
+    int advance_width(uint16_t glyph) const {
+        uint16_t index = std::min<uint16_t>(glyph, static_cast<uint16_t>(h_metrics - 1));
+        return reader.u16(hmtx + size_t{index} * 4);
+    }
+
+    // Contours of `glyph` with composite glyphs resolved
+    std::vector<Contour> outline(uint16_t glyph) const {
+        std::vector<Contour> contours;
+        append_outline(glyph, {1, 0, 0, 1, 0, 0}, contours, 0);
+        return contours;
+    }
+
+    // Rasterize at `pixel_size` pixels per em
+    GlyphBitmap rasterize(uint16_t glyph, float pixel_size) const {
+        float scale = pixel_size / units_per_em;
+        auto contours = outline(glyph);
+
+        float x_min = INFINITY, y_min = INFINITY, x_max = -INFINITY, y_max = -INFINITY;
+        for (const auto& contour : contours) {
+            for (const auto& p : contour) {
+                x_min = std::min(x_min, p.x * scale);
+                x_max = std::max(x_max, p.x * scale);
+                y_min = std::min(y_min, p.y * scale);
+                y_max = std::max(y_max, p.y * scale);
+            }
+        }
+        GlyphBitmap bitmap;
+        if (contours.empty() || x_max <= x_min || y_max <= y_min) {
+            return bitmap;
+        }
+        bitmap.x_offset = static_cast<int>(std::floor(x_min));
+        bitmap.y_offset = static_cast<int>(std::floor(y_min));
+        bitmap.width = static_cast<int>(std::ceil(x_max)) - bitmap.x_offset;
+        bitmap.height = static_cast<int>(std::ceil(y_max)) - bitmap.y_offset;
+        float top = static_cast<float>(bitmap.y_offset + bitmap.height);
+
+        detail::CoverageBuffer buffer(bitmap.width, bitmap.height);
+        auto to_pixel = [&](float x, float y) {
+            return std::pair{x * scale - static_cast<float>(bitmap.x_offset), top - y * scale};
+        };
+        for (const auto& contour : contours) {
+            flatten(contour, to_pixel, buffer);
+        }
+        bitmap.coverage = buffer.resolve();
+        return bitmap;
+    }
+
+private:
+    detail::FontReader reader;
+    size_t head = 0, hhea = 0, hmtx = 0, maxp = 0, cmap = 0, loca = 0, glyf = 0, post = 0;
+    size_t cmap_subtable = 0;
+    uint16_t glyph_count = 0;
+    uint16_t h_metrics = 0;
+    bool long_loca = false;
+
+    // Prefer a full-Unicode format 12 table, then a BMP format 4 one
+    void select_cmap() {
+        const auto& r = reader;
+        uint16_t count = r.u16(cmap + 2);
+        size_t format4 = 0;
+        for (uint16_t i = 0; i < count; ++i) {
+            size_t record = cmap + 4 + size_t{i} * 8;
+            uint16_t platform = r.u16(record);
+            uint16_t encoding = r.u16(record + 2);
+            size_t table = cmap + r.u32(record + 4);
+            bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+            if (!unicode) {
+                continue;
+            }
+            uint16_t format = r.u16(table);
+            if (format == 12) {
+                cmap_subtable = table;
+                return;
+            }
+            if (format == 4 && !format4) {
+                format4 = table;
+            }
+        }
+        cmap_subtable = format4;
+    }
+
+    // 2x3 affine transform [a b c d e f]: x' = a*x + c*y + e, y' = b*x + d*y + f
+    using Transform = std::array<float, 6>;
+
+    void append_outline(uint16_t glyph, const Transform& m, std::vector<Contour>& out, int depth) const {
+        const auto& r = reader;
+        if (glyph >= glyph_count || depth > 8) {
+            return;
+        }
+        size_t start = long_loca ? r.u32(loca + size_t{glyph} * 4) : size_t{r.u16(loca + size_t{glyph} * 2)} * 2;
+        size_t end = long_loca ? r.u32(loca + size_t{glyph} * 4 + 4) : size_t{r.u16(loca + size_t{glyph} * 2 + 2)} * 2;
+        if (end <= start) {
+            return;  // No outline (space)
+        }
+        size_t g = glyf + start;
+        int16_t contour_count = r.i16(g);
+
+        if (contour_count < 0) {
+            append_composite(g + 10, m, out, depth);
+            return;
+        }
+
+        std::vector<uint16_t> end_points(contour_count);
+        for (int16_t c = 0; c < contour_count; ++c) {
+            end_points[c] = r.u16(g + 10 + size_t(c) * 2);
+        }
+        size_t point_count = contour_count ? size_t{end_points.back()} + 1 : 0;
+        size_t at = g + 10 + size_t(contour_count) * 2;
+        at += 2 + r.u16(at);  // Skip instructions
+
+        std::vector<uint8_t> flags(point_count);
+        for (size_t i = 0; i < point_count && r.ok;) {
+            uint8_t flag = r.u8(at++);
+            size_t repeat = (flag & 8) ? r.u8(at++) + 1u : 1u;
+            for (; repeat > 0 && i < point_count; --repeat) {
+                flags[i++] = flag;
+            }
+        }
+        std::vector<int> xs(point_count), ys(point_count);
+        int value = 0;
+        for (size_t i = 0; i < point_count; ++i) {
+            if (flags[i] & 2) {
+                int dx = r.u8(at++);
+                value += (flags[i] & 16) ? dx : -dx;
+            } else if (!(flags[i] & 16)) {
+                value += r.i16(at);
+                at += 2;
+            }
+            xs[i] = value;
+        }
+        value = 0;
+        for (size_t i = 0; i < point_count; ++i) {
+            if (flags[i] & 4) {
+                int dy = r.u8(at++);
+                value += (flags[i] & 32) ? dy : -dy;
+            } else if (!(flags[i] & 32)) {
+                value += r.i16(at);
+                at += 2;
+            }
+            ys[i] = value;
+        }
+        if (!r.ok) {
+            return;
+        }
+
+        size_t first = 0;
+        for (int16_t c = 0; c < contour_count; ++c) {
+            Contour contour;
+            for (size_t i = first; i <= end_points[c] && i < point_count; ++i) {
+                float x = static_cast<float>(xs[i]);
+                float y = static_cast<float>(ys[i]);
+                contour.push_back({m[0] * x + m[2] * y + m[4], m[1] * x + m[3] * y + m[5], (flags[i] & 1) != 0});
+            }
+            if (contour.size() > 1) {
+                out.push_back(std::move(contour));
+            }
+            first = size_t{end_points[c]} + 1;
+        }
+    }
+
+    void append_composite(size_t at, const Transform& parent, std::vector<Contour>& out, int depth) const {
+        const auto& r = reader;
+        constexpr uint16_t ARGS_ARE_WORDS = 0x0001;
+        constexpr uint16_t ARGS_ARE_XY = 0x0002;
+        constexpr uint16_t HAVE_SCALE = 0x0008;
+        constexpr uint16_t MORE_COMPONENTS = 0x0020;
+        constexpr uint16_t HAVE_XY_SCALE = 0x0040;
+        constexpr uint16_t HAVE_2X2 = 0x0080;
+
+        uint16_t flags;
+        do {
+            flags = r.u16(at);
+            uint16_t component = r.u16(at + 2);
+            at += 4;
+            float dx, dy;
+            if (flags & ARGS_ARE_WORDS) {
+                dx = r.i16(at);
+                dy = r.i16(at + 2);
+                at += 4;
+            } else {
+                dx = static_cast<int8_t>(r.u8(at));
+                dy = static_cast<int8_t>(r.u8(at + 1));
+                at += 2;
+            }
+            if (!(flags & ARGS_ARE_XY)) {
+                dx = dy = 0;  // Point matching is not supported
+            }
+            auto f2dot14 = [&](size_t p) { return r.i16(p) / 16384.0f; };
+            Transform m = {1, 0, 0, 1, dx, dy};
+            if (flags & HAVE_SCALE) {
+                m[0] = m[3] = f2dot14(at);
+                at += 2;
+            } else if (flags & HAVE_XY_SCALE) {
+                m[0] = f2dot14(at);
+                m[3] = f2dot14(at + 2);
+                at += 4;
+            } else if (flags & HAVE_2X2) {
+                m[0] = f2dot14(at);
+                m[1] = f2dot14(at + 2);
+                m[2] = f2dot14(at + 4);
+                m[3] = f2dot14(at + 6);
+                at += 8;
+            }
+            Transform combined = {
+                parent[0] * m[0] + parent[2] * m[1], parent[1] * m[0] + parent[3] * m[1],
+                parent[0] * m[2] + parent[2] * m[3], parent[1] * m[2] + parent[3] * m[3],
+                parent[0] * m[4] + parent[2] * m[5] + parent[4], parent[1] * m[4] + parent[3] * m[5] + parent[5]};
+            append_outline(component, combined, out, depth + 1);
+        } while ((flags & MORE_COMPONENTS) && r.ok);
+    }
+
+    // Turn a quadratic contour into line segments. Consecutive off-curve
+    // points have an implied on-curve point halfway between them.
+    template <typename ToPixel>
+    static void flatten(const Contour& contour, ToPixel to_pixel, detail::CoverageBuffer& buffer) {
+        size_t n = contour.size();
+        size_t start = 0;
+        while (start < n && !contour[start].on_curve) {
+            ++start;
+        }
+        std::pair<float, float> first;
+        if (start == n) {
+            // All points off-curve: begin between the first two
+            first = to_pixel((contour[0].x + contour[1].x) / 2, (contour[0].y + contour[1].y) / 2);
+            start = 0;
+        } else {
+            first = to_pixel(contour[start].x, contour[start].y);
+        }
+
+        std::optional<std::pair<float, float>> control;
+        std::pair<float, float> pen = first;
+        auto emit_quad = [&](std::pair<float, float> c, std::pair<float, float> p) {
+            float ddx = pen.first - 2 * c.first + p.first;
+            float ddy = pen.second - 2 * c.second + p.second;
+            int steps = std::clamp(static_cast<int>(std::ceil(std::sqrt(std::sqrt(ddx * ddx + ddy * ddy) * 1.25f))), 1, 32);
+            std::pair<float, float> prev = pen;
+            for (int i = 1; i <= steps; ++i) {
+                float t = static_cast<float>(i) / steps;
+                float u = 1 - t;
+                std::pair<float, float> q = {u * u * pen.first + 2 * u * t * c.first + t * t * p.first,
+                                             u * u * pen.second + 2 * u * t * c.second + t * t * p.second};
+                buffer.line({prev.first, prev.second, q.first, q.second});
+                prev = q;
+            }
+            pen = p;
+        };
+
+        for (size_t k = 1; k <= n; ++k) {
+            const auto& point = contour[(start + k) % n];
+            auto p = to_pixel(point.x, point.y);
+            if (point.on_curve) {
+                if (control) {
+                    emit_quad(*control, p);
+                    control.reset();
+                } else {
+                    buffer.line({pen.first, pen.second, p.first, p.second});
+                    pen = p;
+                }
+            } else {
+                if (control) {
+                    std::pair<float, float> mid = {(control->first + p.first) / 2, (control->second + p.second) / 2};
+                    emit_quad(*control, mid);
+                }
+                control = p;
+            }
+        }
+        // Close back to the starting point
+        if (control) {
+            emit_quad(*control, first);
+        } else if (pen != first) {
+            buffer.line({pen.first, pen.second, first.first, first.second});
+        }
+    }
+};
+
+} // namespace forma::font
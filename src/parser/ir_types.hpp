@@ -1,8 +1,14 @@
 #pragma once
 #include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <string_view>
+#include <vector>
 #include "../tokenizer/forma.hpp"
 #include "diagnostics.hpp"
+#include "../plugin_hash.hpp"
 
 namespace forma {
 
@@ -182,6 +188,10 @@ struct InstanceNode {
     std::array<InstanceDecl, MAX_INSTANCES> instances{};
     size_t count = 0;
     
+    constexpr bool has_room() const {
+        return count < MAX_INSTANCES;
+    }
+    
     constexpr size_t add_instance(const InstanceDecl& inst) {
         if (count < MAX_INSTANCES) {
             instances[count] = inst;
@@ -195,6 +205,38 @@ struct InstanceNode {
     }
 };
 
+// Runtime counterpart of InstanceNode - grows with the input instead of
+// reserving MAX_INSTANCES slots up front. Memory comes from the owning
+// document's arena.
+struct InstanceList {
+    std::pmr::vector<InstanceDecl> instances;
+    size_t count = 0;
+    
+    InstanceList() = default;
+    explicit InstanceList(std::pmr::memory_resource* arena) : instances(arena) {}
+    
+    bool has_room() const {
+        return true;
+    }
+    
+    size_t add_instance(const InstanceDecl& inst) {
+        instances.push_back(inst);
+        return count++;
+    }
+    
+    const InstanceDecl& get(size_t idx) const {
+        return instances[idx];
+    }
+
+    // Drop every instance from index n on
+    void truncate(size_t n) {
+        if (n < count) {
+            instances.erase(instances.begin() + static_cast<std::ptrdiff_t>(n), instances.end());
+            count = n;
+        }
+    }
+};
+
 // Import declaration
 struct ImportDecl {
     std::string_view module_path;  // e.g., "std.ui" or "./MyComponent.fml"
@@ -232,25 +274,61 @@ struct Symbol {
     size_t decl_index = 0;  // Index into the appropriate declaration array
 };
 
+// Open-addressing index shared by the fixed and growable symbol tables.
+// Slots hold (symbol index + 1); 0 marks an empty slot. Only the first
+// symbol with a given name is indexed, so find() keeps returning the
+// earliest declaration just like the old linear scan did.
+template <typename Symbols, typename Slots>
+constexpr const Symbol* symbol_index_find(const Symbols& symbols, const Slots& slots,
+                                          size_t slot_count, std::string_view name) {
+    size_t mask = slot_count - 1;
+    for (size_t i = fnv1a_hash(name) & mask; slots[i] != 0; i = (i + 1) & mask) {
+        const Symbol& sym = symbols[slots[i] - 1];
+        if (sym.name == name) {
+            return &sym;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Symbols, typename Slots>
+constexpr void symbol_index_insert(const Symbols& symbols, Slots& slots,
+                                   size_t slot_count, size_t symbol_index) {
+    size_t mask = slot_count - 1;
+    std::string_view name = symbols[symbol_index].name;
+    size_t i = fnv1a_hash(name) & mask;
+    for (; slots[i] != 0; i = (i + 1) & mask) {
+        if (symbols[slots[i] - 1].name == name) {
+            return; // Keep the first declaration indexed
+        }
+    }
+    slots[i] = static_cast<uint32_t>(symbol_index + 1);
+}
+
 template <size_t MaxSymbols = 128>
 struct SymbolTable {
+    // Load factor stays at or below 1/2 so probe sequences remain short
+    static constexpr size_t SLOT_COUNT = std::bit_ceil(MaxSymbols * 2);
+    
     std::array<Symbol, MaxSymbols> symbols{};
+    std::array<uint32_t, SLOT_COUNT> slots{};
     size_t count = 0;
+    size_t dropped = 0;  // Symbols rejected because the table was full
     
-    constexpr void add_symbol(Symbol::Kind kind, std::string_view name, 
+    constexpr bool add_symbol(Symbol::Kind kind, std::string_view name, 
                              SourceLocation loc, size_t decl_idx = 0) {
-        if (count < MaxSymbols) {
-            symbols[count++] = Symbol{kind, name, loc, decl_idx};
+        if (count >= MaxSymbols) {
+            ++dropped;
+            return false;
         }
+        symbols[count] = Symbol{kind, name, loc, decl_idx};
+        symbol_index_insert(symbols, slots, SLOT_COUNT, count);
+        ++count;
+        return true;
     }
     
     constexpr const Symbol* find(std::string_view name) const {
-        for (size_t i = 0; i < count; ++i) {
-            if (symbols[i].name == name) {
-                return &symbols[i];
-            }
-        }
-        return nullptr;
+        return symbol_index_find(symbols, slots, SLOT_COUNT, name);
     }
     
     constexpr bool exists(std::string_view name) const {
@@ -258,6 +336,60 @@ struct SymbolTable {
     }
 };
 
+// Growable symbol table for runtime documents. Same interface as
+// SymbolTable<N>, but rehashes instead of dropping symbols.
+struct DynamicSymbolTable {
+    std::vector<Symbol> symbols;
+    std::vector<uint32_t> slots;
+    size_t count = 0;
+    size_t dropped = 0;  // Always 0; kept for interface parity with SymbolTable
+    
+    DynamicSymbolTable() : slots(64, 0) {}
+    
+    bool add_symbol(Symbol::Kind kind, std::string_view name,
+                    SourceLocation loc, size_t decl_idx = 0) {
+        if ((count + 1) * 2 > slots.size()) {
+            rehash(slots.size() * 2);
+        }
+        symbols.push_back(Symbol{kind, name, loc, decl_idx});
+        symbol_index_insert(symbols, slots, slots.size(), count);
+        ++count;
+        return true;
+    }
+    
+    const Symbol* find(std::string_view name) const {
+        return symbol_index_find(symbols, slots, slots.size(), name);
+    }
+    
+    bool exists(std::string_view name) const {
+        return find(name) != nullptr;
+    }
+    
+    void reserve(size_t n) {
+        symbols.reserve(n);
+        if (n * 2 > slots.size()) {
+            rehash(std::bit_ceil(n * 2));
+        }
+    }
+
+    // Drop every symbol from index n on
+    void truncate(size_t n) {
+        if (n < count) {
+            symbols.resize(n);
+            count = n;
+            rehash(slots.size());
+        }
+    }
+
+private:
+    void rehash(size_t new_slot_count) {
+        slots.assign(new_slot_count, 0);
+        for (size_t i = 0; i < count; ++i) {
+            symbol_index_insert(symbols, slots, new_slot_count, i);
+        }
+    }
+};
+
 // Document represents a complete .fml file with all declarations
 template <size_t MaxTypes = 32, size_t MaxEnums = 16, size_t MaxEvents = 16, 
           size_t MaxImports = 32, size_t MaxInstances = 64, size_t MaxAssets = 64>
@@ -282,4 +414,73 @@ struct Document {
     SymbolTable<128> symbols;
 };
 
+// ============================================================================
+// Runtime Document Storage
+// ============================================================================
+
+// Heap-backed Document for runtime parsing (compiler pipeline, LSP). Every
+// declaration list is a contiguous vector allocated from a per-document
+// monotonic arena, so storage is proportional to the input instead of the
+// fixed capacities of Document<...>. Member names match Document so code
+// templated on the document type works with either.
+//
+// All string_views point into the parsed source, which must outlive the
+// document. Movable but not assignable: the vectors keep pointing at the
+// arena they were created with.
+struct RuntimeDocument {
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+    
+    std::pmr::vector<TypeDecl> types;
+    size_t type_count = 0;
+    
+    std::pmr::vector<EnumDecl> enums;
+    size_t enum_count = 0;
+    
+    std::pmr::vector<EventDecl> events;
+    size_t event_count = 0;
+    
+    std::pmr::vector<ImportDecl> imports;
+    size_t import_count = 0;
+    
+    std::pmr::vector<AssetDecl> assets;
+    size_t asset_count = 0;
+    
+    InstanceList instances;
+    
+    DynamicSymbolTable symbols;
+    
+    explicit RuntimeDocument(size_t initial_arena_bytes = 4096)
+        : arena(std::make_unique<std::pmr::monotonic_buffer_resource>(initial_arena_bytes))
+        , types(arena.get())
+        , enums(arena.get())
+        , events(arena.get())
+        , imports(arena.get())
+        , assets(arena.get())
+        , instances(arena.get()) {}
+    
+    RuntimeDocument(RuntimeDocument&&) = default;
+    RuntimeDocument& operator=(RuntimeDocument&&) = delete;
+    RuntimeDocument(const RuntimeDocument&) = delete;
+    RuntimeDocument& operator=(const RuntimeDocument&) = delete;
+};
+
+// Append a declaration to a document list. Fixed arrays report false when
+// full (the caller decides whether to drop or diagnose); runtime vectors
+// always grow.
+template <typename T, size_t N>
+constexpr bool append_decl(std::array<T, N>& list, size_t& count, const T& value) {
+    if (count < N) {
+        list[count++] = value;
+        return true;
+    }
+    return false;
+}
+
+template <typename T>
+bool append_decl(std::pmr::vector<T>& list, size_t& count, const T& value) {
+    list.push_back(value);
+    count = list.size();
+    return true;
+}
+
 } // namespace forma
@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "diagnostics.hpp"
+#include "scan.hpp"
+
+namespace forma {
+
+// ============================================================================
+// Line Index - Offset <-> line/column conversion
+// ============================================================================
+
+struct LinePosition {
+    size_t line = 0;    // 0-based
+    size_t column = 0;  // 0-based, in bytes
+};
+
+// Forward-only conversion for offsets visited in increasing order, as the
+// parser visits declarations: linear over the whole source and usable at
+// compile time. Going backwards restarts from the top.
+struct LineCursor {
+    std::string_view src;
+    size_t offset = 0;
+    size_t line = 0;
+    size_t line_start = 0;
+
+    constexpr SourceLocation locate(SourceLocation loc) {
+        if (loc.offset < offset) {
+            offset = line = line_start = 0;
+        }
+        for (; offset < loc.offset && offset < src.size(); ++offset) {
+            if (src[offset] == '\n') {
+                ++line;
+                line_start = offset + 1;
+            }
+        }
+        loc.line = line;
+        loc.column = loc.offset - line_start;
+        return loc;
+    }
+};
+
+// Start offset of every line of a source, so converting between offsets
+// and positions is a binary search instead of a rescan. Built with the
+// runtime scan kernels; edits patch the index using only the replaced
+// range and the replacement text.
+class LineIndex {
+public:
+    LineIndex() = default;
+
+    explicit LineIndex(std::string_view source) {
+        build(source);
+    }
+
+    void build(std::string_view source) {
+        starts.assign(1, 0);
+        starts.reserve(source.size() / 32 + 1);
+        append_line_starts(starts, source, 0);
+        total = source.size();
+    }
+
+    size_t line_count() const { return starts.size(); }
+    size_t size() const { return total; }
+
+    // Offset of the first byte of `line`; lines past the end give size()
+    size_t line_start(size_t line) const {
+        return line < starts.size() ? starts[line] : total;
+    }
+
+    // Offset just past the last byte of `line`, before its newline
+    size_t line_end(size_t line) const {
+        return line + 1 < starts.size() ? starts[line + 1] - 1 : total;
+    }
+
+    // Offsets past the end map to the end of the last line
+    LinePosition position(size_t offset) const {
+        offset = std::min(offset, total);
+        size_t line = static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin()) - 1;
+        return {line, offset - starts[line]};
+    }
+
+    // Columns past the end of a line clamp to the line end, lines past the
+    // end to the end of the source
+    size_t offset(size_t line, size_t column) const {
+        if (line >= starts.size()) {
+            return total;
+        }
+        return std::min(starts[line] + column, line_end(line));
+    }
+
+    // Fill line/column from the location's offset
+    SourceLocation locate(SourceLocation loc) const {
+        LinePosition pos = position(loc.offset);
+        loc.line = pos.line;
+        loc.column = pos.column;
+        return loc;
+    }
+
+    // Bytes [start, end) of the source were replaced with `replacement`
+    void update(size_t start, size_t end, std::string_view replacement) {
+        start = std::min(start, total);
+        end = std::clamp(end, start, total);
+
+        // Lines starting inside the replaced range go; later ones shift
+        auto first = std::upper_bound(starts.begin(), starts.end(), start);
+        auto last = std::upper_bound(first, starts.end(), end);
+        size_t removed = end - start;
+        for (auto it = last; it != starts.end(); ++it) {
+            *it = *it - removed + replacement.size();
+        }
+
+        std::vector<size_t> added;
+        append_line_starts(added, replacement, start);
+        auto pos = starts.erase(first, last);
+        starts.insert(pos, added.begin(), added.end());
+        total = total - removed + replacement.size();
+    }
+
+private:
+    std::vector<size_t> starts{0};
+    size_t total = 0;
+
+    // Stopping at NUL is part of the tokenizer's contract, so a NUL byte is
+    // stepped over here
+    static void append_line_starts(std::vector<size_t>& out, std::string_view text, size_t base) {
+        const scan::Kernels& kernels = scan::kernels();
+        const char* p = text.data();
+        const char* end = p + text.size();
+        while ((p = kernels.find_line_end(p, end)) != end) {
+            if (*p == '\n') {
+                out.push_back(base + static_cast<size_t>(p - text.data()) + 1);
+            }
+            ++p;
+        }
+    }
+};
+
+} // namespace forma
@@ -1,5 +1,8 @@
 #pragma once
+#include <type_traits>
 #include "tokenizer.hpp"
+#include "token_buffer.hpp"
+#include "line_index.hpp"
 #include "ir_types.hpp"
 
 namespace forma {
@@ -7,39 +10,71 @@ namespace forma {
 // ============================================================================
 // Forward Declarations
 // ============================================================================
-struct Parser;
-constexpr TypeRef parse_type_ref(Parser& p);
-constexpr PropertyDecl parse_property(Parser& p);
-constexpr MethodDecl parse_method(Parser& p);
-constexpr TypeDecl parse_type_decl(Parser& p);
-constexpr InstanceDecl parse_instance(Parser& p);
-constexpr EnumDecl parse_enum(Parser& p);
-constexpr EventDecl parse_event(Parser& p);
-constexpr WhenStmt parse_when(Parser& p);
-constexpr AnimationDecl parse_animate(Parser& p);
-constexpr ImportDecl parse_import(Parser& p);
-constexpr ImportDecl parse_import(Parser& p);
+template <typename NodeStorage> struct BasicParser;
+template <typename P> constexpr TypeRef parse_type_ref(P& p);
+template <typename P> constexpr PropertyDecl parse_property(P& p);
+template <typename P> constexpr MethodDecl parse_method(P& p);
+template <typename P> constexpr TypeDecl parse_type_decl(P& p);
+template <typename P> constexpr InstanceDecl parse_instance(P& p);
+template <typename P> constexpr EnumDecl parse_enum(P& p);
+template <typename P> constexpr EventDecl parse_event(P& p);
+template <typename P> constexpr WhenStmt parse_when(P& p);
+template <typename P> constexpr AnimationDecl parse_animate(P& p);
+template <typename P> constexpr ImportDecl parse_import(P& p);
 
 // ============================================================================
 // Parser
 // ============================================================================
 
-struct Parser {
+// NodeStorage receives nested instances: InstanceNode for the fixed
+// constexpr Document, InstanceList for RuntimeDocument.
+//
+// Tokens come either from the lexer, one at a time, or from a TokenBuffer
+// lexed up front, which makes lookahead an index instead of a re-lex.
+template <typename NodeStorage>
+struct BasicParser {
     Lexer lexer;
     Tok current;
-    InstanceNode* node_storage = nullptr; // For storing nested instances
+    NodeStorage* node_storage = nullptr; // For storing nested instances
+    const TokenBuffer* tokens = nullptr;
+    size_t index = 0;                    // Of current in tokens
     
-    constexpr Parser(std::string_view source) : lexer{source, 0} {
+    constexpr BasicParser(std::string_view source) : lexer{source, 0} {
         advance();
     }
     
-    constexpr Parser(std::string_view source, InstanceNode* storage) 
+    constexpr BasicParser(std::string_view source, NodeStorage* storage) 
         : lexer{source, 0}, node_storage(storage) {
         advance();
     }
     
+    constexpr BasicParser(const TokenBuffer& buffer, NodeStorage* storage)
+        : lexer{buffer.source(), 0}, current(buffer.token(0)), node_storage(storage), tokens(&buffer) {}
+    
     constexpr void advance() {
-        current = next_token(lexer);
+        if (tokens) {
+            current = tokens->token(++index);
+        } else {
+            current = next_token(lexer);
+        }
+    }
+    
+    // The token `n` places after current
+    constexpr Tok peek(size_t n = 1) const {
+        if (tokens) {
+            return tokens->token(index + n);
+        }
+        Lexer ahead = lexer;
+        Tok tok = current;
+        for (size_t i = 0; i < n; ++i) {
+            tok = next_token(ahead);
+        }
+        return tok;
+    }
+    
+    // Source offset just past current (past the closing quote of a string)
+    constexpr size_t current_end() const {
+        return tokens ? tokens->end(index) : lexer.pos;
     }
     
     constexpr bool check(TokenKind kind) const {
@@ -65,23 +100,29 @@ struct Parser {
     }
 };
 
+using Parser = BasicParser<InstanceNode>;
+
 // ============================================================================
 // Parse Functions
 // ============================================================================
 
 // Parse a type reference: simple like 'int' or generic like 'Forma.Array(int, 10)'
-constexpr TypeRef parse_type_ref(Parser& p) {
+template <typename P>
+constexpr TypeRef parse_type_ref(P& p) {
     TypeRef type;
     
     // Parse the base type name (could be dotted like Forma.Array)
-    type.name = p.expect(TokenKind::Identifier).text;
+    Tok base = p.expect(TokenKind::Identifier);
+    type.name = base.text;
     
     // Check for dot notation (Forma.Array)
     if (p.accept(TokenKind::Dot)) {
-        auto start = static_cast<size_t>(type.name.data() - p.lexer.src.data());
         Tok next = p.expect(TokenKind::Identifier);
-        auto end = static_cast<size_t>(next.text.data() - p.lexer.src.data()) + next.text.size();
-        type.name = p.lexer.src.substr(start, end - start);
+        // Only join tokens that both come from the source; on malformed
+        // input either one can be the end-of-file token
+        if (base.kind == TokenKind::Identifier && next.kind == TokenKind::Identifier) {
+            type.name = p.lexer.src.substr(base.pos, next.pos + next.text.size() - base.pos);
+        }
     }
     
     // Check for generic parameters: (T, N)
@@ -116,7 +157,8 @@ constexpr TypeRef parse_type_ref(Parser& p) {
 }
 
 // Parse: property name: type
-constexpr PropertyDecl parse_property(Parser& p) {
+template <typename P>
+constexpr PropertyDecl parse_property(P& p) {
     PropertyDecl decl;
     
     p.expect(TokenKind::Property);
@@ -133,7 +175,8 @@ constexpr TypeRef parse_type_ref_from_name(std::string_view name) {
 }
 
 // Parse: method ReturnType name(param1: type1, param2: type2)
-constexpr MethodDecl parse_method(Parser& p) {
+template <typename P>
+constexpr MethodDecl parse_method(P& p) {
     MethodDecl decl;
     
     p.expect(TokenKind::Method);
@@ -141,20 +184,13 @@ constexpr MethodDecl parse_method(Parser& p) {
     // Parse return type (optional - defaults to void)
     if (p.check(TokenKind::Identifier)) {
         // Check if next token is also an identifier (means this is return type)
-        size_t saved_pos = p.lexer.pos;
-        Tok saved_tok = p.current;
-        Tok maybe_type = p.current;
-        p.advance();
-        
-        if (p.check(TokenKind::Identifier)) {
-            // Previous token was return type
-            decl.return_type = parse_type_ref_from_name(maybe_type.text);
+        if (p.peek().kind == TokenKind::Identifier) {
+            decl.return_type = parse_type_ref_from_name(p.current.text);
+            p.advance();
             decl.name = p.current.text;
             p.advance();
         } else {
-            // No return type, go back
-            p.lexer.pos = saved_pos;
-            p.current = saved_tok;
+            // No return type
             decl.return_type = TypeRef("void");
             decl.name = p.expect(TokenKind::Identifier).text;
         }
@@ -187,7 +223,8 @@ constexpr MethodDecl parse_method(Parser& p) {
 }
 
 // Parse: class TypeName { property declarations } or class TypeName: BaseType { property declarations }
-constexpr TypeDecl parse_type_decl(Parser& p) {
+template <typename P>
+constexpr TypeDecl parse_type_decl(P& p) {
     TypeDecl decl;
     
     // Check for @requires annotation
@@ -245,7 +282,8 @@ constexpr TypeDecl parse_type_decl(Parser& p) {
 }
 
 // Parse a value (literal or identifier)
-constexpr Value parse_value(Parser& p) {
+template <typename P>
+constexpr Value parse_value(P& p) {
     Value val;
     
     if (p.check(TokenKind::IntegerLiteral)) {
@@ -274,7 +312,8 @@ constexpr Value parse_value(Parser& p) {
 }
 
 // Parse: name: value or name: value or preview{value}
-constexpr PropertyAssignment parse_property_assignment(Parser& p) {
+template <typename P>
+constexpr PropertyAssignment parse_property_assignment(P& p) {
     PropertyAssignment assign;
     
     assign.name = p.expect(TokenKind::Identifier).text;
@@ -293,11 +332,9 @@ constexpr PropertyAssignment parse_property_assignment(Parser& p) {
     return assign;
 }
 
-// Forward declaration for recursion
-constexpr InstanceDecl parse_instance(Parser& p);
-
 // Parse: TypeName { property assignments and child instances }
-constexpr InstanceDecl parse_instance(Parser& p) {
+template <typename P>
+constexpr InstanceDecl parse_instance(P& p) {
     InstanceDecl inst;
     
     inst.type_name = p.expect(TokenKind::Identifier).text;
@@ -319,27 +356,17 @@ constexpr InstanceDecl parse_instance(Parser& p) {
                 break;  // Too many animations
             }
         } else if (p.check(TokenKind::Identifier)) {
-            // Save position to check what comes next
-            size_t saved_pos = p.lexer.pos;
-            Tok saved_tok = p.current;
-            
-            p.advance(); // Move past identifier
+            // The token after the identifier tells what this is
+            TokenKind next = p.peek().kind;
             
-            if (p.check(TokenKind::Colon)) {
+            if (next == TokenKind::Colon) {
                 // It's a property assignment
-                p.lexer.pos = saved_pos;
-                p.current = saved_tok;
-                
                 if (inst.prop_count < inst.properties.size()) {
                     inst.properties[inst.prop_count++] = parse_property_assignment(p);
                 }
-            } else if (p.check(TokenKind::LBrace)) {
-                // It's a nested instance
-                p.lexer.pos = saved_pos;
-                p.current = saved_tok;
-                
-                // Parse child and store in flat array
-                if (p.node_storage && p.node_storage->count < InstanceNode::MAX_INSTANCES) {
+            } else if (next == TokenKind::LBrace) {
+                // It's a nested instance; parse child and store in flat array
+                if (p.node_storage && p.node_storage->has_room()) {
                     // Parse the child (this recursively handles grandchildren)
                     InstanceDecl child = parse_instance(p);
                     
@@ -354,6 +381,7 @@ constexpr InstanceDecl parse_instance(Parser& p) {
                 }
             } else {
                 // Unknown, skip token
+                p.advance();
                 break;
             }
         } else {
@@ -366,7 +394,8 @@ constexpr InstanceDecl parse_instance(Parser& p) {
 }
 
 // Parse: enum Name { Value1, Value2, Value3 }
-constexpr EnumDecl parse_enum(Parser& p) {
+template <typename P>
+constexpr EnumDecl parse_enum(P& p) {
     EnumDecl decl;
     
     p.expect(TokenKind::Enum);
@@ -394,7 +423,8 @@ constexpr EnumDecl parse_enum(Parser& p) {
 }
 
 // Parse: event eventName(param1: type1, param2: type2)
-constexpr EventDecl parse_event(Parser& p) {
+template <typename P>
+constexpr EventDecl parse_event(P& p) {
     EventDecl decl;
     
     p.expect(TokenKind::Event);
@@ -426,14 +456,15 @@ constexpr EventDecl parse_event(Parser& p) {
 }
 
 // Parse: when (condition) { assignments }
-constexpr WhenStmt parse_when(Parser& p) {
+template <typename P>
+constexpr WhenStmt parse_when(P& p) {
     WhenStmt stmt;
     
     p.expect(TokenKind::When);
     p.expect(TokenKind::LParen);
     
     // For now, just grab everything until the closing paren as the condition
-    size_t start = p.lexer.pos - p.current.text.size();
+    size_t start = p.current_end() - p.current.text.size();
     int paren_depth = 1;
     while (paren_depth > 0 && !p.check(TokenKind::EndOfFile)) {
         p.advance();
@@ -442,7 +473,7 @@ constexpr WhenStmt parse_when(Parser& p) {
             paren_depth--;
             if (paren_depth == 0) {
                 // Found the closing paren
-                stmt.condition = p.lexer.src.substr(start, p.lexer.pos - start - p.current.text.size());
+                stmt.condition = p.lexer.src.substr(start, p.current_end() - start - p.current.text.size());
                 break;
             }
         }
@@ -468,7 +499,8 @@ constexpr WhenStmt parse_when(Parser& p) {
 }
 
 // Parse: animate { property: value, duration: 300, easing: "ease_in" }
-constexpr AnimationDecl parse_animate(Parser& p) {
+template <typename P>
+constexpr AnimationDecl parse_animate(P& p) {
     AnimationDecl anim;
     
     p.expect(TokenKind::Animate);
@@ -583,7 +615,8 @@ constexpr WhenStmt parse_when_from_source(std::string_view source) {
 }
 
 // Parse import statement: import forma.animation
-constexpr ImportDecl parse_import(Parser& p) {
+template <typename P>
+constexpr ImportDecl parse_import(P& p) {
     ImportDecl import;
     size_t start = p.current.pos;
     
@@ -604,76 +637,78 @@ constexpr ImportDecl parse_import(Parser& p) {
         }
         
         import.module_path = p.lexer.src.substr(path_start, path_end - path_start);
-        import.location = SourceLocation{start, path_end};
+        import.location = SourceLocation{0, 0, start, path_end - start};
     } else {
         // Error: expected identifier after import
-        import.location = SourceLocation{start, p.current.pos};
+        import.location = SourceLocation{0, 0, start, p.current.pos - start};
     }
     
     return import;
 }
 
-// Parse a complete document (imports, types, enums, events, instances)
-template <size_t MaxTypes = 32, size_t MaxEnums = 16, size_t MaxEvents = 16, 
-          size_t MaxImports = 32, size_t MaxInstances = 64, size_t MaxAssets = 64>
-constexpr Document<MaxTypes, MaxEnums, MaxEvents, MaxImports, MaxInstances, MaxAssets> 
-parse_document(std::string_view source) {
-    Document<MaxTypes, MaxEnums, MaxEvents, MaxImports, MaxInstances, MaxAssets> doc;
-    Parser p(source, &doc.instances);
+// Parse all top-level declarations (imports, types, enums, events, instances)
+// into `doc`. Works for both the fixed Document<...> and RuntimeDocument;
+// with fixed storage, declarations past capacity are parsed and dropped.
+// `on_decl` is called with the source offset of every top-level
+// declaration before it is parsed; editors use it to find declaration
+// boundaries. If it returns bool, false stops parsing before that
+// declaration.
+template <typename DocType, typename P, typename OnDecl>
+constexpr void parse_declarations(DocType& doc, P& p, OnDecl&& on_decl) {
+    LineCursor lines{p.lexer.src};
     
     // Parse top-level declarations
     while (!p.check(TokenKind::EndOfFile)) {
-        if (p.check(TokenKind::Import)) {
-            if (doc.import_count < doc.imports.size()) {
-                doc.imports[doc.import_count++] = parse_import(p);
+        if (p.check(TokenKind::Import) || p.check(TokenKind::Class) || p.check(TokenKind::Enum) ||
+            p.check(TokenKind::Event) || p.check(TokenKind::Identifier)) {
+            if constexpr (std::is_same_v<std::invoke_result_t<OnDecl&, size_t>, bool>) {
+                if (!on_decl(p.current.pos)) {
+                    return;
+                }
             } else {
-                // Too many imports, skip
-                parse_import(p);
+                on_decl(p.current.pos);
             }
         }
+        
+        if (p.check(TokenKind::Import)) {
+            auto import = parse_import(p);
+            import.location = lines.locate(import.location);
+            append_decl(doc.imports, doc.import_count, import);
+        }
         else if (p.check(TokenKind::Class)) {
-            if (doc.type_count < doc.types.size()) {
-                // Capture position of 'class' keyword or type name
-                size_t decl_pos = p.current.pos;
-                auto type = parse_type_decl(p);
+            // Capture position of 'class' keyword or type name
+            size_t decl_pos = p.current.pos;
+            size_t index = doc.type_count;
+            auto type = parse_type_decl(p);
+            if (append_decl(doc.types, doc.type_count, type)) {
                 // Add to symbol table with actual source location
                 doc.symbols.add_symbol(Symbol::Kind::Type, type.name, 
-                                      SourceLocation{0, 0, decl_pos, type.name.size()}, 
-                                      doc.type_count);
-                doc.types[doc.type_count++] = type;
-            } else {
-                // Too many types, skip
-                parse_type_decl(p);
+                                      lines.locate({0, 0, decl_pos, type.name.size()}), 
+                                      index);
             }
         }
         else if (p.check(TokenKind::Enum)) {
-            if (doc.enum_count < doc.enums.size()) {
-                // Capture position of 'enum' keyword
-                size_t decl_pos = p.current.pos;
-                auto enum_decl = parse_enum(p);
+            // Capture position of 'enum' keyword
+            size_t decl_pos = p.current.pos;
+            size_t index = doc.enum_count;
+            auto enum_decl = parse_enum(p);
+            if (append_decl(doc.enums, doc.enum_count, enum_decl)) {
                 // Add to symbol table with actual source location
                 doc.symbols.add_symbol(Symbol::Kind::Enum, enum_decl.name,
-                                      SourceLocation{0, 0, decl_pos, enum_decl.name.size()},
-                                      doc.enum_count);
-                doc.enums[doc.enum_count++] = enum_decl;
-            } else {
-                // Too many enums, skip
-                parse_enum(p);
+                                      lines.locate({0, 0, decl_pos, enum_decl.name.size()}),
+                                      index);
             }
         }
         else if (p.check(TokenKind::Event)) {
-            if (doc.event_count < doc.events.size()) {
-                // Capture position of 'event' keyword
-                size_t decl_pos = p.current.pos;
-                auto event = parse_event(p);
+            // Capture position of 'event' keyword
+            size_t decl_pos = p.current.pos;
+            size_t index = doc.event_count;
+            auto event = parse_event(p);
+            if (append_decl(doc.events, doc.event_count, event)) {
                 // Add to symbol table with actual source location
                 doc.symbols.add_symbol(Symbol::Kind::Event, event.name,
-                                      SourceLocation{0, 0, decl_pos, event.name.size()},
-                                      doc.event_count);
-                doc.events[doc.event_count++] = event;
-            } else {
-                // Too many events, skip
-                parse_event(p);
+                                      lines.locate({0, 0, decl_pos, event.name.size()}),
+                                      index);
             }
         }
         else if (p.check(TokenKind::Identifier)) {
@@ -685,8 +720,77 @@ parse_document(std::string_view source) {
             p.advance();
         }
     }
+}
+
+template <typename DocType, typename OnDecl>
+constexpr void parse_document_into(DocType& doc, std::string_view source, OnDecl&& on_decl) {
+    BasicParser<std::remove_cvref_t<decltype(doc.instances)>> p(source, &doc.instances);
+    parse_declarations(doc, p, on_decl);
+}
+
+// Same, reading pre-lexed tokens; the document points into the buffer's
+// source, not the buffer, so the buffer can be dropped or reused after
+template <typename DocType, typename OnDecl>
+constexpr void parse_document_into(DocType& doc, const TokenBuffer& tokens, OnDecl&& on_decl) {
+    BasicParser<std::remove_cvref_t<decltype(doc.instances)>> p(tokens, &doc.instances);
+    parse_declarations(doc, p, on_decl);
+}
+
+template <typename DocType>
+constexpr void parse_document_into(DocType& doc, std::string_view source) {
+    parse_document_into(doc, source, [](size_t) {});
+}
+
+// Parse a complete document into fixed-capacity storage (usable at compile time)
+template <size_t MaxTypes = 32, size_t MaxEnums = 16, size_t MaxEvents = 16, 
+          size_t MaxImports = 32, size_t MaxInstances = 64, size_t MaxAssets = 64>
+constexpr Document<MaxTypes, MaxEnums, MaxEvents, MaxImports, MaxInstances, MaxAssets> 
+parse_document(std::string_view source) {
+    Document<MaxTypes, MaxEnums, MaxEvents, MaxImports, MaxInstances, MaxAssets> doc;
+    parse_document_into(doc, source);
+    return doc;
+}
+
+// Every instance, top-level or nested, starts with `TypeName {`, so the
+// Identifier-LBrace pairs bound the instance list. Type and event bodies
+// also open with an Identifier and a '{' but are few and small.
+constexpr size_t count_instance_bodies(const TokenBuffer& tokens) {
+    size_t count = 0;
+    for (size_t i = 1; i < tokens.size(); ++i) {
+        count += tokens.kind(i) == TokenKind::LBrace && tokens.kind(i - 1) == TokenKind::Identifier;
+    }
+    return count;
+}
+
+// Parse a complete document into arena-backed storage. The instance list
+// is reserved from the token stream so the arena does not keep the
+// discarded buffers of repeated vector growth; every other list grows on
+// demand from the arena's small initial block.
+template <typename OnDecl>
+RuntimeDocument parse_document_runtime(const TokenBuffer& tokens, OnDecl&& on_decl) {
+    size_t instance_bound = count_instance_bodies(tokens);
+    
+    RuntimeDocument doc(instance_bound * sizeof(InstanceDecl) + 4096);
+    doc.instances.instances.reserve(instance_bound);
+    parse_document_into(doc, tokens, on_decl);
+    return doc;
+}
+
+// Lexes the whole source first unless it is too large for a TokenBuffer,
+// in which case the lists simply grow as declarations are parsed
+template <typename OnDecl>
+RuntimeDocument parse_document_runtime(std::string_view source, OnDecl&& on_decl) {
+    if (TokenBuffer::fits(source)) {
+        return parse_document_runtime(TokenBuffer(source), on_decl);
+    }
     
+    RuntimeDocument doc;
+    parse_document_into(doc, source, on_decl);
     return doc;
 }
 
+inline RuntimeDocument parse_document_runtime(std::string_view source) {
+    return parse_document_runtime(source, [](size_t) {});
+}
+
 } // namespace forma
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define FORMA_SCAN_AVX2 1
+#endif
+
+namespace forma::scan {
+
+// ============================================================================
+// Scan Kernels - Byte-run scanners behind the runtime tokenizer
+// ============================================================================
+
+// Each kernel returns the first byte in [p, end) that ends the run, or end.
+// A NUL byte ends every run that stops at a terminator, as the tokenizer
+// treats it as end of input.
+struct Kernels {
+    const char* name;
+    const char* (*skip_whitespace)(const char* p, const char* end);   // Past ' ', \n, \t, \r
+    const char* (*skip_identifier)(const char* p, const char* end);   // Past [A-Za-z0-9_]
+    const char* (*find_line_end)(const char* p, const char* end);     // To \n or NUL
+    const char* (*find_star)(const char* p, const char* end);         // To * or NUL
+    const char* (*find_quote)(const char* p, const char* end);        // To " or NUL
+};
+
+constexpr bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+constexpr bool is_identifier_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+namespace scalar {
+
+inline const char* skip_whitespace(const char* p, const char* end) {
+    while (p < end && is_space(*p)) ++p;
+    return p;
+}
+
+inline const char* skip_identifier(const char* p, const char* end) {
+    while (p < end && is_identifier_char(*p)) ++p;
+    return p;
+}
+
+template <char Stop>
+inline const char* find(const char* p, const char* end) {
+    while (p < end && *p != Stop && *p != '\0') ++p;
+    return p;
+}
+
+} // namespace scalar
+
+#if defined(__SSE2__)
+namespace sse2 {
+
+// 16 bytes at a time; runs shorter than a block cost one load and one
+// compare, the remainder under 16 bytes is finished byte by byte
+inline unsigned space_mask(__m128i v) {
+    __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+                             _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+    return static_cast<unsigned>(_mm_movemask_epi8(m));
+}
+
+// Signed compares are enough: bytes >= 0x80 are negative and fall outside
+// every ASCII range. OR-ing 0x20 folds A-Z onto a-z without creating new
+// letters.
+inline unsigned identifier_mask(__m128i v) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), under)));
+}
+
+inline const char* skip_whitespace(const char* p, const char* end) {
+    for (; end - p >= 16; p += 16) {
+        unsigned stop = ~space_mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) & 0xFFFF;
+        if (stop) return p + __builtin_ctz(stop);
+    }
+    return scalar::skip_whitespace(p, end);
+}
+
+inline const char* skip_identifier(const char* p, const char* end) {
+    for (; end - p >= 16; p += 16) {
+        unsigned stop = ~identifier_mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) & 0xFFFF;
+        if (stop) return p + __builtin_ctz(stop);
+    }
+    return scalar::skip_identifier(p, end);
+}
+
+template <char Stop>
+inline const char* find(const char* p, const char* end) {
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(Stop)), _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scalar::find<Stop>(p, end);
+}
+
+} // namespace sse2
+#endif
+
+#if defined(FORMA_SCAN_AVX2)
+namespace avx2 {
+
+// 32 bytes at a time, compiled for AVX2 regardless of the global target
+// flags and only selected when the CPU reports support
+#define FORMA_AVX2_TARGET __attribute__((target("avx2")))
+
+FORMA_AVX2_TARGET inline unsigned space_mask(__m256i v) {
+    __m256i m = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+    return static_cast<unsigned>(_mm256_movemask_epi8(m));
+}
+
+FORMA_AVX2_TARGET inline unsigned identifier_mask(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i letter = _mm256_andnot_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('z')),
+                                         _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)));
+    __m256i digit = _mm256_andnot_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('9')),
+                                        _mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)));
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(letter, digit), under)));
+}
+
+FORMA_AVX2_TARGET inline const char* skip_whitespace(const char* p, const char* end) {
+    for (; end - p >= 32; p += 32) {
+        unsigned stop = ~space_mask(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        if (stop) return p + __builtin_ctz(stop);
+    }
+    return sse2::skip_whitespace(p, end);
+}
+
+FORMA_AVX2_TARGET inline const char* skip_identifier(const char* p, const char* end) {
+    for (; end - p >= 32; p += 32) {
+        unsigned stop = ~identifier_mask(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        if (stop) return p + __builtin_ctz(stop);
+    }
+    return sse2::skip_identifier(p, end);
+}
+
+template <char Stop>
+FORMA_AVX2_TARGET inline const char* find(const char* p, const char* end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(Stop)),
+                                      _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return sse2::find<Stop>(p, end);
+}
+
+#undef FORMA_AVX2_TARGET
+
+} // namespace avx2
+#endif
+
+inline constexpr Kernels SCALAR_KERNELS = {
+    "scalar", scalar::skip_whitespace, scalar::skip_identifier,
+    scalar::find<'\n'>, scalar::find<'*'>, scalar::find<'"'>,
+};
+
+#if defined(__SSE2__)
+inline constexpr Kernels SSE2_KERNELS = {
+    "sse2", sse2::skip_whitespace, sse2::skip_identifier,
+    sse2::find<'\n'>, sse2::find<'*'>, sse2::find<'"'>,
+};
+#endif
+
+#if defined(FORMA_SCAN_AVX2)
+inline constexpr Kernels AVX2_KERNELS = {
+    "avx2", avx2::skip_whitespace, avx2::skip_identifier,
+    avx2::find<'\n'>, avx2::find<'*'>, avx2::find<'"'>,
+};
+#endif
+
+// Every kernel set this CPU can run, widest last
+inline std::span<const Kernels* const> available_kernels() {
+    static const Kernels* const sets[] = {
+        &SCALAR_KERNELS,
+#if defined(__SSE2__)
+        &SSE2_KERNELS,
+#endif
+#if defined(FORMA_SCAN_AVX2)
+        __builtin_cpu_supports("avx2") ? &AVX2_KERNELS : nullptr,
+#endif
+    };
+    size_t count = sizeof(sets) / sizeof(sets[0]);
+    while (count > 1 && sets[count - 1] == nullptr) --count;
+    return {sets, count};
+}
+
+// SSE2 rather than the widest set: most runs (identifiers, indentation)
+// end inside the first 16 bytes, and on 16 MB of generated .fml the
+// tokenizer benchmark measures AVX2 slightly behind SSE2 (~580 vs ~600
+// MB/s, scalar ~400). AVX2 stays available through FORMA_SCAN.
+inline const Kernels& default_kernels() {
+#if defined(__SSE2__)
+    return SSE2_KERNELS;
+#else
+    return SCALAR_KERNELS;
+#endif
+}
+
+namespace detail {
+
+inline const Kernels* select_kernels() {
+    if (const char* forced = std::getenv("FORMA_SCAN")) {
+        for (const Kernels* set : available_kernels()) {
+            if (std::strcmp(set->name, forced) == 0) return set;
+        }
+    }
+    return &default_kernels();
+}
+
+inline const Kernels*& active_kernels() {
+    static const Kernels* active = select_kernels();
+    return active;
+}
+
+} // namespace detail
+
+// Chosen once at startup: default_kernels(), unless FORMA_SCAN names
+// another set the CPU supports ("scalar", "sse2", "avx2")
+inline const Kernels& kernels() {
+    return *detail::active_kernels();
+}
+
+// Replaces the startup choice; for tests and benchmarks, not to be called
+// while another thread is tokenizing
+inline void use_kernels(const Kernels& set) {
+    detail::active_kernels() = &set;
+}
+
+} // namespace forma::scan
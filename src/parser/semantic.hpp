@@ -1,7 +1,9 @@
 #pragma once
+#include <type_traits>
 #include "diagnostics.hpp"
 #include "ir_types.hpp"
 #include "tokenizer.hpp"
+#include "widget_registry.hpp"
 
 namespace forma {
 
@@ -9,12 +11,12 @@ namespace forma {
 // Semantic Analysis & Type Resolution
 // ============================================================================
 
-template <size_t MaxDiags = 64>
+template <size_t MaxDiags = 64, typename Symbols = SymbolTable<128>>
 struct SemanticAnalyzer {
     DiagnosticList<MaxDiags> diagnostics;
-    const SymbolTable<128>* symbols = nullptr;
+    const Symbols* symbols = nullptr;
     
-    constexpr SemanticAnalyzer(const SymbolTable<128>* sym_table) 
+    constexpr SemanticAnalyzer(const Symbols* sym_table) 
         : symbols(sym_table) {}
     
     // Helper to create source location from token
@@ -34,14 +36,8 @@ struct SemanticAnalyzer {
             return true;
         }
         
-        // Check LVGL widget types (built-in widgets)
-        if (type_name == "Button" || type_name == "Label" || type_name == "Panel" || 
-            type_name == "Container" || type_name == "Slider" || type_name == "Switch" ||
-            type_name == "Checkbox" || type_name == "Dropdown" || type_name == "TextArea" ||
-            type_name == "Image" || type_name == "Arc" || type_name == "Bar" ||
-            type_name == "Spinner" || type_name == "List" || type_name == "Chart" ||
-            type_name == "Table" || type_name == "Calendar" || type_name == "Keyboard" ||
-            type_name == "Roller" || type_name == "Textarea") {
+        // Check widget types (built-in and plugin-registered widgets)
+        if (widgets::is_widget(type_name)) {
             return true;
         }
         
@@ -157,11 +153,21 @@ struct SemanticAnalyzer {
         }
     }
     
-    // Find a type declaration by name
-    template <size_t MaxTypes>
+    // Find a type declaration by name (TypeList: std::array or pmr vector)
+    template <typename TypeList>
     constexpr const TypeDecl* find_type_decl(std::string_view name,
-                                             const std::array<TypeDecl, MaxTypes>& types,
+                                             const TypeList& types,
                                              size_t type_count) const {
+        // Symbols carry the declaration index, so the common case is one lookup
+        const Symbol* sym = symbols ? symbols->find(name) : nullptr;
+        if (sym && sym->kind == Symbol::Kind::Type && sym->decl_index < type_count &&
+            types[sym->decl_index].name == name) {
+            return &types[sym->decl_index];
+        }
+        if (!sym && symbols && symbols->dropped == 0) {
+            return nullptr; // Every stored type is indexed; not a user type
+        }
+        
         for (size_t i = 0; i < type_count; ++i) {
             if (types[i].name == name) {
                 return &types[i];
@@ -171,9 +177,9 @@ struct SemanticAnalyzer {
     }
     
     // Validate InstanceDecl
-    template <size_t MaxTypes>
+    template <typename TypeList>
     constexpr void validate_instance(const InstanceDecl& inst, 
-                                    const std::array<TypeDecl, MaxTypes>& types,
+                                    const TypeList& types,
                                     size_t type_count,
                                     SourceLocation loc) {
         // Validate instance type exists
@@ -252,13 +258,19 @@ struct SemanticAnalyzer {
     }
 };
 
-// Analyze a complete document
-template <size_t MaxDiags = 64, size_t MaxTypes = 32, size_t MaxEnums = 16, 
-          size_t MaxEvents = 16, size_t MaxImports = 32, size_t MaxInstances = 64, size_t MaxAssets = 64>
-constexpr DiagnosticList<MaxDiags> analyze_document(
-    Document<MaxTypes, MaxEnums, MaxEvents, MaxImports, MaxInstances, MaxAssets>& doc) {
+// Analyze a complete document (fixed Document<...> or RuntimeDocument)
+template <size_t MaxDiags = 64, typename DocType>
+constexpr DiagnosticList<MaxDiags> analyze_document(DocType& doc) {
     
-    SemanticAnalyzer<MaxDiags> analyzer(&doc.symbols);
+    SemanticAnalyzer<MaxDiags, std::remove_cvref_t<decltype(doc.symbols)>> analyzer(&doc.symbols);
+    
+    // Lookups below would report dropped declarations as unknown types
+    if (doc.symbols.dropped > 0) {
+        analyzer.diagnostics.add(DiagnosticSeverity::Error,
+                                "symbol table full",
+                                SourceLocation{0, 0, 0, 0},
+                                "symbol-table-full");
+    }
     
     // Validate all type declarations
     for (size_t i = 0; i < doc.type_count; ++i) {
@@ -1,5 +1,7 @@
 #include <bugspray/bugspray.hpp>
 #include "ir.hpp"
+#include <string>
+#include <vector>
 
 using namespace forma;
 
@@ -153,3 +155,54 @@ TEST_CASE("Diagnostics - Error Reporting")
         CHECK(diagnostics.diagnostics[2].severity == DiagnosticSeverity::Warning);
     }
 }
+
+TEST_CASE("Diagnostics - Symbol Table")
+{
+    SECTION("First declaration wins on lookup")
+    {
+        SymbolTable<8> symbols;
+        symbols.add_symbol(Symbol::Kind::Type, "Point", SourceLocation{}, 0);
+        symbols.add_symbol(Symbol::Kind::Enum, "Point", SourceLocation{}, 1);
+        
+        const Symbol* sym = symbols.find("Point");
+        REQUIRE(sym != nullptr);
+        CHECK(sym->kind == Symbol::Kind::Type);
+        CHECK(symbols.count == 2ul);
+        CHECK(!symbols.exists("Size"));
+    }
+    
+    SECTION("Full table is reported")
+    {
+        std::string source;
+        for (int i = 0; i < 130; ++i) {
+            source += "enum E" + std::to_string(i) + " { A }\n";
+        }
+        
+        auto doc = parse_document<32, 256>(source);
+        auto diags = analyze_document(doc);
+        
+        CHECK(doc.symbols.count == 128ul);
+        CHECK(doc.symbols.dropped == 2ul);
+        REQUIRE(diags.count == 1ul);
+        CHECK(diags.diagnostics[0].code == "symbol-table-full");
+    }
+    
+    SECTION("Dynamic table grows")
+    {
+        std::vector<std::string> names;
+        for (int i = 0; i < 1000; ++i) {
+            names.push_back("Type" + std::to_string(i));
+        }
+        
+        DynamicSymbolTable symbols;
+        for (size_t i = 0; i < names.size(); ++i) {
+            symbols.add_symbol(Symbol::Kind::Type, names[i], SourceLocation{}, i);
+        }
+        
+        CHECK(symbols.count == 1000ul);
+        CHECK(symbols.dropped == 0ul);
+        REQUIRE(symbols.find("Type999") != nullptr);
+        CHECK(symbols.find("Type999")->decl_index == 999ul);
+        CHECK(symbols.find("Type1000") == nullptr);
+    }
+}
@@ -1,5 +1,6 @@
 #include <bugspray/bugspray.hpp>
 #include "ir.hpp"
+#include <string>
 
 using namespace forma;
 
@@ -199,3 +200,233 @@ Button {
         CHECK(doc.instances.count == 1ul);
     }
 }
+
+TEST_CASE("Parser - Runtime Document")
+{
+    SECTION("Instances beyond fixed capacity are kept")
+    {
+        std::string source = "class Tile {\n    property size: int\n}\n";
+        for (int i = 0; i < 200; ++i) {
+            source += "Tile {\n    size: " + std::to_string(i) + "\n}\n";
+        }
+        
+        auto fixed = parse_document(source);
+        auto doc = parse_document_runtime(source);
+        
+        CHECK(fixed.instances.count == 64ul);
+        CHECK(doc.instances.count == 200ul);
+        CHECK(doc.instances.get(199).properties[0].value.text == "199");
+        CHECK(doc.type_count == 1ul);
+        CHECK(doc.symbols.find("Tile") != nullptr);
+    }
+
+    SECTION("Instance list is reserved from instance bodies only")
+    {
+        std::string source = "class Tile {\n    property size: int\n}\n";
+        source += "Column {\n    Tile { size: 1 }\n    Tile { size: 2 }\n}\n";
+        source += "event Tapped { }\n";
+
+        TokenBuffer tokens(source);
+        auto doc = parse_document_runtime(tokens, [](size_t) {});
+
+        CHECK(count_instance_bodies(tokens) == 5ul);
+        CHECK(doc.instances.count == 3ul);
+        CHECK(doc.instances.instances.capacity() == 5ul);
+    }
+
+    SECTION("Semantic analysis runs on runtime documents")
+    {
+        std::string source = "class Tile {\n    property size: int\n}\n";
+        for (int i = 0; i < 100; ++i) {
+            source += "Tile {\n    size: 1\n}\n";
+        }
+        source += "Tile {\n    colour: 1\n}\n";
+        
+        auto doc = parse_document_runtime(source);
+        auto diags = analyze_document(doc);
+        
+        REQUIRE(diags.count == 1ul);
+        CHECK(diags.diagnostics[0].code == "unknown-property");
+    }
+}
+
+TEST_CASE("Parser - Token Buffer")
+{
+    SECTION("Tokens match the lexer")
+    {
+        constexpr std::string_view source = "class A { method int f(x: int) }\nA { text: \"hi\" n: 12 } // end\n\"open";
+        TokenBuffer tokens(source);
+        
+        Lexer lexer{source, 0};
+        size_t index = 0;
+        while (true) {
+            Tok tok = next_token(lexer);
+            CHECK(tokens.kind(index) == tok.kind);
+            CHECK(tokens.text(index) == tok.text);
+            CHECK(tokens.offset(index) == tok.pos);
+            CHECK(tokens.end(index) == lexer.pos);
+            ++index;
+            if (tok.kind == TokenKind::EndOfFile) break;
+        }
+        CHECK(tokens.size() == index);
+        CHECK(tokens.kind(index + 5) == TokenKind::EndOfFile);
+        CHECK(tokens.count(TokenKind::LBrace) == 2ul);
+    }
+    
+    SECTION("Lexes at compile time")
+    {
+        static_assert(TokenBuffer("a { b: 1 }").size() == 7);
+    }
+    
+    SECTION("Lookahead reads the same tokens either way")
+    {
+        constexpr std::string_view source = "Button { text: \"Go\" }";
+        TokenBuffer tokens(source);
+        Parser lazy(source);
+        Parser buffered(tokens, nullptr);
+        for (size_t n = 0; n < 8; ++n) {
+            CHECK(lazy.peek(n).kind == buffered.peek(n).kind);
+            CHECK(lazy.peek(n).text == buffered.peek(n).text);
+        }
+        CHECK(lazy.peek(2).text == "text");
+        CHECK(lazy.current.text == "Button");
+    }
+    
+    SECTION("Buffered parse matches the lazy parse")
+    {
+        std::string source = "import ui.widgets\nclass Tile {\n    property size: int\n    method bool hit(x: int, y: int)\n    method reset()\n}\n";
+        source += "Tile {\n    size: 3\n    when (size > (1 + 1)) { size: 2 }\n    Label { text: \"a\" or preview{\"b\"} }\n}\n";
+        source += "Tile { stray Label { } }\n";
+        
+        auto lazy = parse_document<>(source);
+        RuntimeDocument buffered(4096);
+        parse_document_into(buffered, TokenBuffer(source), [](size_t) {});
+        
+        REQUIRE(buffered.type_count == 1ul);
+        CHECK(buffered.types[0].methods[0].return_type.name == "bool");
+        CHECK(buffered.types[0].methods[0].name == "hit");
+        CHECK(buffered.types[0].methods[1].return_type.name == "void");
+        CHECK(buffered.types[0].methods[1].name == "reset");
+        CHECK(buffered.instances.count == lazy.instances.count);
+        for (size_t i = 0; i < lazy.instances.count; ++i) {
+            const auto& a = lazy.instances.get(i);
+            const auto& b = buffered.instances.get(i);
+            CHECK(a.type_name == b.type_name);
+            CHECK(a.prop_count == b.prop_count);
+            CHECK(a.child_count == b.child_count);
+            CHECK(a.when_count == b.when_count);
+            if (a.when_count > 0) {
+                CHECK(a.when_stmts[0].condition == b.when_stmts[0].condition);
+            }
+        }
+        CHECK(buffered.instances.get(1).when_stmts[0].condition == "size > (1 + 1)");
+    }
+}
+
+TEST_CASE("Parser - Line Index")
+{
+    SECTION("Offsets and positions round-trip")
+    {
+        std::string source = "class A {\n    property x: int\n}\n\nA { x: 1 }";
+        LineIndex lines(source);
+        
+        CHECK(lines.line_count() == 5ul);
+        for (size_t offset = 0; offset <= source.size(); ++offset) {
+            LinePosition pos = lines.position(offset);
+            CHECK(lines.offset(pos.line, pos.column) == offset);
+        }
+        CHECK(lines.position(source.find("property")).line == 1ul);
+        CHECK(lines.position(source.find("property")).column == 4ul);
+        CHECK(lines.offset(0, 100) == source.find('\n'));  // Clamped to line end
+        CHECK(lines.offset(9, 0) == source.size());
+        CHECK(lines.position(source.size() + 10).line == 4ul);
+    }
+    
+    SECTION("Newlines after NUL bytes are indexed")
+    {
+        std::string source = std::string(40, 'a') + '\0' + "\nb\n" + std::string(40, ' ') + '\0' + '\n';
+        LineIndex lines(source);
+        CHECK(lines.line_count() == 4ul);
+        CHECK(lines.line_start(1) == 42ul);
+    }
+    
+    SECTION("Edits patch the index")
+    {
+        std::string source = "a\nbb\nccc\n\ndddd\n";
+        LineIndex lines(source);
+        
+        std::string many_lines(70, '\n');
+        struct Edit { size_t start, end; std::string_view text; };
+        for (Edit edit : {Edit{0, 0, "x\n"}, Edit{3, 7, ""}, Edit{2, 2, "\n\n\n"}, Edit{1, 6, "yy"},
+                          Edit{0, 0, many_lines}, Edit{5, 200, "z"}}) {
+            std::string text(edit.text);
+            size_t end = std::min(edit.end, source.size());
+            source.replace(edit.start, end - edit.start, text);
+            lines.update(edit.start, end, text);
+            
+            LineIndex fresh(source);
+            REQUIRE(lines.line_count() == fresh.line_count());
+            for (size_t i = 0; i < fresh.line_count(); ++i) {
+                CHECK(lines.line_start(i) == fresh.line_start(i));
+            }
+            CHECK(lines.size() == source.size());
+        }
+    }
+    
+    SECTION("Parser fills declaration positions")
+    {
+        constexpr std::string_view source = "import ui.widgets\n\nclass Card {\n}\n  enum Mode { A }\nevent Tap()";
+        constexpr auto doc = parse_document(source);
+        
+        static_assert(doc.symbols.find("Mode")->location.line == 4);
+        static_assert(doc.symbols.find("Mode")->location.column == 2);
+        CHECK(doc.symbols.find("Card")->location.line == 2ul);
+        CHECK(doc.symbols.find("Tap")->location.line == 5ul);
+        CHECK(doc.imports[0].location.offset == 0ul);
+        CHECK(doc.imports[0].location.length == std::string_view("import ui.widgets").size());
+        
+        auto runtime = parse_document_runtime(source);
+        CHECK(runtime.symbols.find("Mode")->location.column == 2ul);
+    }
+}
+
+TEST_CASE("Widget Registry")
+{
+    SECTION("Built-in widgets resolve at compile time")
+    {
+        static_assert(widgets::is_widget("Button"));
+        static_assert(widgets::is_widget("Textarea"));
+        static_assert(!widgets::is_widget("button"));
+        static_assert(std::string_view(widgets::lvgl_widget("Container")) == "lv_obj");
+        static_assert(widgets::lvgl_setter("opacity") == nullptr);
+        static_assert(std::string_view(widgets::lvgl_anim_setter("opacity")) == "lv_obj_set_style_opa");
+        CHECK(std::string_view(widgets::lvgl_event("value_changed")) == "LV_EVENT_VALUE_CHANGED");
+        CHECK(widgets::lvgl_easing("") == nullptr);
+    }
+    
+    SECTION("Every key has its own slot")
+    {
+        for (const auto& [name, info] : widgets::BUILTIN_WIDGETS.all()) {
+            CHECK(widgets::BUILTIN_WIDGETS.find(name) == &info);
+        }
+        for (const auto& [name, info] : widgets::BUILTIN_PROPERTIES.all()) {
+            CHECK(widgets::BUILTIN_PROPERTIES.find(name) == &info);
+        }
+        for (const auto& [name, code] : widgets::BUILTIN_EVENTS.all()) {
+            CHECK(widgets::BUILTIN_EVENTS.find(name) == &code);
+        }
+    }
+    
+    SECTION("Registered widgets pass type validation")
+    {
+        std::string_view source = "Gauge {\n    needle: 40\n}\n";
+        auto doc = parse_document(source);
+        SemanticAnalyzer<64, decltype(doc.symbols)> before(&doc.symbols);
+        CHECK(!before.validate_type("Gauge", Tok{TokenKind::Identifier, "Gauge", 0}));
+        
+        widgets::overlay().add_widget("Gauge", "lv_scale");
+        SemanticAnalyzer<64, decltype(doc.symbols)> after(&doc.symbols);
+        CHECK(after.validate_type("Gauge", Tok{TokenKind::Identifier, "Gauge", 0}));
+        widgets::overlay().clear();
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "tokenizer.hpp"
+
+namespace forma {
+
+// ============================================================================
+// Token Buffer - Whole source lexed up front, stored column by column
+// ============================================================================
+
+// Every token of a source, ending with one EndOfFile token. Kinds, offsets
+// and lengths live in separate arrays (6 bytes per token) so a parser can
+// look any distance ahead by index and consumers that only need kinds
+// (highlighting, counting) walk one dense byte array.
+//
+// A token's offset and length cover its source span, quotes included;
+// text() strips them from string literals, giving the same text as
+// next_token(). Offsets are 32-bit: sources of 4 GiB or more must be
+// lexed lazily (see fits()).
+//
+// The buffer refers to the source, which must outlive it.
+class TokenBuffer {
+public:
+    constexpr TokenBuffer() = default;
+
+    constexpr explicit TokenBuffer(std::string_view source) {
+        lex(source);
+    }
+
+    static constexpr bool fits(std::string_view source) {
+        return source.size() < UINT32_MAX;
+    }
+
+    // Lex `source`, replacing the previous contents but keeping capacity
+    constexpr void lex(std::string_view source) {
+        src = source;
+        kinds.clear();
+        offsets.clear();
+        lengths.clear();
+
+        // Generated and hand-written .fml average well over 8 bytes per token
+        size_t estimate = source.size() / 8 + 1;
+        kinds.reserve(estimate);
+        offsets.reserve(estimate);
+        lengths.reserve(estimate);
+
+        Lexer lexer{source, 0};
+        while (true) {
+            Tok tok = next_token(lexer);
+            kinds.push_back(tok.kind);
+            offsets.push_back(static_cast<uint32_t>(tok.pos));
+            lengths.push_back(static_cast<uint32_t>(lexer.pos - tok.pos));
+            if (tok.kind == TokenKind::EndOfFile) {
+                break;
+            }
+        }
+    }
+
+    constexpr std::string_view source() const { return src; }
+
+    // Token count, including the trailing EndOfFile
+    constexpr size_t size() const { return kinds.size(); }
+
+    constexpr TokenKind kind(size_t index) const { return kinds[clamp(index)]; }
+    constexpr uint32_t offset(size_t index) const { return offsets[clamp(index)]; }
+    constexpr uint32_t length(size_t index) const { return lengths[clamp(index)]; }
+    constexpr size_t end(size_t index) const { return size_t{offset(index)} + length(index); }
+
+    constexpr std::string_view text(size_t index) const {
+        index = clamp(index);
+        if (kinds[index] == TokenKind::StringLiteral) {
+            // As next_token(): an unterminated string loses its last byte
+            return src.substr(offsets[index] + 1, lengths[index] - 2);
+        }
+        return src.substr(offsets[index], lengths[index]);
+    }
+
+    // Indices past the end read the EndOfFile token
+    constexpr Tok token(size_t index) const {
+        return {kind(index), text(index), offset(index)};
+    }
+
+    constexpr size_t count(TokenKind k) const {
+        size_t n = 0;
+        for (TokenKind each : kinds) {
+            n += (each == k);
+        }
+        return n;
+    }
+
+private:
+    std::string_view src;
+    std::vector<TokenKind> kinds;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+
+    constexpr size_t clamp(size_t index) const {
+        return index < kinds.size() ? index : kinds.size() - 1;
+    }
+};
+
+} // namespace forma
@@ -1,6 +1,8 @@
 #pragma once
 #include <array>
+#include <cstdint>
 #include <string_view>
+#include "scan.hpp"
 
 namespace forma {
 
@@ -8,7 +10,7 @@ namespace forma {
 // Tokenizer / Lexer
 // ============================================================================
 
-enum class TokenKind {
+enum class TokenKind : uint8_t {
     // identifiers & literals
     Identifier,
     IntegerLiteral,
@@ -95,18 +97,47 @@ constexpr bool is_digit(char c) {
     return c >= '0' && c <= '9';
 }
 
+namespace detail {
+
+// Position after the run starting at `pos`. At runtime runs go through the
+// SIMD scan kernels (after an inline check of the first byte, as most runs
+// are short); constant evaluation walks byte by byte.
+template <typename InRun, typename Kernel>
+constexpr size_t scan_run(std::string_view src, size_t pos, InRun in_run, Kernel kernel) {
+    if (pos >= src.size() || !in_run(src[pos])) {
+        return pos;
+    }
+    if !consteval {
+        return static_cast<size_t>((scan::kernels().*kernel)(src.data() + pos, src.data() + src.size()) - src.data());
+    }
+    while (pos < src.size() && in_run(src[pos])) ++pos;
+    return pos;
+}
+
+constexpr size_t skip_whitespace(std::string_view src, size_t pos) {
+    return scan_run(src, pos, scan::is_space, &scan::Kernels::skip_whitespace);
+}
+
+constexpr size_t skip_identifier(std::string_view src, size_t pos) {
+    return scan_run(src, pos, scan::is_identifier_char, &scan::Kernels::skip_identifier);
+}
+
+// Stops at `stop`, a NUL byte or the end of input
+template <char Stop>
+constexpr size_t find_stop(std::string_view src, size_t pos, decltype(&scan::Kernels::find_star) kernel) {
+    return scan_run(src, pos, [](char c) { return c != Stop && c != '\0'; }, kernel);
+}
+
+} // namespace detail
+
 constexpr Tok next_token(Lexer& l) {
     // Skip whitespace and comments
     while (true) {
-        while (l.peek() == ' ' || l.peek() == '\n' || l.peek() == '\t' || l.peek() == '\r')
-            l.advance();
+        l.pos = detail::skip_whitespace(l.src, l.pos);
         
         // Skip line comments (// ...)
         if (l.peek() == '/' && l.pos + 1 < l.src.size() && l.src[l.pos + 1] == '/') {
-            l.advance(); // skip first /
-            l.advance(); // skip second /
-            while (l.peek() && l.peek() != '\n')
-                l.advance();
+            l.pos = detail::find_stop<'\n'>(l.src, l.pos + 2, &scan::Kernels::find_line_end);
             if (l.peek() == '\n')
                 l.advance();
             continue; // Check for more whitespace/comments
@@ -114,15 +145,16 @@ constexpr Tok next_token(Lexer& l) {
         
         // Skip block comments (/* ... */)
         if (l.peek() == '/' && l.pos + 1 < l.src.size() && l.src[l.pos + 1] == '*') {
-            l.advance(); // skip /
-            l.advance(); // skip *
-            while (l.peek()) {
-                if (l.peek() == '*' && l.pos + 1 < l.src.size() && l.src[l.pos + 1] == '/') {
-                    l.advance(); // skip *
+            l.pos += 2;
+            while (true) {
+                l.pos = detail::find_stop<'*'>(l.src, l.pos, &scan::Kernels::find_star);
+                if (!l.peek())
+                    break;
+                l.advance(); // skip *
+                if (l.peek() == '/') {
                     l.advance(); // skip /
                     break;
                 }
-                l.advance();
             }
             continue; // Check for more whitespace/comments
         }
@@ -146,7 +178,7 @@ constexpr Tok next_token(Lexer& l) {
         case ')': return {TokenKind::RParen, ")", start};
         case '@': return {TokenKind::At, "@", start};
         case '"': {
-            while (l.peek() && l.peek() != '"') l.advance();
+            l.pos = detail::find_stop<'"'>(l.src, l.pos, &scan::Kernels::find_quote);
             l.advance(); // closing "
             return {
                 TokenKind::StringLiteral,
@@ -157,8 +189,7 @@ constexpr Tok next_token(Lexer& l) {
     }
 
     if (is_alpha(c)) {
-        while (is_alpha(l.peek()) || is_digit(l.peek()))
-            l.advance();
+        l.pos = detail::skip_identifier(l.src, l.pos);
 
         auto text = l.src.substr(start, l.pos - start);
         if (text == "true" || text == "false")
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace forma {
+
+// ============================================================================
+// Widget Registry - Built-in widgets, properties, events and easings with
+// their LVGL bindings, looked up through compile-time perfect hashes
+// ============================================================================
+
+namespace detail {
+
+constexpr uint32_t registry_hash(uint32_t seed, std::string_view key) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+} // namespace detail
+
+// Immutable string map whose hash seed is searched at compile time so that
+// no two keys share a slot: a lookup is one hash and one key comparison.
+template <typename V, size_t N>
+class PerfectHashTable {
+public:
+    static constexpr size_t SLOTS = [] {
+        size_t slots = 1;
+        while (slots < N * 4) slots <<= 1;  // Sparse enough to find a seed quickly
+        return slots;
+    }();
+
+    using Entry = std::pair<std::string_view, V>;
+
+    constexpr explicit PerfectHashTable(const std::array<Entry, N>& entries) : entries(entries) {
+        for (uint32_t candidate = 0;; ++candidate) {
+            if (try_seed(candidate)) {
+                seed = candidate;
+                return;
+            }
+        }
+    }
+
+    constexpr const V* find(std::string_view key) const {
+        uint8_t index = slots[detail::registry_hash(seed, key) & (SLOTS - 1)];
+        if (index == 0 || entries[index - 1].first != key) {
+            return nullptr;
+        }
+        return &entries[index - 1].second;
+    }
+
+    constexpr const std::array<Entry, N>& all() const { return entries; }
+
+private:
+    static_assert(N < 255, "slot indices are stored in a byte");
+
+    std::array<Entry, N> entries;
+    std::array<uint8_t, SLOTS> slots{};  // Entry index + 1, 0 = empty
+    uint32_t seed = 0;
+
+    constexpr bool try_seed(uint32_t candidate) {
+        slots.fill(0);
+        for (size_t i = 0; i < N; ++i) {
+            auto& slot = slots[detail::registry_hash(candidate, entries[i].first) & (SLOTS - 1)];
+            if (slot != 0) {
+                return false;
+            }
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        return true;
+    }
+};
+
+namespace widgets {
+
+struct WidgetInfo {
+    const char* lvgl_type;  // Widget class prefix: lv_<name>_create()
+};
+
+struct PropertyInfo {
+    const char* lvgl_setter;       // Called with the object and the value
+    const char* lvgl_anim_setter;  // Animation exec callback, nullptr if not animatable
+};
+
+inline constexpr PerfectHashTable<WidgetInfo, 20> BUILTIN_WIDGETS{{{
+    {"Button", {"lv_btn"}},
+    {"Label", {"lv_label"}},
+    {"Panel", {"lv_obj"}},
+    {"Container", {"lv_obj"}},
+    {"Slider", {"lv_slider"}},
+    {"Switch", {"lv_switch"}},
+    {"Checkbox", {"lv_checkbox"}},
+    {"Dropdown", {"lv_dropdown"}},
+    {"TextArea", {"lv_textarea"}},
+    {"Image", {"lv_img"}},
+    {"Arc", {"lv_arc"}},
+    {"Bar", {"lv_bar"}},
+    {"Spinner", {"lv_spinner"}},
+    {"List", {"lv_list"}},
+    {"Chart", {"lv_chart"}},
+    {"Table", {"lv_table"}},
+    {"Calendar", {"lv_calendar"}},
+    {"Keyboard", {"lv_keyboard"}},
+    {"Roller", {"lv_roller"}},
+    {"Textarea", {"lv_textarea"}},
+}}};
+
+inline constexpr PerfectHashTable<PropertyInfo, 12> BUILTIN_PROPERTIES{{{
+    {"text", {"lv_label_set_text", nullptr}},
+    {"width", {"lv_obj_set_width", "lv_obj_set_width"}},
+    {"height", {"lv_obj_set_height", "lv_obj_set_height"}},
+    {"x", {"lv_obj_set_x", "lv_obj_set_x"}},
+    {"y", {"lv_obj_set_y", "lv_obj_set_y"}},
+    {"visible", {"lv_obj_set_hidden", nullptr}},
+    {"enabled", {"lv_obj_set_enabled", nullptr}},
+    {"value", {"lv_slider_set_value", nullptr}},
+    {"min", {"lv_slider_set_range", nullptr}},
+    {"max", {"lv_slider_set_range", nullptr}},
+    {"checked", {"lv_checkbox_set_checked", nullptr}},
+    {"opacity", {nullptr, "lv_obj_set_style_opa"}},
+}}};
+
+inline constexpr PerfectHashTable<const char*, 12> BUILTIN_EVENTS{{{
+    {"onClick", "LV_EVENT_CLICKED"},
+    {"clicked", "LV_EVENT_CLICKED"},
+    {"onPressed", "LV_EVENT_PRESSED"},
+    {"pressed", "LV_EVENT_PRESSED"},
+    {"onReleased", "LV_EVENT_RELEASED"},
+    {"released", "LV_EVENT_RELEASED"},
+    {"onValueChanged", "LV_EVENT_VALUE_CHANGED"},
+    {"value_changed", "LV_EVENT_VALUE_CHANGED"},
+    {"onFocused", "LV_EVENT_FOCUSED"},
+    {"focused", "LV_EVENT_FOCUSED"},
+    {"onDefocused", "LV_EVENT_DEFOCUSED"},
+    {"defocused", "LV_EVENT_DEFOCUSED"},
+}}};
+
+inline constexpr PerfectHashTable<const char*, 6> BUILTIN_EASINGS{{{
+    {"linear", "lv_anim_path_linear"},
+    {"ease_in", "lv_anim_path_ease_in"},
+    {"ease_out", "lv_anim_path_ease_out"},
+    {"ease_in_out", "lv_anim_path_ease_in_out"},
+    {"overshoot", "lv_anim_path_overshoot"},
+    {"bounce", "lv_anim_path_bounce"},
+}}};
+
+// Widgets and properties added by plugins at load time (plugin.toml
+// [widgets] / [properties]). Built-in entries and earlier registrations
+// win; the overlay is only consulted when the static tables miss, so
+// lookups of built-in names never take the lock.
+class RegistryOverlay {
+public:
+    void add_widget(std::string_view name, std::string_view lvgl_type) {
+        std::unique_lock lock(mutex);
+        if (widget_types.try_emplace(std::string(name), lvgl_type).second) {
+            changes.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    void add_property(std::string_view name, std::string_view lvgl_setter) {
+        std::unique_lock lock(mutex);
+        if (property_setters.try_emplace(std::string(name), lvgl_setter).second) {
+            changes.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    // Pointers stay valid until clear(): map nodes never move and entries
+    // are never overwritten
+    const char* widget(std::string_view name) const { return find(widget_types, name); }
+    const char* property(std::string_view name) const { return find(property_setters, name); }
+
+    std::vector<std::string> widget_names() const { return names(widget_types); }
+    std::vector<std::string> property_names() const { return names(property_setters); }
+
+    // Bumped by every change, so caches built from the overlay (the LSP's
+    // completion index) can tell when to rebuild
+    uint64_t generation() const { return changes.load(std::memory_order_acquire); }
+
+    void clear() {
+        std::unique_lock lock(mutex);
+        widget_types.clear();
+        property_setters.clear();
+        changes.fetch_add(1, std::memory_order_release);
+    }
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, std::string> widget_types;
+    std::unordered_map<std::string, std::string> property_setters;
+    std::atomic<uint64_t> changes{0};
+
+    std::vector<std::string> names(const std::unordered_map<std::string, std::string>& map) const {
+        std::shared_lock lock(mutex);
+        std::vector<std::string> out;
+        out.reserve(map.size());
+        for (const auto& [name, binding] : map) {
+            out.push_back(name);
+        }
+        return out;
+    }
+
+    const char* find(const std::unordered_map<std::string, std::string>& map, std::string_view name) const {
+        std::shared_lock lock(mutex);
+        if (map.empty()) {
+            return nullptr;
+        }
+        auto it = map.find(std::string(name));
+        return it == map.end() ? nullptr : it->second.c_str();
+    }
+};
+
+inline RegistryOverlay& overlay() {
+    static RegistryOverlay instance;
+    return instance;
+}
+
+// LVGL widget class for a widget type, nullptr if unknown. Constant
+// evaluation sees only the built-in widgets.
+constexpr const char* lvgl_widget(std::string_view type_name) {
+    if (const auto* info = BUILTIN_WIDGETS.find(type_name)) {
+        return info->lvgl_type;
+    }
+    if !consteval {
+        return overlay().widget(type_name);
+    }
+    return nullptr;
+}
+
+constexpr bool is_widget(std::string_view type_name) {
+    return lvgl_widget(type_name) != nullptr;
+}
+
+// LVGL setter for a property, nullptr if it has none
+constexpr const char* lvgl_setter(std::string_view prop_name) {
+    if (const auto* info = BUILTIN_PROPERTIES.find(prop_name)) {
+        return info->lvgl_setter;
+    }
+    if !consteval {
+        return overlay().property(prop_name);
+    }
+    return nullptr;
+}
+
+constexpr const char* lvgl_anim_setter(std::string_view prop_name) {
+    const auto* info = BUILTIN_PROPERTIES.find(prop_name);
+    return info ? info->lvgl_anim_setter : nullptr;
+}
+
+constexpr const char* lvgl_event(std::string_view event_name) {
+    const auto* code = BUILTIN_EVENTS.find(event_name);
+    return code ? *code : nullptr;
+}
+
+constexpr const char* lvgl_easing(std::string_view easing) {
+    const auto* path = BUILTIN_EASINGS.find(easing);
+    return path ? *path : nullptr;
+}
+
+} // namespace widgets
+
+} // namespace forma
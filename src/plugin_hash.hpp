@@ -7,9 +7,8 @@
 
 namespace forma {
 
-// Simple FNV-1a hash for compile-time metadata verification
-constexpr uint64_t fnv1a_hash(std::string_view str) {
-    uint64_t hash = 14695981039346656037ULL;
+// Continue an FNV-1a hash over more input, for hashing several fields
+constexpr uint64_t fnv1a_hash_append(uint64_t hash, std::string_view str) {
     for (char c : str) {
         hash ^= static_cast<uint64_t>(c);
         hash *= 1099511628211ULL;
@@ -17,6 +16,11 @@ constexpr uint64_t fnv1a_hash(std::string_view str) {
     return hash;
 }
 
+// Simple FNV-1a hash for compile-time metadata verification
+constexpr uint64_t fnv1a_hash(std::string_view str) {
+    return fnv1a_hash_append(14695981039346656037ULL, str);
+}
+
 // Helper to convert hash to hex string at runtime
 inline std::string hash_to_hex(uint64_t hash) {
     char buf[17];
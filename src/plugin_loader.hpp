@@ -1,6 +1,7 @@
 #pragma once
 
 #include <dlfcn.h>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -10,9 +11,11 @@
 #include <filesystem>
 #include "plugin_metadata.hpp"
 #include "plugin_hash.hpp"
+#include "plugin_registry.hpp"
 #include "core/fs/i_file_system.hpp"
 #include "core/fs/fs_copy.hpp"
 #include "core/host_context.hpp"
+#include "parser/widget_registry.hpp"
 #include <random>
 #include <chrono>
 
@@ -20,6 +23,15 @@ namespace forma {
 
 // Plugin function pointers loaded from dynamic library
 // Low-level C ABI function pointers
+//
+// Thread safety: forma may call forma_render / forma_render_host
+// concurrently, on several plugins with the same document (forma
+// --renderer lvgl,json) and on one plugin with several documents (forma
+// build). The document must be treated as read-only, output_path differs
+// per call, and the host's stream_io may be used from any thread.
+// Plugins must not keep unsynchronized mutable globals across render
+// calls. forma_register and forma_build are only called from one thread
+// at a time.
 struct PluginFunctions {
     bool (*render)(const void* doc, const char* input_path, const char* output_path);
     int (*build)(const char* project_dir, const char* config_path, bool verbose, bool flash, bool monitor);  // For build plugins
@@ -46,6 +58,12 @@ struct LoadedPlugin {
     PluginFunctions functions;
     std::string path;
     std::unique_ptr<PluginMetadata> metadata;  // Loaded from plugin.toml
+    std::string toml_path;
+    uint64_t metadata_hash = 0;  // FNV-1a of plugin.toml; 0 for builtins
+    // Lazily loaded plugins know only their metadata until ensure_loaded
+    // opens the library
+    bool pending = false;
+    std::string load_error;  // Why opening a pending plugin failed
     // High-level adapters generated at load time
     RendererAdapter renderer_adapter;
     BuildAdapter build_adapter;
@@ -74,6 +92,7 @@ struct IPluginLoader {
     virtual RendererAdapter get_renderer_adapter(const std::string& name) = 0;
     virtual BuildAdapter get_build_adapter(const std::string& name) = 0;
     virtual LoadedPlugin* find_plugin(const std::string& name) = 0;
+    virtual LoadedPlugin* find_provider(const std::string& capability) = 0;
     virtual void print_loaded_plugins(std::ostream& out = std::cout) const = 0;
     // HostContext accessors - default implementations may be no-ops
     virtual void set_host_context(std::unique_ptr<HostContext> ctx) = 0;
@@ -85,13 +104,160 @@ private:
     std::vector<std::unique_ptr<LoadedPlugin>> loaded_plugins;
     std::vector<std::string> plugin_search_paths;  // Custom search paths
     std::unique_ptr<HostContext> host_context; // owned by loader, shared/passed to plugins
-    
+    std::unique_ptr<PluginRegistryCache> registry;  // Optional, see use_registry_cache
+    bool lazy_loading = false;
+
+    // Widgets a plugin declares become known to semantic analysis and the
+    // renderers in this process
+    static void register_widgets(const PluginMetadata& metadata) {
+        for (const auto& [name, lvgl_type] : metadata.widgets) {
+            widgets::overlay().add_widget(name, lvgl_type);
+        }
+        for (const auto& [name, setter] : metadata.properties) {
+            widgets::overlay().add_property(name, setter);
+        }
+    }
+
+    static std::string registry_key(const std::string& path) {
+        std::error_code ec;
+        auto absolute = std::filesystem::absolute(path, ec);
+        return ec ? path : absolute.lexically_normal().string();
+    }
+
+    // Metadata for the plugin library at `path`: from the registry when
+    // neither the library nor its plugin.toml changed since it was
+    // recorded, otherwise read, hashed and parsed from plugin.toml (and
+    // recorded). Returns nullptr with error_msg set on failure.
+    std::unique_ptr<PluginMetadata> plugin_metadata(const std::string& path, uint64_t& toml_hash,
+                                                    std::string& toml_path, std::string& error_msg) {
+        if (registry) {
+            if (const PluginRegistryEntry* entry = registry->find_fresh(registry_key(path))) {
+                toml_hash = entry->metadata_hash;
+                toml_path = entry->toml;
+                return std::make_unique<PluginMetadata>(entry->metadata);
+            }
+        }
+
+        auto found = find_plugin_toml(path);
+        if (found.empty()) {
+            error_msg = "Plugin metadata file (plugin.toml) not found for: " + path;
+            return nullptr;
+        }
+        toml_path = found.string();
+
+        // Read once for both the hash and the parse
+        std::ifstream toml_file(found, std::ios::binary);
+        std::string toml_content((std::istreambuf_iterator<char>(toml_file)), {});
+        toml_hash = forma::fnv1a_hash(toml_content);
+        auto metadata = load_plugin_metadata(forma::toml::parse_runtime(std::move(toml_content)));
+        if (!metadata) {
+            error_msg = "Failed to parse plugin metadata from: " + toml_path;
+            return nullptr;
+        }
+
+        if (registry) {
+            std::string key = registry_key(path);
+            std::string toml_key = registry_key(toml_path);
+            registry->record(PluginRegistryEntry{key, FileStamp::of(key), toml_key, FileStamp::of(toml_key),
+                                                 toml_hash, *metadata});
+        }
+        return metadata;
+    }
+
 public:
-    ~PluginLoader() = default;
+    // The registry is written back when the loader goes away
+    ~PluginLoader() {
+        if (registry) {
+            registry->save();
+        }
+    }
+
+    // Remember plugin metadata and name lookups in a registry file across
+    // runs (see PluginRegistryCache). Without one, every load reads its
+    // plugin.toml and every lookup probes the search paths.
+    void use_registry_cache(const std::string& cache_path = PluginRegistryCache::default_path()) {
+        if (cache_path.empty()) {
+            return;
+        }
+        registry = std::make_unique<PluginRegistryCache>(cache_path);
+        registry->load();
+    }
+
+    PluginRegistryCache* registry_cache() { return registry.get(); }
     
-    // Load a plugin from a shared library (.so file)
+    // Load plugins on first use instead of at load time (see load_plugin)
+    void set_lazy_loading(bool enabled) { lazy_loading = enabled; }
+    bool is_lazy_loading() const { return lazy_loading; }
+    
+    // Load a plugin from a shared library (.so file). Its plugin.toml is
+    // read (or taken from the registry) right away, so the metadata and the
+    // widgets it declares are available. With lazy loading the library is
+    // only opened by ensure_loaded, when one of its adapters is requested;
+    // otherwise it is opened and verified here.
     bool load_plugin(const std::string& path, std::string& error_msg) {
-        // Open the shared library
+        auto loaded = declare_plugin(path, error_msg);
+        if (!loaded) {
+            return false;
+        }
+        if (!lazy_loading && !open_plugin(*loaded, error_msg)) {
+            return false;
+        }
+        register_widgets(*loaded->metadata);
+        loaded_plugins.push_back(std::move(loaded));
+        return true;
+    }
+    
+    // Open the library of a plugin that was loaded lazily. Returns false with
+    // error_msg set when the library cannot be opened or does not match its
+    // plugin.toml; the plugin then stays unusable for the rest of the run.
+    // Not thread-safe: resolve plugins before handing adapters to workers.
+    bool ensure_loaded(LoadedPlugin& plugin, std::string& error_msg) {
+        if (!plugin.pending) {
+            return true;
+        }
+        if (!plugin.load_error.empty()) {
+            error_msg = plugin.load_error;
+            return false;
+        }
+        if (!open_plugin(plugin, error_msg)) {
+            plugin.load_error = error_msg;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // A plugin entry for the library at `path` holding only its metadata
+    std::unique_ptr<LoadedPlugin> declare_plugin(const std::string& path, std::string& error_msg) {
+        uint64_t toml_hash = 0;
+        std::string toml_path;
+        auto metadata = plugin_metadata(path, toml_hash, toml_path, error_msg);
+        if (!metadata) {
+            return nullptr;
+        }
+        
+        // Validate API version from metadata
+        if (metadata->api_version != "1.0.0") {
+            error_msg = std::string("Incompatible API version: expected 1.0.0, got ") + metadata->api_version;
+            return nullptr;
+        }
+        
+        auto loaded = std::make_unique<LoadedPlugin>();
+        loaded->pending = true;
+        loaded->path = path;
+        loaded->toml_path = std::move(toml_path);
+        loaded->metadata_hash = toml_hash;
+        loaded->metadata = std::move(metadata);
+        return loaded;
+    }
+
+    // dlopen a declared plugin, resolve its entry points, check them against
+    // its metadata and create its adapters
+    bool open_plugin(LoadedPlugin& plugin, std::string& error_msg) {
+        const std::string& path = plugin.path;
+        
+        // Open the shared library; RTLD_LAZY defers binding of the plugin's
+        // own imports until they are first called
         void* handle = dlopen(path.c_str(), RTLD_LAZY | RTLD_LOCAL);
         if (!handle) {
             error_msg = std::string("Failed to load plugin: ") + dlerror();
@@ -142,65 +308,29 @@ public:
             return false;
         }
         
-        // Get expected hash from plugin
+        // Verify the hash the plugin expects matches its plugin.toml
         uint64_t expected_hash = hash_fn();
-        
-        // Try to load plugin.toml from same directory as .so
-        auto toml_path = find_plugin_toml(path);
-        if (toml_path.empty()) {
-            error_msg = "Plugin metadata file (plugin.toml) not found for: " + path;
-            dlclose(handle);
-            return false;
-        }
-        
-        // Load and verify metadata
-        auto metadata = load_plugin_metadata(toml_path);
-        if (!metadata) {
-            error_msg = "Failed to parse plugin metadata from: " + toml_path.string();
-            dlclose(handle);
-            return false;
-        }
-        
-        // Verify hash matches
-        std::ifstream toml_file(toml_path);
-        std::stringstream toml_buffer;
-        toml_buffer << toml_file.rdbuf();
-        std::string toml_content = toml_buffer.str();
-        uint64_t actual_hash = forma::fnv1a_hash(toml_content);
-        
-        if (actual_hash != expected_hash) {
+        if (plugin.metadata_hash != expected_hash) {
             error_msg = std::string("Plugin metadata hash mismatch!\n") +
                        "  Expected: " + forma::hash_to_hex(expected_hash) + "\n" +
-                       "  Got:      " + forma::hash_to_hex(actual_hash) + "\n" +
-                       "  TOML file may be outdated or corrupted: " + toml_path.string();
-            dlclose(handle);
-            return false;
-        }
-        
-        // Validate API version from metadata
-        if (metadata->api_version != "1.0.0") {
-            error_msg = std::string("Incompatible API version: expected 1.0.0, got ") + metadata->api_version;
+                       "  Got:      " + forma::hash_to_hex(plugin.metadata_hash) + "\n" +
+                       "  TOML file may be outdated or corrupted: " + plugin.toml_path;
             dlclose(handle);
             return false;
         }
         
-        // Store the loaded plugin
-        auto loaded = std::make_unique<LoadedPlugin>();
-        loaded->handle = handle;
-        loaded->functions.render = render_fn;
-        loaded->functions.build = build_fn;
-        loaded->functions.register_plugin = register_fn;
-        loaded->functions.render_with_host = reinterpret_cast<bool(*)(void*, const void*, const char*, const char*)>(render_host_fn);
-        loaded->functions.build_with_host = reinterpret_cast<int(*)(void*, const char*, const char*, bool, bool, bool)>(build_host_fn);
-        loaded->functions.get_metadata_hash = hash_fn;
-        loaded->path = path;
-        loaded->metadata = std::move(metadata);
-
-        // Save loaded plugin first (adapters will be created after registration so they can capture a stable pointer)
-        loaded_plugins.push_back(std::move(loaded));
-
-        // Retrieve the stored plugin pointer
-        LoadedPlugin* p = loaded_plugins.back().get();
+        plugin.handle = handle;
+        plugin.pending = false;
+        plugin.functions.render = render_fn;
+        plugin.functions.build = build_fn;
+        plugin.functions.register_plugin = register_fn;
+        plugin.functions.render_with_host = reinterpret_cast<bool(*)(void*, const void*, const char*, const char*)>(render_host_fn);
+        plugin.functions.build_with_host = reinterpret_cast<int(*)(void*, const char*, const char*, bool, bool, bool)>(build_host_fn);
+        plugin.functions.get_metadata_hash = hash_fn;
+
+        // Adapters capture the plugin; LoadedPlugin is heap-allocated so
+        // the pointer stays stable
+        LoadedPlugin* p = &plugin;
 
         // Call registration function if available; create and attach HostContext to loader and pass pointer to plugin
         if (register_fn) {
@@ -235,10 +365,15 @@ public:
                         try {
                             if (!input_path.empty()) {
                                 auto in_contents_opt = fs.read_file(input_path);
-                                // Ensure parent dirs in plugin io
-                                auto parent = std::filesystem::path(input_path).parent_path().string();
-                                if (!parent.empty()) plugin_io.create_dirs(parent);
-                                plugin_io.open_write(input_path, in_contents_opt);
+                                // Mirror only when the plugin would see something else:
+                                // renderers of one compile run concurrently on the same
+                                // input, and rewriting it could tear another's read
+                                if (plugin_io.open_read(input_path) != in_contents_opt) {
+                                    // Ensure parent dirs in plugin io
+                                    auto parent = std::filesystem::path(input_path).parent_path().string();
+                                    if (!parent.empty()) plugin_io.create_dirs(parent);
+                                    plugin_io.open_write(input_path, in_contents_opt);
+                                }
                             }
                         } catch (...) {}
 
@@ -337,6 +472,8 @@ public:
         
         return true;
     }
+
+public:
     
     // Load all plugins from a directory
     // Each .so must have a matching plugin.toml in the same directory
@@ -400,11 +537,29 @@ public:
             plugin_name + ".so"
         };
         
+        // The registry knows where the name resolved to, as long as none of
+        // the directories searched before it changed. Its records hold
+        // absolute paths, so runs from other directories do not mix them up.
+        if (registry) {
+            for (auto& search_path : search_paths) {
+                std::error_code ec;
+                auto absolute = std::filesystem::absolute(search_path, ec);
+                if (!ec) search_path = absolute.lexically_normal().string();
+            }
+            if (auto cached = registry->resolve(plugin_name, search_paths)) {
+                return load_plugin(*cached, error_msg);
+            }
+        }
+        
         // Search for plugin
-        for (const auto& search_path : search_paths) {
+        for (size_t i = 0; i < search_paths.size(); ++i) {
             for (const auto& variant : name_variants) {
-                auto full_path = std::filesystem::path(search_path) / variant;
+                auto full_path = std::filesystem::path(search_paths[i]) / variant;
                 if (std::filesystem::exists(full_path)) {
+                    if (registry) {
+                        registry->record_resolution(plugin_name, full_path.string(),
+                                                    {search_paths.begin(), search_paths.begin() + i + 1});
+                    }
                     return load_plugin(full_path.string(), error_msg);
                 }
             }
@@ -451,6 +606,7 @@ public:
         loaded->functions.build = build_fn;
         loaded->functions.register_plugin = register_fn;
         loaded->path = "builtin:" + metadata->name;
+        register_widgets(*metadata);
         loaded->metadata = std::move(metadata);
         // For builtins: create adapters and call register if present
         if (loaded->functions.render) {
@@ -458,7 +614,9 @@ public:
             loaded->renderer_adapter = [rf](const void* doc, const std::string& in, const std::string& out, forma::fs::IFileSystem& fs) -> bool {
                 try {
                     // Write input to temp file
-                    std::string tmp_in = std::filesystem::temp_directory_path() / ("forma_builtin_in_" + std::to_string(std::chrono::high_resolution_clock::now().time_since_epoch().count()));
+                    // Counter keeps names unique when builds render concurrently
+                    static std::atomic<uint64_t> temp_counter{0};
+                    std::string tmp_in = std::filesystem::temp_directory_path() / ("forma_builtin_in_" + std::to_string(std::chrono::high_resolution_clock::now().time_since_epoch().count()) + "_" + std::to_string(temp_counter++));
                     std::ofstream of(tmp_in, std::ios::binary);
                     of << fs.read_file(in);
                     of.close();
@@ -523,16 +681,19 @@ public:
         return host_context.get();
     }
 
-    // Get adapters for a plugin by name (returns null if not available)
+    // Get adapters for a plugin by name (returns null if not available).
+    // A lazily loaded plugin is opened here; on failure its load_error says why.
     RendererAdapter get_renderer_adapter(const std::string& name) {
         auto p = find_plugin(name);
-        if (!p) return RendererAdapter();
+        std::string error_msg;
+        if (!p || !ensure_loaded(*p, error_msg)) return RendererAdapter();
         return p->renderer_adapter;
     }
 
     BuildAdapter get_build_adapter(const std::string& name) {
         auto p = find_plugin(name);
-        if (!p) return BuildAdapter();
+        std::string error_msg;
+        if (!p || !ensure_loaded(*p, error_msg)) return BuildAdapter();
         return p->build_adapter;
     }
     
@@ -546,6 +707,17 @@ public:
         return nullptr;
     }
     
+    // First plugin whose metadata provides `capability` (e.g. "renderer:c"),
+    // decided from metadata alone so lazily loaded plugins stay unopened
+    LoadedPlugin* find_provider(const std::string& capability) {
+        for (auto& plugin : loaded_plugins) {
+            if (plugin->metadata && plugin->metadata->has_capability(capability)) {
+                return plugin.get();
+            }
+        }
+        return nullptr;
+    }
+    
     // Print loaded plugins
     void print_loaded_plugins(std::ostream& out = std::cout) const {
         if (loaded_plugins.empty()) {
@@ -576,7 +748,11 @@ public:
                     out << " [" << plugin->metadata->kind << "]";
                 }
                 
-                out << "\n    Path: " << plugin->path << "\n";
+                out << "\n    Path: " << plugin->path;
+                if (plugin->pending) {
+                    out << " (not opened yet)";
+                }
+                out << "\n";
             }
         }
     }
@@ -7,6 +7,7 @@
 #include <fstream>
 #include <sstream>
 #include <memory>
+#include <utility>
 
 namespace forma {
 
@@ -26,6 +27,11 @@ struct PluginMetadata {
     // [renderer] (optional, for renderer plugins)
     std::string output_extension;  // e.g., ".c", ".cpp", ".js"
     std::string output_language;   // e.g., "c", "cpp", "javascript"
+
+    // [widgets] / [properties] (optional): widget type -> LVGL class and
+    // property -> LVGL setter, added to the widget registry on load
+    std::vector<std::pair<std::string, std::string>> widgets;
+    std::vector<std::pair<std::string, std::string>> properties;
     
     // Helper methods
     bool is_renderer() const { return kind == "renderer"; }
@@ -45,22 +51,9 @@ struct PluginMetadata {
     }
 };
 
-// Load plugin metadata from a TOML string (embedded in plugin binary)
-inline std::unique_ptr<PluginMetadata> load_plugin_metadata_from_string(const char* toml_str) {
-    if (!toml_str) {
-        return nullptr;
-    }
-    
-    std::string content(toml_str);
-    if (content.empty()) {
-        return nullptr;
-    }
-    
-    // Parse TOML
-    try {
-        auto doc = forma::toml::parse(content);
-        
-        auto metadata = std::make_unique<PluginMetadata>();
+// Plugin metadata from a parsed plugin.toml
+inline std::unique_ptr<PluginMetadata> load_plugin_metadata(const forma::toml::RuntimeDocument& doc) {
+    auto metadata = std::make_unique<PluginMetadata>();
     
     // Get [plugin] section
     const auto* plugin_table = doc.get_table("plugin");
@@ -86,23 +79,13 @@ inline std::unique_ptr<PluginMetadata> load_plugin_metadata_from_string(const ch
     const auto* cap_table = doc.get_table("capabilities");
     if (cap_table) {
         // Get "provides" array
-        if (const auto* provides_val = cap_table->get("provides")) {
-            if (provides_val->type == forma::toml::ValueType::Array) {
-                const auto& arr = doc.arrays[provides_val->array_index];
-                for (size_t i = 0; i < arr.count; ++i) {
-                    metadata->provides.push_back(std::string(arr.elements[i]));
-                }
-            }
+        for (auto capability : cap_table->get_strings("provides")) {
+            metadata->provides.push_back(std::string(capability));
         }
         
         // Get "requires" array (stored as dependencies)
-        if (const auto* requires_val = cap_table->get("requires")) {
-            if (requires_val->type == forma::toml::ValueType::Array) {
-                const auto& arr = doc.arrays[requires_val->array_index];
-                for (size_t i = 0; i < arr.count; ++i) {
-                    metadata->dependencies.push_back(std::string(arr.elements[i]));
-                }
-            }
+        for (auto dependency : cap_table->get_strings("requires")) {
+            metadata->dependencies.push_back(std::string(dependency));
         }
     }
     
@@ -117,26 +100,45 @@ inline std::unique_ptr<PluginMetadata> load_plugin_metadata_from_string(const ch
         }
     }
     
+    // Get [widgets] and [properties] sections (optional)
+    if (const auto* widgets_table = doc.get_table("widgets")) {
+        for (const auto& entry : widgets_table->items()) {
+            if (entry.value.type == forma::toml::ValueType::String) {
+                metadata->widgets.emplace_back(std::string(entry.key), std::string(entry.value.string_value));
+            }
+        }
+    }
+    if (const auto* properties_table = doc.get_table("properties")) {
+        for (const auto& entry : properties_table->items()) {
+            if (entry.value.type == forma::toml::ValueType::String) {
+                metadata->properties.emplace_back(std::string(entry.key), std::string(entry.value.string_value));
+            }
+        }
+    }
+    
     return metadata;
+}
+
+// Load plugin metadata from a TOML string (embedded in plugin binary)
+inline std::unique_ptr<PluginMetadata> load_plugin_metadata_from_string(const char* toml_str) {
+    if (!toml_str || !*toml_str) {
+        return nullptr;
+    }
+    
+    try {
+        return load_plugin_metadata(forma::toml::parse_runtime(toml_str));
     } catch (...) {
         // If TOML parsing fails, return nullptr
         return nullptr;
     }
 }
 
-// Load plugin metadata from a plugin.toml file
+// Load plugin metadata from a plugin.toml file, parsed once per process
+// (see forma::core::TomlCache)
 inline std::unique_ptr<PluginMetadata> load_plugin_metadata(const std::filesystem::path& toml_path) {
-    // Use RealFileSystem + core TOML helper
-    forma::fs::RealFileSystem realfs;
-    auto doc_opt = forma::core::parse_toml_from_fs(realfs, toml_path.string());
-    if (!doc_opt) return nullptr;
-
-    // Re-serialize minimal TOML for the existing parser from string path
-    // The helper above parsed it; we'll now reconstruct a simple string and call existing loader.
-    // For now, reuse the original load from string by reading file content.
     try {
-        std::string content = realfs.read_file(toml_path.string());
-        return load_plugin_metadata_from_string(content.c_str());
+        auto doc = forma::core::TomlCache::instance().load(toml_path);
+        return doc ? load_plugin_metadata(*doc) : nullptr;
     } catch (...) {
         return nullptr;
     }
@@ -0,0 +1,315 @@
+#pragma once
+
+#include "plugin_metadata.hpp"
+#include "plugin_hash.hpp"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace forma {
+
+// ============================================================================
+// Plugin Registry - Remembers what was learned about installed plugins
+// ============================================================================
+
+// Modification time and size of a file or directory, from one stat call.
+// A directory's modification time changes whenever an entry is added,
+// removed or renamed in it.
+struct FileStamp {
+    int64_t mtime_ns = -1;  // -1: the path did not exist
+    uint64_t size = 0;
+
+    static FileStamp of(const std::string& path) {
+        struct stat st {};
+        if (::stat(path.c_str(), &st) != 0) {
+            return {};
+        }
+        return {static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec,
+                static_cast<uint64_t>(st.st_size)};
+    }
+
+    bool exists() const { return mtime_ns >= 0; }
+    bool operator==(const FileStamp&) const = default;
+};
+
+// What loading a plugin library produced: where its plugin.toml is, the
+// FNV-1a hash of that file and the metadata parsed from it. Valid while
+// both files keep the stamps recorded here.
+struct PluginRegistryEntry {
+    std::string library;
+    FileStamp library_stamp;
+    std::string toml;
+    FileStamp toml_stamp;
+    uint64_t metadata_hash = 0;
+    PluginMetadata metadata;
+};
+
+// Persisted across runs so startup does not re-read and re-hash every
+// plugin.toml or probe every search path for every plugin name. Checking
+// an entry costs a stat per file instead. Stored as plain text, one record
+// per line, tab-separated:
+//   P <library> <mtime ns> <size> <toml> <mtime ns> <size> <hash hex>
+//   M <field> <value>                (metadata of the preceding P)
+//   C <capability> / R <requirement> (provides / requires of the preceding P)
+//   W <widget> <lvgl class> / Y <property> <lvgl setter>
+//   N <plugin name> <library>
+//   D <search dir> <mtime ns> <size> (directories probed for the preceding N,
+//                                     in order, up to the one holding it)
+class PluginRegistryCache {
+public:
+    static constexpr std::string_view FORMAT_HEADER = "forma-plugin-registry 1";
+
+    explicit PluginRegistryCache(std::string cache_path) : cache_path(std::move(cache_path)) {}
+
+    // $XDG_CACHE_HOME/forma/plugin-registry, or ~/.cache/forma/plugin-registry;
+    // empty when neither variable is set
+    static std::string default_path() {
+        if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+            return (std::filesystem::path(xdg) / "forma" / "plugin-registry").string();
+        }
+        if (const char* home = std::getenv("HOME"); home && *home) {
+            return (std::filesystem::path(home) / ".cache" / "forma" / "plugin-registry").string();
+        }
+        return {};
+    }
+
+    // Load records from disk. A missing or unrecognised file leaves the
+    // registry empty, which only means plugins are inspected again.
+    void load() {
+        plugins.clear();
+        resolutions.clear();
+        modified = false;
+        std::ifstream in(cache_path, std::ios::binary);
+        if (!in) {
+            return;
+        }
+        std::string content((std::istreambuf_iterator<char>(in)), {});
+        std::string_view rest = content;
+
+        PluginRegistryEntry* plugin = nullptr;
+        Resolution* resolution = nullptr;
+        bool header_seen = false;
+        while (!rest.empty()) {
+            size_t eol = rest.find('\n');
+            std::string_view line = rest.substr(0, eol);
+            rest = eol == std::string_view::npos ? std::string_view{} : rest.substr(eol + 1);
+
+            if (!header_seen) {
+                if (line != FORMAT_HEADER) {
+                    return;
+                }
+                header_seen = true;
+                continue;
+            }
+
+            auto fields = split_tabs(line);
+            if (fields.size() == 8 && fields[0] == "P") {
+                auto& entry = plugins[std::string(fields[1])];
+                entry = PluginRegistryEntry{std::string(fields[1]), parse_stamp(fields[2], fields[3]),
+                                            std::string(fields[4]), parse_stamp(fields[5], fields[6]),
+                                            parse_hex(fields[7]), {}};
+                plugin = &entry;
+                resolution = nullptr;
+            } else if (fields.size() == 3 && fields[0] == "M" && plugin) {
+                if (std::string* field = metadata_field(plugin->metadata, fields[1])) {
+                    *field = std::string(fields[2]);
+                }
+            } else if (fields.size() == 2 && fields[0] == "C" && plugin) {
+                plugin->metadata.provides.emplace_back(fields[1]);
+            } else if (fields.size() == 2 && fields[0] == "R" && plugin) {
+                plugin->metadata.dependencies.emplace_back(fields[1]);
+            } else if (fields.size() == 3 && fields[0] == "W" && plugin) {
+                plugin->metadata.widgets.emplace_back(std::string(fields[1]), std::string(fields[2]));
+            } else if (fields.size() == 3 && fields[0] == "Y" && plugin) {
+                plugin->metadata.properties.emplace_back(std::string(fields[1]), std::string(fields[2]));
+            } else if (fields.size() == 3 && fields[0] == "N") {
+                resolution = &resolutions[std::string(fields[1])];
+                *resolution = Resolution{std::string(fields[2]), {}};
+                plugin = nullptr;
+            } else if (fields.size() == 4 && fields[0] == "D" && resolution) {
+                resolution->probed.emplace_back(std::string(fields[1]), parse_stamp(fields[2], fields[3]));
+            }
+        }
+    }
+
+    // Write the records back if anything changed since load()
+    bool save() {
+        if (!modified || cache_path.empty()) {
+            return true;
+        }
+        std::string out(FORMAT_HEADER);
+        out += '\n';
+        for (const auto& [library, entry] : plugins) {
+            out += "P\t" + library + "\t" + stamp_fields(entry.library_stamp) + "\t" + entry.toml + "\t" +
+                   stamp_fields(entry.toml_stamp) + "\t" + hash_to_hex(entry.metadata_hash) + "\n";
+            for (std::string_view name : METADATA_FIELDS) {
+                const std::string& value = *metadata_field(entry.metadata, name);
+                if (!value.empty()) {
+                    out += "M\t" + std::string(name) + "\t" + value + "\n";
+                }
+            }
+            for (const auto& capability : entry.metadata.provides) {
+                out += "C\t" + capability + "\n";
+            }
+            for (const auto& dependency : entry.metadata.dependencies) {
+                out += "R\t" + dependency + "\n";
+            }
+            for (const auto& [widget, lvgl_type] : entry.metadata.widgets) {
+                out += "W\t" + widget + "\t" + lvgl_type + "\n";
+            }
+            for (const auto& [property, setter] : entry.metadata.properties) {
+                out += "Y\t" + property + "\t" + setter + "\n";
+            }
+        }
+        for (const auto& [name, resolution] : resolutions) {
+            out += "N\t" + name + "\t" + resolution.library + "\n";
+            for (const auto& [dir, stamp] : resolution.probed) {
+                out += "D\t" + dir + "\t" + stamp_fields(stamp) + "\n";
+            }
+        }
+
+        // Write a sibling file and rename it over the cache, so concurrent
+        // runs never read a half-written registry
+        std::error_code ec;
+        auto path = std::filesystem::path(cache_path);
+        if (path.has_parent_path()) {
+            std::filesystem::create_directories(path.parent_path(), ec);
+        }
+        std::string temp = cache_path + ".tmp" + std::to_string(::getpid());
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            if (!(file << out)) {
+                return false;
+            }
+        }
+        std::filesystem::rename(temp, cache_path, ec);
+        if (ec) {
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+        modified = false;
+        return true;
+    }
+
+    // The record for `library` if neither it nor its plugin.toml changed
+    // since it was made
+    const PluginRegistryEntry* find_fresh(const std::string& library) const {
+        auto it = plugins.find(library);
+        if (it == plugins.end()) {
+            return nullptr;
+        }
+        const PluginRegistryEntry& entry = it->second;
+        if (FileStamp::of(library) != entry.library_stamp || FileStamp::of(entry.toml) != entry.toml_stamp) {
+            return nullptr;
+        }
+        return &entry;
+    }
+
+    void record(PluginRegistryEntry entry) {
+        std::string key = entry.library;
+        plugins.insert_or_assign(std::move(key), std::move(entry));
+        modified = true;
+    }
+
+    // The library `name` resolved to last time, if the search path is the
+    // same and none of the directories searched up to it gained or lost a
+    // file since (which could make another library win)
+    std::optional<std::string> resolve(const std::string& name, const std::vector<std::string>& search_paths) const {
+        auto it = resolutions.find(name);
+        if (it == resolutions.end()) {
+            return std::nullopt;
+        }
+        const Resolution& resolution = it->second;
+        if (resolution.probed.size() > search_paths.size()) {
+            return std::nullopt;
+        }
+        for (size_t i = 0; i < resolution.probed.size(); ++i) {
+            const auto& [dir, stamp] = resolution.probed[i];
+            if (dir != search_paths[i] || FileStamp::of(dir) != stamp) {
+                return std::nullopt;
+            }
+        }
+        if (!FileStamp::of(resolution.library).exists()) {
+            return std::nullopt;
+        }
+        return resolution.library;
+    }
+
+    // `name` was found at `library` after probing `probed_dirs`, in order
+    void record_resolution(const std::string& name, const std::string& library,
+                           const std::vector<std::string>& probed_dirs) {
+        Resolution resolution{library, {}};
+        for (const auto& dir : probed_dirs) {
+            resolution.probed.emplace_back(dir, FileStamp::of(dir));
+        }
+        resolutions.insert_or_assign(name, std::move(resolution));
+        modified = true;
+    }
+
+    size_t size() const { return plugins.size(); }
+    const std::string& path() const { return cache_path; }
+
+private:
+    struct Resolution {
+        std::string library;
+        std::vector<std::pair<std::string, FileStamp>> probed;
+    };
+
+    static constexpr std::string_view METADATA_FIELDS[] = {
+        "name", "kind", "api_version", "runtime", "entrypoint", "output_extension", "output_language"};
+
+    std::string cache_path;
+    std::unordered_map<std::string, PluginRegistryEntry> plugins;
+    std::unordered_map<std::string, Resolution> resolutions;
+    bool modified = false;
+
+    // The string member of PluginMetadata called `name`, or nullptr
+    template <typename Metadata>
+    static auto metadata_field(Metadata& metadata, std::string_view name) -> decltype(&metadata.name) {
+        if (name == "name") return &metadata.name;
+        if (name == "kind") return &metadata.kind;
+        if (name == "api_version") return &metadata.api_version;
+        if (name == "runtime") return &metadata.runtime;
+        if (name == "entrypoint") return &metadata.entrypoint;
+        if (name == "output_extension") return &metadata.output_extension;
+        if (name == "output_language") return &metadata.output_language;
+        return nullptr;
+    }
+
+    static std::string stamp_fields(const FileStamp& stamp) {
+        return std::to_string(stamp.mtime_ns) + "\t" + std::to_string(stamp.size);
+    }
+
+    static FileStamp parse_stamp(std::string_view mtime, std::string_view size) {
+        return {std::strtoll(std::string(mtime).c_str(), nullptr, 10),
+                std::strtoull(std::string(size).c_str(), nullptr, 10)};
+    }
+
+    static std::vector<std::string_view> split_tabs(std::string_view line) {
+        std::vector<std::string_view> fields;
+        size_t start = 0;
+        for (size_t i = 0; i <= line.size(); ++i) {
+            if (i == line.size() || line[i] == '\t') {
+                fields.push_back(line.substr(start, i - start));
+                start = i + 1;
+            }
+        }
+        return fields;
+    }
+
+    static uint64_t parse_hex(std::string_view text) {
+        return std::strtoull(std::string(text).c_str(), nullptr, 16);
+    }
+};
+
+} // namespace forma
@@ -1,6 +1,9 @@
 #include <bugspray/bugspray.hpp>
 #include "forma.hpp"
 #include "ir.hpp"
+#include <string>
+#include <utility>
+#include <vector>
 
 using namespace forma;
 
@@ -164,6 +167,113 @@ TEST_CASE("Tokenizer - Complex Sequences")
     }
 }
 
+namespace {
+
+// Deterministic mix of every byte class the kernels distinguish
+std::string make_scan_input(size_t length, unsigned seed) {
+    constexpr std::string_view alphabet = " \n\t\rabzAZ09_/*\"{}:.@\x80\xff";
+    std::string text;
+    for (size_t i = 0; i < length; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        text += alphabet[(seed >> 16) % alphabet.size()];
+    }
+    return text;
+}
+
+std::vector<std::pair<TokenKind, std::string_view>> tokenize_all(std::string_view source) {
+    std::vector<std::pair<TokenKind, std::string_view>> toks;
+    Lexer lexer{source, 0};
+    while (true) {
+        auto tok = next_token(lexer);
+        toks.emplace_back(tok.kind, tok.text);
+        if (tok.kind == TokenKind::EndOfFile) break;
+    }
+    return toks;
+}
+
+constexpr size_t count_tokens(std::string_view source) {
+    Lexer lexer{source, 0};
+    size_t count = 0;
+    while (next_token(lexer).kind != TokenKind::EndOfFile) ++count;
+    return count;
+}
+
+} // namespace
+
+TEST_CASE("Tokenizer - Comments")
+{
+    constexpr std::string_view source = "a // line\n/* block ** still */ b /**/ c /* unterminated";
+    static_assert(count_tokens(source) == 3);
+    
+    Lexer lexer{source, 0};
+    CHECK(next_token(lexer).text == "a");
+    CHECK(next_token(lexer).text == "b");
+    CHECK(next_token(lexer).text == "c");
+    CHECK(next_token(lexer).kind == TokenKind::EndOfFile);
+}
+
+TEST_CASE("Tokenizer - Scan kernels match scalar")
+{
+    auto sets = scan::available_kernels();
+    REQUIRE(!sets.empty());
+    CHECK(std::string_view(sets.front()->name) == "scalar");
+    
+    SECTION("Runs across block boundaries")
+    {
+        for (size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 64, 100}) {
+            for (unsigned seed = 0; seed < 50; ++seed) {
+                std::string text = make_scan_input(length, seed);
+                const char* begin = text.data();
+                const char* end = begin + text.size();
+                for (const char* p = begin; p <= end; ++p) {
+                    for (const scan::Kernels* set : sets) {
+                        CHECK(set->skip_whitespace(p, end) == scan::SCALAR_KERNELS.skip_whitespace(p, end));
+                        CHECK(set->skip_identifier(p, end) == scan::SCALAR_KERNELS.skip_identifier(p, end));
+                        CHECK(set->find_line_end(p, end) == scan::SCALAR_KERNELS.find_line_end(p, end));
+                        CHECK(set->find_star(p, end) == scan::SCALAR_KERNELS.find_star(p, end));
+                        CHECK(set->find_quote(p, end) == scan::SCALAR_KERNELS.find_quote(p, end));
+                    }
+                }
+            }
+        }
+    }
+    
+    SECTION("Long runs and embedded NUL")
+    {
+        std::string text = std::string(100, ' ') + std::string(70, 'x') + "// " + std::string(40, '-') + '\0' + "tail";
+        const char* end = text.data() + text.size();
+        for (const scan::Kernels* set : sets) {
+            const char* p = set->skip_whitespace(text.data(), end);
+            CHECK(p - text.data() == 100);
+            p = set->skip_identifier(p, end);
+            CHECK(p - text.data() == 170);
+            p = set->find_line_end(p, end);
+            CHECK(*p == '\0');
+            CHECK(set->find_quote(p + 1, end) == end);
+        }
+    }
+    
+    SECTION("Token streams are identical")
+    {
+        std::string source = "// header\nimport ui.widgets\n/* long ";
+        source += std::string(200, '*') + "*/\nButton {\n    text: \"" + std::string(90, 'q') + "\"\n";
+        source += "    " + std::string(50, 'i') + ": 42\n}\n";
+        for (unsigned seed = 0; seed < 20; ++seed) {
+            source += make_scan_input(80, seed);
+        }
+        
+        const scan::Kernels& selected = scan::kernels();
+        scan::use_kernels(scan::SCALAR_KERNELS);
+        auto expected = tokenize_all(source);
+        for (const scan::Kernels* set : sets) {
+            scan::use_kernels(*set);
+            CHECK(tokenize_all(source) == expected);
+        }
+        scan::use_kernels(selected);
+        CHECK(expected.size() > 10ul);
+    }
+}
+
 // Compile-time evaluation tests (commented out - tokenizer not yet fully constexpr)
 // EVAL_TEST_CASE("Tokenizer - Basic Punctuation");
 // EVAL_TEST_CASE("Tokenizer - String Literals");
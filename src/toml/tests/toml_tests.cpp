@@ -229,3 +229,103 @@ enabled_list = ["cmake", "vscode", "lsp"]
         CHECK(enabled.elements[2] == "lsp");
     }
 }
+
+TEST_CASE("TOML - Runtime Documents")
+{
+    auto doc = parse_runtime(R"(
+name = "Forma"  # trailing comment
+ratio = 1.5
+big = 1_000_000
+
+[server]
+port = 8080
+
+[server.logging]
+level = 'debug'
+path = "C:\\logs\tapp \u00e9"
+
+[dependencies]
+lvgl = { version = "9.2", features = ["fonts", "images"] }
+tools.cmake = "3.20"
+
+[[target]]
+name = "native"
+[[target]]
+name = "esp32"
+)");
+
+    SECTION("Values and dotted table names")
+    {
+        CHECK(doc.root.get_string("name") == "Forma");
+        CHECK(doc.root.get_float("ratio") == 1.5);
+        CHECK(doc.root.get_int("big") == 1000000);
+        CHECK(doc.get_table("server")->get_int("port") == 8080);
+        CHECK(doc.get_table("server.logging")->get_string("level") == "debug");
+        CHECK(doc.get_table("server")->get_table("logging") == doc.get_table("server.logging"));
+        CHECK(doc.get_table("server.missing") == nullptr);
+    }
+
+    SECTION("Escapes are decoded")
+    {
+        CHECK(doc.get_table("server.logging")->get_string("path") == "C:\\logs\tapp \xc3\xa9");
+    }
+
+    SECTION("Inline tables, dotted keys and arrays of tables")
+    {
+        const auto* lvgl = doc.get_table("dependencies.lvgl");
+        REQUIRE(lvgl != nullptr);
+        CHECK(lvgl->get_string("version") == "9.2");
+        auto features = lvgl->get_strings("features");
+        REQUIRE(features.size() == 2);
+        CHECK(features[1] == "images");
+        CHECK(doc.get_table("dependencies.tools")->get_string("cmake") == "3.20");
+
+        const auto* targets = doc.root.get_array("target");
+        REQUIRE(targets != nullptr);
+        REQUIRE(targets->size() == 2);
+        CHECK((*targets)[1].table->get_string("name") == "esp32");
+    }
+
+    SECTION("Entries keep file order")
+    {
+        auto items = doc.root.items();
+        REQUIRE(items.size() == 6);
+        CHECK(items[0].key == "name");
+        CHECK(items[3].key == "server");
+    }
+}
+
+TEST_CASE("TOML - Runtime Documents Have No Fixed Capacity")
+{
+    std::string source;
+    for (int t = 0; t < 40; ++t) {
+        source += "[table" + std::to_string(t) + "]\n";
+        for (int k = 0; k < 50; ++k) {
+            source += "key" + std::to_string(k) + " = " + std::to_string(t * 100 + k) + "\n";
+        }
+    }
+    source += "list = [" ;
+    for (int i = 0; i < 100; ++i) {
+        source += "\"item" + std::to_string(i) + "\", ";
+    }
+    source += "]\n";
+
+    auto doc = parse_runtime(source);
+    CHECK(doc.get_table("table39")->size() == 51);
+    CHECK(doc.get_table("table39")->get_int("key49") == 3949);
+    CHECK(doc.get_table("table39")->get_strings("list").size() == 100);
+}
+
+TEST_CASE("TOML - Runtime Malformed Lines Are Skipped")
+{
+    auto doc = parse_runtime(R"(
+before = 1
+broken = "unterminated
+= 2
+[unclosed
+after = 3
+)");
+    CHECK(doc.root.get_int("before") == 1);
+    CHECK(doc.root.get("broken") == nullptr);
+    CHECK(doc.root.get_int("after") == 3);
+}
@@ -4,6 +4,14 @@
 #include <array>
 #include <optional>
 #include <cstdint>
+#include <charconv>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace forma::toml {
 
@@ -421,4 +429,563 @@ constexpr Document<MaxTables> parse(std::string_view input) {
     return parser.parse_document<MaxTables>();
 }
 
+// ============================================================================
+// Runtime Document Storage
+// ============================================================================
+
+// The constexpr Document above has fixed capacities (16 tables of 32 keys,
+// 32 arrays of 16 strings) and silently drops whatever does not fit; it is
+// meant for TOML known at compile time. Configuration read from disk goes
+// through RuntimeDocument instead: tables grow as needed, keys are found
+// through a hash map, and dotted headers, dotted keys, inline tables,
+// arrays of any value and arrays of tables nest the way TOML defines them.
+
+struct RuntimeTable;
+
+struct RuntimeValue {
+    ValueType type = ValueType::None;
+    std::string_view string_value;
+    int64_t int_value = 0;
+    double float_value = 0.0;
+    bool bool_value = false;
+    const std::vector<RuntimeValue>* array = nullptr;  // ValueType::Array
+    const RuntimeTable* table = nullptr;               // ValueType::Table
+};
+
+struct RuntimeKeyValue {
+    std::string_view key;
+    RuntimeValue value;
+};
+
+// Table of a RuntimeDocument. Entries keep their order in the file; the
+// hash index maps each key to its entry.
+struct RuntimeTable {
+    std::string_view name;  // Key in the parent table; empty for the root
+
+    RuntimeTable() = default;
+    explicit RuntimeTable(std::string_view n) : name(n) {}
+
+    // Add `key`, or replace its value when the table already has it
+    RuntimeValue& set(std::string_view key, const RuntimeValue& value) {
+        auto [it, inserted] = index.try_emplace(key, entries.size());
+        if (inserted) {
+            entries.push_back({key, value});
+        } else {
+            entries[it->second].value = value;
+        }
+        return entries[it->second].value;
+    }
+
+    const RuntimeValue* get(std::string_view key) const {
+        auto it = index.find(key);
+        return it != index.end() ? &entries[it->second].value : nullptr;
+    }
+
+    std::optional<std::string_view> get_string(std::string_view key) const {
+        const RuntimeValue* v = get(key);
+        if (v && v->type == ValueType::String) {
+            return v->string_value;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<int64_t> get_int(std::string_view key) const {
+        const RuntimeValue* v = get(key);
+        if (v && v->type == ValueType::Integer) {
+            return v->int_value;
+        }
+        return std::nullopt;
+    }
+
+    // Integers are accepted where a float is asked for
+    std::optional<double> get_float(std::string_view key) const {
+        const RuntimeValue* v = get(key);
+        if (v && v->type == ValueType::Float) {
+            return v->float_value;
+        }
+        if (v && v->type == ValueType::Integer) {
+            return static_cast<double>(v->int_value);
+        }
+        return std::nullopt;
+    }
+
+    std::optional<bool> get_bool(std::string_view key) const {
+        const RuntimeValue* v = get(key);
+        if (v && v->type == ValueType::Boolean) {
+            return v->bool_value;
+        }
+        return std::nullopt;
+    }
+
+    const std::vector<RuntimeValue>* get_array(std::string_view key) const {
+        const RuntimeValue* v = get(key);
+        return v && v->type == ValueType::Array ? v->array : nullptr;
+    }
+
+    // The string elements of an array; other elements are skipped
+    std::vector<std::string_view> get_strings(std::string_view key) const {
+        std::vector<std::string_view> result;
+        if (const auto* array = get_array(key)) {
+            for (const RuntimeValue& element : *array) {
+                if (element.type == ValueType::String) {
+                    result.push_back(element.string_value);
+                }
+            }
+        }
+        return result;
+    }
+
+    const RuntimeTable* get_table(std::string_view key) const {
+        const RuntimeValue* v = get(key);
+        return v && v->type == ValueType::Table ? v->table : nullptr;
+    }
+
+    std::span<const RuntimeKeyValue> items() const { return entries; }
+    size_t size() const { return entries.size(); }
+
+private:
+    std::vector<RuntimeKeyValue> entries;
+    std::unordered_map<std::string_view, size_t> index;
+};
+
+// Heap-backed TOML document. It owns the text it was parsed from: keys and
+// strings are views into that text, or into `decoded` for strings with
+// escape sequences. Tables and arrays live in deques, so the pointers
+// values hold stay valid while the document grows and when it is moved.
+// Movable but not assignable, like forma::RuntimeDocument.
+struct RuntimeDocument {
+    RuntimeTable root;
+
+    RuntimeDocument() = default;
+    RuntimeDocument(RuntimeDocument&&) = default;
+    RuntimeDocument& operator=(RuntimeDocument&&) = delete;
+    RuntimeDocument(const RuntimeDocument&) = delete;
+    RuntimeDocument& operator=(const RuntimeDocument&) = delete;
+
+    // A table by dotted name ("server.logging"); the root for ""
+    const RuntimeTable* get_table(std::string_view name) const {
+        const RuntimeTable* table = &root;
+        while (table && !name.empty()) {
+            size_t dot = name.find('.');
+            table = table->get_table(name.substr(0, dot));
+            name = dot == std::string_view::npos ? std::string_view{} : name.substr(dot + 1);
+        }
+        return table;
+    }
+
+    std::string_view source() const { return text ? std::string_view(*text) : std::string_view{}; }
+
+private:
+    friend class RuntimeParser;
+
+    std::unique_ptr<const std::string> text;
+    std::deque<RuntimeTable> tables;
+    std::deque<std::vector<RuntimeValue>> arrays;
+    std::deque<std::string> decoded;
+};
+
+// TOML parser producing a RuntimeDocument. Malformed lines are skipped,
+// as the constexpr Parser does, so a typo in one key does not lose the
+// rest of the file.
+class RuntimeParser {
+    RuntimeDocument& doc;
+    std::string_view input;
+    size_t pos = 0;
+
+    explicit RuntimeParser(RuntimeDocument& d) : doc(d), input(d.source()) {}
+
+    void parse_document() {
+        RuntimeTable* current = &doc.root;
+        while (skip_blank(), pos < input.size()) {
+            size_t line_start = pos;
+            if (peek() == '[') {
+                RuntimeTable* header = parse_table_header();
+                current = header ? header : current;
+            } else if (!parse_key_value(*current)) {
+                pos = line_start;
+            }
+            skip_to_next_line();
+        }
+    }
+
+    char peek(size_t ahead = 0) const {
+        return pos + ahead < input.size() ? input[pos + ahead] : '\0';
+    }
+
+    static bool is_bare_key_char(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+    }
+
+    void skip_spaces() {
+        while (peek() == ' ' || peek() == '\t') {
+            ++pos;
+        }
+    }
+
+    // Whitespace, newlines and comments
+    void skip_blank() {
+        for (;;) {
+            char c = peek();
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                ++pos;
+            } else if (c == '#') {
+                skip_to_next_line();
+            } else {
+                return;
+            }
+        }
+    }
+
+    void skip_to_next_line() {
+        size_t newline = input.find('\n', pos);
+        pos = newline == std::string_view::npos ? input.size() : newline + 1;
+    }
+
+    RuntimeTable* new_table(std::string_view name) {
+        return &doc.tables.emplace_back(name);
+    }
+
+    // The table `key` of `parent`, created when missing. A key holding an
+    // array of tables resolves to its last table.
+    RuntimeTable* child_table(RuntimeTable& parent, std::string_view key) {
+        if (const RuntimeValue* existing = parent.get(key)) {
+            if (existing->type == ValueType::Table) {
+                return const_cast<RuntimeTable*>(existing->table);
+            }
+            if (existing->type == ValueType::Array && existing->array && !existing->array->empty() &&
+                existing->array->back().type == ValueType::Table) {
+                return const_cast<RuntimeTable*>(existing->array->back().table);
+            }
+            return nullptr;  // A value, not a table
+        }
+        RuntimeValue value;
+        value.type = ValueType::Table;
+        value.table = new_table(key);
+        parent.set(key, value);
+        return const_cast<RuntimeTable*>(value.table);
+    }
+
+    // One key of a dotted key path: bare, "basic" or 'literal'
+    std::optional<std::string_view> parse_simple_key() {
+        skip_spaces();
+        if (peek() == '"' || peek() == '\'') {
+            return parse_string();
+        }
+        size_t start = pos;
+        while (is_bare_key_char(peek())) {
+            ++pos;
+        }
+        if (pos == start) {
+            return std::nullopt;
+        }
+        return input.substr(start, pos - start);
+    }
+
+    // a.b.c: walks `table` to the table holding the last key, creating the
+    // intermediate tables, and returns that key
+    std::optional<std::string_view> parse_key_path(RuntimeTable*& table) {
+        auto key = parse_simple_key();
+        skip_spaces();
+        while (key && peek() == '.') {
+            ++pos;
+            table = child_table(*table, *key);
+            if (!table) {
+                return std::nullopt;
+            }
+            key = parse_simple_key();
+            skip_spaces();
+        }
+        return key;
+    }
+
+    // [a.b] or [[a.b]]
+    RuntimeTable* parse_table_header() {
+        ++pos;  // [
+        bool array_of_tables = peek() == '[';
+        if (array_of_tables) {
+            ++pos;
+        }
+        RuntimeTable* parent = &doc.root;
+        auto key = parse_key_path(parent);
+        if (!key || peek() != ']' || (array_of_tables && peek(1) != ']')) {
+            return nullptr;
+        }
+        pos += array_of_tables ? 2 : 1;
+
+        if (!array_of_tables) {
+            return child_table(*parent, *key);
+        }
+        const RuntimeValue* existing = parent->get(*key);
+        if (existing && existing->type != ValueType::Array) {
+            return nullptr;
+        }
+        std::vector<RuntimeValue>* array = existing ? const_cast<std::vector<RuntimeValue>*>(existing->array) : nullptr;
+        if (!array) {
+            array = &doc.arrays.emplace_back();
+            RuntimeValue value;
+            value.type = ValueType::Array;
+            value.array = array;
+            parent->set(*key, value);
+        }
+        RuntimeValue element;
+        element.type = ValueType::Table;
+        element.table = new_table(*key);
+        array->push_back(element);
+        return const_cast<RuntimeTable*>(element.table);
+    }
+
+    // key = value, with `key` relative to `table`
+    bool parse_key_value(RuntimeTable& table) {
+        RuntimeTable* target = &table;
+        auto key = parse_key_path(target);
+        if (!key || peek() != '=') {
+            return false;
+        }
+        ++pos;
+        auto value = parse_value();
+        if (!value) {
+            return false;
+        }
+        target->set(*key, *value);
+        return true;
+    }
+
+    std::optional<RuntimeValue> parse_value() {
+        skip_spaces();
+        RuntimeValue value;
+        char c = peek();
+        if (c == '"' || c == '\'') {
+            auto text = parse_string();
+            if (!text) {
+                return std::nullopt;
+            }
+            value.type = ValueType::String;
+            value.string_value = *text;
+        } else if (c == '[') {
+            return parse_array();
+        } else if (c == '{') {
+            return parse_inline_table();
+        } else if (input.substr(pos, 4) == "true") {
+            pos += 4;
+            value.type = ValueType::Boolean;
+            value.bool_value = true;
+        } else if (input.substr(pos, 5) == "false") {
+            pos += 5;
+            value.type = ValueType::Boolean;
+            value.bool_value = false;
+        } else {
+            return parse_number();
+        }
+        return value;
+    }
+
+    // Integers and floats, with optional sign and '_' separators. Anything
+    // else unquoted (dates, inf, nan) is not supported.
+    std::optional<RuntimeValue> parse_number() {
+        size_t start = pos;
+        std::string digits;
+        bool is_float = false;
+        while (pos < input.size()) {
+            char c = input[pos];
+            if ((c >= '0' && c <= '9') || c == '+' || c == '-') {
+                digits += c;
+            } else if (c == '.' || c == 'e' || c == 'E') {
+                is_float = true;
+                digits += c;
+            } else if (c != '_') {
+                break;
+            }
+            ++pos;
+        }
+        const char* first = digits.data() + (!digits.empty() && digits[0] == '+');
+        const char* last = digits.data() + digits.size();
+        RuntimeValue value;
+        std::from_chars_result result{};
+        if (is_float) {
+            value.type = ValueType::Float;
+            result = std::from_chars(first, last, value.float_value);
+        } else {
+            value.type = ValueType::Integer;
+            result = std::from_chars(first, last, value.int_value);
+        }
+        if (digits.empty() || result.ec != std::errc() || result.ptr != last) {
+            pos = start;
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    // [v, v, ...]: newlines, comments and a trailing comma are allowed
+    std::optional<RuntimeValue> parse_array() {
+        ++pos;  // [
+        std::vector<RuntimeValue>& array = doc.arrays.emplace_back();
+        for (;;) {
+            skip_blank();
+            if (peek() == ']') {
+                ++pos;
+                break;
+            }
+            auto element = parse_value();
+            if (!element) {
+                return std::nullopt;
+            }
+            array.push_back(*element);
+            skip_blank();
+            if (peek() == ',') {
+                ++pos;
+            } else if (peek() != ']') {
+                return std::nullopt;
+            }
+        }
+        RuntimeValue value;
+        value.type = ValueType::Array;
+        value.array = &array;
+        return value;
+    }
+
+    // { key = value, a.b = value }
+    std::optional<RuntimeValue> parse_inline_table() {
+        ++pos;  // {
+        RuntimeTable* table = new_table({});
+        skip_spaces();
+        if (peek() == '}') {
+            ++pos;
+        } else {
+            for (;;) {
+                if (!parse_key_value(*table)) {
+                    return std::nullopt;
+                }
+                skip_spaces();
+                if (peek() == ',') {
+                    ++pos;
+                } else if (peek() == '}') {
+                    ++pos;
+                    break;
+                } else {
+                    return std::nullopt;
+                }
+            }
+        }
+        RuntimeValue value;
+        value.type = ValueType::Table;
+        value.table = table;
+        return value;
+    }
+
+    // "basic", 'literal', and their """ / ''' multi-line forms. Strings
+    // without escapes are views into the source.
+    std::optional<std::string_view> parse_string() {
+        char quote = peek();
+        bool multiline = peek(1) == quote && peek(2) == quote;
+        size_t delimiter = multiline ? 3 : 1;
+        pos += delimiter;
+        if (multiline && peek() == '\n') {
+            ++pos;  // A newline right after the opening quotes is trimmed
+        } else if (multiline && peek() == '\r' && peek(1) == '\n') {
+            pos += 2;
+        }
+
+        size_t start = pos;
+        std::string* unescaped = nullptr;
+        for (;;) {
+            char c = peek();
+            if (c == '\0' || (!multiline && c == '\n')) {
+                return std::nullopt;
+            }
+            if (c == quote && (!multiline || (peek(1) == quote && peek(2) == quote))) {
+                break;
+            }
+            if (c == '\\' && quote == '"') {
+                if (!unescaped) {
+                    unescaped = &doc.decoded.emplace_back(input.substr(start, pos - start));
+                }
+                ++pos;
+                if (!append_escape(*unescaped, multiline)) {
+                    return std::nullopt;
+                }
+                continue;
+            }
+            if (unescaped) {
+                *unescaped += c;
+            }
+            ++pos;
+        }
+        std::string_view result = unescaped ? std::string_view(*unescaped) : input.substr(start, pos - start);
+        pos += delimiter;
+        return result;
+    }
+
+    // The escape after a backslash (already consumed)
+    bool append_escape(std::string& out, bool multiline) {
+        char c = peek();
+        ++pos;
+        switch (c) {
+            case 'n': out += '\n'; return true;
+            case 't': out += '\t'; return true;
+            case 'r': out += '\r'; return true;
+            case 'b': out += '\b'; return true;
+            case 'f': out += '\f'; return true;
+            case 'e': out += '\x1b'; return true;
+            case '"': out += '"'; return true;
+            case '\\': out += '\\'; return true;
+            case 'u': return append_code_point(out, 4);
+            case 'U': return append_code_point(out, 8);
+            default: break;
+        }
+        // A backslash ending a line of a multi-line string joins the lines
+        if (multiline && (c == '\n' || c == ' ' || c == '\t' || c == '\r')) {
+            --pos;
+            skip_whitespace();
+            return true;
+        }
+        return false;
+    }
+
+    void skip_whitespace() {
+        while (peek() == ' ' || peek() == '\t' || peek() == '\r' || peek() == '\n') {
+            ++pos;
+        }
+    }
+
+    // \uXXXX / \UXXXXXXXX, written as UTF-8
+    bool append_code_point(std::string& out, size_t digits) {
+        uint32_t cp = 0;
+        auto [end, ec] = std::from_chars(input.data() + pos, input.data() + std::min(pos + digits, input.size()), cp, 16);
+        if (ec != std::errc() || end != input.data() + pos + digits || cp > 0x10FFFF) {
+            return false;
+        }
+        pos += digits;
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        return true;
+    }
+
+public:
+    // Parse `text` into a new document that owns it
+    static RuntimeDocument parse(std::string text) {
+        RuntimeDocument doc;
+        doc.text = std::make_unique<const std::string>(std::move(text));
+        RuntimeParser(doc).parse_document();
+        return doc;
+    }
+};
+
+// Parse TOML read at runtime; the document keeps its own copy of the text
+inline RuntimeDocument parse_runtime(std::string text) {
+    return RuntimeParser::parse(std::move(text));
+}
+
 } // namespace forma::toml